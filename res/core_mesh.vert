@@ -0,0 +1,27 @@
+#version 330 core
+
+#include "frame_constants.glsl"
+
+uniform mat4 modelMatrix;
+
+// The locations match the VERTEX_ATTRIBUTE_* constants in render/meshprogram.h.
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec4 colour;
+layout(location = 3) in vec2 textureCoord;
+
+out vec4 vertexColour;
+out vec2 vertexTextureCoord;
+out vec3 worldPosition;
+out vec3 worldNormal;
+
+void main()
+{
+	vec4 world = modelMatrix * vec4(position, 1.0);
+	gl_Position = viewProjection * world;
+	worldPosition = world.xyz;
+	// Models are only scaled uniformly, so the normals need no inverse transpose.
+	worldNormal = mat3(modelMatrix) * normal;
+	vertexColour = colour;
+	vertexTextureCoord = textureCoord;
+}
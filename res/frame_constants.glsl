@@ -0,0 +1,10 @@
+// Shared by every program and updated once per frame, see render/uniformblocks.h. The members must match the
+// FrameConstants struct there.
+layout(std140) uniform FrameConstants
+{
+	mat4 viewProjection;
+	vec4 cameraPosition;
+	vec4 wind;
+	vec4 time;
+	vec4 lightClusters;
+};
@@ -1,9 +1,17 @@
-#version 110
+#version 330 core
 
-uniform sampler2D texture1; 
+uniform sampler2D texture1;
 
-void main() 
+in vec2 vertexTextureCoord;
+
+out vec4 fragmentColour;
+
+void main()
 {
-    gl_FragColor = texture2D(texture1, gl_TexCoord[0].st); 
-  
+	fragmentColour = texture(texture1, vertexTextureCoord);
+	// Grass is always alpha tested at 0.1, like the fixed function path.
+	if(fragmentColour.a <= 0.1)
+	{
+		discard;
+	}
 }
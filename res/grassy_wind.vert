@@ -1,18 +1,35 @@
-#version 120
+#version 330 core
 
-uniform vec3 windDirection;
-uniform float windPower;
+#include "frame_constants.glsl"
 
-void main() 
+uniform vec3 fieldCenter;
+uniform vec3 fieldExtent;
+
+// The locations match the VERTEX_ATTRIBUTE_* constants in render/meshprogram.h.
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec4 colour;
+layout(location = 3) in vec2 textureCoord;
+// Per instance: the cluster position in [-1, 1] relative to the grass field, and a (seed, scale) pair in [0, 1].
+layout(location = 4) in vec3 instancePosition;
+layout(location = 5) in vec2 instanceVariation;
+
+out vec2 vertexTextureCoord;
+
+void main()
 {
-	vec4 temp = gl_Vertex;
+	float angle = instanceVariation.x * 6.2831853;
+	float s = sin(angle);
+	float c = cos(angle);
+	float scale = 0.75 + instanceVariation.y * 0.5;
 
-	if(gl_Color.x < 0.1f || gl_Color.y < 0.1f || gl_Color.z < 0.1f)
+	vec4 temp = vec4(c * position.x + s * position.z, position.y, c * position.z - s * position.x, 1.0);
+	temp.xyz = temp.xyz * scale + fieldCenter + instancePosition * fieldExtent;
+
+	if(colour.x < 0.1 || colour.y < 0.1 || colour.z < 0.1)
 	{
-		temp += vec4(windDirection.x * windPower, windDirection.y * windPower, windDirection.z * windPower, 0.0f);
+		temp.xyz += wind.xyz * wind.w * (0.8 + 0.4 * instanceVariation.x);
 	}
 
-	gl_Position = gl_ModelViewProjectionMatrix * temp; //Transform the vertex position
-    	gl_TexCoord[0] = gl_MultiTexCoord0;
-
+	gl_Position = viewProjection * temp; //Transform the vertex position
+	vertexTextureCoord = textureCoord;
 }
@@ -0,0 +1,27 @@
+#version 330 core
+
+#include "frame_constants.glsl"
+#include "lighting.glsl"
+
+uniform sampler2D texture1;
+uniform bool useTexture;
+// Replaces the fixed function alpha test: fragments with alpha at or below this are discarded.
+uniform float alphaThreshold;
+
+in vec4 vertexColour;
+in vec2 vertexTextureCoord;
+in vec3 worldPosition;
+in vec3 worldNormal;
+
+out vec4 fragmentColour;
+
+void main()
+{
+	vec4 colour = useTexture ? texture(texture1, vertexTextureCoord) * vertexColour : vertexColour;
+	if(colour.a <= alphaThreshold)
+	{
+		discard;
+	}
+	colour.rgb += colour.rgb * getLighting(worldPosition, worldNormal);
+	fragmentColour = colour;
+}
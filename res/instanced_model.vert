@@ -0,0 +1,27 @@
+#version 330 core
+
+#include "frame_constants.glsl"
+
+// The locations match the VERTEX_ATTRIBUTE_* constants in render/meshprogram.h.
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec4 colour;
+layout(location = 3) in vec2 textureCoord;
+// One model-to-world matrix per instance, supplied with a vertex attribute divisor of 1.
+layout(location = 4) in mat4 instanceTransform;
+
+out vec4 vertexColour;
+out vec2 vertexTextureCoord;
+out vec3 worldPosition;
+out vec3 worldNormal;
+
+void main()
+{
+	vec4 world = instanceTransform * vec4(position, 1.0);
+	gl_Position = viewProjection * world;
+	worldPosition = world.xyz;
+	// Models are only scaled uniformly, so the normals need no inverse transpose.
+	worldNormal = mat3(instanceTransform) * normal;
+	vertexColour = colour;
+	vertexTextureCoord = textureCoord;
+}
@@ -0,0 +1,77 @@
+// The scene's lights and the clusters they were sorted into on the CPU, see render/lightmanager.h. Include it after
+// frame_constants.glsl. The sizes must match render/uniformblocks.h and render/lightclusters.h.
+const int MAX_POINT_LIGHTS = 128;
+const int MAX_DIRECTION_LIGHTS = 4;
+const int LIGHT_CLUSTERS_X = 16;
+const int LIGHT_CLUSTERS_Y = 9;
+const int LIGHT_CLUSTERS_Z = 24;
+
+struct PointLight
+{
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	// The position in world space in xyz, and the radius the light reaches in w.
+	vec4 position;
+};
+
+struct DirectionLight
+{
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	vec4 direction;
+};
+
+layout(std140) uniform LightList
+{
+	ivec4 lightCounts;
+	PointLight pointLights[MAX_POINT_LIGHTS];
+	DirectionLight directionLights[MAX_DIRECTION_LIGHTS];
+};
+
+// Each cluster's first light and light count, followed by the light indices. Bound to LIGHT_CLUSTER_TEXTURE_UNIT.
+uniform usamplerBuffer lightClusterData;
+
+// How strongly light arriving along a direction falls on a surface. Meshes without normals are lit head on.
+float getFacing(vec3 normal, vec3 lightDirection)
+{
+	return (dot(normal, normal) > 0.0) ? max(dot(normalize(normal), lightDirection), 0.0) : 1.0;
+}
+
+// Sums the light reaching a fragment, to be added on top of its unlit colour. Only the point lights assigned to the
+// fragment's cluster are visited.
+vec3 getLighting(vec3 worldPosition, vec3 normal)
+{
+	vec3 light = vec3(0.0);
+	for (int i = 0; i < lightCounts.y; i++)
+	{
+		light += directionLights[i].ambient.rgb +
+			directionLights[i].diffuse.rgb * getFacing(normal, -normalize(directionLights[i].direction.xyz));
+	}
+	// The clusters have not been built, such as when buffer textures are unsupported.
+	if (lightClusters.z <= 0.0)
+	{
+		return light;
+	}
+	// With a perspective projection, clip space w is the view space depth.
+	float viewDepth = 1.0 / gl_FragCoord.w;
+	int x = clamp(int(gl_FragCoord.x * lightClusters.z), 0, LIGHT_CLUSTERS_X - 1);
+	int y = clamp(int(gl_FragCoord.y * lightClusters.w), 0, LIGHT_CLUSTERS_Y - 1);
+	int z = clamp(int(floor(log(viewDepth) * lightClusters.x + lightClusters.y)), 0, LIGHT_CLUSTERS_Z - 1);
+	int cluster = x + LIGHT_CLUSTERS_X * (y + LIGHT_CLUSTERS_Y * z);
+	int first = 2 * LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z + int(texelFetch(lightClusterData, 2 * cluster).r);
+	int count = int(texelFetch(lightClusterData, 2 * cluster + 1).r);
+	for (int i = 0; i < count; i++)
+	{
+		PointLight pointLight = pointLights[texelFetch(lightClusterData, first + i).r];
+		vec3 toLight = pointLight.position.xyz - worldPosition;
+		float distance = length(toLight);
+		// Falls smoothly to nothing at the light's radius, so it never reaches past the clusters it was put in.
+		float falloff = clamp(1.0 - distance / pointLight.position.w, 0.0, 1.0);
+		falloff *= falloff;
+		vec3 lightDirection = (distance > 0.0) ? toLight / distance : vec3(0.0, 1.0, 0.0);
+		light += (pointLight.ambient.rgb + pointLight.diffuse.rgb * getFacing(normal, lightDirection)) * falloff;
+	}
+	return light;
+}
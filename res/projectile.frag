@@ -0,0 +1,10 @@
+#version 330 core
+
+in vec4 vertexColour;
+
+out vec4 fragmentColour;
+
+void main()
+{
+	fragmentColour = vertexColour;
+}
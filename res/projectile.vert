@@ -0,0 +1,17 @@
+#version 330 core
+
+#include "frame_constants.glsl"
+
+// The locations match the VERTEX_ATTRIBUTE_* constants in render/meshprogram.h.
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec4 colour;
+// The centre of each projectile in xyz and its radius in w, supplied with a vertex attribute divisor of 1.
+layout(location = 4) in vec4 instanceSphere;
+
+out vec4 vertexColour;
+
+void main()
+{
+	gl_Position = viewProjection * vec4(instanceSphere.xyz + position * instanceSphere.w, 1.0);
+	vertexColour = colour;
+}
@@ -1,9 +1,11 @@
 ﻿
 #include <glbinding/gl/gl.h>
+#include <glm/gtc/matrix_transform.hpp>
 #include "math/gamemath.h"
 #include "graphics/gluhelper.h"
 #include "enemy.h"
 #include "render/render.h"
+#include "render/matrixstack.h"
 
 /**
 * Creates a new Entity and assigns it the provided entityID, model, and camera.
@@ -84,12 +86,16 @@ void Enemy::onGameTick(Player &player, float deltaTime, AABB &worldBounds)
 
 void Enemy::draw(Camera *cam)
 {
-	using namespace gl;
-	glMatrixMode(GL_MODELVIEW);
-	glPushMatrix();
-	glTranslatef(getX(), getY(), getZ());
-	glScalef(0.2, 0.2, 0.2);
-	glRotatef(toDeg(getRotation().y), 0, 1, 0);
+	MatrixStack &modelMatrices = getModelMatrixStack();
+	modelMatrices.push();
+	modelMatrices.multiply(getTransform());
 	model->draw(cam);
-	glPopMatrix();
+	modelMatrices.pop();
+}
+
+glm::mat4 Enemy::getTransform()
+{
+	glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(getX(), getY(), getZ()));
+	transform = glm::scale(transform, glm::vec3(0.2f, 0.2f, 0.2f));
+	return glm::rotate(transform, getRotation().y, glm::vec3(0, 1, 0));
 }
\ No newline at end of file
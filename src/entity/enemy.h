@@ -25,6 +25,8 @@ class Enemy : public Entity
 public:
 	AIState state = AIState::IDLE;
 	float speedModifier;
+	/** The level of detail this enemy was last drawn at. */
+	int lodLevel = 0;
 	/**
 	* Creates a new Entity and assigns it the provided entityID, model, and camera.
 	* @param entityID an int which must uniquely identify this Entity. It is suggested that this
@@ -36,5 +38,10 @@ public:
 	~Enemy();
 	void onGameTick(Player &player, float deltaTime, AABB &worldBounds);
 	void draw(Camera* cam);
+	/**
+	 * Gets the model-to-world matrix used to draw this enemy. This is equivalent to the translation, scale and rotation
+	 * applied by draw(...).
+	 */
+	glm::mat4 getTransform();
 };
 #endif
@@ -8,8 +8,7 @@
  * @param model a Model that will be used for this entity
  * @param camera a Camera that will be used for this entity
  */
-Projectile::Projectile(Camera camera, float size) : Entity(std::shared_ptr<Model>(nullptr), camera), size(size), boundingSphere(AABS(camera.getPosition(), size)),
-	sphere(Sphere(size, 12, 24))
+Projectile::Projectile(Camera camera, float size) : Entity(std::shared_ptr<Model>(nullptr), camera), size(size), boundingSphere(AABS(camera.getPosition(), size))
 {
 	maxMoveSpeed = (10000.0f);
 }
@@ -26,10 +25,9 @@ void Projectile::onGameTick(float deltaTime)
 	this->boundingSphere.moveTo(pos.x, pos.y, pos.z);
 }
 
-void Projectile::draw()
+void Projectile::draw(ProjectileRenderer &renderer)
 {
-	auto pos = getPosition();
-	sphere.draw(pos.x, pos.y, pos.z);
+	renderer.add(getPosition(), boundingSphere.radius);
 }
 
 void Projectile::move(float deltaTime)
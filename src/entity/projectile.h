@@ -7,7 +7,7 @@
 #include "physics/aabs.h"
 #include "graphics/camera.h"
 #include "graphics/model.h"
-#include "render/sphere.h"
+#include "render/projectilerenderer.h"
 #include "entity.h"
 #include "math/linesegment3.h"
 
@@ -29,13 +29,15 @@ public:
 	 */
 	Projectile(Camera camera, float size = 0);
 	~Projectile();
-	void draw();
+	/**
+	 * Queues this Projectile to be drawn as a sphere of its bounding radius.
+	 * @param renderer the ProjectileRenderer that draws every projectile of the frame
+	 */
+	void draw(ProjectileRenderer &renderer);
 	void onGameTick(float deltaTime);
 	void move(float deltaTime);
 	LineSegment3 getMovement();
 
-protected:
-	Sphere sphere;
 };
 
 inline bool operator==(const Projectile& one, const Projectile& two)
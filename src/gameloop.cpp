@@ -37,6 +37,21 @@
 #include "entity/player.h"
 #include "render/menu.h"
 #include "entity/grid.h"
+#include "render/glstate.h"
+#include "render/glcallstats.h"
+#include "render/instancedrenderer.h"
+#include "render/staticmeshbuffer.h"
+#include "render/projectilerenderer.h"
+#include "render/textureresidency.h"
+#include "render/spritebatch.h"
+#include "render/uniformblocks.h"
+#include "render/lightmanager.h"
+#include "render/matrixstack.h"
+#include "math/frustum.h"
+#include "utils/textformat.h"
+
+/** How far the light of a muzzle flash reaches. */
+static const float MUZZLE_FLASH_RADIUS = 8.0f;
 
 ///***********************************************************************
 ///***********************************************************************
@@ -47,6 +62,7 @@
 /// Initialization functions
 ///
 void initializeEngine();
+void shutdownEngine();
 ///
 /// Input functions
 ///
@@ -87,6 +103,10 @@ public:
 	Level();
 	virtual void createLevel() = 0;
 	virtual void update(float deltaTime) = 0;
+	/**
+	 * Draws the level's own geometry and queues its models on the model renderer. The caller draws the queue, so
+	 * every model in the frame is submitted together.
+	 */
 	virtual void draw(Camera *cam, float deltaTime) = 0;
 	virtual void drawTerrain(Camera *cam) = 0;
 };
@@ -134,6 +154,10 @@ public:
 	std::shared_ptr<Model> gunModel;
 	std::shared_ptr<Model> zombieModel;
 	std::shared_ptr<Model> zombieModel2;
+	/** Draws trees and enemies with one instanced draw call per model mesh. */
+	InstancedModelRenderer modelRenderer;
+	ProjectileRenderer projectileRenderer;
+	SpriteBatch spriteBatch;
 	std::shared_ptr<GLFont> fontRenderer;
 	unsigned long long previousFrameTime;
 	float deltaTime;
@@ -162,7 +186,9 @@ public:
 	std::shared_ptr<Texture> gameOverTexture;
 	std::shared_ptr<Menu> mainMenu;
 	std::shared_ptr<Texture> terrainTextureGrass;
-	std::shared_ptr<Texture> terrainTextureSand;	
+	std::shared_ptr<Texture> terrainTextureSand;
+	/** The grass blade texture. It is held here so restarting the forest level doesn't reload it. */
+	std::shared_ptr<Texture> grassTexture;
 	std::shared_ptr<Level> activeLevel;
 	float volume;
 
@@ -215,6 +241,16 @@ void ERRCHECK(FMOD_RESULT result)
 	}
 }
 
+///
+/// Releases the GL objects that live outside the game objects. GLUT calls this when the window closes, while the
+/// context still exists, which is not true of static destructors at exit.
+///
+void shutdownEngine()
+{
+	releaseUniformBlocks();
+	releaseStaticMeshBuffer();
+}
+
 void initializeEngine()
 {
     using namespace gl;    
@@ -322,37 +358,27 @@ GameLoop::~GameLoop()
 void GameLoop::loadModels()
 {
 	// Load the tree model
-	ObjParser parser(
-		buildPath("res/models/pine_tree1/"), buildPath("res/models/pine_tree1/Tree.obj"),
-		"Branches0018_1_S.png", false);
-	gameLoopObject.treeModel = parser.exportModel();
-	auto treeTexture = getTexture(buildPath("res/models/pine_tree1/BarkDecidious0107_M.jpg"));
-	auto branchTexture = getTexture(buildPath("res/models/pine_tree1/Branches0018_1_S.png"));
+	gameLoopObject.treeModel = loadModel(buildPath("res/models/pine_tree1/"), buildPath("res/models/pine_tree1/Tree.obj"), false);
+	auto treeTexture = getStreamedTexture(buildPath("res/models/pine_tree1/BarkDecidious0107_M.jpg"));
+	auto branchTexture = getStreamedTexture(buildPath("res/models/pine_tree1/Branches0018_1_S.png"));
 	std::map<std::string, std::shared_ptr<Texture>> textures;
 	textures["tree"] = treeTexture;
 	textures["leaves"] = branchTexture;
 	gameLoopObject.treeModel->createVBOs(textures);
 
 	// Load the gun model
-	parser = ObjParser(
-		buildPath("res/models/gun/"), buildPath("res/models/gun/M9.obj"),
-		"", true);
-	gameLoopObject.gunModel = parser.exportModel();
+	gameLoopObject.gunModel = loadModel(buildPath("res/models/gun/"), buildPath("res/models/gun/M9.obj"), true);
 	auto Handgun_D = getTexture(buildPath("res/models/gun/Tex_0009_1.jpg"));
 	gameLoopObject.gunTexture = Handgun_D;
 	textures = std::map<std::string, std::shared_ptr<Texture>>();
 	textures["Tex_0009_1"] = Handgun_D;
+	gameLoopObject.gunModel->overrideTexture = Handgun_D;
 	gameLoopObject.gunModel->createVBOs(textures);
-	for (std::shared_ptr<VBO> vbo : gameLoopObject.gunModel->vbos)
-	{
-		vbo->associatedTexture = Handgun_D;
-	}
 	gameLoopObject.gunModel->generateAABB();
 
 	// Load the zombie
-	parser = ObjParser(buildPath("res/models/zombie/"), buildPath("res/models/zombie/Lambent_Male.obj"), "", true);
-	gameLoopObject.zombieModel = parser.exportModel();
-	auto _D = getTexture(buildPath("res/models/zombie/Lambent_Male_D.png"));
+	gameLoopObject.zombieModel = loadModel(buildPath("res/models/zombie/"), buildPath("res/models/zombie/Lambent_Male.obj"), true);
+	auto _D = getStreamedTexture(buildPath("res/models/zombie/Lambent_Male_D.png"));
 	auto _E = getTexture(buildPath("res/models/zombie/Lambent_Male_E.tga"));
 	auto _N = getTexture(buildPath("res/models/zombie/Lambent_Male_N.tga"));
 	auto _S = getTexture(buildPath("res/models/zombie/Lambent_Male_S.tga"));
@@ -361,25 +387,31 @@ void GameLoop::loadModels()
 	textures["Lambent_Male_E.tga"] = _E;
 	textures["Lambent_Male_N.tga"] = _N;
 	textures["Lambent_Male_S.tga"] = _S;
+	gameLoopObject.zombieModel->overrideTexture = _D;
 	gameLoopObject.zombieModel->createVBOs(textures);
-	for (std::shared_ptr<VBO> vbo : gameLoopObject.zombieModel->vbos)
-	{
-		vbo->associatedTexture = _D;
-	}
 	gameLoopObject.zombieModel->generateAABB();
 
 	// Load the second zombie
-	parser = ObjParser(buildPath("res/models/zombie2/"), buildPath("res/models/zombie2/Lambent_Female.obj"), "", true);
-	gameLoopObject.zombieModel2 = parser.exportModel();
-	auto __D = getTexture(buildPath("res/models/zombie2/Lambent_Female_D.png"));
+	gameLoopObject.zombieModel2 = loadModel(buildPath("res/models/zombie2/"), buildPath("res/models/zombie2/Lambent_Female.obj"), true);
+	auto __D = getStreamedTexture(buildPath("res/models/zombie2/Lambent_Female_D.png"));
 	textures = std::map<std::string, std::shared_ptr<Texture>>();
 	textures["Lambent_Female_D.tga"] = __D;
+	gameLoopObject.zombieModel2->overrideTexture = __D;
 	gameLoopObject.zombieModel2->createVBOs(textures);
-	for (std::shared_ptr<VBO> vbo : gameLoopObject.zombieModel2->vbos)
-	{
-		vbo->associatedTexture = __D;
-	}
 	gameLoopObject.zombieModel2->generateAABB();
+
+	// Pack the projectile sphere now, so it is uploaded to the static mesh buffer with the models.
+	getUnitSphereMesh();
+}
+
+static void logResourceCacheStatistics()
+{
+	ResourceCacheStatistics textures = getTextureCacheStatistics();
+	ResourceCacheStatistics models = getModelCacheStatistics();
+	std::cout << "Texture cache: " << textures.hits << " hits, " << textures.misses << " misses, " << textures.liveResources
+		<< " live. Model cache: " << models.hits << " hits, " << models.misses << " misses, " << models.liveResources
+		<< " live." << std::endl;
+	logTextureResidency();
 }
 
 void GameLoop::loadWithGLContext()
@@ -389,7 +421,8 @@ void GameLoop::loadWithGLContext()
 	desertSkyboxTexture = getTexture(buildPath("res/skybox_desert.png"));
 	skyboxTexture = getTexture(buildPath("res/skybox_texture.jpg"));
 	terrainTextureGrass = getTexture(buildPath("res/grass1.png"));
-	terrainTextureSand = getTexture(buildPath("res/sand1.png"));	
+	terrainTextureSand = getTexture(buildPath("res/sand1.png"));
+	grassTexture = getTexture(buildPath("res/grass_1.png"));
 	logo = getTexture(buildPath("res/logo.png"));
 	gameOverTexture = getTexture(buildPath("res/game_over.png"));
 	sliderTexture = getTexture(buildPath("res/volume.png"));
@@ -412,6 +445,7 @@ void GameLoop::loadWithGLContext()
 			{
 				*activeLevel = std::shared_ptr<Level>(new DesertLevel());
 				(*activeLevel)->createLevel();
+				logResourceCacheStatistics();
 			}
 		},
 		[activeLevel](){
@@ -420,6 +454,7 @@ void GameLoop::loadWithGLContext()
 			{
 				*activeLevel = std::shared_ptr<Level>(new ForestLevel());
 				(*activeLevel)->createLevel();
+				logResourceCacheStatistics();
 			}
 		},
 		[backButtonTexture, helpTexture](){
@@ -441,17 +476,12 @@ void GameLoop::loadWithGLContext()
 
 bool GameLoop::drawString(std::string val, float x, float y, float z, Colour colour)
 {
-    using namespace gl;
     try
     {
-        glEnable(GL_TEXTURE_2D);
-        gl::glColor4f(colour.r, colour.g, colour.b, colour.a);
-        glDisable(GL_BLEND);
-        glAlphaFunc(GL_GREATER, 0.1f);
-        glEnable(GL_ALPHA_TEST);
-		std::stringstream ss;
-		ss << "score:" << player.score;
-        fontRenderer->TextOut(ss.str(), 20, 20, 0);
+        // Queued on the sprite batch, which is flushed at the end of the 2D pass.
+		char text[32];
+		size_t length = formatInteger(text, sizeof(text), "score:", player.score);
+        fontRenderer->TextOut(spriteBatch, text, length, 20, 20, colour);
         return true;
     }
     catch(GLFontError::InvalidFont)
@@ -639,9 +669,8 @@ void ForestLevel::createLevel()
 	std::shared_ptr<Terrain> terrain(new FlatTerrain(200));
 	worldBounds = AABB(-100, 0, -100, 60, 50, 60);
 	auto tex = getTexture(buildPath("res/grass1.png"));
-	auto terrainExp = terrain->exportToTerrainData();
 	this->terrainRenderer = std::shared_ptr<TerrainRenderer>(new TerrainRenderer());
-	this->terrainRenderer->create(terrainExp, tex);
+	this->terrainRenderer->create(terrain, tex);
 	// Create the grass
 	auto grassTexture = getTexture(buildPath("res/grass_1.png"));
 	int grassDensity = (getRandomInt(1000) + 300) * 7;
@@ -714,56 +743,31 @@ void ForestLevel::drawTerrain(Camera *cam)
 void ForestLevel::draw(Camera* cam, float deltaTime)
 {
 	using namespace gl;
-	/// tree
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_NORMAL_ARRAY);
-	glEnableClientState(GL_COLOR_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-	glDisable(GL_BLEND);
-	glAlphaFunc(GL_GREATER, 0.1f);
-	glEnable(GL_ALPHA_TEST);
+	setClientArrays(true, true, true, true);
+
+	disableState(GL_BLEND);
+	setAlphaFunc(GL_GREATER, 0.1f);
+	enableState(GL_ALPHA_TEST);
 	gl::glLoadIdentity();
-	glEnable(GL_TEXTURE_2D);
+	enableState(GL_TEXTURE_2D);
 	setLookAt(cam);
-	glDisable(GL_CULL_FACE);
-	glEnable(GL_DEPTH_TEST);
+	disableState(GL_CULL_FACE);
+	enableState(GL_DEPTH_TEST);
+	// queue trees
 	for (Tree &tree : trees)
 	{
-		tree.draw(cam);
+		gameLoopObject.modelRenderer.add(tree.treeModel, tree.getTransform(), cam, tree.lodLevel);
 	}
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_NORMAL_ARRAY);
-	glDisableClientState(GL_COLOR_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	/// end tree
 		
+	setGLCallSection(GLCallSection::GRASS);
 	grass->draw(cam);
+	setGLCallSection(GLCallSection::OTHER);
 
-	// draw enemies
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_NORMAL_ARRAY);
-	glEnableClientState(GL_COLOR_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-	glDisable(GL_BLEND);
-	glAlphaFunc(GL_GREATER, 0.1f);
-	glEnable(GL_ALPHA_TEST);
-	glLoadIdentity();
-	glEnable(GL_TEXTURE_2D);
-	setLookAt(cam);
-	glDisable(GL_CULL_FACE);
-	glEnable(GL_DEPTH_TEST);
-	for (std::shared_ptr<Enemy> enemy : enemies)
+	// queue enemies
+	for (std::shared_ptr<Enemy> &enemy : enemies)
 	{
-		enemy->draw(cam);
+		gameLoopObject.modelRenderer.add(enemy->getModel(), enemy->getTransform(), cam, enemy->lodLevel);
 	}
-
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_NORMAL_ARRAY);
-	glDisableClientState(GL_COLOR_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	// End draw enemies
 }
 
 DesertLevel::DesertLevel() : Level()
@@ -782,9 +786,8 @@ void DesertLevel::createLevel()
 	std::shared_ptr<Terrain> terrain(new FlatTerrain(200));
 	worldBounds = AABB(-100, 0, -100, 60, 50, 60);
 	auto tex = getTexture(buildPath("res/sand1.png"));
-	auto terrainExp = terrain->exportToTerrainData();
 	this->terrainRenderer = std::shared_ptr<TerrainRenderer>(new TerrainRenderer());
-	this->terrainRenderer->create(terrainExp, tex);
+	this->terrainRenderer->create(terrain, tex);
 	gameLoopObject.projectiles.clear();
 	gameLoopObject.player.reset();
 }
@@ -812,36 +815,33 @@ void DesertLevel::update(float deltaTime)
 
 void DesertLevel::draw(Camera* cam, float deltaTime)
 {
-	using namespace gl;
-	// draw enemies
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_NORMAL_ARRAY);
-	glEnableClientState(GL_COLOR_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-	glDisable(GL_BLEND);
-	glAlphaFunc(GL_GREATER, 0.1f);
-	glEnable(GL_ALPHA_TEST);
-	glLoadIdentity();
-	glEnable(GL_TEXTURE_2D);
-	setLookAt(cam);
-	glDisable(GL_CULL_FACE);
-	glEnable(GL_DEPTH_TEST);
-	for (std::shared_ptr<Enemy> enemy : enemies)
+	// queue enemies
+	for (std::shared_ptr<Enemy> &enemy : enemies)
 	{
-		enemy->draw(cam);
+		gameLoopObject.modelRenderer.add(enemy->getModel(), enemy->getTransform(), cam, enemy->lodLevel);
 	}
-
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_NORMAL_ARRAY);
-	glDisableClientState(GL_COLOR_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	// End draw enemies
 }
 
 ///***********************************************************************
 ///***********************************************************************
 /// Define Gameloop/render functions.
+/**
+ * Fills in and uploads the uniform block values shared by every shader this frame. The wind is set by the level's
+ * grass when it updates.
+ */
+static void updateFrameConstants(Camera *cam)
+{
+	static unsigned long long startTime = getCurrentTimeMillis();
+	FrameConstants &frame = getFrameConstants();
+	glm::mat4 view = createViewMatrix(cam);
+	frame.viewProjection = createProjectionMatrix(getAspectRatio()) * view;
+	frame.cameraPosition = glm::vec4(cam->position, 1.0f);
+	frame.time = glm::vec4(static_cast<float>(getCurrentTimeMillis() - startTime) / 1000.0f, 0.0f, 0.0f, 0.0f);
+	updateLightClusters(view, getAspectRatio());
+	uploadUniformBlocks();
+	clearTransientLights();
+}
+
 ///***********************************************************************
 ///***********************************************************************
 
@@ -855,10 +855,12 @@ void gameUpdateTick()
 		// Draw the menu
 		startRenderCycle();
 		start2DRenderCycle();
+		setGLCallSection(GLCallSection::UI);
 
 		std::shared_ptr<Menu> m = gameLoopObject.menus.top();
 		m->update(&gameLoopObject.mouseManager, deltaTime);
-		m->draw(deltaTime);
+		m->draw(gameLoopObject.spriteBatch, deltaTime);
+		gameLoopObject.spriteBatch.flush();
 		if (m->shouldPopThisMenu())
 		{
 			gameLoopObject.menus.pop();
@@ -876,20 +878,23 @@ void gameUpdateTick()
     //Draw here
     startRenderCycle();
 	glClearDepth(1.0f);
-	glEnable(GL_DEPTH_TEST);
+	enableState(GL_DEPTH_TEST);
 	glDepthFunc(GL_LEQUAL);
 
     Camera *cam = gameLoopObject.player.getCamera();
     startRenderCycle();
     start3DRenderCycle();
+	updateFrameConstants(cam);
 	//renderAxes(cam);
 	
+	setGLCallSection(GLCallSection::TERRAIN);
 	gameLoopObject.activeLevel->drawTerrain(cam);
 
-	glDisable(GL_CULL_FACE);
-	glEnable(GL_DEPTH_TEST);
+	setGLCallSection(GLCallSection::PROJECTILES);
+	disableState(GL_CULL_FACE);
+	enableState(GL_DEPTH_TEST);
 	glCullFace(GL_BACK);
-	glDisable(GL_TEXTURE_2D);
+	disableState(GL_TEXTURE_2D);
 	for (int i = 0; i < gameLoopObject.projectiles.size(); )
 	{
 		std::shared_ptr<Projectile> p = gameLoopObject.projectiles.at(i);
@@ -901,38 +906,38 @@ void gameUpdateTick()
 		}
 		else
 		{
-			p->draw();
+			p->draw(gameLoopObject.projectileRenderer);
 			i++;
 		}
 	}
+	gameLoopObject.projectileRenderer.draw();
 
 	glPopMatrix();
-	glEnable(GL_TEXTURE_2D);
+	enableState(GL_TEXTURE_2D);
 
+	setGLCallSection(GLCallSection::OTHER);
 	gameLoopObject.activeLevel->draw(cam, deltaTime);
 	    
-	// Draw the player's gun
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_NORMAL_ARRAY);
-	glEnableClientState(GL_COLOR_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-	glDisable(GL_BLEND);
-	glAlphaFunc(GL_GREATER, 0.1f);
-	glEnable(GL_ALPHA_TEST);	
+	// Draw the player's gun along with every model the level queued
+	setGLCallSection(GLCallSection::MODELS);
+	disableState(GL_BLEND);
+	setAlphaFunc(GL_GREATER, 0.1f);
+	enableState(GL_ALPHA_TEST);	
 	glMatrixMode(GL_MODELVIEW);
 	glPushMatrix();
 	glLoadIdentity();
 	setLookAt(cam);
-	glDisable(GL_CULL_FACE);
-	glEnable(GL_DEPTH_TEST);
+	disableState(GL_CULL_FACE);
+	enableState(GL_DEPTH_TEST);
 	glm::vec3 lookAt = glm::normalize(glm::vec3(
 		+ sin(cam->rotation.y),
 		- sin(cam->rotation.x),
 		- cos(cam->rotation.y)
 	));
 	glm::vec3 offset = lookAt;
-	glTranslatef(cam->position.x + offset.x, cam->position.y + offset.y - 0.2f, cam->position.z + offset.z);
+	MatrixStack &modelMatrices = getModelMatrixStack();
+	modelMatrices.push();
+	modelMatrices.translate(cam->position.x + offset.x, cam->position.y + offset.y - 0.2f, cam->position.z + offset.z);
 	glm::vec3 forward(
 		cam->position.x + sin(cam->rotation.y),
 		cam->position.y - sin(cam->rotation.x),
@@ -940,19 +945,20 @@ void gameUpdateTick()
 		);
 	glm::vec3 up(0, cos(cam->rotation.x), 0);
 	glm::vec3 left = glm::cross(up, forward);
-	glRotatef(toDeg(-cam->rotation.y), 0, 1, 0);
-	glEnable(GL_TEXTURE_2D);
-	gameLoopObject.gunModel->draw(cam);	
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_NORMAL_ARRAY);
-	glDisableClientState(GL_COLOR_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	modelMatrices.rotate(-cam->rotation.y, glm::vec3(0, 1, 0));
+	enableState(GL_TEXTURE_2D);
+	gameLoopObject.modelRenderer.add(gameLoopObject.gunModel, modelMatrices.top());
+	modelMatrices.pop();
+	gameLoopObject.modelRenderer.draw(cam);
 	glPopMatrix();
-	// End gun draw
+	// End gun and model draw
 	end3DRenderCycle();
 
+	setGLCallSection(GLCallSection::UI);
     start2DRenderCycle();
-	drawUI(gameLoopObject.player, gameLoopObject.mouseManager, gameLoopObject.fontRenderer, gameLoopObject.ammoTexture, gameLoopObject.medkitTexture);
+	drawUI(gameLoopObject.spriteBatch, gameLoopObject.player, gameLoopObject.mouseManager, gameLoopObject.fontRenderer,
+		gameLoopObject.ammoTexture, gameLoopObject.medkitTexture);
+	gameLoopObject.spriteBatch.flush();
     end2DRenderCycle();
     endRenderCycle();
 	gameLoopObject.endOfTick();
@@ -979,6 +985,7 @@ void processKeyboardInput()
    
     if (manager->getKeyState('=') == KeyManager::PRESSED) // Escape key
 	{
+		shutdownEngine();
 		exit(0);
 	}
 
@@ -1145,6 +1152,14 @@ void processMouseInput()
 			projectile->accel(acceleration);
 			gameLoopObject.projectiles.push_back(projectile);
 
+			// Light the area around the barrel for a frame.
+			PointLight muzzleFlash;
+			muzzleFlash.ambient = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			muzzleFlash.diffuse = glm::vec4(1.0f, 0.8f, 0.4f, 1.0f);
+			muzzleFlash.specular = glm::vec4(1.0f, 0.9f, 0.6f, 1.0f);
+			muzzleFlash.position = glm::vec4(camera.position, MUZZLE_FLASH_RADIUS);
+			addTransientPointLight(muzzleFlash);
+
 			ERRCHECK(gameLoopObject.eventInstance->start());
 			gameLoopObject.player.ammoCount -= 1;
 		}
@@ -1159,6 +1174,15 @@ void entryCall(int argc, char **argv)
 {
     // init GLUT and create window
 	glutInit(&argc, argv);
+	// --gl-call-stats [file] writes per frame GL call counts to a CSV file, gl_call_stats.csv by default.
+	std::string callStatsPath;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--gl-call-stats")
+		{
+			callStatsPath = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[i + 1] : "gl_call_stats.csv";
+		}
+	}
     glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA);
 	glutInitWindowPosition(100,100);
 	glutInitWindowSize(800,640);
@@ -1167,6 +1191,7 @@ void entryCall(int argc, char **argv)
 	glutDisplayFunc(gameUpdateTick);
 	glutReshapeFunc(changeSize);
 	glutIdleFunc(gameUpdateTick);
+	glutCloseFunc(shutdownEngine);
 
 	glutKeyboardFunc(keyManagerKeyPressed);
 	glutKeyboardUpFunc(keyManagerKeyUp);
@@ -1181,6 +1206,10 @@ void entryCall(int argc, char **argv)
     glutPassiveMotionFunc(mouseManagerHandleMouseMovementWhileNotClicked);
     // load opengl functions beyond version 1.1
     glbinding::Binding::initialize(true);
+	if (!callStatsPath.empty())
+	{
+		enableGLCallStats(callStatsPath);
+	}
     // Initialize the engine.
     initializeEngine();
 	// enter GLUT event processing loop
@@ -12,9 +12,9 @@ Button::Button(std::shared_ptr<Texture> tex, double x, double y, double width, d
 /**
 * Draws the button, and fixes the position if the screen has been resized
 */
-void Button::draw()
+void Button::draw(SpriteBatch &batch)
 {
-	drawBackground();
+	drawBackground(batch);
 }
 
 void Button::update(MouseManager *manager)
@@ -1,5 +1,4 @@
 
-#include <glbinding/gl/gl.h>
 #include <vector>
 #include "windowhelper.h"
 #include "render/glfont.h"
@@ -38,9 +37,8 @@ bool ComponentBase::inBounds(int mouseX, int mouseY)
 * @param parentOffsetX a double which is how far the parent component offsets this component along the x axis
 * @param parentOffsetY a double which is how far the parent component offsets this component along the y axis
 */
-void ComponentBase::drawBackground()
+void ComponentBase::drawBackground(SpriteBatch &batch)
 {
-	using namespace gl;
 	float y = this->y;
 	if (y < 0)
 	{
@@ -48,17 +46,5 @@ void ComponentBase::drawBackground()
 	}
 
 	//Draw the background texture if there is one. 
-	glEnable(GL_TEXTURE_2D);
-	renderTexture->bind();
-	glColor4f(1, 1, 1, 1);
-	glBegin(GL_QUADS);
-		glVertex3d(x, y + height, 0);
-		glTexCoord2f(1, 0);
-		glVertex3d(x + width, y + height, 0);
-		glTexCoord2f(1, 1);
-		glVertex3d(x + width, y, 0);
-		glTexCoord2f(0, 1);
-		glVertex3d(x, y, 0);
-		glTexCoord2f(0, 0);
-	glEnd();
-}
\ No newline at end of file
+	batch.addQuad(renderTexture, x, y, x + width, y + height, 0, 1, 1, 0, WHITE);
+}
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <memory>
+#include "render/spritebatch.h"
 #include "render/texture.h"
 #include "gameloop.h"
 
@@ -43,8 +44,9 @@ public:
 	* the origin on the x axis. This value should be used when determining the position of the component.
 	* @param parentOffsetY a double value provided by the parent component which is their position relative to
 	* the origin on the y axis. This value should be used when determining the position of the component.
+	* @param batch the SpriteBatch of the pass the component is drawn in
 	*/
-	virtual void draw() = 0;
+	virtual void draw(SpriteBatch &batch) = 0;
 	/**
 	* Update is called when the frame's update method is called, which should be on every game tick. If a component needs periodically
 	* updated, it should do so using this method.
@@ -62,8 +64,9 @@ public:
 	* This may be overridden to do something different in each component.
 	* @param parentOffsetX a double which is how far the parent component offsets this component along the x axis
 	* @param parentOffsetY a double which is how far the parent component offsets this component along the y axis
+	* @param batch the SpriteBatch of the pass the component is drawn in
 	*/
-	void drawBackground();
+	void drawBackground(SpriteBatch &batch);
 };
 
 
@@ -1,8 +1,13 @@
 
+#include <algorithm>
 #include <cmath>
 #include <stdexcept>
+#include <glm/geometric.hpp>
 #include "model.h"
 #include "math/gamemath.h"
+#include "render/matrixstack.h"
+#include "render/meshprogram.h"
+#include "render/staticmeshbuffer.h"
 
 int getNextModelID()
 {
@@ -76,13 +81,29 @@ AABB Model::generateAABB()
  * @param data a ModelData object that can be used to construct this Model
  */
 Model::Model(std::vector<std::shared_ptr<MeshData>> data) : modelID(getNextModelID()), origin(glm::vec3(0, 0, 0)), rotationOnAxes(glm::vec3(0, 0, 0)),
-        data(data), aabb(generateAABB()), scale(glm::vec3(1.0f, 1.0f, 1.0f))
+        data(data), aabb(generateAABB()), scale(glm::vec3(1.0f, 1.0f, 1.0f)), boundingRadius(0.0f)
 {
+    for (auto mesh : data)
+    {
+        int positionOffset = mesh->vertexOffset / static_cast<int>(sizeof(float));
+        for (int i = positionOffset; i + 2 < mesh->combinedData.size(); i += mesh->elementsPerRowOfCombinedData)
+        {
+            glm::vec3 position(mesh->combinedData[i], mesh->combinedData[i + 1], mesh->combinedData[i + 2]);
+            boundingRadius = std::max(boundingRadius, glm::length(position));
+        }
+    }
 }
 
 Model::~Model()
 {
-
+    // Packed meshes are freed so reloading models does not grow the buffer. At shutdown it may already be gone.
+    if(!staticMeshIDs.empty() && hasStaticMeshBuffer())
+    {
+        for(int meshID : staticMeshIDs)
+        {
+            getStaticMeshBuffer().removeMesh(meshID);
+        }
+    }
 }
 
 /**
@@ -189,26 +210,83 @@ int Model::getID()
 
 void Model::createVBOs(std::map<std::string, std::shared_ptr<Texture>> textureMap)
 {
+    if(!meshTextures.empty())
+    {
+        return;
+    }
     for(unsigned int i = 0; i < data.size(); i++)
     {
         std::cout << ">" << data[i]->associatedTextureName << "<"<< std::endl;
-        if(overrideTexture)
+        meshTextures.push_back((overrideTexture) ? overrideTexture : textureMap[data[i]->associatedTextureName]);
+    }
+    if(isMultiDrawIndirectSupported())
+    {
+        StaticMeshBuffer &staticMeshes = getStaticMeshBuffer();
+        for(auto &mesh : data)
         {
-            vbos.push_back(std::shared_ptr<VBO>(new VBO(data[i], overrideTexture)));
+            int meshID = staticMeshes.addMesh(*mesh);
+            if(meshID < 0)
+            {
+                // Meshes already added stay in the buffer unused; the Model is drawn from its own VBOs.
+                staticMeshIDs.clear();
+                break;
+            }
+            staticMeshIDs.push_back(meshID);
         }
-        else
+        if(!staticMeshIDs.empty())
         {
-            vbos.push_back(std::shared_ptr<VBO>(new VBO(data[i], textureMap[data[i]->associatedTextureName])));
+            return;
         }
     }
+    for(unsigned int i = 0; i < data.size(); i++)
+    {
+        vbos.push_back(std::shared_ptr<VBO>(new VBO(data[i], meshTextures[i])));
+    }
 }
 
 void Model::draw(Camera *camera)
 {
+    using namespace gl;
     for(unsigned int i = 0; i < vbos.size(); i++)
     {
         vbos[i]->draw(camera);
     }
+    if(staticMeshIDs.empty())
+    {
+        return;
+    }
+    StaticMeshBuffer &staticMeshes = getStaticMeshBuffer();
+    staticMeshes.bind();
+    for(unsigned int i = 0; i < staticMeshIDs.size(); i++)
+    {
+        const StaticMesh &mesh = staticMeshes.getMesh(staticMeshIDs[i]);
+        if(meshTextures[i])
+        {
+            meshTextures[i]->bind();
+        }
+        useMeshProgram(getModelMatrixStack().top(), static_cast<bool>(meshTextures[i]));
+        glDrawElementsBaseVertex(GL_TRIANGLES, mesh.lods[0].indexCount, GL_UNSIGNED_INT,
+            (void*)((mesh.firstIndex + mesh.lods[0].firstIndex) * sizeof(GLuint)), mesh.baseVertex);
+    }
+}
+
+float Model::getBoundingRadius()
+{
+    return boundingRadius;
+}
+
+int Model::getLODCount()
+{
+    int lodCount = 1;
+    for (auto &vbo : vbos)
+    {
+        lodCount = std::max(lodCount, vbo->getLODCount());
+    }
+    for (int meshID : staticMeshIDs)
+    {
+        lodCount = std::max(lodCount, static_cast<int>(getStaticMeshBuffer().getMesh(meshID).lods.size()));
+    }
+    return lodCount;
 }
 
 
@@ -26,9 +26,19 @@ protected:
 	glm::vec3 rotationOnAxes;
 	AABB aabb;
 	glm::vec3 scale;
+	/** The distance from the model space origin to the furthest vertex of any mesh. */
+	float boundingRadius;
 public:
 	std::vector<std::shared_ptr<MeshData>> data;
+	/** Each mesh's own VBO. These are only created when the meshes could not be packed into the StaticMeshBuffer. */
 	std::vector<std::shared_ptr<VBO>> vbos;
+	/** The texture of each mesh, in the same order as data, or null for an untextured mesh. */
+	std::vector<std::shared_ptr<Texture>> meshTextures;
+	/**
+	 * The ID of each mesh in the StaticMeshBuffer, in the same order as data. This is empty unless every mesh could
+	 * be packed there.
+	 */
+	std::vector<int> staticMeshIDs;
 	std::shared_ptr<Texture> overrideTexture;
 	void onAABBCollision(AABB &boundsCollidedWith) override;
 
@@ -100,8 +110,22 @@ public:
 	 * @return a ModelData object which describes this Model
 	 */
 	int getID();
+	/**
+	 * Textures each mesh from textureMap by the mesh's texture name, or with overrideTexture when it is set, and packs
+	 * the meshes into the StaticMeshBuffer when it is in use. A VBO is created for each mesh only if they could not all
+	 * be packed. A Model shared through the model cache may already have been set up, in which case this does nothing.
+	 */
     void createVBOs(std::map<std::string, std::shared_ptr<Texture>> textureMap);
     void draw(Camera *camera);
+	/**
+	 * Gets the radius of a sphere around the model space origin that contains every vertex of this Model.
+	 */
+	float getBoundingRadius();
+	/**
+	 * Gets the number of levels of detail this Model can be drawn at, which is the most of any of its meshes.
+	 * createVBOs(...) must already have been called.
+	 */
+	int getLODCount();
 };
 
 inline bool operator<(const Model &first, const Model &other)
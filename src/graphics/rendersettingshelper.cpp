@@ -2,6 +2,10 @@
 #include "graphics/glincludes.h"
 #include "graphics/rendersettingshelper.h"
 #include "graphics/gluhelper.h"
+#include "render/glstate.h"
+#include "render/glcallstats.h"
+#include "render/streambuffer.h"
+#include "render/textureresidency.h"
 
 const int virtual_width = 1280;
 const int virtual_height = 720;
@@ -37,7 +41,7 @@ void initializeViewport()
 
     glViewport(vpX, screenHeight - (vpY + height), width, height); //Setup the second element for 2D projection
 
-    glEnable(GL_DEPTH_TEST);
+    enableState(GL_DEPTH_TEST);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity(); //Reset to the origin
     glOrtho(0, getWindowWidth(), getWindowHeight(), 0, -1, 1); //initialize the 2D drawing area
@@ -46,9 +50,9 @@ void initializeViewport()
     glTranslatef(0.0F, 0.0F, 1); //Move out on the screen so stuff is actually visible
 
     glClearColor(0.0F, 0.0F, 0.0F, 0.0F); //Clear the colour
-    glDisable(GL_LIGHTING); //Ensure lighting isnt enabled
-    glEnable(GL_TEXTURE_2D); //Allow flat textures to be drawn
-    glDisable(GL_FOG); //Ensure there isnt fog enabled
+    disableState(GL_LIGHTING); //Ensure lighting isnt enabled
+    enableState(GL_TEXTURE_2D); //Allow flat textures to be drawn
+    disableState(GL_FOG); //Ensure there isnt fog enabled
 //		System.out.println(x + " " + y + " " + width + " " + height);
     // set up lighting
 //	    GL11.glEnable(GL11.GL_LIGHTING);
@@ -73,11 +77,14 @@ void start2DRenderCycle()
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
     glOrtho(0, getWindowWidth(), getWindowHeight(), 0, -1, 1); //initialize the 2D drawing area
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_BLEND);
-    glDisable(GL_TEXTURE_2D);
-    glDisable(GL_LIGHTING);
+    disableState(GL_DEPTH_TEST);
+    disableState(GL_CULL_FACE);
+    disableState(GL_BLEND);
+    disableState(GL_TEXTURE_2D);
+    disableState(GL_LIGHTING);
+    // The HUD is still drawn with the fixed function pipeline, so the 3D programs must not stay current.
+    useProgram(0);
+    setClientArrays(false, false, false, false);
 }
 
 /**
@@ -111,6 +118,11 @@ void endRenderCycle()
     // TODO -- update
     // Display.update();
     swapBuffers();
+    endGLStateFrame();
+    setGLCallSection(GLCallSection::OTHER);
+    advanceStreamBufferFrame();
+    updateTextureResidency();
+    endGLCallStatsFrame();
 }
 
 /**
@@ -176,13 +188,13 @@ void start3DRenderCycle()
     // set up the camera
     //TODO improve the camera and field of view settings
 
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
+    enableState(GL_CULL_FACE);
+    enableState(GL_DEPTH_TEST);
     glCullFace(GL_BACK);
 
     glMatrixMode(GL_PROJECTION);
     gl::glLoadIdentity();
-    setPerspective(45.0f, getAspectRatio(), 0.1f, 1000.0f);
+    setPerspective(FIELD_OF_VIEW, getAspectRatio(), NEAR_CLIP_DISTANCE, FAR_CLIP_DISTANCE);
     glMatrixMode(GL_MODELVIEW);
     gl::glLoadIdentity();
     gl::glPushMatrix();
@@ -5,6 +5,13 @@
  * RenderSettingsHelper defines static methods that set OpenGL settings to some sort of default for a particular operation. For example, 2D or 3D rendering.
  */
 
+/** The vertical field of view, in degrees, used for 3D rendering. */
+const float FIELD_OF_VIEW = 45.0f;
+/** The distance to the near clipping plane used for 3D rendering. */
+const float NEAR_CLIP_DISTANCE = 0.1f;
+/** The distance to the far clipping plane used for 3D rendering. */
+const float FAR_CLIP_DISTANCE = 1000.0f;
+
 /**
  * Initializes the default 2D openGL settings, making the resolution of the game math the approximate width and height required.
  */
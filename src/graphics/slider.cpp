@@ -1,6 +1,5 @@
 
 #include "windowhelper.h"
-#include <glbinding/gl/gl.h>
 #include "slider.h"
 #include "math/gamemath.h"
 
@@ -13,28 +12,14 @@ Slider::Slider(std::shared_ptr<Texture> tex, double x, double y, double width, d
 /**
 * Draws the button, and fixes the position if the screen has been resized
 */
-void Slider::draw()
+void Slider::draw(SpriteBatch &batch)
 {
-	using namespace gl;
-	drawBackground();
+	drawBackground(batch);
 	
 	//The "slide bar"
 	const float BAR_WIDTH = 10;
-	double barPosition = (this->value - BAR_WIDTH < 0) ? 0 : (this->value - BAR_WIDTH > 0.95) ? 0.95 : (this->value - (BAR_WIDTH));
 	float x1 = x + (width * value);
-	glDisable(GL_TEXTURE_2D);
-	glColor4d(1, 1, 1, 1);
-	glBegin(GL_QUADS);
-		glVertex3d(x1, y + height, 0);
-		glTexCoord2f(0, 1);
-		glVertex3d(x1 + BAR_WIDTH, y + height, 0);
-		glTexCoord2f(1, 1);
-		glVertex3d(x1 + BAR_WIDTH, y, 0);
-		glTexCoord2f(1, 0);
-		glVertex3d(x1, y, 0);
-		glTexCoord2f(0, 0);
-	glEnd();
-	glEnable(GL_TEXTURE_2D);
+	batch.addQuad(nullptr, x1, y, x1 + BAR_WIDTH, y + height, 0, 0, 1, 1, WHITE);
 }
 
 void Slider::update(MouseManager *manager)
@@ -25,7 +25,7 @@ public:
 	/**
 	 * Draws the button, and fixes the position if the screen has been resized
 	 */
-	virtual void draw() override;	
+	virtual void draw(SpriteBatch &batch) override;	
 	virtual void update(MouseManager *manager) override;
 };
 
@@ -1,23 +1,29 @@
 
 
 #include <glbinding/gl/gl.h>
+#include <glm/gtc/matrix_transform.hpp>
 #include "tree.h"
+#include "render/matrixstack.h"
 
-Tree::Tree(std::shared_ptr<Model> treeModel, float x, float y, float z) : treeModel(treeModel), x(x), y(y), z(z)
+Tree::Tree(std::shared_ptr<Model> treeModel, float x, float y, float z) : treeModel(treeModel), x(x), y(y), z(z), lodLevel(0)
 {
 
 }
 
 void Tree::draw(Camera *camera)
 {
-	using namespace gl;
-	glMatrixMode(GL_MODELVIEW);
-	glPushMatrix();
-	glTranslatef(x, y, z);
+	MatrixStack &modelMatrices = getModelMatrixStack();
+	modelMatrices.push();
+	modelMatrices.translate(x, y, z);
 
 	treeModel->draw(camera);
 
-	glPopMatrix();
+	modelMatrices.pop();
+}
+
+glm::mat4 Tree::getTransform()
+{
+	return glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z));
 }
 
 
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <memory>
+#include <glm/mat4x4.hpp>
 #include "graphics/model.h"
 
 class Tree
@@ -12,8 +13,14 @@ public:
 	float x;
 	float y;
 	float z;
+	/** The level of detail this tree was last drawn at. */
+	int lodLevel;
 	Tree(std::shared_ptr<Model> treeModel, float x, float y, float z);
 	void draw(Camera *camera);
+	/**
+	 * Gets the model-to-world matrix used to draw this tree. This is equivalent to the translation applied by draw(...).
+	 */
+	glm::mat4 getTransform();
 };
 
 #endif
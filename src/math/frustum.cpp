@@ -0,0 +1,75 @@
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "math/frustum.h"
+#include "math/gamemath.h"
+#include "graphics/rendersettingshelper.h"
+
+Frustum::Frustum(const glm::mat4 &m)
+{
+	// Gribb/Hartmann plane extraction. glm is column major, so m[c][r] is row r, column c.
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec4 row(m[0][i], m[1][i], m[2][i], m[3][i]);
+		glm::vec4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+		planes[i * 2] = w + row;
+		planes[i * 2 + 1] = w - row;
+	}
+	for (int i = 0; i < 6; i++)
+	{
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
+
+bool Frustum::intersects(const AABB &box) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec4 &p = planes[i];
+		// Test the corner that is furthest along the plane normal; if even that is outside, the whole box is.
+		glm::vec3 positive(
+			p.x >= 0 ? box.xMax : box.xMin,
+			p.y >= 0 ? box.yMax : box.yMin,
+			p.z >= 0 ? box.zMax : box.zMin
+		);
+		if (glm::dot(glm::vec3(p), positive) + p.w < 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Frustum::intersects(const glm::vec3 &center, float radius) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+glm::mat4 createViewMatrix(Camera *camera)
+{
+	glm::vec3 eye = camera->position;
+	glm::vec3 target(
+		camera->position.x + sin(camera->rotation.y),
+		camera->position.y - sin(camera->rotation.x),
+		camera->position.z - cos(camera->rotation.y)
+	);
+	glm::vec3 up(0, cos(camera->rotation.x), 0);
+	return glm::lookAt(eye, target, up);
+}
+
+glm::mat4 createProjectionMatrix(float aspectRatio)
+{
+	return glm::perspective(toRad(FIELD_OF_VIEW), aspectRatio, NEAR_CLIP_DISTANCE, FAR_CLIP_DISTANCE);
+}
+
+Frustum createCameraFrustum(Camera *camera, float aspectRatio)
+{
+	return Frustum(createProjectionMatrix(aspectRatio) * createViewMatrix(camera));
+}
@@ -0,0 +1,53 @@
+#ifndef ENG_FRUSTUM_H
+#define ENG_FRUSTUM_H
+
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include "physics/aabb.h"
+#include "graphics/camera.h"
+
+/**
+ * Frustum is the volume visible through a camera, stored as six inward facing planes. It is used to skip drawing
+ * things that are entirely off screen.
+ */
+class Frustum
+{
+public:
+	/**
+	 * Extracts the six planes from a combined projection * view matrix.
+	 * @param viewProjection the matrix that takes world coordinates to clip coordinates
+	 */
+	Frustum(const glm::mat4 &viewProjection);
+	/**
+	 * Checks if any part of an AABB could be inside this Frustum. This is conservative: boxes near the corners of
+	 * the frustum may be reported as visible when they are not, but a visible box is never rejected.
+	 * @param box the AABB to test
+	 * @return true if the box may be visible, otherwise false
+	 */
+	bool intersects(const AABB &box) const;
+	/**
+	 * Checks if a sphere could be inside this Frustum.
+	 */
+	bool intersects(const glm::vec3 &center, float radius) const;
+private:
+	/** Planes in the form (a, b, c, d) with ax + by + cz + d >= 0 on the inside. */
+	glm::vec4 planes[6];
+};
+
+/**
+ * Builds the view matrix that setLookAt(Camera*) applies to the modelview stack.
+ */
+glm::mat4 createViewMatrix(Camera *camera);
+/**
+ * Builds the projection matrix that start3DRenderCycle() sets up.
+ * @param aspectRatio the aspect ratio of the viewport
+ */
+glm::mat4 createProjectionMatrix(float aspectRatio);
+/**
+ * Builds the Frustum matching the projection set up by start3DRenderCycle() and the view set up by setLookAt(...).
+ * @param camera the Camera the scene is drawn from
+ * @param aspectRatio the aspect ratio of the viewport
+ */
+Frustum createCameraFrustum(Camera *camera, float aspectRatio);
+
+#endif
@@ -1,434 +1,414 @@
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
 #include <glbinding/gl/gl.h>
 #include "render/dynamicvbo.h"
+#include "render/glstate.h"
+#include "render/meshprogram.h"
 
+using namespace gl;
 
-TerrainPolygon _p(
-        FlexArray<glm::vec3>({
-                glm::vec3(3.0f,  1.0f, -1.0f),
-                glm::vec3(3.0f,  1.0f,  1.0f),
-                glm::vec3(3.0f, -1.0f,  1.0f),
-                glm::vec3(3.0f, -1.0f, -1.0f)
-        }),
-        FlexArray<float>({
-                0.0f,1.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f
-        }),
-        FlexArray<float>({
-                1.0f, 1.0f,
-                0.0f, 1.0f,
-                0.0f, 0.0f,
-                1.0f, 0.0f
-        })
-);
-TerrainPolygon _p1(
-        FlexArray<glm::vec3>({
-                glm::vec3(5.0f,  1.0f, -1.0f),
-                glm::vec3(5.0f,  1.0f,  1.0f),
-                glm::vec3(5.0f, -1.0f,  1.0f),
-                glm::vec3(5.0f, -1.0f, -1.0f)
-        }),
-        FlexArray<float>({
-                0.0f,0.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f
-        }),
-        FlexArray<float>({
-                1.0f, 1.0f,
-                0.0f, 1.0f,
-                0.0f, 0.0f,
-                1.0f, 0.0f
-        })
-);
-TerrainPolygon _p2(
-        FlexArray<glm::vec3>({
-                glm::vec3(7.0f,  1.0f, -1.0f),
-                glm::vec3(7.0f,  1.0f,  1.0f),
-                glm::vec3(7.0f, -1.0f,  1.0f),
-                glm::vec3(7.0f, -1.0f, -1.0f)
-        }),
-        FlexArray<float>({
-                0.0f,1.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f
-        }),
-        FlexArray<float>({
-                1.0f, 1.0f,
-                0.0f, 1.0f,
-                0.0f, 0.0f,
-                1.0f, 0.0f
-        })
-);
-TerrainPolygon _p3(
-        FlexArray<glm::vec3> {
-                glm::vec3(10.0f,  1.0f, -1.0f),
-                glm::vec3(10.0f,  1.0f,  1.0f),
-                glm::vec3(10.0f, -1.0f,  1.0f),
-                glm::vec3(10.0f, -1.0f, -1.0f)
-        },
-        FlexArray<float>({
-                0.0f,0.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f,
-                0.0f,1.0f,1.0f,1.0f
-        }),
-        FlexArray<float>({
-                1.0f, 1.0f,
-                0.0f, 1.0f,
-                0.0f, 0.0f,
-                1.0f, 0.0f
-        })
-);
+static const int ROW_SIZE = TerrainPolygon::TOTAL_ROW_SIZE;
 
-using namespace gl;
+DynamicVBO::DynamicVBO() : vertexBufferID(0), indexBufferID(0), vertexArrayID(0), vertexCapacity(0), triangleCapacity(0),
+    triangleCount(0), initialized(false), texture(std::shared_ptr<Texture>(nullptr))
+{
+}
 
-int *constructRange(int a, int b)
+/**
+ * Empties the CPU side copies and sizes them for at least the given number of vertices and triangles.
+ */
+void DynamicVBO::reset(int minimumVertices, int minimumTriangles)
 {
-    int *vals = new int[b - a];
-    for(int i = 0; i < b - a; i++)
-    {
-        vals[i] = a + i;
-    }
-    return vals;
+    vertexCapacity = std::max(minimumVertices, DYNAMIC_VBO_MINIMUM_CAPACITY);
+    triangleCapacity = std::max(minimumTriangles, DYNAMIC_VBO_MINIMUM_CAPACITY);
+    vertexData.assign(vertexCapacity * ROW_SIZE, 0.0f);
+    indexData.assign(triangleCapacity * 3, 0);
+    triangleOwners.assign(triangleCapacity, -1);
+    triangleCount = 0;
+    allocations.clear();
+    freeHandles.clear();
+    freeRanges.clear();
 }
 
-DynamicVBO::DynamicVBO() : vertexBufferID(0), indexBufferID(0),
-    indicesCount(0), vertCount(0), texture(std::shared_ptr<Texture>(nullptr)), initialized(false)
+/**
+ * Creates the buffers if they do not exist yet, and uploads both CPU side copies in one call each.
+ */
+void DynamicVBO::createBuffers()
 {
+    if(vertexBufferID == 0)
+    {
+        vertexBufferID = createVBOID();
+        indexBufferID = createVBOID();
+        bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+        if(isCoreRenderPathActive())
+        {
+            // Growing the buffers respecifies their storage but keeps their names, so this is only done once.
+            glGenVertexArrays(1, &vertexArrayID);
+            bindVertexArray(vertexArrayID);
+            setVertexAttribute(VERTEX_ATTRIBUTE_POSITION, 3, GL_FLOAT, 48, 0);
+            setVertexAttribute(VERTEX_ATTRIBUTE_NORMAL, 3, GL_FLOAT, 48, 12);
+            setVertexAttribute(VERTEX_ATTRIBUTE_COLOUR, 4, GL_FLOAT, 48, 24);
+            setVertexAttribute(VERTEX_ATTRIBUTE_TEXTURE_COORD, 2, GL_FLOAT, 48, 40);
+        }
+    }
+    bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_DYNAMIC_DRAW);
+    bindIndexBuffer();
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(GLuint), indexData.data(), GL_DYNAMIC_DRAW);
+    initialized = true;
 }
 
 /**
- * Initializes the VBO and IBO, and assigns indexes to each of the TerrainPolygons as the indexes
- * appear in the VBO. This method must be invoked otherwise the draw method will cause the
- * dynamic vbo to throw an exception.
- * <br><br>
- * <b><u>Note:</u>Re-adding a TerrainPolygon to the same VBO without removing it or adding a TerrainPolygon to
- * two or more VBOs at the same time will cause the IBO indexes to be overwritten. This makes it
- * functionally impossible to remove the TerrainPolygon from any VBOs but the last, a
- * pseudo memory leak</b>
+ * Initializes the VBO and IBO with an initial set of polygons, uploading each buffer once.
  */
 void DynamicVBO::create(std::shared_ptr<FlexArray<TerrainPolygon>> &polys, std::shared_ptr<Texture> terrainTexture)
 {
     this->texture = terrainTexture;
-//    polys = std::shared_ptr<FlexArray<TerrainPolygon>>(new FlexArray<TerrainPolygon>({_p, _p1, _p2, _p3}));
 
-    int vertexCount = 0;
+    int totalVertices = 0;
+    int totalTriangles = 0;
     for(int i = 0; i < polys->size(); i++)
     {
-        vertexCount += polys->at(i).getVertexCount();
+        int vertices = polys->at(i).getVertexCount();
+        totalVertices += vertices;
+        totalTriangles += std::max(vertices - 2, 0);
     }
-    vertCount = vertexCount;
-    int totalNumberOfElements = vertexCount * TerrainPolygon::TOTAL_ROW_SIZE;
+    reset(totalVertices, totalTriangles);
 
-    //std::cout << "!" << totalNumberOfElements << std::endl;
-    float *rawData = new float[totalNumberOfElements];
-    int IBOIndexCounter = 0;
+    // The polygons are written straight into the CPU copy, which is then uploaded in one call.
+    int nextVertex = 0;
+    for(int i = 0; i < polys->size(); i++)
+    {
+        RawPolygonData raw = polys->at(i).getRawData();
+        std::copy(raw.data, raw.data + raw.size, vertexData.begin() + nextVertex * ROW_SIZE);
+        delete[] raw.data;
+        Allocation allocation;
+        allocation.firstVertex = nextVertex;
+        allocation.vertexCount = polys->at(i).getVertexCount();
+        allocation.live = true;
+        allocations.push_back(allocation);
+        writeTriangles(static_cast<int>(allocations.size()) - 1);
+        nextVertex += allocation.vertexCount;
+    }
+    if(nextVertex < vertexCapacity)
+    {
+        freeRanges[nextVertex] = vertexCapacity - nextVertex;
+    }
+    createBuffers();
+}
 
+void DynamicVBO::create(int initialVertexCapacity, std::shared_ptr<Texture> terrainTexture)
+{
+    this->texture = terrainTexture;
+    reset(initialVertexCapacity, 0);
+    freeRanges[0] = vertexCapacity;
+    createBuffers();
+}
 
-    int j = 0; //Raw Data Indexer
-    for(int i = 0; i < polys->size(); i++)
+/**
+ * Appends the triangle fan of an allocation to the CPU copy of the index buffer. The index buffer must already
+ * have room for it.
+ */
+void DynamicVBO::writeTriangles(int handle)
+{
+    Allocation &allocation = allocations[handle];
+    for(int k = 1; k + 1 < allocation.vertexCount; k++)
     {
-        TerrainPolygon *p = &polys->at(i);
-        RawPolygonData f = p->getRawData();
+        int slot = triangleCount++;
+        indexData[slot * 3] = allocation.firstVertex;
+        indexData[slot * 3 + 1] = allocation.firstVertex + k;
+        indexData[slot * 3 + 2] = allocation.firstVertex + k + 1;
+        triangleOwners[slot] = handle;
+        allocation.triangleSlots.push_back(slot);
+    }
+}
 
-        /*
-        if(p->getVertexCount() > 0)
+/**
+ * Takes a range of vertices from the free-list, first fit, growing the vertex buffer if no range is large enough.
+ * @return the first vertex of the range
+ */
+int DynamicVBO::allocateVertices(int vertexCount)
+{
+    for(auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+    {
+        if(it->second >= vertexCount)
         {
-            rawData[6] = 1.0f;
-            rawData[7] = 1.0f;
-            rawData[8] = 1.0f;
-            rawData[9] = 1.0f;
+            int first = it->first;
+            int remaining = it->second - vertexCount;
+            freeRanges.erase(it);
+            if(remaining > 0)
+            {
+                freeRanges[first + vertexCount] = remaining;
+            }
+            return first;
         }
-*/
+    }
+    growVertexBuffer(vertexCapacity + vertexCount);
+    return allocateVertices(vertexCount);
+}
 
-        for(int i = 0; i < f.size; i++,j++)
+/**
+ * Returns a range of vertices to the free-list, merging it with the free ranges on either side.
+ */
+void DynamicVBO::freeVertices(int firstVertex, int vertexCount)
+{
+    auto next = freeRanges.lower_bound(firstVertex);
+    if(next != freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if(previous->first + previous->second == firstVertex)
         {
-            rawData[j] = f.data[i];
+            firstVertex = previous->first;
+            vertexCount += previous->second;
+            freeRanges.erase(previous);
         }
-        int *val = constructRange(IBOIndexCounter, IBOIndexCounter + p->getVertexCount());
-        p->setIBOIndexes(val);
-        IBOIndexCounter += p->getVertexCount();
-        // THIS IS A SERIOUS MEMORY LEAK
-        //delete[] f.data;
     }
-    float* vertex_buffer_data = new float[totalNumberOfElements]/*rawData.length*/;
-    for(int i = 0; i < totalNumberOfElements/*rawData's size*/; i++)
+    if(next != freeRanges.end() && firstVertex + vertexCount == next->first)
     {
-        vertex_buffer_data[i] = rawData[i];
+        vertexCount += next->second;
+        freeRanges.erase(next);
     }
-    // vertex_buffer_data.put(rawData);
-    //vertex_buffer_data.rewind();
-    vbo = vertex_buffer_data;
-
-    unsigned int* intBuffer = new unsigned int[vertexCount] /*IBOIndexCounter*/;
-    for(unsigned int i = 0; i < IBOIndexCounter; i++)
-        intBuffer[i] = i;
-    //intBuffer.rewind();
-    ibo = intBuffer;
-    indicesCount = totalNumberOfElements/*rawData's size*/ / TerrainPolygon::TOTAL_ROW_SIZE;
-
-    vertexBufferID = createVBOID();
-    indexBufferID = createVBOID();
-
-   // std::cout << "!" << glBindBuffer << ":" << vertexBufferID << std::endl;
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-    glBufferData(GL_ARRAY_BUFFER, totalNumberOfElements * sizeof(float)/*rawData's size*/, vertex_buffer_data, GL_DYNAMIC_DRAW);
-
-    //glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-    std::cout << "DynamicVBO[SIZE]>" << totalNumberOfElements << std::endl;
-    //glBufferData(GL_ELEMENT_ARRAY_BUFFER, vertexCount * sizeof(unsigned int), intBuffer, GL_DYNAMIC_DRAW);
-    initialized = true;
+    freeRanges[firstVertex] = vertexCount;
+}
 
-    delete[] rawData;
+/**
+ * Doubles the vertex buffer (or more, if required), orphaning the old storage and re-uploading the CPU copy.
+ */
+void DynamicVBO::growVertexBuffer(int requiredCapacity)
+{
+    int oldCapacity = vertexCapacity;
+    vertexCapacity = std::max(std::max(vertexCapacity * 2, requiredCapacity), DYNAMIC_VBO_MINIMUM_CAPACITY);
+    vertexData.resize(vertexCapacity * ROW_SIZE, 0.0f);
+    bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_DYNAMIC_DRAW);
+    freeVertices(oldCapacity, vertexCapacity - oldCapacity);
 }
 
 /**
- * Draws the terrain as specified by the index buffer object associated with this terrain renderer.
- * @param cam the Camera that will be used to properly display the terrain
- * @throws IllegalStateException - the create(...) method has not been called so there is no data
- * in the buffer to draw
+ * Doubles the index buffer (or more, if required), orphaning the old storage and re-uploading the CPU copy.
  */
-void DynamicVBO::draw(Camera *cam)
+void DynamicVBO::growIndexBuffer(int requiredCapacity)
 {
-    if(!initialized)
-    {
-        return;
-        // TODO - throw exception on failure instead?
-        //throw IllegalStateException("The VBO has not been initialized with any data.");
-    }
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_NORMAL_ARRAY);
-    glEnableClientState(GL_COLOR_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    triangleCapacity = std::max(std::max(triangleCapacity * 2, requiredCapacity), DYNAMIC_VBO_MINIMUM_CAPACITY);
+    indexData.resize(triangleCapacity * 3, 0);
+    triangleOwners.resize(triangleCapacity, -1);
+    bindIndexBuffer();
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(GLuint), indexData.data(), GL_DYNAMIC_DRAW);
+}
 
-    glLoadIdentity();
-   
-    //glColor3f(1.0f, 1.0f, 1.0f);
-    // Translate to model co-ordinates, based on the origin of the shape
-    setLookAt(cam);
-    if(texture)
+void DynamicVBO::uploadVertices(int firstVertex, int vertexCount)
+{
+    bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+    glBufferSubData(GL_ARRAY_BUFFER, firstVertex * ROW_SIZE * sizeof(float), vertexCount * ROW_SIZE * sizeof(float),
+            &vertexData[firstVertex * ROW_SIZE]);
+}
+
+void DynamicVBO::uploadTriangles(int firstTriangle, int count)
+{
+    bindIndexBuffer();
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstTriangle * 3 * sizeof(GLuint), count * 3 * sizeof(GLuint),
+            &indexData[firstTriangle * 3]);
+}
+
+/**
+ * Binds the index buffer. On the core render path the binding belongs to the vertex array object, so that is bound
+ * first; otherwise it would replace the index buffer of whichever one was bound last.
+ */
+void DynamicVBO::bindIndexBuffer()
+{
+    if(vertexArrayID != 0)
     {
-		glEnable(GL_TEXTURE_2D);
-        texture->bind(); // terrain texture?
+        bindVertexArray(vertexArrayID);
     }
-    else
+    bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+}
+
+void DynamicVBO::bindVertices()
+{
+    if(vertexArrayID != 0)
     {
-		glDisable(GL_TEXTURE_2D);
-        std::cout << "failure to bind texture: nullptr" << std::endl;
+        bindVertexArray(vertexArrayID);
+        return;
     }
-    int firstVert = 0;
-    int firstNormal = 12;
-    int firstColour = 24;
-    int firstTextureCoord = 40;
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+    setClientArrays(true, true, true, true);
+    bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
     glVertexPointer(3, GL_FLOAT, 48, (void*)(0));
     glNormalPointer(GL_FLOAT, 48, (void*)(12));
     glColorPointer(4, GL_FLOAT, 48, (void*)(24));
     glTexCoordPointer(2, GL_FLOAT, 48, (void*)(40));
-
-    //glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-    //std::cout << "Error1:" << glGetError() << std::endl;
-  //  glDrawElements(GL_TRIANGLES, vertCount, GL_UNSIGNED_INT, 0);
-    //std::cout << "Error2:" << glGetError() << std::endl;
-
-    glDrawArrays(GL_TRIANGLES, 0, vertCount);
-  //  std::cout << "Error!:" << glGetError() << std::endl;
-//
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_NORMAL_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-
-   // std::cout << "Error3:" << glGetError() << std::endl;
 }
 
 /**
- * <i> Javadoc comment pending finalized functionality. </i><br>
- * Iteration 1: the number of vertices to remove is not strictly enforced
- * likewise, it's assumed the vbo:ibo mapping is one to one, that is each
- * of the ibo indexes maps one-to-one to a set of vertex data in the vbo
- *
- * @param iboIndexes an int[], where each element of the array is a value
- * that will be removed from the vbo. The vertex removed for each element e, will
- * be the one at ibo.get(e), however, this data will also be purged from the vbo
- * when the index is removed from the ibo.
- * @throws IllegalStateException - the create(...) method has not been called so there is no data
- * in the buffer to draw
+ * Draws every polygon currently in the buffer with one indexed draw call.
  */
-void DynamicVBO::remove(FlexArray<int> iboIndexes)
+void DynamicVBO::draw(Camera *cam)
 {
-    if(!initialized)
+    if(!initialized || triangleCount == 0)
     {
         return;
-        // TODO -- throw exception on failure?
-        //throw IllegalStateException("The VBO has not been initialized with any data.");
     }
-    //ibo.clear();
-    //vbo.clear();
-    //ibo.rewind();
-    //vbo.rewind();
-    //ASSUMPTION: 1 iboIndexes element : 1 vertex
-    int verts = iboIndexes.size();
-
-    for(int i = 0; i < indicesCount; i++)
+    if(vertexArrayID != 0)
     {
-        std::cout << i << "> " << ibo[i] << std::endl;
+        // The polygons are already in world space.
+        if(texture)
+        {
+            texture->bind();
+        }
+        // A caller drawing blocks may have bound its own element buffer into the vertex array object.
+        bindIndexBuffer();
+        useMeshProgram(glm::mat4(1.0f), static_cast<bool>(texture));
+        glDrawElements(GL_TRIANGLES, triangleCount * 3, GL_UNSIGNED_INT, nullptr);
+        return;
     }
 
-    //Figure out what values are actually stored in the ibo at the specified indexes
-    FlexArray<int> valuesAtIndexes(iboIndexes.size());
-    for(int i = 0; i < iboIndexes.size(); i++)
+    glLoadIdentity();
+    setLookAt(cam);
+    if(texture)
     {
-        std::cout << i << "> " << std::endl;
-        valuesAtIndexes[i] = ibo[iboIndexes[i]];
-        std::cout << "valuesAtIndexes[" << i << "]=" << valuesAtIndexes[i];
+		enableState(GL_TEXTURE_2D);
+        texture->bind();
     }
-    //A problem that's going to occur here, I think, is that if a vertex is shared
-    //then when I update the indexes and change stuff it'll break
-
-    // Update vertices in the VBO, first bind the VBO
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-    //vbo.rewind();
+    else
+    {
+		disableState(GL_TEXTURE_2D);
+    }
+    bindVertices();
+    bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+    glDrawElements(GL_TRIANGLES, triangleCount * 3, GL_UNSIGNED_INT, nullptr);
+}
 
-    FlexArray<float> valuesAtVBOEnd(iboIndexes.size() * TerrainPolygon::TOTAL_ROW_SIZE);
-    for(int i = verts * TerrainPolygon::TOTAL_ROW_SIZE - 1,
-        j = (indicesCount * TerrainPolygon::TOTAL_ROW_SIZE) - 1; i >= 0; i--, j--)
+/**
+ * Removes a polygon from the buffer. Its vertex range is returned to the free-list, and its triangles are
+ * replaced by the last triangles of the index buffer.
+ */
+void DynamicVBO::remove(int handle)
+{
+    if(!initialized || handle < 0 || handle >= static_cast<int>(allocations.size()) || !allocations[handle].live)
     {
-        valuesAtVBOEnd[i] = vbo[j];
-        vbo[j] = 0;
+        return;
     }
-    int count = 0;
-    for(int i = 0; i < iboIndexes.size(); i++)
+    Allocation &allocation = allocations[handle];
+    freeVertices(allocation.firstVertex, allocation.vertexCount);
+
+    // Filling the highest slots first means a triangle moved into a hole is never one that is about to be removed.
+    std::sort(allocation.triangleSlots.begin(), allocation.triangleSlots.end(), std::greater<int>());
+    for(int slot : allocation.triangleSlots)
     {
-        for(int j = 0; j < TerrainPolygon::TOTAL_ROW_SIZE; j++)
+        int last = triangleCount - 1;
+        if(slot != last)
         {
-            vbo[iboIndexes[i] * TerrainPolygon::TOTAL_ROW_SIZE + j] = valuesAtVBOEnd[count++];
+            int owner = triangleOwners[last];
+            std::copy(indexData.begin() + last * 3, indexData.begin() + last * 3 + 3, indexData.begin() + slot * 3);
+            triangleOwners[slot] = owner;
+            std::vector<int> &ownerSlots = allocations[owner].triangleSlots;
+            *std::find(ownerSlots.begin(), ownerSlots.end(), last) = slot;
+            uploadTriangles(slot, 1);
         }
+        triangleOwners[last] = -1;
+        triangleCount--;
     }
-//			vbo.flip();
-    //Should this offset be zero? minimum changed index?
-    glBufferSubData(GL_ARRAY_BUFFER, 0/*(vertCount) * VAL_PER_VERT * 4*/, iboIndexes.size(), vbo);
-
-    //At this point the values at the end of the vbo have been shifted to wherever the things were before
-    //So we have to update the ibo values.
-
-    // Update the indexes in the IBO, first bind the IBO
-    glBindBuffer(GL_ARRAY_BUFFER, indexBufferID);
-//		ibo.rewind();
-    FlexArray<int> valuesAtIboEnd(iboIndexes.size());
-    for(int i = verts - 1, j = indicesCount - 1; i >= 0; i--, j--)
+    allocation.triangleSlots.clear();
+    allocation.live = false;
+    freeHandles.push_back(handle);
+}
+
+/**
+ * Adds a polygon to the buffer, growing the buffers if they are full.
+ */
+int DynamicVBO::add(TerrainPolygon &poly)
+{
+    RawPolygonData raw = poly.getRawData();
+    int handle = add(raw.data, poly.getVertexCount());
+    delete[] raw.data;
+    return handle;
+}
+
+int DynamicVBO::add(const float *data, int vertexCount)
+{
+    if(!initialized || vertexCount < 3)
     {
-        valuesAtIboEnd[i] = ibo[j];
-        ibo[j] = 0;
+        return -1;
     }
-    for(int i = 0; i < iboIndexes.size(); i++)
+    int handle = allocate(data, vertexCount);
+    int firstTriangle = triangleCount;
+    int newTriangles = vertexCount - 2;
+    if(triangleCount + newTriangles > triangleCapacity)
     {
-        ibo[iboIndexes[i]] = valuesAtIboEnd[i];
+        growIndexBuffer(triangleCount + newTriangles);
     }
+    writeTriangles(handle);
+    uploadTriangles(firstTriangle, newTriangles);
+    return handle;
+}
 
-    int lowerBound = indicesCount - verts;
-    int upperBound = indicesCount;
-    //This step can probably be optimized or skipped somehow
-    for(int i = 0, x = 0; i < indicesCount; i++)
+int DynamicVBO::addVertices(const float *data, int vertexCount)
+{
+    if(!initialized || vertexCount <= 0)
     {
-        x = ibo[i];
-        if(x < upperBound && x >= lowerBound)
-        {
-            ibo[i] = iboIndexes[upperBound - x - 1];
-        }
+        return -1;
     }
-//			ibo.flip();
-    //Should the offset be 0? perhaps the index where I shifted stuff to?
-    glBufferSubData(GL_ARRAY_BUFFER, 0/*(indicesCount) * 4*/, iboIndexes.size(), ibo);
-    // And of course unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    //Update vertex counts
-    vertCount -= verts;
-    indicesCount -= verts;
+    return allocate(data, vertexCount);
 }
 
 /**
- * Adds a TerrainPolygon to this Dynamic VBO.
- * <br><br>
- * <b><u>Note:</u>Re-adding a TerrainPolygon to the same VBO without removing it or adding a TerrainPolygon to
- * two or more VBOs at the same time will cause the IBO indexes to be overwritten. This makes it
- * functionally impossible to remove the TerrainPolygon from any VBOs but the last, a
- * pseudo memory leak</b>
- * @param poly
- * @throws IllegalStateException - the create(...) method has not been called so there is no data
- * in the buffer to draw
+ * Copies vertices into a newly allocated range, uploads them, and records the range under a new handle.
+ * @return the handle
  */
-void DynamicVBO::add(TerrainPolygon &poly)
+int DynamicVBO::allocate(const float *data, int vertexCount)
 {
-    if(!initialized)
+    int firstVertex = allocateVertices(vertexCount);
+    std::copy(data, data + vertexCount * ROW_SIZE, vertexData.begin() + firstVertex * ROW_SIZE);
+    uploadVertices(firstVertex, vertexCount);
+
+    int handle;
+    if(!freeHandles.empty())
     {
-        return;
-        // TODO- throw exception on failure?
-        //throw IllegalStateException("The VBO has not been initialized with any data. To add initial data, use the create(...) method instead. ");
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<int>(allocations.size());
+        allocations.push_back(Allocation());
     }
+    Allocation &allocation = allocations[handle];
+    allocation.firstVertex = firstVertex;
+    allocation.vertexCount = vertexCount;
+    allocation.live = true;
+    return handle;
+}
 
-    int verts = poly.getVertexCount();
-    int* indexes = constructRange(indicesCount, indicesCount + verts);
-    poly.setIBOIndexes(indexes);
-
-    //Note the offset in glBufferSubData(...)
-    //First of all, it's the offset in bytes not data values.
-    //Second, it's only as far into the buffer as we need to copy... basically we're appending after
-    //that byte in the buffer. So, the * 12 and * 4 are hardcoded and not strictly correct. It may
-    //not be the case that each vertex has exactly 12 floats (of size 4), which would break this.
-    //The same follows for the IBO call below - though we can get away with a bit more because we'll likely
-    //always use ints for the IBO
-
-    // Update vertices in the VBO, first bind the VBO
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-    //vbo.rewind();
-    RawPolygonData data = poly.getRawData();
-    for(int k = 0, i = vertCount * TerrainPolygon::TOTAL_ROW_SIZE;
-        i < (vertCount + verts) * TerrainPolygon::TOTAL_ROW_SIZE;
-        i++, k++)
+void DynamicVBO::updateVertices(int handle, int offset, const float *data, int vertexCount)
+{
+    if(!initialized || handle < 0 || handle >= static_cast<int>(allocations.size()) || !allocations[handle].live)
+    {
+        return;
+    }
+    Allocation &allocation = allocations[handle];
+    vertexCount = std::min(vertexCount, allocation.vertexCount - offset);
+    if(offset < 0 || vertexCount <= 0)
     {
-        vbo[i] = data.data[k];
+        return;
     }
-    delete[] data.data;
-
-    //vbo.position(vertCount * TerrainPolygon::TOTAL_ROW_SIZE);
-    //vbo.limit((vertCount + verts) * TerrainPolygon::TOTAL_ROW_SIZE);
-    //vbo.put(poly.getRawData());
-    //vbo.flip();
-    glBufferSubData(GL_ARRAY_BUFFER,
-            0/*(vertCount) * 12*/,
-            (vertCount + verts) * TerrainPolygon::TOTAL_ROW_SIZE,
-            vbo);
-
-    // Update the indexes in the IBO, second bind the IBO
-    glBindBuffer(GL_ARRAY_BUFFER, indexBufferID);
-    //ibo.rewind();
-//		ibo.position(indicesCount);
-//		ibo.limit(indicesCount + verts);
-//		ibo.put(indexes);
-    for(int i = indicesCount, k = 0; i < indicesCount + verts; i++, k++)
+    int firstVertex = allocation.firstVertex + offset;
+    std::copy(data, data + vertexCount * ROW_SIZE, vertexData.begin() + firstVertex * ROW_SIZE);
+    uploadVertices(firstVertex, vertexCount);
+}
+
+int DynamicVBO::getFirstVertex(int handle)
+{
+    if(handle < 0 || handle >= static_cast<int>(allocations.size()) || !allocations[handle].live)
     {
-        ibo[i] = indexes[k];
+        return -1;
     }
-    //ibo.flip();
-    glBufferSubData(GL_ARRAY_BUFFER,
-            0/*(indicesCount) * 4*/,
-            indicesCount + verts,
-            ibo);
-
-    // And of course unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    //Update vertex counts
-    vertCount += verts;
-    indicesCount += verts;
+    return allocations[handle].firstVertex;
+}
+
+int DynamicVBO::getTriangleCount()
+{
+    return triangleCount;
 }
 
 /**
@@ -436,12 +416,19 @@ void DynamicVBO::add(TerrainPolygon &poly)
  */
 DynamicVBO::~DynamicVBO()
 {
-    GLuint *ptr1 = new GLuint[1];
-    ptr1[0] = vertexBufferID;
-    GLuint *ptr2 = new GLuint[1];
-    ptr2[0] = indexBufferID;
-    glDeleteBuffers(1, ptr1);
-    glDeleteBuffers(1, ptr2);
-//    delete[] ibo;
-//    delete[] vbo;
+    if(vertexBufferID != 0)
+    {
+        glDeleteBuffers(1, &vertexBufferID);
+        notifyBufferDeleted(vertexBufferID);
+    }
+    if(indexBufferID != 0)
+    {
+        glDeleteBuffers(1, &indexBufferID);
+        notifyBufferDeleted(indexBufferID);
+    }
+    if(vertexArrayID != 0)
+    {
+        glDeleteVertexArrays(1, &vertexArrayID);
+        notifyVertexArrayDeleted(vertexArrayID);
+    }
 }
@@ -1,6 +1,10 @@
 #ifndef ENG_DYNAMIC_VBO_H
 #define ENG_DYNAMIC_VBO_H
 
+#include <map>
+#include <memory>
+#include <vector>
+#include <glbinding/gl/gl.h>
 #include "graphics/gluhelper.h"
 #include "graphics/camera.h"
 #include "graphics/terrainpolygon.h"
@@ -8,87 +12,141 @@
 #include "utils/flexarray.h"
 #include "render/texture.h"
 
-/**
- * Creates an array of values on [a, b).
- * @param a an int, the lower inclusive bound of the array's values
- * @param b an int, the upper exclusive bound of the array's values
- * @return an int[] with values on [a, b)
- */
-int *constructRange(int a, int b);
+/** The capacity, in vertices, of a DynamicVBO that is grown before create(...) has given it any data. */
+const int DYNAMIC_VBO_MINIMUM_CAPACITY = 1024;
 
 /**
- * DynamicVBO implements a dynamic Vertex Buffer Object. This VBO chooses what vertexes to render based
- * on an Index Buffer Object that is kept in addition to the vertex data.
+ * DynamicVBO implements a dynamic Vertex Buffer Object: a GPU buffer that polygons can be added to and removed
+ * from one at a time. Vertex storage is suballocated from a free-list of vertex ranges, which are coalesced with
+ * their neighbours when freed. What is drawn is decided by an index buffer of triangles. Removing a polygon moves
+ * the last triangles of the index buffer into the hole it leaves, so removal costs a few index uploads no matter
+ * how large the buffer is. Every change uploads only the bytes that changed, and when either buffer runs out of
+ * room it doubles in size and is re-uploaded from a CPU side copy.
+ *
+ * Blocks of vertices can also be added without triangles, for callers such as TerrainRenderer that draw them with
+ * their own index buffer. Vertices never move once allocated, so a block's first vertex can be used as a base vertex.
  */
 class DynamicVBO
 {
 private:
+	/**
+	 * The storage held by one polygon added to the buffer.
+	 */
+	struct Allocation
+	{
+		int firstVertex;
+		int vertexCount;
+		/** The slots in the index buffer, in triangles, holding this polygon's triangles. */
+		std::vector<int> triangleSlots;
+		bool live;
+	};
     gl::GLuint vertexBufferID;
 	gl::GLuint indexBufferID;
-	int indicesCount;
-	int vertCount;
-	unsigned int* ibo;
-	float* vbo;
+	/** The vertex array object holding the vertex format and index buffer, or 0 on the fixed function path. */
+	gl::GLuint vertexArrayID;
+	/** CPU side copies of both buffers, used to re-upload them when they grow. */
+	std::vector<float> vertexData;
+	std::vector<gl::GLuint> indexData;
+	/** The capacity of the vertex buffer, in vertices. */
+	int vertexCapacity;
+	/** The capacity of the index buffer, in triangles. */
+	int triangleCapacity;
+	int triangleCount;
+	/** Free vertex ranges keyed by their first vertex, mapped to their length. Adjacent ranges are always merged. */
+	std::map<int, int> freeRanges;
+	std::vector<Allocation> allocations;
+	std::vector<int> freeHandles;
+	/** The handle of the polygon each triangle slot of the index buffer belongs to. */
+	std::vector<int> triangleOwners;
 	bool initialized;
+	void reset(int minimumVertices, int minimumTriangles);
+	void createBuffers();
+	int allocate(const float *data, int vertexCount);
+	int allocateVertices(int vertexCount);
+	void freeVertices(int firstVertex, int vertexCount);
+	void growVertexBuffer(int requiredCapacity);
+	void growIndexBuffer(int requiredCapacity);
+	void uploadVertices(int firstVertex, int vertexCount);
+	void uploadTriangles(int firstTriangle, int count);
+	void bindIndexBuffer();
+	void writeTriangles(int handle);
 public:
     std::shared_ptr<Texture> texture;
 	/**
 	 * Creates a new DynamicVBO but does not invoke the create(...) method.
 	 * The create(...) method must be invoked prior to drawing, adding, or
-	 * removing from this DynamicVBO; otherwise exceptions will be thrown
-	 * indicating the requested operations are invalid.
+	 * removing from this DynamicVBO; otherwise those operations do nothing.
 	 */
 	DynamicVBO();
 	/**
-	 * Initializes the VBO and IBO, and assigns indexes to each of the TerrainPolygons as the indexes
-	 * appear in the VBO. This method must be invoked otherwise the draw method will cause the
-	 * dynamic vbo to throw an exception.
-	 * <br><br>
-	 * <b><u>Note:</u>Re-adding a TerrainPolygon to the same VBO without removing it or adding a TerrainPolygon to
-	 * two or more VBOs at the same time will cause the IBO indexes to be overwritten. This makes it
-	 * functionally impossible to remove the TerrainPolygon from any VBOs but the last, a
-	 * pseudo memory leak</b>
+	 * Initializes the VBO and IBO with an initial set of polygons, uploading each buffer once.
+	 * @param polys the polygons to start with. Their handles are 0 to polys->size() - 1, in order
+	 * @param texture the texture to draw the polygons with, which may be nullptr
 	 */
 	void create(std::shared_ptr<FlexArray<TerrainPolygon>> &polys, std::shared_ptr<Texture> texture);
 	/**
-	 * Draws the terrain as specified by the index buffer object associated with this terrain renderer.
-	 * @param cam the Camera that will be used to properly display the terrain
-	 * @throws IllegalStateException - the create(...) method has not been called so there is no data
-	 * in the buffer to draw
+	 * Initializes empty buffers, to be filled with add(...) or addVertices(...).
+	 * @param vertexCapacity the number of vertices there is room for before the vertex buffer has to grow
+	 * @param texture the texture to draw the polygons with, which may be nullptr
+	 */
+	void create(int vertexCapacity, std::shared_ptr<Texture> texture);
+	/**
+	 * Draws every polygon currently in the buffer with one indexed draw call.
+	 * @param cam the Camera that will be used to properly display the polygons
 	 */
 	void draw(Camera *cam);
 	/**
-     * <i> Javadoc comment pending finalized functionality. </i><br>
-	 * Iteration 1: the number of vertices to remove is not strictly enforced
-	 * likewise, it's assumed the vbo:ibo mapping is one to one, that is each
-	 * of the ibo indexes maps one-to-one to a set of vertex data in the vbo
-	 *
-	 * @param iboIndexes an int[], where each element of the array is a value
-	 * that will be removed from the vbo. The vertex removed for each element e, will
-	 * be the one at ibo.get(e), however, this data will also be purged from the vbo
-	 * when the index is removed from the ibo.
-	 * @throws IllegalStateException - the create(...) method has not been called so there is no data
-	 * in the buffer to draw
+	 * Removes a polygon or block from the buffer. Its vertex range is returned to the free-list, and a polygon's
+	 * triangles are replaced by the last triangles of the index buffer.
+	 * @param handle a handle returned by add(...) or addVertices(...), or assigned by create(...)
+	 */
+	void remove(int handle);
+	/**
+	 * Adds a polygon to the buffer, growing the buffers if they are full.
+	 * @param poly the polygon to add. It is drawn as a triangle fan
+	 * @return a handle that can be passed to remove(...)
+	 */
+	int add(TerrainPolygon &poly);
+	/**
+	 * Adds a polygon described by raw vertex data in the TerrainPolygon layout.
+	 * @param data TerrainPolygon::TOTAL_ROW_SIZE floats per vertex
+	 * @param vertexCount the number of vertices. They are drawn as a triangle fan
+	 * @return a handle that can be passed to remove(...)
 	 */
-	void remove(FlexArray<int> iboIndexes);
+	int add(const float *data, int vertexCount);
 	/**
-	 * Adds a TerrainPolygon to this Dynamic VBO.
-	 * <br><br>
-	 * <b><u>Note:</u>Re-adding a TerrainPolygon to the same VBO without removing it or adding a TerrainPolygon to
-	 * two or more VBOs at the same time will cause the IBO indexes to be overwritten. This makes it
-	 * functionally impossible to remove the TerrainPolygon from any VBOs but the last, a
-	 * pseudo memory leak</b>
-	 * @param poly
-	 * @throws IllegalStateException - the create(...) method has not been called so there is no data
-	 * in the buffer to draw
+	 * Adds a block of vertices in the TerrainPolygon layout that draw(...) does not draw. The caller draws it with its
+	 * own index buffer after bindVertices(), offsetting the indices by getFirstVertex(...).
+	 * @param data TerrainPolygon::TOTAL_ROW_SIZE floats per vertex
+	 * @param vertexCount the number of vertices
+	 * @return a handle that can be passed to updateVertices(...) and remove(...)
 	 */
-	void add(TerrainPolygon &poly);
+	int addVertices(const float *data, int vertexCount);
+	/**
+	 * Overwrites some of the vertices of a block or polygon, uploading only those vertices.
+	 * @param handle a handle returned by add(...) or addVertices(...), or assigned by create(...)
+	 * @param offset the first vertex to overwrite, counted from the start of the block
+	 * @param data TerrainPolygon::TOTAL_ROW_SIZE floats per vertex
+	 * @param vertexCount the number of vertices to overwrite. Vertices past the end of the block are ignored
+	 */
+	void updateVertices(int handle, int offset, const float *data, int vertexCount);
+	/**
+	 * Gets the index of the first vertex of a block or polygon in the vertex buffer, or -1 for an unknown handle.
+	 */
+	int getFirstVertex(int handle);
+	/**
+	 * Binds the vertex array object. On the fixed function path the vertex buffer is bound instead and the client
+	 * arrays are pointed at its start. Nothing is drawn, and the element buffer is left to the caller.
+	 */
+	void bindVertices();
+	/**
+	 * Gets the number of triangles that draw(...) will draw.
+	 */
+	int getTriangleCount();
 	/**
 	 * Frees the allocated resources.
 	 */
 	~DynamicVBO();
 };
 
-
-
 #endif
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <glbinding/Binding.h>
+#include <glbinding/callbacks.h>
+#include "render/glcallstats.h"
+#include "render/staticmeshbuffer.h"
+
+using namespace gl;
+
+static const char *SECTION_NAMES[GL_CALL_SECTION_COUNT] = { "other", "terrain", "grass", "models", "projectiles", "ui" };
+
+static bool enabled = false;
+static std::ofstream csvFile;
+static unsigned long long frame = 0;
+static GLCallSection currentSection = GLCallSection::OTHER;
+/** This frame's counts, by section and by the function called. */
+static std::unordered_map<const glbinding::AbstractFunction*, GLCallCounts> functionCounts[GL_CALL_SECTION_COUNT];
+static GLCallCounts lastFrame[GL_CALL_SECTION_COUNT];
+static std::chrono::steady_clock::time_point callStart;
+/** What the typed callbacks found out about the call in progress, added to its counts once it returns. */
+static GLCallCounts pending;
+/** The commands of the next indirect draw, from setGLIndirectCommands(...). */
+static const DrawElementsIndirectCommand *indirectCommands = nullptr;
+static int indirectCommandCount = 0;
+
+/**
+ * Gets the number of primitives a draw of some number of vertices makes.
+ */
+static long long countPrimitives(GLenum mode, long long vertices)
+{
+	switch (mode)
+	{
+	case GL_POINTS:
+		return vertices;
+	case GL_LINES:
+		return vertices / 2;
+	case GL_LINE_LOOP:
+		return (vertices >= 2) ? vertices : 0;
+	case GL_LINE_STRIP:
+		return std::max(vertices - 1, 0LL);
+	case GL_TRIANGLES:
+		return vertices / 3;
+	case GL_TRIANGLE_STRIP:
+	case GL_TRIANGLE_FAN:
+		return std::max(vertices - 2, 0LL);
+	case GL_QUADS:
+		return vertices / 4;
+	case GL_QUAD_STRIP:
+		return std::max((vertices - 2) / 2, 0LL);
+	case GL_POLYGON:
+		return (vertices >= 3) ? 1 : 0;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Gets the size of one pixel of uncompressed texture data, ignoring row alignment.
+ */
+static long long getPixelBytes(GLenum format, GLenum type)
+{
+	switch (type)
+	{
+	case GL_UNSIGNED_SHORT_5_6_5:
+	case GL_UNSIGNED_SHORT_4_4_4_4:
+	case GL_UNSIGNED_SHORT_5_5_5_1:
+		return 2;
+	case GL_UNSIGNED_INT_8_8_8_8:
+	case GL_UNSIGNED_INT_8_8_8_8_REV:
+	case GL_UNSIGNED_INT_2_10_10_10_REV:
+	case GL_UNSIGNED_INT_24_8:
+		return 4;
+	default:
+		break;
+	}
+	long long componentBytes = 1;
+	if (type == GL_SHORT || type == GL_UNSIGNED_SHORT || type == GL_HALF_FLOAT)
+	{
+		componentBytes = 2;
+	}
+	else if (type == GL_INT || type == GL_UNSIGNED_INT || type == GL_FLOAT)
+	{
+		componentBytes = 4;
+	}
+	long long components = 4;
+	if (format == GL_RED || format == GL_ALPHA || format == GL_LUMINANCE || format == GL_DEPTH_COMPONENT)
+	{
+		components = 1;
+	}
+	else if (format == GL_RG || format == GL_LUMINANCE_ALPHA)
+	{
+		components = 2;
+	}
+	else if (format == GL_RGB || format == GL_BGR)
+	{
+		components = 3;
+	}
+	return components * componentBytes;
+}
+
+static void countDraw(GLenum mode, long long vertices, long long instances)
+{
+	pending.drawCalls++;
+	pending.primitives += countPrimitives(mode, vertices) * instances;
+}
+
+/**
+ * Counts the draws of a glMultiDrawElementsIndirect from the commands given to setGLIndirectCommands(...).
+ */
+static void countIndirectDraws(GLenum mode, GLsizei drawCount)
+{
+	if (!indirectCommands || indirectCommandCount != drawCount)
+	{
+		pending.drawCalls += drawCount;
+	}
+	else
+	{
+		for (GLsizei i = 0; i < drawCount; i++)
+		{
+			countDraw(mode, indirectCommands[i].count, indirectCommands[i].instanceCount);
+		}
+	}
+	indirectCommands = nullptr;
+	indirectCommandCount = 0;
+}
+
+/**
+ * Gives the functions that upload data or draw typed callbacks, which see their arguments without glbinding
+ * having to record every call's parameters.
+ */
+static void installTypedCallbacks()
+{
+	using glbinding::Binding;
+	Binding::BufferData.setAfterCallback([](GLenum, GLsizeiptr size, const void *data, GLenum) {
+		if (data)
+			pending.bufferBytes += size;
+	});
+	Binding::BufferSubData.setAfterCallback([](GLenum, GLintptr, GLsizeiptr size, const void*) {
+		pending.bufferBytes += size;
+	});
+	Binding::MapBufferRange.setAfterCallback([](void*, GLenum, GLintptr, GLsizeiptr length, BufferAccessMask access) {
+		// A persistent mapping is made once and written through for many frames, so it is not a per-frame upload.
+		unsigned int bits = static_cast<unsigned int>(access);
+		if ((bits & static_cast<unsigned int>(BufferAccessMask::GL_MAP_WRITE_BIT)) &&
+			!(bits & static_cast<unsigned int>(BufferAccessMask::GL_MAP_PERSISTENT_BIT)))
+			pending.mappedBytes += length;
+	});
+	Binding::TexImage2D.setAfterCallback([](GLenum, GLint, GLint, GLsizei width, GLsizei height, GLint, GLenum format,
+		GLenum type, const void *pixels) {
+		if (pixels)
+			pending.textureBytes += static_cast<long long>(width) * height * getPixelBytes(format, type);
+	});
+	Binding::TexSubImage2D.setAfterCallback([](GLenum, GLint, GLint, GLint, GLsizei width, GLsizei height,
+		GLenum format, GLenum type, const void*) {
+		pending.textureBytes += static_cast<long long>(width) * height * getPixelBytes(format, type);
+	});
+	Binding::CompressedTexImage2D.setAfterCallback([](GLenum, GLint, GLenum, GLsizei, GLsizei, GLint,
+		GLsizei imageSize, const void *data) {
+		if (data)
+			pending.textureBytes += imageSize;
+	});
+	Binding::CompressedTexSubImage2D.setAfterCallback([](GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum,
+		GLsizei imageSize, const void*) {
+		pending.textureBytes += imageSize;
+	});
+	Binding::DrawArrays.setAfterCallback([](GLenum mode, GLint, GLsizei count) {
+		countDraw(mode, count, 1);
+	});
+	Binding::DrawArraysInstanced.setAfterCallback([](GLenum mode, GLint, GLsizei count, GLsizei instances) {
+		countDraw(mode, count, instances);
+	});
+	Binding::DrawElements.setAfterCallback([](GLenum mode, GLsizei count, GLenum, const void*) {
+		countDraw(mode, count, 1);
+	});
+	Binding::DrawElementsBaseVertex.setAfterCallback([](GLenum mode, GLsizei count, GLenum, const void*, GLint) {
+		countDraw(mode, count, 1);
+	});
+	Binding::DrawElementsInstanced.setAfterCallback([](GLenum mode, GLsizei count, GLenum, const void*,
+		GLsizei instances) {
+		countDraw(mode, count, instances);
+	});
+	Binding::DrawElementsInstancedBaseVertex.setAfterCallback([](GLenum mode, GLsizei count, GLenum, const void*,
+		GLsizei instances, GLint) {
+		countDraw(mode, count, instances);
+	});
+	Binding::MultiDrawElementsIndirect.setAfterCallback([](GLenum mode, GLenum, const void*, GLsizei drawCount,
+		GLsizei) {
+		countIndirectDraws(mode, drawCount);
+	});
+	// Immediate mode draws are counted when they end; their vertices are not.
+	Binding::End.setAfterCallback([]() {
+		pending.drawCalls++;
+	});
+}
+
+static void addCounts(GLCallCounts &total, const GLCallCounts &counts)
+{
+	total.calls += counts.calls;
+	total.driverMicroseconds += counts.driverMicroseconds;
+	total.bufferBytes += counts.bufferBytes;
+	total.mappedBytes += counts.mappedBytes;
+	total.textureBytes += counts.textureBytes;
+	total.drawCalls += counts.drawCalls;
+	total.primitives += counts.primitives;
+}
+
+bool enableGLCallStats(const std::string &csvPath)
+{
+	if (enabled)
+	{
+		return true;
+	}
+	csvFile.open(csvPath.c_str(), std::ios::out | std::ios::trunc);
+	if (!csvFile.is_open())
+	{
+		std::cout << "Error: could not open " << csvPath << " for GL call stats" << std::endl;
+		return false;
+	}
+	csvFile << "frame,section,function,calls,driver_us,buffer_bytes,mapped_bytes,texture_bytes,draw_calls,primitives\n";
+	pending = GLCallCounts();
+
+	glbinding::setBeforeCallback([](const glbinding::FunctionCall&) {
+		callStart = std::chrono::steady_clock::now();
+	});
+	glbinding::setAfterCallback([](const glbinding::FunctionCall &call) {
+		std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - callStart;
+		GLCallCounts &counts = functionCounts[static_cast<int>(currentSection)][&call.function];
+		pending.calls = 1;
+		pending.driverMicroseconds = elapsed.count();
+		addCounts(counts, pending);
+		pending = GLCallCounts();
+	});
+	installTypedCallbacks();
+	glbinding::setCallbackMask(glbinding::CallbackMask::Before | glbinding::CallbackMask::After);
+	enabled = true;
+	std::cout << "Writing GL call stats to " << csvPath << std::endl;
+	return true;
+}
+
+bool isGLCallStatsEnabled()
+{
+	return enabled;
+}
+
+void setGLCallSection(GLCallSection section)
+{
+	currentSection = section;
+}
+
+void setGLIndirectCommands(const DrawElementsIndirectCommand *commands, int drawCount)
+{
+	if (!enabled)
+	{
+		return;
+	}
+	indirectCommands = commands;
+	indirectCommandCount = drawCount;
+}
+
+void endGLCallStatsFrame()
+{
+	if (!enabled)
+	{
+		return;
+	}
+	for (int s = 0; s < GL_CALL_SECTION_COUNT; s++)
+	{
+		lastFrame[s] = GLCallCounts();
+		for (auto &entry : functionCounts[s])
+		{
+			const GLCallCounts &counts = entry.second;
+			csvFile << frame << ',' << SECTION_NAMES[s] << ',' << entry.first->name() << ',' << counts.calls << ','
+				<< counts.driverMicroseconds << ',' << counts.bufferBytes << ',' << counts.mappedBytes << ','
+				<< counts.textureBytes << ',' << counts.drawCalls << ',' << counts.primitives << '\n';
+			addCounts(lastFrame[s], counts);
+		}
+		functionCounts[s].clear();
+	}
+	// Flushed every frame so the file is complete up to the last frame if the game is killed.
+	csvFile.flush();
+	frame++;
+	currentSection = GLCallSection::OTHER;
+}
+
+GLCallCounts getGLCallStats(GLCallSection section)
+{
+	return lastFrame[static_cast<int>(section)];
+}
@@ -0,0 +1,83 @@
+#ifndef ENG_GL_CALL_STATS_H
+#define ENG_GL_CALL_STATS_H
+
+#include <string>
+
+struct DrawElementsIndirectCommand;
+
+///
+/// Opt-in accounting of every GL call made through glbinding. When enabled, a before and after callback is run
+/// around each call to count it and time it, and the calls that upload data or draw are also given typed callbacks
+/// that read their arguments. Calls are attributed to the GLCallSection set at the time, and each frame is written
+/// to a CSV file with one row per section and function:
+///
+///   frame,section,function,calls,driver_us,buffer_bytes,mapped_bytes,texture_bytes,draw_calls,primitives
+///
+/// driver_us is the wall time spent inside the calls, including the callbacks' own overhead. mapped_bytes counts
+/// ranges mapped for writing with glMapBufferRange; writes through a persistent mapping and uploads made by
+/// libraries that call GL directly, such as SOIL, are not seen. Indirect draws are counted from the CPU side copy of
+/// their commands that the caller passes to setGLIndirectCommands(...), as reading them back from the GPU would stall
+/// inside the timed call. Nothing here depends on the platform, so it works under any context, including Mesa on a
+/// headless machine.
+///
+
+/** The parts of a frame GL calls are attributed to. */
+enum class GLCallSection
+{
+	OTHER,
+	TERRAIN,
+	GRASS,
+	/** The instanced model pass: trees, enemies and the player's gun are submitted together. */
+	MODELS,
+	PROJECTILES,
+	UI
+};
+const int GL_CALL_SECTION_COUNT = 6;
+
+/**
+ * GLCallCounts totals the calls made by one function, or by one section, over a frame.
+ */
+struct GLCallCounts
+{
+	long long calls;
+	double driverMicroseconds;
+	long long bufferBytes;
+	long long mappedBytes;
+	long long textureBytes;
+	long long drawCalls;
+	long long primitives;
+};
+
+/**
+ * Installs the callbacks and starts writing to a CSV file. glbinding must already be initialized for the current
+ * context.
+ * @param csvPath the path of the CSV file, which is replaced if it exists
+ * @return false if the file could not be opened, in which case nothing is installed
+ */
+bool enableGLCallStats(const std::string &csvPath);
+/**
+ * Gets whether enableGLCallStats(...) has installed the callbacks.
+ */
+bool isGLCallStatsEnabled();
+/**
+ * Attributes the GL calls made from now on to a section of the frame.
+ */
+void setGLCallSection(GLCallSection section);
+/**
+ * Gives the commands of the next glMultiDrawElementsIndirect, so its draws and primitives can be counted. Without
+ * them only the number of draws is known. Does nothing unless the stats are enabled.
+ * @param commands the commands, which must stay valid until the draw is made
+ * @param drawCount the number of commands
+ */
+void setGLIndirectCommands(const DrawElementsIndirectCommand *commands, int drawCount);
+/**
+ * Ends the counting period for the current frame. The frame is written to the CSV file, its section totals become
+ * available through getGLCallStats(...) and the running counts are reset. The section goes back to OTHER.
+ */
+void endGLCallStatsFrame();
+/**
+ * Gets the totals of one section over the last completed frame. These are all zero unless the stats are enabled.
+ */
+GLCallCounts getGLCallStats(GLCallSection section);
+
+#endif
@@ -3,7 +3,7 @@
 #include "glfont.h"
 using namespace gl;
 
-GLFont::GLFont() : ok(false)
+GLFont::GLFont() : characters(), ok(false), textCacheUses(0)
 {
 }
 
@@ -23,7 +23,7 @@ void GLFont::Create(std::shared_ptr<Texture> tex)
 		c.ty2 = ty - 16.0f / 256.0f;
 		c.width = 16;
 		c.height = 16;
-		characters.insert({static_cast<char>(48 + i), c });
+		characters[48 + i] = c;
 
 		tx += 16.0f / 256.0f;
 	}
@@ -34,7 +34,7 @@ void GLFont::Create(std::shared_ptr<Texture> tex)
 	c.ty2 = ty - 16.0f / 256.0f;
 	c.width = 16;
 	c.height = 16;
-	characters.insert({ 48 , c });
+	characters[48] = c;
 
 	tx = 0.0f;
 	ty = 1.0f - 16.0f / 256.0f;
@@ -53,7 +53,7 @@ void GLFont::Create(std::shared_ptr<Texture> tex)
 		c.width = 16;
 		c.height = 16;
 
-		characters.insert({ i, c });
+		characters[static_cast<unsigned char>(i)] = c;
 
 		tx += 16.0f / 256.0f;
 	}
@@ -65,7 +65,7 @@ void GLFont::Create(std::shared_ptr<Texture> tex)
 	c.ty2 = ty - 32.0f / 256.0f;
 	c.width = 16;
 	c.height = 16;
-	characters.insert({ ':' , c });
+	characters[static_cast<unsigned char>(':')] = c;
 
 	ok = true;
 }
@@ -94,7 +94,7 @@ void GLFont::TextOut(std::string String, float x, float y, float z)
 	for (int i = 0; i < Length; i++)
 	{
 		//Get pointer to glFont character
-		GLFontChar* Char = &characters[String[i]];
+		GLFontChar* Char = &characters[static_cast<unsigned char>(String[i])];
 
 		//Specify vertices and texture coordinates
 		glTexCoord2f(Char->tx1, Char->ty1);
@@ -113,3 +113,64 @@ void GLFont::TextOut(std::string String, float x, float y, float z)
 	//Stop rendering quads
 	glEnd();
 }
+
+/**
+ * Finds the cached mesh for a line of text, or takes over the least recently used one and rebuilds it. Entries keep
+ * their storage when they are reused, so once the cache has warmed up nothing here allocates.
+ */
+const SpriteMesh &GLFont::getTextMesh(const char *text, size_t length, float x, float y, const Colour &colour)
+{
+	textCacheUses++;
+	CachedText *oldest = nullptr;
+	for (CachedText &entry : textCache)
+	{
+		if (entry.x == x && entry.y == y && entry.colour.r == colour.r && entry.colour.g == colour.g &&
+			entry.colour.b == colour.b && entry.colour.a == colour.a && entry.text.compare(0, std::string::npos, text, length) == 0)
+		{
+			entry.lastUse = textCacheUses;
+			return entry.mesh;
+		}
+		if (!oldest || entry.lastUse < oldest->lastUse)
+		{
+			oldest = &entry;
+		}
+	}
+	if (textCache.size() < GLFONT_TEXT_CACHE_SIZE)
+	{
+		textCache.push_back(CachedText());
+		oldest = &textCache.back();
+	}
+	CachedText &entry = *oldest;
+	entry.text.assign(text, length);
+	entry.x = x;
+	entry.y = y;
+	entry.colour = colour;
+	entry.lastUse = textCacheUses;
+	entry.mesh.clear();
+	for (size_t i = 0; i < length; i++)
+	{
+		// Characters the font does not have are all zero, so they take up no space.
+		const GLFontChar &glyph = characters[static_cast<unsigned char>(text[i])];
+		if (glyph.width > 0)
+		{
+			entry.mesh.addQuad(x, y, x + glyph.width, y + glyph.height, glyph.tx1, glyph.ty1, glyph.tx2, glyph.ty2,
+				colour);
+		}
+		x += glyph.width;
+	}
+	return entry.mesh;
+}
+
+void GLFont::TextOut(SpriteBatch &batch, const char *text, size_t length, float x, float y, const Colour &colour)
+{
+	if (!ok)
+	{
+		throw GLFontError::InvalidFont();
+	}
+	batch.add(fontTexture, getTextMesh(text, length, x, y, colour));
+}
+
+void GLFont::TextOut(SpriteBatch &batch, const std::string &text, float x, float y, const Colour &colour)
+{
+	TextOut(batch, text.data(), text.size(), x, y, colour);
+}
@@ -1,11 +1,14 @@
 #ifndef _glfonth_
 #define _glfonth_
 
+#include <cstddef>
 #include <string>
-#include <map>
 #include <memory>
+#include <vector>
 #include <glbinding/gl/gl.h>
+#include "render/spritebatch.h"
 #include "render/texture.h"
+#include "utils/colour.h"
 
 namespace GLFontError 
 {
@@ -20,6 +23,9 @@ public:
 	float width, height;
 };
 
+/** The number of lines of text whose meshes a GLFont keeps. */
+const size_t GLFONT_TEXT_CACHE_SIZE = 32;
+
 class GLFont 
 {
 public:
@@ -27,12 +33,38 @@ public:
 	~GLFont();
 	const int textureWidth = 256;
 	const int textureHeight = 256;
-	std::map<char, GLFontChar> characters;
+	/** Indexed by the character's unsigned value. Characters the font does not have are all zero. */
+	GLFontChar characters[256];
 	std::shared_ptr<Texture> fontTexture;
 	bool ok;
 
 	void Create(std::shared_ptr<Texture> tex);
 	void TextOut(std::string String, float x, float y, float z);
+	/**
+	 * Adds a line of text to a SpriteBatch, with the top left of its first character at (x, y). The text's mesh is
+	 * cached by its contents, position and colour, so text that has not changed since an earlier frame is copied
+	 * into the batch rather than built again.
+	 * @param text the characters of the text, which need not be null terminated
+	 * @param length the number of characters
+	 */
+	void TextOut(SpriteBatch &batch, const char *text, size_t length, float x, float y, const Colour &colour);
+	void TextOut(SpriteBatch &batch, const std::string &text, float x, float y, const Colour &colour);
+private:
+	/**
+	 * The mesh of a line of text drawn recently.
+	 */
+	struct CachedText
+	{
+		std::string text;
+		float x;
+		float y;
+		Colour colour;
+		SpriteMesh mesh;
+		unsigned long long lastUse;
+	};
+	std::vector<CachedText> textCache;
+	unsigned long long textCacheUses;
+	const SpriteMesh &getTextMesh(const char *text, size_t length, float x, float y, const Colour &colour);
 };
 
 #endif
@@ -0,0 +1,330 @@
+#include "render/glstate.h"
+
+using namespace gl;
+
+static const int UNKNOWN = -1;
+static const unsigned int UNKNOWN_ID = 0xFFFFFFFFu;
+static const int MAX_TRACKED_CAPS = 8;
+static const int MAX_CLIENT_ARRAYS = 4;
+static const int MAX_TEXTURE_UNITS = 16;
+
+/**
+ * The shadow copy of the context. Tri-state flags use UNKNOWN, 0 and 1; bindings use UNKNOWN_ID.
+ */
+struct GLStateShadow
+{
+	int caps[MAX_TRACKED_CAPS];
+	/** GL_TEXTURE_2D is enabled and disabled per texture unit, so it is kept apart from the other caps. */
+	int texture2D[MAX_TEXTURE_UNITS];
+	int clientArrays[MAX_CLIENT_ARRAYS];
+	unsigned int textures[MAX_TEXTURE_UNITS];
+	unsigned int arrayBuffer;
+	unsigned int elementArrayBuffer;
+	unsigned int vertexArray;
+	unsigned int program;
+	int activeUnit;
+	GLenum alphaFunc;
+	float alphaRef;
+	bool alphaKnown;
+	GLStateShadow()
+	{
+		reset();
+	}
+	void reset()
+	{
+		for (int i = 0; i < MAX_TRACKED_CAPS; i++)
+			caps[i] = UNKNOWN;
+		for (int i = 0; i < MAX_CLIENT_ARRAYS; i++)
+			clientArrays[i] = UNKNOWN;
+		for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+		{
+			texture2D[i] = UNKNOWN;
+			textures[i] = UNKNOWN_ID;
+		}
+		arrayBuffer = UNKNOWN_ID;
+		elementArrayBuffer = UNKNOWN_ID;
+		vertexArray = UNKNOWN_ID;
+		program = UNKNOWN_ID;
+		activeUnit = UNKNOWN;
+		alphaKnown = false;
+	}
+};
+
+static GLStateShadow shadow;
+/** Set once any vertex array object has been bound, as contexts without them cannot unbind one. */
+static bool vertexArraysUsed = false;
+static GLStateCounters current = { 0, 0 };
+static GLStateCounters lastFrame = { 0, 0 };
+
+static int capSlot(GLenum cap)
+{
+	switch (cap)
+	{
+	case GL_BLEND:        return 0;
+	case GL_ALPHA_TEST:   return 1;
+	case GL_CULL_FACE:    return 2;
+	case GL_DEPTH_TEST:   return 3;
+	case GL_LIGHTING:     return 4;
+	case GL_FOG:          return 5;
+	default:              return UNKNOWN;
+	}
+}
+
+/**
+ * Texture bindings are tracked per unit, so unit 0 is assumed until setActiveTexture says otherwise.
+ */
+static int currentUnit()
+{
+	return (shadow.activeUnit == UNKNOWN) ? 0 : shadow.activeUnit;
+}
+
+/**
+ * Gets the shadowed flag of a capability, which for GL_TEXTURE_2D is the active unit's.
+ * @return nullptr if the capability is not tracked
+ */
+static int *capState(GLenum cap)
+{
+	if (cap == GL_TEXTURE_2D)
+		return &shadow.texture2D[currentUnit()];
+	int slot = capSlot(cap);
+	return (slot != UNKNOWN) ? &shadow.caps[slot] : nullptr;
+}
+
+static int clientArraySlot(GLenum array)
+{
+	switch (array)
+	{
+	case GL_VERTEX_ARRAY:        return 0;
+	case GL_NORMAL_ARRAY:        return 1;
+	case GL_COLOR_ARRAY:         return 2;
+	case GL_TEXTURE_COORD_ARRAY: return 3;
+	default:                     return UNKNOWN;
+	}
+}
+
+
+static inline bool filter(bool redundant)
+{
+	if (redundant)
+		current.filtered++;
+	else
+		current.issued++;
+	return redundant;
+}
+
+void enableState(GLenum cap)
+{
+	int *state = capState(cap);
+	if (state)
+	{
+		if (filter(*state == 1))
+			return;
+		*state = 1;
+	}
+	else
+	{
+		current.issued++;
+	}
+	glEnable(cap);
+}
+
+void disableState(GLenum cap)
+{
+	int *state = capState(cap);
+	if (state)
+	{
+		if (filter(*state == 0))
+			return;
+		*state = 0;
+	}
+	else
+	{
+		current.issued++;
+	}
+	glDisable(cap);
+}
+
+void enableClientArray(GLenum array)
+{
+	int slot = clientArraySlot(array);
+	if (slot != UNKNOWN)
+	{
+		if (filter(shadow.clientArrays[slot] == 1))
+			return;
+		shadow.clientArrays[slot] = 1;
+	}
+	else
+	{
+		current.issued++;
+	}
+	glEnableClientState(array);
+}
+
+void disableClientArray(GLenum array)
+{
+	int slot = clientArraySlot(array);
+	if (slot != UNKNOWN)
+	{
+		if (filter(shadow.clientArrays[slot] == 0))
+			return;
+		shadow.clientArrays[slot] = 0;
+	}
+	else
+	{
+		current.issued++;
+	}
+	glDisableClientState(array);
+}
+
+void setClientArrays(bool vertex, bool normal, bool colour, bool textureCoord)
+{
+	if (vertexArraysUsed)
+		bindVertexArray(0);
+	vertex ? enableClientArray(GL_VERTEX_ARRAY) : disableClientArray(GL_VERTEX_ARRAY);
+	normal ? enableClientArray(GL_NORMAL_ARRAY) : disableClientArray(GL_NORMAL_ARRAY);
+	colour ? enableClientArray(GL_COLOR_ARRAY) : disableClientArray(GL_COLOR_ARRAY);
+	textureCoord ? enableClientArray(GL_TEXTURE_COORD_ARRAY) : disableClientArray(GL_TEXTURE_COORD_ARRAY);
+}
+
+void setAlphaFunc(GLenum func, GLfloat ref)
+{
+	if (filter(shadow.alphaKnown && shadow.alphaFunc == func && shadow.alphaRef == ref))
+		return;
+	shadow.alphaKnown = true;
+	shadow.alphaFunc = func;
+	shadow.alphaRef = ref;
+	glAlphaFunc(func, ref);
+}
+
+void setActiveTexture(GLenum unit)
+{
+	int index = static_cast<int>(unit) - static_cast<int>(GL_TEXTURE0);
+	if (index < 0 || index >= MAX_TEXTURE_UNITS)
+	{
+		// Out of the tracked range, so we no longer know which unit bindTexture2D applies to.
+		current.issued++;
+		shadow.activeUnit = UNKNOWN;
+		for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+		{
+			shadow.texture2D[i] = UNKNOWN;
+			shadow.textures[i] = UNKNOWN_ID;
+		}
+		glActiveTexture(unit);
+		return;
+	}
+	if (filter(shadow.activeUnit == index))
+		return;
+	shadow.activeUnit = index;
+	glActiveTexture(unit);
+}
+
+void bindTexture2D(GLuint textureID)
+{
+	int unit = currentUnit();
+	if (filter(shadow.textures[unit] == textureID))
+		return;
+	shadow.textures[unit] = textureID;
+	glBindTexture(GL_TEXTURE_2D, textureID);
+}
+
+void bindBuffer(GLenum target, GLuint bufferID)
+{
+	unsigned int *slot = nullptr;
+	if (target == GL_ARRAY_BUFFER)
+		slot = &shadow.arrayBuffer;
+	else if (target == GL_ELEMENT_ARRAY_BUFFER)
+		slot = &shadow.elementArrayBuffer;
+
+	if (slot)
+	{
+		if (filter(*slot == bufferID))
+			return;
+		*slot = bufferID;
+	}
+	else
+	{
+		current.issued++;
+	}
+	glBindBuffer(target, bufferID);
+}
+
+void bindVertexArray(GLuint vertexArrayID)
+{
+	vertexArraysUsed = true;
+	if (filter(shadow.vertexArray == vertexArrayID))
+		return;
+	shadow.vertexArray = vertexArrayID;
+	// Both are part of the vertex array object that was just bound.
+	shadow.elementArrayBuffer = UNKNOWN_ID;
+	for (int i = 0; i < MAX_CLIENT_ARRAYS; i++)
+		shadow.clientArrays[i] = UNKNOWN;
+	glBindVertexArray(vertexArrayID);
+}
+
+bool isStateEnabled(GLenum cap)
+{
+	int *state = capState(cap);
+	return state && *state == 1;
+}
+
+bool getAlphaFunc(GLenum &func, GLfloat &ref)
+{
+	if (!shadow.alphaKnown)
+		return false;
+	func = shadow.alphaFunc;
+	ref = shadow.alphaRef;
+	return true;
+}
+
+void useProgram(GLuint programID)
+{
+	if (filter(shadow.program == programID))
+		return;
+	shadow.program = programID;
+	glUseProgram(programID);
+}
+
+void notifyTextureDeleted(GLuint textureID)
+{
+	for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+	{
+		if (shadow.textures[i] == textureID)
+			shadow.textures[i] = 0;
+	}
+}
+
+void notifyBufferDeleted(GLuint bufferID)
+{
+	if (shadow.arrayBuffer == bufferID)
+		shadow.arrayBuffer = 0;
+	if (shadow.elementArrayBuffer == bufferID)
+		shadow.elementArrayBuffer = 0;
+}
+
+void notifyVertexArrayDeleted(GLuint vertexArrayID)
+{
+	if (shadow.vertexArray == vertexArrayID)
+	{
+		shadow.vertexArray = 0;
+		shadow.elementArrayBuffer = UNKNOWN_ID;
+		for (int i = 0; i < MAX_CLIENT_ARRAYS; i++)
+			shadow.clientArrays[i] = UNKNOWN;
+	}
+}
+
+void invalidateGLState()
+{
+	shadow.reset();
+}
+
+void endGLStateFrame()
+{
+	lastFrame = current;
+	current.issued = 0;
+	current.filtered = 0;
+}
+
+GLStateCounters getGLStateCounters()
+{
+	return lastFrame;
+}
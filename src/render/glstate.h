@@ -0,0 +1,123 @@
+#ifndef ENG_GL_STATE_H
+#define ENG_GL_STATE_H
+
+#include <glbinding/gl/gl.h>
+
+///
+/// A shadow copy of the OpenGL state used by the renderer. Each function in this file mirrors a raw
+/// gl call, but first compares the requested value against the last value that was sent to the driver
+/// and drops the call if nothing would change. Every piece of tracked state starts out "unknown" so the
+/// first call is always issued.
+///
+/// All code that changes tracked state must go through these functions, otherwise the shadow copy
+/// drifts away from the real context. Code that has to touch the context directly should call
+/// invalidateGLState() afterwards.
+///
+
+/**
+ * GLStateCounters records how many state changes were sent to the driver and how many were dropped
+ * because they were redundant.
+ */
+struct GLStateCounters
+{
+	int issued;
+	int filtered;
+};
+
+/**
+ * Enables a server side capability, such as GL_BLEND or GL_TEXTURE_2D, if it is not already enabled.
+ * GL_TEXTURE_2D is tracked for the active texture unit only.
+ * @param cap a GLenum which is the capability to enable
+ */
+void enableState(gl::GLenum cap);
+/**
+ * Disables a server side capability, such as GL_BLEND or GL_TEXTURE_2D, if it is not already disabled.
+ * @param cap a GLenum which is the capability to disable
+ */
+void disableState(gl::GLenum cap);
+/**
+ * Enables a client side array, such as GL_VERTEX_ARRAY, if it is not already enabled.
+ * @param array a GLenum which is the client array to enable
+ */
+void enableClientArray(gl::GLenum array);
+/**
+ * Disables a client side array, such as GL_VERTEX_ARRAY, if it is not already disabled.
+ * @param array a GLenum which is the client array to disable
+ */
+void disableClientArray(gl::GLenum array);
+/**
+ * Sets all four of the fixed function client arrays in one call. Interleaved VBOs in this engine
+ * always use all four, so this is the usual way to prepare for a draw. The client arrays belong to
+ * vertex array object 0, so if another vertex array object is bound it is unbound first.
+ */
+void setClientArrays(bool vertex, bool normal, bool colour, bool textureCoord);
+/**
+ * Sets the alpha test function if it differs from the current one.
+ */
+void setAlphaFunc(gl::GLenum func, gl::GLfloat ref);
+/**
+ * Selects the active texture unit, such as GL_TEXTURE0.
+ */
+void setActiveTexture(gl::GLenum unit);
+/**
+ * Binds a 2D texture to the active texture unit if it is not already bound there.
+ * @param textureID a GLuint which is the texture to bind, or 0 to unbind
+ */
+void bindTexture2D(gl::GLuint textureID);
+/**
+ * Binds a buffer to GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER if it is not already bound. Other
+ * targets are passed straight through to the driver.
+ */
+void bindBuffer(gl::GLenum target, gl::GLuint bufferID);
+/**
+ * Binds a vertex array object if it is not already bound. The element buffer binding is part of the
+ * vertex array object, so the cached GL_ELEMENT_ARRAY_BUFFER binding is forgotten whenever it changes.
+ * @param vertexArrayID a GLuint which is the vertex array object to bind, or 0 to unbind
+ */
+void bindVertexArray(gl::GLuint vertexArrayID);
+/**
+ * Checks whether a tracked capability, such as GL_ALPHA_TEST, was last enabled through this file.
+ */
+bool isStateEnabled(gl::GLenum cap);
+/**
+ * Gets the alpha test function last set with setAlphaFunc(...).
+ * @return false if it has not been set since the state was last invalidated
+ */
+bool getAlphaFunc(gl::GLenum &func, gl::GLfloat &ref);
+/**
+ * Makes a program current if it is not already current.
+ * @param programID a GLuint which is the program to use, or 0 for the fixed function pipeline
+ */
+void useProgram(gl::GLuint programID);
+/**
+ * Tells the state cache that a texture has been deleted. OpenGL silently unbinds a deleted texture, so
+ * any unit that held it is reset to 0.
+ */
+void notifyTextureDeleted(gl::GLuint textureID);
+/**
+ * Tells the state cache that a buffer has been deleted. OpenGL silently unbinds a deleted buffer, so
+ * any target that held it is reset to 0.
+ */
+void notifyBufferDeleted(gl::GLuint bufferID);
+/**
+ * Tells the state cache that a vertex array object has been deleted. OpenGL reverts to vertex array
+ * object 0 if it was bound.
+ */
+void notifyVertexArrayDeleted(gl::GLuint vertexArrayID);
+/**
+ * Marks every piece of tracked state as unknown, forcing the next call of each kind to be issued.
+ * This must be called after anything changes the GL context without going through this file.
+ */
+void invalidateGLState();
+/**
+ * Ends the counting period for the current frame. The counts gathered so far become available through
+ * getGLStateCounters() and the running counts are reset to zero.
+ */
+void endGLStateFrame();
+/**
+ * Gets the issued and filtered call counts of the last completed frame.
+ * @return a GLStateCounters for the previous frame
+ */
+GLStateCounters getGLStateCounters();
+
+#endif
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <glm/geometric.hpp>
+#include "render/instancedrenderer.h"
+#include "render/glcallstats.h"
+#include "render/glstate.h"
+#include "render/lodselector.h"
+#include "render/matrixstack.h"
+#include "render/meshprogram.h"
+#include "render/textureresidency.h"
+#include "graphics/rendersettingshelper.h"
+#include "utils/fileutils.h"
+
+using namespace gl;
+
+InstancedModelRenderer::InstancedModelRenderer() : instanceStream(GL_ARRAY_BUFFER, INSTANCE_STREAM_REGION_SIZE),
+	commandStream(GL_DRAW_INDIRECT_BUFFER, INDIRECT_COMMAND_REGION_SIZE), instancingAvailable(false),
+	multiDrawAvailable(false), transformLocation(-1),
+	textureUniform(Shader::INVALID_UNIFORM), useTextureUniform(Shader::INVALID_UNIFORM),
+	alphaThresholdUniform(Shader::INVALID_UNIFORM), initialized(false), lastDrawCallCount(0)
+{
+}
+
+InstancedModelRenderer::~InstancedModelRenderer()
+{
+}
+
+/**
+ * Creates the instancing shader. This needs a GL context, so it is deferred until the
+ * first draw.
+ */
+void InstancedModelRenderer::initialize()
+{
+	initialized = true;
+	std::string vertPath = buildPath("res/instanced_model.vert");
+	std::string fragPath = buildPath("res/instanced_model.frag");
+	shader = createShader(&vertPath, &fragPath);
+	if (shader)
+	{
+		transformLocation = shader->getAttributeLocation("instanceTransform");
+		textureUniform = shader->getUniform("texture1");
+		useTextureUniform = shader->getUniform("useTexture");
+		alphaThresholdUniform = shader->getUniform("alphaThreshold");
+	}
+	// The shader reads the models through the core path's generic attributes.
+	if (!shader || !isCoreRenderPathActive() || transformLocation < 0)
+	{
+		std::cout << "Instanced model shader unavailable, drawing instances one at a time." << std::endl;
+		return;
+	}
+	instancingAvailable = true;
+	multiDrawAvailable = isMultiDrawIndirectSupported();
+}
+
+/**
+ * Tells the texture residency manager how large a model's textures appear this frame.
+ * @param screenSize the model's size on screen in pixels
+ */
+static void requestModelTextures(const std::shared_ptr<Model> &model, float screenSize)
+{
+	for (std::shared_ptr<Texture> &texture : model->meshTextures)
+	{
+		requestTextureDetail(texture, screenSize);
+	}
+}
+
+/**
+ * Points the per-instance transform attributes of the bound vertex array object at a block of transforms.
+ * @param location the location of the first column of the transform
+ * @param offset the offset of the first instance's transform in the instance buffer, in bytes
+ */
+static void setInstanceTransformAttributes(GLint location, GLuint instanceBufferID, size_t offset)
+{
+	bindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+	for (int i = 0; i < 4; i++)
+	{
+		glEnableVertexAttribArray(location + i);
+		glVertexAttribDivisor(location + i, 1);
+		glVertexAttribPointer(location + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + i * sizeof(glm::vec4)));
+	}
+}
+
+void InstancedModelRenderer::add(std::shared_ptr<Model> model, const glm::mat4 &transform)
+{
+	// With no camera there is no telling how large the model is, so it gets full detail.
+	requestModelTextures(model, std::numeric_limits<float>::max());
+	InstanceBatch &batch = batches[model->getID()];
+	if (!batch.model)
+	{
+		batch.model = model;
+	}
+	batch.transforms[0].push_back(transform);
+}
+
+void InstancedModelRenderer::add(std::shared_ptr<Model> model, const glm::mat4 &transform, Camera *camera, int &lodLevel)
+{
+	float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])),
+			glm::length(glm::vec3(transform[2]))));
+	float projectedSize = getProjectedSize(glm::vec3(transform[3]), model->getBoundingRadius() * scale, camera->position);
+	lodLevel = selectLOD(projectedSize, lodLevel, model->getLODCount());
+	// The projected size is a fraction of half the screen height, so this is the model's diameter in pixels.
+	requestModelTextures(model, projectedSize * getWindowHeight());
+	InstanceBatch &batch = batches[model->getID()];
+	if (!batch.model)
+	{
+		batch.model = model;
+	}
+	batch.transforms[lodLevel].push_back(transform);
+}
+
+void InstancedModelRenderer::draw(Camera *camera)
+{
+	if (!initialized)
+	{
+		initialize();
+	}
+	lastDrawCallCount = 0;
+	if (!instancingAvailable)
+	{
+		drawWithoutInstancing(camera);
+		releaseBatches();
+		return;
+	}
+
+	// Pack every batch into one block so the stream buffer is only written once per call.
+	uploadData.clear();
+	for (auto &entry : batches)
+	{
+		for (std::vector<glm::mat4> &transforms : entry.second.transforms)
+		{
+			uploadData.insert(uploadData.end(), transforms.begin(), transforms.end());
+		}
+	}
+	if (uploadData.empty())
+	{
+		releaseBatches();
+		return;
+	}
+	size_t baseOffset = instanceStream.write(uploadData.data(), uploadData.size() * sizeof(glm::mat4));
+	GLuint instanceBufferID = instanceStream.getBufferID();
+
+	shader->bindShader();
+	shader->setUniform(textureUniform, 0);
+	shader->setUniform(alphaThresholdUniform, getAlphaTestThreshold());
+	setActiveTexture(GL_TEXTURE0);
+
+	size_t firstInstance = 0;
+	for (auto &entry : batches)
+	{
+		InstanceBatch &batch = entry.second;
+		bool packed = multiDrawAvailable && !batch.model->staticMeshIDs.empty();
+		for (int lod = 0; lod < MAX_MESH_LOD_LEVELS; lod++)
+		{
+			int count = static_cast<int>(batch.transforms[lod].size());
+			if (count == 0)
+			{
+				continue;
+			}
+			if (packed)
+			{
+				queueIndirectDraws(batch, lod, count, firstInstance);
+			}
+			else
+			{
+				for (std::shared_ptr<VBO> &vbo : batch.model->vbos)
+				{
+					vbo->bind();
+					shader->setUniform(useTextureUniform, static_cast<bool>(vbo->associatedTexture));
+					// The transform columns are attributes of the VBO's vertex array object. Only drawInstanced(...)
+					// draws with a shader that reads them, so they are left enabled.
+					setInstanceTransformAttributes(transformLocation, instanceBufferID,
+						baseOffset + firstInstance * sizeof(glm::mat4));
+					vbo->drawInstanced(count, lod);
+					lastDrawCallCount++;
+				}
+			}
+			firstInstance += count;
+			batch.transforms[lod].clear();
+		}
+	}
+	if (multiDrawAvailable)
+	{
+		drawIndirect(baseOffset, instanceBufferID);
+	}
+	releaseBatches();
+}
+
+void InstancedModelRenderer::releaseBatches()
+{
+	for (auto it = batches.begin(); it != batches.end();)
+	{
+		if (!it->second.model)
+		{
+			it = batches.erase(it);
+			continue;
+		}
+		it->second.model.reset();
+		++it;
+	}
+}
+
+void InstancedModelRenderer::queueIndirectDraws(InstanceBatch &batch, int lod, int count, size_t firstInstance)
+{
+	StaticMeshBuffer &staticMeshes = getStaticMeshBuffer();
+	for (size_t i = 0; i < batch.model->staticMeshIDs.size(); i++)
+	{
+		const StaticMesh &mesh = staticMeshes.getMesh(batch.model->staticMeshIDs[i]);
+		const MeshLOD &range = mesh.lods[std::min(lod, static_cast<int>(mesh.lods.size()) - 1)];
+		DrawElementsIndirectCommand command;
+		command.count = static_cast<GLuint>(range.indexCount);
+		command.instanceCount = static_cast<GLuint>(count);
+		command.firstIndex = static_cast<GLuint>(mesh.firstIndex + range.firstIndex);
+		command.baseVertex = mesh.baseVertex;
+		command.baseInstance = static_cast<GLuint>(firstInstance);
+		commandGroups[batch.model->meshTextures[i]].push_back(command);
+	}
+}
+
+void InstancedModelRenderer::drawIndirect(size_t baseOffset, GLuint instanceBufferID)
+{
+	commands.clear();
+	for (auto &group : commandGroups)
+	{
+		commands.insert(commands.end(), group.second.begin(), group.second.end());
+	}
+	if (commands.empty())
+	{
+		return;
+	}
+	size_t commandOffset = commandStream.write(commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+
+	// Each command's baseInstance picks its transforms, so the attributes point at the start of this frame's block.
+	getStaticMeshBuffer().bind();
+	setInstanceTransformAttributes(transformLocation, instanceBufferID, baseOffset);
+	bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandStream.getBufferID());
+	size_t firstCommand = 0;
+	for (auto &group : commandGroups)
+	{
+		GLsizei drawCount = static_cast<GLsizei>(group.second.size());
+		if (group.first)
+		{
+			group.first->bind();
+		}
+		shader->setUniform(useTextureUniform, static_cast<bool>(group.first));
+		setGLIndirectCommands(&commands[firstCommand], drawCount);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(commandOffset), drawCount, 0);
+		commandOffset += drawCount * sizeof(DrawElementsIndirectCommand);
+		firstCommand += drawCount;
+		lastDrawCallCount++;
+	}
+	// Textures can come and go between frames, so the groups are rebuilt each time.
+	commandGroups.clear();
+}
+
+void InstancedModelRenderer::drawWithoutInstancing(Camera *camera)
+{
+	MatrixStack &modelMatrices = getModelMatrixStack();
+	for (auto &entry : batches)
+	{
+		InstanceBatch &batch = entry.second;
+		for (std::vector<glm::mat4> &transforms : batch.transforms)
+		{
+			for (glm::mat4 &transform : transforms)
+			{
+				modelMatrices.push();
+				modelMatrices.multiply(transform);
+				batch.model->draw(camera);
+				modelMatrices.pop();
+				lastDrawCallCount += static_cast<int>(batch.model->data.size());
+			}
+			transforms.clear();
+		}
+	}
+}
+
+int InstancedModelRenderer::getLastDrawCallCount()
+{
+	return lastDrawCallCount;
+}
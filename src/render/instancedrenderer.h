@@ -0,0 +1,107 @@
+#ifndef ENG_INSTANCED_RENDERER_H
+#define ENG_INSTANCED_RENDERER_H
+
+#include <map>
+#include <vector>
+#include <memory>
+#include <glbinding/gl/gl.h>
+#include <glm/mat4x4.hpp>
+#include "graphics/camera.h"
+#include "graphics/model.h"
+#include "render/staticmeshbuffer.h"
+#include "render/streambuffer.h"
+#include "render/texture.h"
+#include "shaders/shader.h"
+
+/** The initial size, in bytes, of each frame's region of the instance stream: room for 4096 transforms. */
+const size_t INSTANCE_STREAM_REGION_SIZE = 4096 * sizeof(glm::mat4);
+/** The initial size, in bytes, of each frame's region of the indirect command stream: room for 1024 draws. */
+const size_t INDIRECT_COMMAND_REGION_SIZE = 1024 * sizeof(DrawElementsIndirectCommand);
+
+/**
+ * InstancedModelRenderer collects model transforms over a frame and draws every copy of the same Model with
+ * one instanced draw call per mesh. The transforms of all models are packed into one block of a StreamBuffer
+ * each time draw(...) is called, and fed to res/instanced_model.vert as a per-instance mat4 attribute. Instances added with a level of detail are grouped per level, so each level of a mesh is still
+ * one draw call.
+ * <br><br>
+ * Models whose meshes are packed into the StaticMeshBuffer are not drawn per mesh. Their draws are written to an
+ * indirect command buffer instead and submitted with one glMultiDrawElementsIndirect per texture, so the number of
+ * draw calls does not grow with the number of models or instances.
+ * <br><br>
+ * If the instancing shader cannot be created, or the core render path is not in use, the renderer falls back to
+ * drawing each instance on its own with the model matrix stack.
+ */
+class InstancedModelRenderer
+{
+public:
+	InstancedModelRenderer();
+	~InstancedModelRenderer();
+	/**
+	 * Queues one instance of a Model to be drawn on the next call to draw(...).
+	 * @param model the Model to draw. All instances sharing this Model are drawn together
+	 * @param transform the model-to-world matrix of this instance
+	 */
+	void add(std::shared_ptr<Model> model, const glm::mat4 &transform);
+	/**
+	 * Queues one instance of a Model, picking its level of detail from how large it appears from the camera.
+	 * @param model the Model to draw
+	 * @param transform the model-to-world matrix of this instance
+	 * @param camera the Camera the scene will be drawn from
+	 * @param lodLevel the level this instance was drawn at last frame. It is updated to the level chosen now, so
+	 * the caller should keep it with the instance
+	 */
+	void add(std::shared_ptr<Model> model, const glm::mat4 &transform, Camera *camera, int &lodLevel);
+	/**
+	 * Draws everything queued since the last call and clears the queue. The FrameConstants block must already
+	 * hold the camera's view; on the fixed function path the modelview matrix must hold it instead.
+	 * @param camera the Camera the scene is being drawn from
+	 */
+	void draw(Camera *camera);
+	/**
+	 * Gets the number of draw calls issued by the last call to draw(...).
+	 */
+	int getLastDrawCallCount();
+private:
+	/**
+	 * All the transforms queued for one Model during a frame, by level of detail.
+	 */
+	struct InstanceBatch
+	{
+		/** The Model, held only from its first instance until the end of draw(...). */
+		std::shared_ptr<Model> model;
+		std::vector<glm::mat4> transforms[MAX_MESH_LOD_LEVELS];
+	};
+	std::map<int, InstanceBatch> batches;
+	std::vector<glm::mat4> uploadData;
+	std::shared_ptr<Shader> shader;
+	StreamBuffer instanceStream;
+	StreamBuffer commandStream;
+	/** The indirect draws of packed models this frame, by the texture they are drawn with. */
+	std::map<std::shared_ptr<Texture>, std::vector<DrawElementsIndirectCommand>> commandGroups;
+	std::vector<DrawElementsIndirectCommand> commands;
+	bool instancingAvailable;
+	bool multiDrawAvailable;
+	gl::GLint transformLocation;
+	Shader::UniformHandle textureUniform;
+	Shader::UniformHandle useTextureUniform;
+	Shader::UniformHandle alphaThresholdUniform;
+	bool initialized;
+	int lastDrawCallCount;
+	void initialize();
+	void drawWithoutInstancing(Camera *camera);
+	/**
+	 * Lets go of every batch's Model once it is drawn, so models no longer in use can be released, and removes the
+	 * batches nothing was queued in this frame. The others are kept to reuse their transform storage.
+	 */
+	void releaseBatches();
+	/**
+	 * Queues one indirect draw per mesh of a packed Model, for count instances starting at firstInstance.
+	 */
+	void queueIndirectDraws(InstanceBatch &batch, int lod, int count, size_t firstInstance);
+	/**
+	 * Submits the queued indirect draws, reading the instance transforms from baseOffset in the instance buffer.
+	 */
+	void drawIndirect(size_t baseOffset, gl::GLuint instanceBufferID);
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cmath>
+#include "render/lightclusters.h"
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define ENG_LIGHT_CLUSTERS_SSE
+#endif
+
+LightClusterGrid::LightClusterGrid() : fieldOfView(0.0f), aspectRatio(0.0f), nearDistance(0.0f), farDistance(0.0f),
+	tanHalfHeight(0.0f), tanHalfWidth(0.0f), clusterData(2 * LIGHT_CLUSTER_COUNT, 0)
+{
+	std::fill(minX, minX + LIGHT_CLUSTER_COUNT, 0.0f);
+	std::fill(minY, minY + LIGHT_CLUSTER_COUNT, 0.0f);
+	std::fill(minZ, minZ + LIGHT_CLUSTER_COUNT, 0.0f);
+	std::fill(maxX, maxX + LIGHT_CLUSTER_COUNT, 0.0f);
+	std::fill(maxY, maxY + LIGHT_CLUSTER_COUNT, 0.0f);
+	std::fill(maxZ, maxZ + LIGHT_CLUSTER_COUNT, 0.0f);
+}
+
+float LightClusterGrid::getSliceDepth(int slice) const
+{
+	return nearDistance * std::pow(farDistance / nearDistance, static_cast<float>(slice) / LIGHT_CLUSTERS_Z);
+}
+
+int LightClusterGrid::getSlice(float depth) const
+{
+	glm::vec4 sliceScaleAndBias = getSliceScaleAndBias();
+	int slice = static_cast<int>(std::floor(std::log(depth) * sliceScaleAndBias.x + sliceScaleAndBias.y));
+	return std::min(std::max(slice, 0), LIGHT_CLUSTERS_Z - 1);
+}
+
+glm::vec4 LightClusterGrid::getSliceScaleAndBias() const
+{
+	float scale = LIGHT_CLUSTERS_Z / std::log(farDistance / nearDistance);
+	return glm::vec4(scale, -scale * std::log(nearDistance), 0.0f, 0.0f);
+}
+
+void LightClusterGrid::setProjection(float fieldOfView, float aspectRatio, float nearDistance, float farDistance)
+{
+	if (fieldOfView == this->fieldOfView && aspectRatio == this->aspectRatio &&
+		nearDistance == this->nearDistance && farDistance == this->farDistance)
+	{
+		return;
+	}
+	this->fieldOfView = fieldOfView;
+	this->aspectRatio = aspectRatio;
+	this->nearDistance = nearDistance;
+	this->farDistance = farDistance;
+	tanHalfHeight = std::tan(fieldOfView * 3.14159265f / 360.0f);
+	tanHalfWidth = tanHalfHeight * aspectRatio;
+
+	for (int z = 0; z < LIGHT_CLUSTERS_Z; z++)
+	{
+		float sliceNear = getSliceDepth(z);
+		float sliceFar = getSliceDepth(z + 1);
+		for (int y = 0; y < LIGHT_CLUSTERS_Y; y++)
+		{
+			float bottom = (-1.0f + 2.0f * y / LIGHT_CLUSTERS_Y) * tanHalfHeight;
+			float top = (-1.0f + 2.0f * (y + 1) / LIGHT_CLUSTERS_Y) * tanHalfHeight;
+			for (int x = 0; x < LIGHT_CLUSTERS_X; x++)
+			{
+				float left = (-1.0f + 2.0f * x / LIGHT_CLUSTERS_X) * tanHalfWidth;
+				float right = (-1.0f + 2.0f * (x + 1) / LIGHT_CLUSTERS_X) * tanHalfWidth;
+				// The sides of a cluster are planes through the eye, so its bounds are at its nearest or
+				// farthest depth.
+				int cluster = x + LIGHT_CLUSTERS_X * (y + LIGHT_CLUSTERS_Y * z);
+				minX[cluster] = std::min(left * sliceNear, left * sliceFar);
+				maxX[cluster] = std::max(right * sliceNear, right * sliceFar);
+				minY[cluster] = std::min(bottom * sliceNear, bottom * sliceFar);
+				maxY[cluster] = std::max(top * sliceNear, top * sliceFar);
+				minZ[cluster] = -sliceFar;
+				maxZ[cluster] = -sliceNear;
+			}
+		}
+	}
+}
+
+int LightClusterGrid::intersectsClusters(int first, const glm::vec4 &center, float radiusSquared) const
+{
+	// The distance from the sphere's centre to the closest point of each box, compared with the radius.
+#ifdef ENG_LIGHT_CLUSTERS_SSE
+	__m128 centerX = _mm_set1_ps(center.x);
+	__m128 centerY = _mm_set1_ps(center.y);
+	__m128 centerZ = _mm_set1_ps(center.z);
+	__m128 dx = _mm_sub_ps(centerX,
+		_mm_min_ps(_mm_max_ps(centerX, _mm_load_ps(minX + first)), _mm_load_ps(maxX + first)));
+	__m128 dy = _mm_sub_ps(centerY,
+		_mm_min_ps(_mm_max_ps(centerY, _mm_load_ps(minY + first)), _mm_load_ps(maxY + first)));
+	__m128 dz = _mm_sub_ps(centerZ,
+		_mm_min_ps(_mm_max_ps(centerZ, _mm_load_ps(minZ + first)), _mm_load_ps(maxZ + first)));
+	__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+	return _mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_set1_ps(radiusSquared)));
+#else
+	int mask = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		int cluster = first + i;
+		float dx = center.x - std::min(std::max(center.x, minX[cluster]), maxX[cluster]);
+		float dy = center.y - std::min(std::max(center.y, minY[cluster]), maxY[cluster]);
+		float dz = center.z - std::min(std::max(center.z, minZ[cluster]), maxZ[cluster]);
+		if (dx * dx + dy * dy + dz * dz <= radiusSquared)
+		{
+			mask |= 1 << i;
+		}
+	}
+	return mask;
+#endif
+}
+
+/**
+ * Finds the tiles along one screen axis that a sphere may cover.
+ * @param low the sphere's lowest view space coordinate along the axis
+ * @param high the sphere's highest view space coordinate along the axis
+ * @param nearest the nearest depth of the sphere within the clipping planes
+ * @param farthest the farthest depth of the sphere within the clipping planes
+ * @param tanHalfAngle the tangent of half the field of view along the axis
+ * @param tiles the number of tiles along the axis
+ * @return false if the sphere is entirely off screen along the axis
+ */
+static bool getTileRange(float low, float high, float nearest, float farthest, float tanHalfAngle, int tiles,
+	int &first, int &last)
+{
+	// Dividing by the depth is monotonic, so the widest extent on screen is at the nearest or farthest depth.
+	float screenLow = std::min(low / nearest, low / farthest) / tanHalfAngle;
+	float screenHigh = std::max(high / nearest, high / farthest) / tanHalfAngle;
+	if (screenHigh < -1.0f || screenLow > 1.0f)
+	{
+		return false;
+	}
+	first = std::max(static_cast<int>(std::floor((screenLow + 1.0f) * 0.5f * tiles)), 0);
+	last = std::min(static_cast<int>(std::floor((screenHigh + 1.0f) * 0.5f * tiles)), tiles - 1);
+	return true;
+}
+
+void LightClusterGrid::assignLights(const glm::mat4 &view, const glm::vec4 *positions, int lightCount)
+{
+	assignments.clear();
+	for (int light = 0; light < lightCount; light++)
+	{
+		float radius = positions[light].w;
+		if (radius <= 0.0f)
+		{
+			continue;
+		}
+		glm::vec4 center = view * glm::vec4(positions[light].x, positions[light].y, positions[light].z, 1.0f);
+		float depth = -center.z;
+		if (depth + radius < nearDistance || depth - radius > farDistance)
+		{
+			continue;
+		}
+		float nearest = std::max(depth - radius, nearDistance);
+		float farthest = std::min(depth + radius, farDistance);
+		int firstX, lastX, firstY, lastY;
+		if (!getTileRange(center.x - radius, center.x + radius, nearest, farthest, tanHalfWidth, LIGHT_CLUSTERS_X,
+				firstX, lastX) ||
+			!getTileRange(center.y - radius, center.y + radius, nearest, farthest, tanHalfHeight, LIGHT_CLUSTERS_Y,
+				firstY, lastY))
+		{
+			continue;
+		}
+		// The range only narrows the search; the sphere test decides, so widening it to whole groups of 4 is safe.
+		firstX &= ~3;
+		int firstZ = getSlice(nearest);
+		int lastZ = getSlice(farthest);
+		float radiusSquared = radius * radius;
+		for (int z = firstZ; z <= lastZ; z++)
+		{
+			for (int y = firstY; y <= lastY; y++)
+			{
+				for (int x = firstX; x <= lastX; x += 4)
+				{
+					int first = x + LIGHT_CLUSTERS_X * (y + LIGHT_CLUSTERS_Y * z);
+					int mask = intersectsClusters(first, center, radiusSquared);
+					for (int i = 0; mask != 0; i++, mask >>= 1)
+					{
+						if ((mask & 1) && assignments.size() < MAX_LIGHT_CLUSTER_INDICES)
+						{
+							assignments.push_back(static_cast<uint32_t>(first + i) << 16 |
+								static_cast<uint32_t>(light));
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Count the lights in each cluster, turn the counts into offsets, then place the indices. The pairs are in
+	// light order, so each cluster's lights stay in ascending order.
+	clusterData.assign(2 * LIGHT_CLUSTER_COUNT + assignments.size(), 0);
+	for (uint32_t assignment : assignments)
+	{
+		clusterData[2 * (assignment >> 16) + 1]++;
+	}
+	uint32_t offset = 0;
+	for (int cluster = 0; cluster < LIGHT_CLUSTER_COUNT; cluster++)
+	{
+		clusterData[2 * cluster] = offset;
+		offset += clusterData[2 * cluster + 1];
+		clusterData[2 * cluster + 1] = 0;
+	}
+	for (uint32_t assignment : assignments)
+	{
+		uint32_t cluster = assignment >> 16;
+		clusterData[2 * LIGHT_CLUSTER_COUNT + clusterData[2 * cluster] + clusterData[2 * cluster + 1]++] =
+			assignment & 0xFFFF;
+	}
+}
+
+const std::vector<uint32_t> &LightClusterGrid::getClusterData() const
+{
+	return clusterData;
+}
@@ -0,0 +1,90 @@
+#ifndef ENG_LIGHT_CLUSTERS_H
+#define ENG_LIGHT_CLUSTERS_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+/** The number of clusters across the screen. A multiple of 4, so each row is tested four clusters at a time. */
+const int LIGHT_CLUSTERS_X = 16;
+/** The number of clusters down the screen. */
+const int LIGHT_CLUSTERS_Y = 9;
+/** The number of depth slices, spaced exponentially between the near and far planes. */
+const int LIGHT_CLUSTERS_Z = 24;
+const int LIGHT_CLUSTER_COUNT = LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z;
+/**
+ * The most light indices kept across all clusters. The cluster data has to fit in 65536 texels, the smallest
+ * GL_MAX_TEXTURE_BUFFER_SIZE allowed, and any light assignments past this are dropped.
+ */
+const int MAX_LIGHT_CLUSTER_INDICES = 65536 - 2 * LIGHT_CLUSTER_COUNT;
+
+///
+/// The cluster data is one array of uints. Cluster c = x + LIGHT_CLUSTERS_X * (y + LIGHT_CLUSTERS_Y * z) has its
+/// first light at [2c] and its light count at [2c + 1]; both count into the index list, which starts at
+/// [2 * LIGHT_CLUSTER_COUNT]. A fragment finds its cluster from FrameConstants.lightClusters, clamping z to the
+/// slices there are:
+///
+///   x = int(gl_FragCoord.x * lightClusters.z), y = int(gl_FragCoord.y * lightClusters.w),
+///   z = int(log(-viewZ) * lightClusters.x + lightClusters.y)
+///
+
+/**
+ * LightClusterGrid splits the view frustum into a grid of clusters and works out which point lights reach each of
+ * them, so a fragment only has to loop over the lights in its own cluster. It does no GL work of its own.
+ */
+class LightClusterGrid
+{
+public:
+	LightClusterGrid();
+	/**
+	 * Sets the projection the grid covers, rebuilding the cluster bounds if it has changed.
+	 * @param fieldOfView the vertical field of view, in degrees
+	 * @param aspectRatio the aspect ratio of the viewport
+	 * @param nearDistance the distance to the near clipping plane
+	 * @param farDistance the distance to the far clipping plane
+	 */
+	void setProjection(float fieldOfView, float aspectRatio, float nearDistance, float farDistance);
+	/**
+	 * Assigns point lights to the clusters they reach.
+	 * @param view the view matrix the frame is drawn with
+	 * @param positions the world space position of each light in xyz and its radius in w. Lights with a radius of 0
+	 * or less reach nothing
+	 * @param lightCount the number of lights
+	 */
+	void assignLights(const glm::mat4 &view, const glm::vec4 *positions, int lightCount);
+	/**
+	 * Gets the cluster data written by the last assignLights(...), in the layout described above.
+	 */
+	const std::vector<uint32_t> &getClusterData() const;
+	/**
+	 * Gets the factors that turn the log of a view space depth into a depth slice, in x and y.
+	 */
+	glm::vec4 getSliceScaleAndBias() const;
+private:
+	/** Cluster bounds in view space, as separate arrays so four neighbouring clusters load as one vector each. */
+	alignas(16) float minX[LIGHT_CLUSTER_COUNT];
+	alignas(16) float minY[LIGHT_CLUSTER_COUNT];
+	alignas(16) float minZ[LIGHT_CLUSTER_COUNT];
+	alignas(16) float maxX[LIGHT_CLUSTER_COUNT];
+	alignas(16) float maxY[LIGHT_CLUSTER_COUNT];
+	alignas(16) float maxZ[LIGHT_CLUSTER_COUNT];
+	float fieldOfView;
+	float aspectRatio;
+	float nearDistance;
+	float farDistance;
+	float tanHalfHeight;
+	float tanHalfWidth;
+	/** Each (cluster, light) pair found, packed as cluster << 16 | light, in the order the lights were tested. */
+	std::vector<uint32_t> assignments;
+	std::vector<uint32_t> clusterData;
+	int getSlice(float depth) const;
+	/**
+	 * Tests a sphere in view space against the four clusters starting at first, which must be a multiple of 4.
+	 * @return a bit mask with bit i set if the sphere reaches cluster first + i
+	 */
+	int intersectsClusters(int first, const glm::vec4 &center, float radiusSquared) const;
+	float getSliceDepth(int slice) const;
+};
+
+#endif
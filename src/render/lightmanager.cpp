@@ -0,0 +1,99 @@
+#include <vector>
+#include <glbinding/ContextInfo.h>
+#include <glbinding/Version.h>
+#include <glbinding/gl/extension.h>
+#include "render/lightmanager.h"
+#include "render/lightclusters.h"
+#include "render/glstate.h"
+#include "graphics/rendersettingshelper.h"
+#include "graphics/windowhelper.h"
+
+using namespace gl;
+
+static LightClusterGrid clusterGrid;
+/** The light positions copied out of the LightList, which the grid reads as one packed array. */
+static std::vector<glm::vec4> lightPositions;
+static int transientLightCount = 0;
+static GLuint clusterBufferID = 0;
+static GLuint clusterTextureID = 0;
+/** Whether the uploaded cluster data holds no lights, in which case a frame without lights has nothing to upload. */
+static bool clusterDataEmpty = false;
+
+/**
+ * Checks, once, whether the context has buffer textures.
+ */
+static bool isTextureBufferSupported()
+{
+	static int supported = -1;
+	if (supported < 0)
+	{
+		supported = glbinding::ContextInfo::version() >= glbinding::Version(3, 1) ||
+			glbinding::ContextInfo::extensions().count(GLextension::GL_ARB_texture_buffer_object) > 0;
+	}
+	return supported == 1;
+}
+
+bool addTransientPointLight(const PointLight &light)
+{
+	LightList &lights = getLightList();
+	if (lights.lightCounts[0] >= MAX_POINT_LIGHTS)
+	{
+		return false;
+	}
+	lights.pointLights[lights.lightCounts[0]++] = light;
+	transientLightCount++;
+	markLightListChanged();
+	return true;
+}
+
+void clearTransientLights()
+{
+	if (transientLightCount > 0)
+	{
+		getLightList().lightCounts[0] -= transientLightCount;
+		transientLightCount = 0;
+		markLightListChanged();
+	}
+}
+
+void updateLightClusters(const glm::mat4 &view, float aspectRatio)
+{
+	if (!isTextureBufferSupported())
+	{
+		return;
+	}
+	const LightList &lights = getLightList();
+	clusterGrid.setProjection(FIELD_OF_VIEW, aspectRatio, NEAR_CLIP_DISTANCE, FAR_CLIP_DISTANCE);
+	glm::vec4 &clusterConstants = getFrameConstants().lightClusters;
+	clusterConstants = clusterGrid.getSliceScaleAndBias();
+	clusterConstants.z = static_cast<float>(LIGHT_CLUSTERS_X) / getWindowWidth();
+	clusterConstants.w = static_cast<float>(LIGHT_CLUSTERS_Y) / getWindowHeight();
+	// Most frames have no point lights at all, and an empty grid only has to be uploaded once.
+	if (lights.lightCounts[0] == 0 && clusterDataEmpty)
+	{
+		return;
+	}
+	lightPositions.resize(lights.lightCounts[0]);
+	for (int i = 0; i < lights.lightCounts[0]; i++)
+	{
+		lightPositions[i] = lights.pointLights[i].position;
+	}
+	clusterGrid.assignLights(view, lightPositions.data(), lights.lightCounts[0]);
+	clusterDataEmpty = lights.lightCounts[0] == 0;
+
+	if (clusterBufferID == 0)
+	{
+		glGenBuffers(1, &clusterBufferID);
+		glGenTextures(1, &clusterTextureID);
+		glBindBuffer(GL_TEXTURE_BUFFER, clusterBufferID);
+		glBufferData(GL_TEXTURE_BUFFER, 0, nullptr, GL_STREAM_DRAW);
+		// The texture refers to the buffer object, not its storage, so it stays bound while the data is replaced.
+		setActiveTexture(static_cast<GLenum>(static_cast<unsigned int>(GL_TEXTURE0) + LIGHT_CLUSTER_TEXTURE_UNIT));
+		glBindTexture(GL_TEXTURE_BUFFER, clusterTextureID);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, clusterBufferID);
+		setActiveTexture(GL_TEXTURE0);
+	}
+	const std::vector<uint32_t> &clusterData = clusterGrid.getClusterData();
+	glBindBuffer(GL_TEXTURE_BUFFER, clusterBufferID);
+	glBufferData(GL_TEXTURE_BUFFER, clusterData.size() * sizeof(uint32_t), clusterData.data(), GL_STREAM_DRAW);
+}
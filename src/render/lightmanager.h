@@ -0,0 +1,38 @@
+#ifndef ENG_LIGHT_MANAGER_H
+#define ENG_LIGHT_MANAGER_H
+
+#include <glm/mat4x4.hpp>
+#include "render/uniformblocks.h"
+
+/** The texture unit the light cluster data is bound to, as a usamplerBuffer named lightClusterData. */
+const int LIGHT_CLUSTER_TEXTURE_UNIT = 7;
+/** The radius of a point light that is not given one. */
+const float DEFAULT_POINT_LIGHT_RADIUS = 25.0f;
+
+///
+/// The scene's point lights live in the LightList (see render/uniformblocks.h). Each frame they are sorted into the
+/// clusters of a LightClusterGrid on the CPU and the result is uploaded to a GL_R32UI buffer texture, so a fragment
+/// shader reads the lights of its own cluster with texelFetch instead of looping over every light. Reading it needs
+/// GLSL 1.40 or EXT_gpu_shader4, and does nothing without GL 3.1 or ARB_texture_buffer_object. Shaders get the
+/// declarations and getLighting(...), which sums the lights reaching a fragment, from res/lighting.glsl.
+///
+
+/**
+ * Adds a point light, such as a muzzle flash, that is only drawn for the next frame. It goes after the lights
+ * already in the LightList and is removed by clearTransientLights().
+ * @return false if the LightList is already full
+ */
+bool addTransientPointLight(const PointLight &light);
+/**
+ * Assigns the point lights in the LightList to clusters, uploads the result and fills in
+ * FrameConstants.lightClusters. Call this once per frame, before uploadUniformBlocks().
+ * @param view the view matrix the frame is drawn with
+ * @param aspectRatio the aspect ratio of the viewport
+ */
+void updateLightClusters(const glm::mat4 &view, float aspectRatio);
+/**
+ * Removes the lights added by addTransientPointLight(...), once the frame they were for has been uploaded.
+ */
+void clearTransientLights();
+
+#endif
@@ -0,0 +1,32 @@
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include "render/lodselector.h"
+#include "graphics/rendersettingshelper.h"
+
+float getProjectedSize(const glm::vec3 &center, float radius, const glm::vec3 &eye)
+{
+	static const float tanHalfFieldOfView = std::tan(FIELD_OF_VIEW * 3.14159265f / 360.0f);
+	float distance = glm::length(center - eye);
+	if (distance <= radius)
+	{
+		return 1.0f;
+	}
+	return radius / (distance * tanHalfFieldOfView);
+}
+
+int selectLOD(float projectedSize, int currentLOD, int lodCount)
+{
+	currentLOD = std::min(std::max(currentLOD, 0), lodCount - 1);
+	int lod = 0;
+	while (lod < lodCount - 1 && projectedSize < LOD_SCREEN_SIZE[lod])
+	{
+		lod++;
+	}
+	// Becoming coarser happens straight away, becoming finer only once the model is clearly past the threshold.
+	while (lod < currentLOD && projectedSize < LOD_SCREEN_SIZE[lod] * (1.0f + LOD_HYSTERESIS))
+	{
+		lod++;
+	}
+	return lod;
+}
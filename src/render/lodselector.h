@@ -0,0 +1,34 @@
+#ifndef ENG_LOD_SELECTOR_H
+#define ENG_LOD_SELECTOR_H
+
+#include <glm/vec3.hpp>
+#include "world/meshdata.h"
+
+/**
+ * A model drops to level i + 1 once its projected size falls below LOD_SCREEN_SIZE[i]. Sizes are the fraction of
+ * half the screen height covered by the model's bounding sphere.
+ */
+const float LOD_SCREEN_SIZE[MAX_MESH_LOD_LEVELS - 1] = { 0.25f, 0.1f, 0.04f };
+/**
+ * How far past a threshold, as a fraction of it, a model must grow before it returns to a finer level. This stops
+ * models near a threshold from switching back and forth every frame.
+ */
+const float LOD_HYSTERESIS = 0.15f;
+
+/**
+ * Estimates how large a bounding sphere appears on screen with the 3D projection set up by start3DRenderCycle().
+ * @param center the centre of the sphere in world space
+ * @param radius the radius of the sphere
+ * @param eye the position of the camera
+ * @return the fraction of half the screen height covered by the sphere
+ */
+float getProjectedSize(const glm::vec3 &center, float radius, const glm::vec3 &eye);
+/**
+ * Picks the level of detail to draw a model at.
+ * @param projectedSize the model's size on screen, as returned by getProjectedSize(...)
+ * @param currentLOD the level the model was drawn at last time, used for hysteresis
+ * @param lodCount the number of levels the model has
+ */
+int selectLOD(float projectedSize, int currentLOD, int lodCount);
+
+#endif
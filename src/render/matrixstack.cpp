@@ -0,0 +1,57 @@
+#include <stdexcept>
+#include <glm/gtc/matrix_transform.hpp>
+#include "render/matrixstack.h"
+
+MatrixStack::MatrixStack() : matrices(1, glm::mat4(1.0f))
+{
+}
+
+void MatrixStack::push()
+{
+	matrices.push_back(matrices.back());
+}
+
+void MatrixStack::pop()
+{
+	if (matrices.size() <= 1)
+	{
+		throw std::runtime_error("Matrix stack underflow");
+	}
+	matrices.pop_back();
+}
+
+void MatrixStack::loadIdentity()
+{
+	matrices.back() = glm::mat4(1.0f);
+}
+
+void MatrixStack::translate(float x, float y, float z)
+{
+	matrices.back() = glm::translate(matrices.back(), glm::vec3(x, y, z));
+}
+
+void MatrixStack::rotate(float angle, const glm::vec3 &axis)
+{
+	matrices.back() = glm::rotate(matrices.back(), angle, axis);
+}
+
+void MatrixStack::scale(float x, float y, float z)
+{
+	matrices.back() = glm::scale(matrices.back(), glm::vec3(x, y, z));
+}
+
+void MatrixStack::multiply(const glm::mat4 &matrix)
+{
+	matrices.back() = matrices.back() * matrix;
+}
+
+const glm::mat4 &MatrixStack::top() const
+{
+	return matrices.back();
+}
+
+MatrixStack &getModelMatrixStack()
+{
+	static MatrixStack modelMatrixStack;
+	return modelMatrixStack;
+}
@@ -0,0 +1,52 @@
+#ifndef ENG_MATRIX_STACK_H
+#define ENG_MATRIX_STACK_H
+
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+/**
+ * MatrixStack replaces the fixed function matrix stack for model transforms. Each operation is applied to the top
+ * matrix the way glTranslatef(...) and friends apply to the modelview matrix, so a model drawn inside nested
+ * push() and pop() calls is placed the same way. The view and projection are not part of it; shaders get them from
+ * the FrameConstants block.
+ */
+class MatrixStack
+{
+public:
+	/**
+	 * Creates a MatrixStack holding one identity matrix.
+	 */
+	MatrixStack();
+	/**
+	 * Pushes a copy of the top matrix.
+	 */
+	void push();
+	/**
+	 * Pops the top matrix. The last matrix cannot be popped.
+	 * @throws std::runtime_error if only one matrix is left
+	 */
+	void pop();
+	void loadIdentity();
+	void translate(float x, float y, float z);
+	/**
+	 * Rotates about an axis.
+	 * @param angle the angle in radians
+	 */
+	void rotate(float angle, const glm::vec3 &axis);
+	void scale(float x, float y, float z);
+	/**
+	 * Multiplies the top matrix by another, on the right, like glMultMatrixf(...).
+	 */
+	void multiply(const glm::mat4 &matrix);
+	const glm::mat4 &top() const;
+private:
+	std::vector<glm::mat4> matrices;
+};
+
+/**
+ * Gets the stack of model-to-world transforms that VBO, Sphere and the other drawables are placed with.
+ */
+MatrixStack &getModelMatrixStack();
+
+#endif
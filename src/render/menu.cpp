@@ -29,34 +29,18 @@ MainMenu::MainMenu(std::shared_ptr<Texture> desertText, std::shared_ptr<Texture>
 {
 }
 
-void MainMenu::draw(float deltaTime)
+void MainMenu::draw(SpriteBatch &batch, float deltaTime)
 {
-	startDesertLevel.draw();
-	startForestLevel.draw();
-	helpButton.draw();
-	optionsButton.draw();
+	startDesertLevel.draw(batch);
+	startForestLevel.draw(batch);
+	helpButton.draw(batch);
+	optionsButton.draw(batch);
 
-	using namespace gl;
 	float x = getWindowWidth() / 2 - 256;
 	float y = 0;
 	float width = 512;
 	float height = 512;
-	glDisable(GL_BLEND);
-	glAlphaFunc(GL_GREATER, 0.1f);
-	glEnable(GL_ALPHA_TEST);
-	glEnable(GL_TEXTURE_2D);
-	logo->bind();
-	glColor4f(1, 1, 1, 1);
-	glBegin(GL_QUADS);
-		glVertex3d(x, y + height, 0);
-		glTexCoord2f(1, 0);
-		glVertex3d(x + width, y + height, 0);
-		glTexCoord2f(1, 1);
-		glVertex3d(x + width, y, 0);
-		glTexCoord2f(0, 1);
-		glVertex3d(x, y, 0);
-		glTexCoord2f(0, 0);
-	glEnd();
+	batch.addQuad(logo, x, y, x + width, y + height, 0, 1, 1, 0, WHITE);
 }
 
 void MainMenu::update(MouseManager *manager, float deltaTime)
@@ -90,11 +74,11 @@ OptionsMenu::OptionsMenu(std::shared_ptr<Texture> backTex, std::shared_ptr<Textu
 	volumeSlider.value = volume;
 }
 
-void OptionsMenu::draw(float deltaTime)
+void OptionsMenu::draw(SpriteBatch &batch, float deltaTime)
 {
-	backButton.draw();
+	backButton.draw(batch);
 	volumeSlider.x = (getWindowWidth() / 2) - (volumeSlider.width / 2);
-	volumeSlider.draw();
+	volumeSlider.draw(batch);
 }
 
 void OptionsMenu::update(MouseManager *manager, float deltaTime)
@@ -115,31 +99,15 @@ HelpMenu::HelpMenu(std::shared_ptr<Texture> backTex, std::shared_ptr<Texture> gu
 {
 }
 
-void HelpMenu::draw(float deltaTime)
+void HelpMenu::draw(SpriteBatch &batch, float deltaTime)
 {
-	backButton.draw();
+	backButton.draw(batch);
 	
-	using namespace gl;
 	float x = 30;
 	float y = 50;
 	float width = 512;
 	float height = 512;
-	glDisable(GL_BLEND);
-	glAlphaFunc(GL_GREATER, 0.1f);
-	glEnable(GL_ALPHA_TEST);
-	glEnable(GL_TEXTURE_2D);
-	guide->bind();
-	glColor4f(1, 1, 1, 1);
-	glBegin(GL_QUADS);
-		glVertex3d(x, y + height, 0);
-		glTexCoord2f(1, 0);
-		glVertex3d(x + width, y + height, 0);
-		glTexCoord2f(1, 1);
-		glVertex3d(x + width, y, 0);
-		glTexCoord2f(0, 1);
-		glVertex3d(x, y, 0);
-		glTexCoord2f(0, 0);
-	glEnd();
+	batch.addQuad(guide, x, y, x + width, y + height, 0, 1, 1, 0, WHITE);
 }
 
 void HelpMenu::update(MouseManager *manager, float deltaTime)
@@ -159,31 +127,15 @@ GameOverMenu::GameOverMenu(std::shared_ptr<Texture> backTex, std::shared_ptr<Tex
 {
 }
 
-void GameOverMenu::draw(float deltaTime)
+void GameOverMenu::draw(SpriteBatch &batch, float deltaTime)
 {
-	using namespace gl;
-	backButton.draw();
+	backButton.draw(batch);
 
 	float x = getWindowWidth() / 2 - 256;
 	float y = 50;
 	float width = 512;
 	float height = 512;
-	glDisable(GL_BLEND);
-	glAlphaFunc(GL_GREATER, 0.1f);
-	glEnable(GL_ALPHA_TEST);
-	glEnable(GL_TEXTURE_2D);
-	gameOverTexture->bind();
-	glColor4f(1, 1, 1, 1);
-	glBegin(GL_QUADS);
-		glVertex3d(x, y + height, 0);
-		glTexCoord2f(1, 0);
-		glVertex3d(x + width, y + height, 0);
-		glTexCoord2f(1, 1);
-		glVertex3d(x + width, y, 0);
-		glTexCoord2f(0, 1);
-		glVertex3d(x, y, 0);
-		glTexCoord2f(0, 0);
-	glEnd();
+	batch.addQuad(gameOverTexture, x, y, x + width, y + height, 0, 1, 1, 0, WHITE);
 
 }
 
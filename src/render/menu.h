@@ -5,6 +5,7 @@
 #include "graphics/button.h"
 #include "gameloop.h"
 #include "graphics/slider.h"
+#include "render/spritebatch.h"
 
 class Menu
 {
@@ -12,7 +13,10 @@ protected:
 	bool shouldPopMenu;
 public: 
 	Menu();
-	virtual void draw(float deltaTime) = 0;
+	/**
+	 * Adds the menu to the SpriteBatch of the 2D pass, which the caller flushes.
+	 */
+	virtual void draw(SpriteBatch &batch, float deltaTime) = 0;
 	virtual void update(MouseManager* manager, float deltaTime) = 0;
 	bool shouldPopThisMenu();
 };
@@ -34,7 +38,7 @@ public:
 	MainMenu(std::shared_ptr<Texture> desertText, std::shared_ptr<Texture> forestTex, std::shared_ptr<Texture> helpTex, std::shared_ptr<Texture> optionsTex,
 		std::function<void()> desertEvent, std::function<void()> forestEvent, std::function<void()> helpEvent, std::function<void()> optionsEvent, 
 		std::shared_ptr<Texture> logo);
-	void draw(float deltaTime);
+	void draw(SpriteBatch &batch, float deltaTime);
 	void update(MouseManager* manager, float deltaTime);
 };
 
@@ -46,7 +50,7 @@ private:
 	std::function<void(float)> onVolumeChange;
 public:
 	OptionsMenu(std::shared_ptr<Texture> backTex, std::shared_ptr<Texture> volumeTexture, float volume, std::function<void(float)> onVolumeChange);
-	void draw(float deltaTime);
+	void draw(SpriteBatch &batch, float deltaTime);
 	void update(MouseManager* manager, float deltaTime);
 };
 
@@ -57,7 +61,7 @@ private:
 	std::shared_ptr<Texture> guide;
 public:
 	HelpMenu(std::shared_ptr<Texture> backTex, std::shared_ptr<Texture> guide);
-	void draw(float deltaTime);
+	void draw(SpriteBatch &batch, float deltaTime);
 	void update(MouseManager* manager, float deltaTime);
 };
 
@@ -68,7 +72,7 @@ private:
 	Button backButton;
 public:
 	GameOverMenu(std::shared_ptr<Texture> backTex, std::shared_ptr<Texture> gameOverTexture);
-	void draw(float deltaTime);
+	void draw(SpriteBatch &batch, float deltaTime);
 	void update(MouseManager* manager, float deltaTime);
 };
 
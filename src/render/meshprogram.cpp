@@ -0,0 +1,67 @@
+#include <iostream>
+#include <memory>
+#include <glbinding/ContextInfo.h>
+#include <glbinding/Version.h>
+#include "render/meshprogram.h"
+#include "render/glstate.h"
+#include "shaders/shader.h"
+#include "utils/fileutils.h"
+
+using namespace gl;
+
+static std::shared_ptr<Shader> meshShader;
+static Shader::UniformHandle modelMatrixUniform = Shader::INVALID_UNIFORM;
+static Shader::UniformHandle useTextureUniform = Shader::INVALID_UNIFORM;
+static Shader::UniformHandle alphaThresholdUniform = Shader::INVALID_UNIFORM;
+
+bool isCoreRenderPathActive()
+{
+	static int active = -1;
+	if (active < 0)
+	{
+		active = 0;
+		if (glbinding::ContextInfo::version() >= glbinding::Version(3, 3))
+		{
+			std::string vertPath = buildPath("res/core_mesh.vert");
+			std::string fragPath = buildPath("res/core_mesh.frag");
+			meshShader = createShader(&vertPath, &fragPath);
+		}
+		if (!meshShader)
+		{
+			std::cout << "Core mesh shader unavailable, drawing with fixed function client arrays." << std::endl;
+			return false;
+		}
+		modelMatrixUniform = meshShader->getUniform("modelMatrix");
+		useTextureUniform = meshShader->getUniform("useTexture");
+		alphaThresholdUniform = meshShader->getUniform("alphaThreshold");
+		meshShader->setUniform(meshShader->getUniform("texture1"), 0);
+		active = 1;
+	}
+	return active == 1;
+}
+
+void setVertexAttribute(GLuint location, int size, GLenum type, int stride, size_t offset)
+{
+	glEnableVertexAttribArray(location);
+	glVertexAttribPointer(location, size, type, (type == GL_FLOAT) ? GL_FALSE : GL_TRUE, stride, (void*)(offset));
+}
+
+float getAlphaTestThreshold()
+{
+	GLenum func;
+	GLfloat ref;
+	if (isStateEnabled(GL_ALPHA_TEST) && getAlphaFunc(func, ref) && func == GL_GREATER)
+	{
+		return ref;
+	}
+	return -1.0f;
+}
+
+void useMeshProgram(const glm::mat4 &modelMatrix, bool textured)
+{
+	setActiveTexture(GL_TEXTURE0);
+	meshShader->bindShader();
+	meshShader->setUniform(modelMatrixUniform, modelMatrix);
+	meshShader->setUniform(useTextureUniform, textured);
+	meshShader->setUniform(alphaThresholdUniform, getAlphaTestThreshold());
+}
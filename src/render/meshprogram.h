@@ -0,0 +1,50 @@
+#ifndef ENG_MESH_PROGRAM_H
+#define ENG_MESH_PROGRAM_H
+
+#include <cstddef>
+#include <glbinding/gl/gl.h>
+#include <glm/mat4x4.hpp>
+
+/** The generic attribute locations every vertex array object and core path shader agree on. */
+const gl::GLuint VERTEX_ATTRIBUTE_POSITION = 0;
+const gl::GLuint VERTEX_ATTRIBUTE_NORMAL = 1;
+const gl::GLuint VERTEX_ATTRIBUTE_COLOUR = 2;
+const gl::GLuint VERTEX_ATTRIBUTE_TEXTURE_COORD = 3;
+/** The first location left free for per-instance attributes. */
+const gl::GLuint VERTEX_ATTRIBUTE_FIRST_INSTANCE = 4;
+
+///
+/// The core render path draws every mesh from a vertex array object configured once, through #version 330 core
+/// shaders that read the view from the FrameConstants block and the model transform from a uniform. It is used
+/// whenever the context is GL 3.3 or newer and res/core_mesh.* builds; otherwise the fixed function client arrays
+/// and matrix stack are used as before.
+///
+
+/**
+ * Checks, once, whether the core render path is in use. The first call creates the mesh program, so it needs a
+ * GL context.
+ */
+bool isCoreRenderPathActive();
+/**
+ * Enables a generic vertex attribute of the bound vertex array object and points it at the bound GL_ARRAY_BUFFER.
+ * Integer types are normalized.
+ * @param location the attribute location, such as VERTEX_ATTRIBUTE_POSITION
+ * @param size the number of components
+ * @param type the component type, such as GL_FLOAT
+ * @param stride the distance between vertices in bytes
+ * @param offset the offset of the first vertex's value in the buffer, in bytes
+ */
+void setVertexAttribute(gl::GLuint location, int size, gl::GLenum type, int stride, size_t offset);
+/**
+ * Gets the alpha value a fragment must exceed to be drawn, matching the alpha test set through glstate, or -1 if
+ * the alpha test is disabled. Only GL_GREATER is emulated.
+ */
+float getAlphaTestThreshold();
+/**
+ * Makes the mesh program current and sets the uniforms of one draw. Texture unit 0 is sampled.
+ * @param modelMatrix the model-to-world transform, usually the top of the model matrix stack
+ * @param textured true if the bound texture is applied, otherwise only the vertex colours are drawn
+ */
+void useMeshProgram(const glm::mat4 &modelMatrix, bool textured);
+
+#endif
@@ -0,0 +1,101 @@
+#include <iostream>
+#include "render/projectilerenderer.h"
+#include "render/glstate.h"
+#include "render/matrixstack.h"
+#include "render/meshprogram.h"
+#include "render/staticmeshbuffer.h"
+#include "utils/fileutils.h"
+
+using namespace gl;
+
+ProjectileRenderer::ProjectileRenderer() : sphereStream(GL_ARRAY_BUFFER, PROJECTILE_STREAM_REGION_SIZE),
+	unitSphere(1.0f, UNIT_SPHERE_RINGS, UNIT_SPHERE_SECTORS), sphereMeshID(-1), instancingAvailable(false),
+	initialized(false), lastDrawCallCount(0)
+{
+}
+
+ProjectileRenderer::~ProjectileRenderer()
+{
+}
+
+/**
+ * Creates the projectile shader and finds the packed sphere. This needs a GL context, so it is deferred until the
+ * first draw.
+ */
+void ProjectileRenderer::initialize()
+{
+	initialized = true;
+	sphereMeshID = getUnitSphereMesh();
+	if (sphereMeshID >= 0)
+	{
+		std::string vertPath = buildPath("res/projectile.vert");
+		std::string fragPath = buildPath("res/projectile.frag");
+		shader = createShader(&vertPath, &fragPath);
+	}
+	if (!shader)
+	{
+		std::cout << "Projectile shader unavailable, drawing projectiles one at a time." << std::endl;
+		return;
+	}
+	instancingAvailable = true;
+}
+
+void ProjectileRenderer::add(const glm::vec3 &position, float radius)
+{
+	spheres.push_back(glm::vec4(position, radius));
+}
+
+void ProjectileRenderer::draw()
+{
+	if (!initialized)
+	{
+		initialize();
+	}
+	lastDrawCallCount = 0;
+	if (spheres.empty())
+	{
+		return;
+	}
+	if (!instancingAvailable)
+	{
+		drawWithoutInstancing();
+		return;
+	}
+
+	size_t offset = sphereStream.write(spheres.data(), spheres.size() * sizeof(glm::vec4));
+	StaticMeshBuffer &staticMeshes = getStaticMeshBuffer();
+	const StaticMesh &mesh = staticMeshes.getMesh(sphereMeshID);
+	staticMeshes.bind();
+	// The sphere is read from the shared vertex array object, so its per-instance attribute is pointed at this
+	// frame's block every draw.
+	bindBuffer(GL_ARRAY_BUFFER, sphereStream.getBufferID());
+	glEnableVertexAttribArray(VERTEX_ATTRIBUTE_FIRST_INSTANCE);
+	glVertexAttribDivisor(VERTEX_ATTRIBUTE_FIRST_INSTANCE, 1);
+	glVertexAttribPointer(VERTEX_ATTRIBUTE_FIRST_INSTANCE, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)(offset));
+	shader->bindShader();
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.lods[0].indexCount, GL_UNSIGNED_INT,
+		(void*)((mesh.firstIndex + mesh.lods[0].firstIndex) * sizeof(GLuint)), static_cast<GLsizei>(spheres.size()),
+		mesh.baseVertex);
+	lastDrawCallCount++;
+	spheres.clear();
+}
+
+void ProjectileRenderer::drawWithoutInstancing()
+{
+	MatrixStack &modelMatrices = getModelMatrixStack();
+	for (glm::vec4 &sphere : spheres)
+	{
+		modelMatrices.push();
+		modelMatrices.translate(sphere.x, sphere.y, sphere.z);
+		modelMatrices.scale(sphere.w, sphere.w, sphere.w);
+		unitSphere.draw(0.0f, 0.0f, 0.0f);
+		modelMatrices.pop();
+		lastDrawCallCount++;
+	}
+	spheres.clear();
+}
+
+int ProjectileRenderer::getLastDrawCallCount()
+{
+	return lastDrawCallCount;
+}
@@ -0,0 +1,61 @@
+#ifndef ENG_PROJECTILE_RENDERER_H
+#define ENG_PROJECTILE_RENDERER_H
+
+#include <memory>
+#include <vector>
+#include <glbinding/gl/gl.h>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include "render/sphere.h"
+#include "render/streambuffer.h"
+#include "shaders/shader.h"
+
+/** The initial size, in bytes, of each frame's region of the projectile stream: room for 4096 projectiles. */
+const size_t PROJECTILE_STREAM_REGION_SIZE = 4096 * sizeof(glm::vec4);
+
+/**
+ * ProjectileRenderer collects the projectiles of a frame and draws them all with one instanced draw call. Every
+ * projectile is the unit sphere from the StaticMeshBuffer, moved and scaled in res/projectile.vert by a per-instance
+ * vec4 holding its centre and radius. The vec4s are packed into one block of a StreamBuffer each frame.
+ * <br><br>
+ * If the projectile shader cannot be created, or the core render path is not in use, each projectile is drawn on
+ * its own from one shared Sphere with the model matrix stack.
+ */
+class ProjectileRenderer
+{
+public:
+	ProjectileRenderer();
+	~ProjectileRenderer();
+	/**
+	 * Queues one projectile to be drawn on the next call to draw().
+	 * @param position the centre of the projectile
+	 * @param radius the radius of the projectile
+	 */
+	void add(const glm::vec3 &position, float radius);
+	/**
+	 * Draws everything queued since the last call and clears the queue, untextured. The FrameConstants block must
+	 * already hold the camera's view; on the fixed function path the modelview matrix must hold it instead.
+	 */
+	void draw();
+	/**
+	 * Gets the number of draw calls issued by the last call to draw().
+	 */
+	int getLastDrawCallCount();
+private:
+	ProjectileRenderer(const ProjectileRenderer&) = delete;
+	ProjectileRenderer& operator=(const ProjectileRenderer&) = delete;
+	/** The centre of each queued projectile in xyz and its radius in w. */
+	std::vector<glm::vec4> spheres;
+	StreamBuffer sphereStream;
+	std::shared_ptr<Shader> shader;
+	/** The sphere drawn once per projectile when instancing is unavailable. */
+	Sphere unitSphere;
+	int sphereMeshID;
+	bool instancingAvailable;
+	bool initialized;
+	int lastDrawCallCount;
+	void initialize();
+	void drawWithoutInstancing();
+};
+
+#endif
@@ -4,6 +4,8 @@
 #include "graphics/model.h"
 #include "world/meshbuilder.h"
 #include "graphics/gluhelper.h"
+#include "render/glstate.h"
+#include "render/matrixstack.h"
 // TODO - figure out what to do with the Render Class. Possibly remove it?
 
 
@@ -259,21 +261,17 @@ void drawSkybox(std::shared_ptr<Texture> skyboxTexture, Camera *cam)
 	 glPushMatrix();
 	 glLoadIdentity();
 	 setLookAt(cam);
-	 glTranslatef(cam->getX(), cam->getY(), cam->getZ());
-
-	 glEnable(GL_TEXTURE_2D);
-	 glDisable(GL_CULL_FACE);
-	 glEnableClientState(GL_VERTEX_ARRAY);
-	 glEnableClientState(GL_NORMAL_ARRAY);
-	 glEnableClientState(GL_COLOR_ARRAY);
-	 glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	 // The skybox follows the camera.
+	 MatrixStack &modelMatrices = getModelMatrixStack();
+	 modelMatrices.push();
+	 modelMatrices.translate(cam->getX(), cam->getY(), cam->getZ());
+
+	 enableState(GL_TEXTURE_2D);
+	 disableState(GL_CULL_FACE);
 	 vbo->draw(cam);
-	 glDisableClientState(GL_VERTEX_ARRAY);
-	 glDisableClientState(GL_NORMAL_ARRAY);
-	 glDisableClientState(GL_COLOR_ARRAY);
-	 glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	 glEnable(GL_CULL_FACE);
+	 enableState(GL_CULL_FACE);
 
+	 modelMatrices.pop();
 	 glPopMatrix();
 
 
@@ -284,7 +282,7 @@ void drawSkybox(std::shared_ptr<Texture> skyboxTexture, Camera *cam)
     using namespace gl;
     glLoadIdentity();
     setLookAt(cam);
-    glDisable(GL_TEXTURE_2D);
+    disableState(GL_TEXTURE_2D);
 
     glColor3f(1, 0, 0);
     glBegin(GL_LINES);
@@ -304,7 +302,7 @@ void drawSkybox(std::shared_ptr<Texture> skyboxTexture, Camera *cam)
     glVertex3f(0, 0, 2000);
     glEnd();
 
-    glEnable(GL_TEXTURE_2D);
+    enableState(GL_TEXTURE_2D);
 }
 
 void drawAABB(AABB &box)
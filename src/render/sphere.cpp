@@ -1,11 +1,22 @@
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <glm/gtc/type_ptr.hpp>
 #include "sphere.h"
 #include "math/gamemath.h"
+#include "render/glstate.h"
+#include "render/matrixstack.h"
+#include "render/meshprogram.h"
+#include "render/staticmeshbuffer.h"
+#include "render/vbo.h"
 using namespace gl;
 
-Sphere::Sphere(float radius, unsigned int rings, unsigned int sectors)
+/** Floats per vertex in the vertex buffer: a position, a normal and a texture coordinate. */
+static const int SPHERE_VERTEX_SIZE = 8;
+
+Sphere::Sphere(float radius, unsigned int rings, unsigned int sectors) : vertexBufferID(0), indexBufferID(0),
+	vertexArrayID(0)
 {
 	float const R = 1. / (float)(rings - 1);
 	float const S = 1. / (float)(sectors - 1);
@@ -34,34 +45,132 @@ Sphere::Sphere(float radius, unsigned int rings, unsigned int sectors)
 		*n++ = z;
 	}
 
-	indices.resize(rings * sectors * 4);
+	// Each quad between two rings is split into two triangles, as core profiles cannot draw quads.
+	indices.resize((rings - 1) * (sectors - 1) * 6);
 	std::vector<GLushort>::iterator i = indices.begin();
 	for (r = 0; r < rings - 1; r++) for (s = 0; s < sectors - 1; s++) {
 		*i++ = r * sectors + s;
 		*i++ = r * sectors + (s + 1);
 		*i++ = (r + 1) * sectors + (s + 1);
+		*i++ = r * sectors + s;
+		*i++ = (r + 1) * sectors + (s + 1);
 		*i++ = (r + 1) * sectors + s;
 	}
+
 }
 
-void Sphere::draw(GLfloat x, GLfloat y, GLfloat z)
+Sphere::~Sphere()
 {
-	glMatrixMode(GL_MODELVIEW);
-	glPushMatrix();
-	glTranslatef(x, y, z);
+	if (vertexBufferID != 0)
+	{
+		glDeleteBuffers(1, &vertexBufferID);
+		notifyBufferDeleted(vertexBufferID);
+	}
+	if (indexBufferID != 0)
+	{
+		glDeleteBuffers(1, &indexBufferID);
+		notifyBufferDeleted(indexBufferID);
+	}
+	if (vertexArrayID != 0)
+	{
+		glDeleteVertexArrays(1, &vertexArrayID);
+		notifyVertexArrayDeleted(vertexArrayID);
+	}
+}
+
+/**
+ * Interleaves the vertices and uploads them and the indices. This needs a GL context, so it is deferred until the
+ * first draw.
+ */
+void Sphere::upload()
+{
+	int vertexCount = static_cast<int>(vertices.size()) / 3;
+	std::vector<GLfloat> interleaved(vertexCount * SPHERE_VERTEX_SIZE);
+	for (int k = 0; k < vertexCount; k++)
+	{
+		std::copy(&vertices[k * 3], &vertices[k * 3] + 3, &interleaved[k * SPHERE_VERTEX_SIZE]);
+		std::copy(&normals[k * 3], &normals[k * 3] + 3, &interleaved[k * SPHERE_VERTEX_SIZE + 3]);
+		std::copy(&texcoords[k * 2], &texcoords[k * 2] + 2, &interleaved[k * SPHERE_VERTEX_SIZE + 6]);
+	}
+	vertexBufferID = createVBOID();
+	indexBufferID = createVBOID();
+	GLsizei stride = SPHERE_VERTEX_SIZE * sizeof(GLfloat);
+	if (isCoreRenderPathActive())
+	{
+		glGenVertexArrays(1, &vertexArrayID);
+		bindVertexArray(vertexArrayID);
+	}
+	bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+	glBufferData(GL_ARRAY_BUFFER, interleaved.size() * sizeof(GLfloat), interleaved.data(), GL_STATIC_DRAW);
+	if (vertexArrayID != 0)
+	{
+		setVertexAttribute(VERTEX_ATTRIBUTE_POSITION, 3, GL_FLOAT, stride, 0);
+		setVertexAttribute(VERTEX_ATTRIBUTE_NORMAL, 3, GL_FLOAT, stride, 3 * sizeof(GLfloat));
+		setVertexAttribute(VERTEX_ATTRIBUTE_TEXTURE_COORD, 2, GL_FLOAT, stride, 6 * sizeof(GLfloat));
+	}
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+}
 
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_NORMAL_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+void Sphere::draw(GLfloat x, GLfloat y, GLfloat z)
+{
+	if (vertexBufferID == 0)
+	{
+		upload();
+	}
+	MatrixStack &modelMatrices = getModelMatrixStack();
+	modelMatrices.push();
+	modelMatrices.translate(x, y, z);
 
-	glVertexPointer(3, GL_FLOAT, 0, &vertices[0]);
-	glNormalPointer(GL_FLOAT, 0, &normals[0]);
-	glTexCoordPointer(2, GL_FLOAT, 0, &texcoords[0]);
-	glDrawElements(GL_QUADS, indices.size(), GL_UNSIGNED_SHORT, &indices[0]);
+	if (vertexArrayID != 0)
+	{
+		bindVertexArray(vertexArrayID);
+		// Spheres have no colours of their own, so they are drawn white like the fixed function default.
+		glVertexAttrib4f(VERTEX_ATTRIBUTE_COLOUR, 1.0f, 1.0f, 1.0f, 1.0f);
+		useMeshProgram(modelMatrices.top(), false);
+		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_SHORT, nullptr);
+	}
+	else
+	{
+		GLsizei stride = SPHERE_VERTEX_SIZE * sizeof(GLfloat);
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glMultMatrixf(glm::value_ptr(modelMatrices.top()));
+		setClientArrays(true, true, false, true);
+		bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+		bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+		glVertexPointer(3, GL_FLOAT, stride, (void*)(0));
+		glNormalPointer(GL_FLOAT, stride, (void*)(3 * sizeof(GLfloat)));
+		glTexCoordPointer(2, GL_FLOAT, stride, (void*)(6 * sizeof(GLfloat)));
+		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_SHORT, nullptr);
+		glPopMatrix();
+	}
+	modelMatrices.pop();
+}
 
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_NORMAL_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+int Sphere::addToStaticMeshBuffer() const
+{
+	int vertexCount = static_cast<int>(vertices.size()) / 3;
+	std::vector<GLfloat> packed(vertexCount * STATIC_MESH_VERTEX_SIZE);
+	for (int k = 0; k < vertexCount; k++)
+	{
+		GLfloat *vertex = &packed[k * STATIC_MESH_VERTEX_SIZE];
+		std::copy(&vertices[k * 3], &vertices[k * 3] + 3, vertex);
+		std::copy(&normals[k * 3], &normals[k * 3] + 3, vertex + 3);
+		std::fill(vertex + 6, vertex + 10, 1.0f);
+		std::copy(&texcoords[k * 2], &texcoords[k * 2] + 2, vertex + 10);
+	}
+	return getStaticMeshBuffer().addMesh(packed, std::vector<unsigned int>(indices.begin(), indices.end()),
+		std::vector<MeshLOD>());
+}
 
-	glPopMatrix();
+int getUnitSphereMesh()
+{
+	static int meshID = -2;
+	if (meshID == -2)
+	{
+		meshID = (isCoreRenderPathActive()) ?
+			Sphere(1.0f, UNIT_SPHERE_RINGS, UNIT_SPHERE_SECTORS).addToStaticMeshBuffer() : -1;
+	}
+	return meshID;
 }
@@ -4,6 +4,14 @@
 #include <vector>
 #include <glbinding/gl/gl.h>
 
+/** The detail of the sphere returned by getUnitSphereMesh(), as passed to the Sphere constructor. */
+const unsigned int UNIT_SPHERE_RINGS = 12;
+const unsigned int UNIT_SPHERE_SECTORS = 24;
+
+/**
+ * A UV sphere drawn as triangles. Its vertices, interleaved, and its indices are uploaded once to a static vertex
+ * buffer and index buffer the first time it is drawn.
+ */
 class Sphere
 {
 protected:
@@ -11,12 +19,36 @@ protected:
 	std::vector<gl::GLfloat> normals;
 	std::vector<gl::GLfloat> texcoords;
 	std::vector<gl::GLushort> indices;
+	gl::GLuint vertexBufferID;
+	gl::GLuint indexBufferID;
+	/** The vertex array object holding the vertex format and index buffer, or 0 on the fixed function path. */
+	gl::GLuint vertexArrayID;
+	void upload();
 
 public:
 	Sphere(float radius, unsigned int rings, unsigned int sectors);
+	~Sphere();
+	/**
+	 * Draws the sphere centred on a point, relative to the top of the model matrix stack.
+	 */
 	void draw(gl::GLfloat x, gl::GLfloat y, gl::GLfloat z);
+	/**
+	 * Packs this sphere into the StaticMeshBuffer, coloured white like the fixed function default.
+	 * @return the ID of the mesh in the StaticMeshBuffer
+	 */
+	int addToStaticMeshBuffer() const;
+private:
+	Sphere(const Sphere&) = delete;
+	Sphere& operator=(const Sphere&) = delete;
 };
 
+/**
+ * Gets a sphere of radius 1 packed into the StaticMeshBuffer, packing it on the first call. It is scaled to draw a
+ * sphere of any size.
+ * @return the ID of the mesh, or -1 if the core render path is not in use
+ */
+int getUnitSphereMesh();
+
 
 
 
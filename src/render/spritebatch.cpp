@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include "render/spritebatch.h"
+#include "render/glstate.h"
+
+using namespace gl;
+
+static SpriteVertex makeVertex(float x, float y, float u, float v, const Colour &colour)
+{
+	SpriteVertex vertex;
+	vertex.x = x;
+	vertex.y = y;
+	vertex.u = u;
+	vertex.v = v;
+	vertex.colour[0] = static_cast<unsigned char>(colour.r * 255.0 + 0.5);
+	vertex.colour[1] = static_cast<unsigned char>(colour.g * 255.0 + 0.5);
+	vertex.colour[2] = static_cast<unsigned char>(colour.b * 255.0 + 0.5);
+	vertex.colour[3] = static_cast<unsigned char>(colour.a * 255.0 + 0.5);
+	return vertex;
+}
+
+/**
+ * Gets the points of a unit circle split into a number of segments, with the first point repeated at the end.
+ */
+static const std::vector<float> &getUnitCircle(int segmentsPerCircle)
+{
+	static std::map<int, std::vector<float>> circles;
+	std::vector<float> &circle = circles[segmentsPerCircle];
+	if (circle.empty())
+	{
+		float step = 2.0f * 3.14159265f / segmentsPerCircle;
+		for (int i = 0; i <= segmentsPerCircle; i++)
+		{
+			circle.push_back(std::cos(i * step));
+			circle.push_back(std::sin(i * step));
+		}
+	}
+	return circle;
+}
+
+void SpriteMesh::clear()
+{
+	vertices.clear();
+}
+
+bool SpriteMesh::empty() const
+{
+	return vertices.empty();
+}
+
+void SpriteMesh::addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+	const Colour &colour)
+{
+	SpriteVertex topLeft = makeVertex(x0, y0, u0, v0, colour);
+	SpriteVertex bottomLeft = makeVertex(x0, y1, u0, v1, colour);
+	SpriteVertex bottomRight = makeVertex(x1, y1, u1, v1, colour);
+	SpriteVertex topRight = makeVertex(x1, y0, u1, v0, colour);
+	vertices.push_back(topLeft);
+	vertices.push_back(bottomLeft);
+	vertices.push_back(bottomRight);
+	vertices.push_back(topLeft);
+	vertices.push_back(bottomRight);
+	vertices.push_back(topRight);
+}
+
+void SpriteMesh::addFan(float x, float y, float radius, int segments, int segmentsPerCircle, const Colour &colour)
+{
+	const std::vector<float> &circle = getUnitCircle(segmentsPerCircle);
+	segments = std::min(segments, segmentsPerCircle);
+	SpriteVertex centre = makeVertex(x, y, 0.0f, 0.0f, colour);
+	for (int i = 0; i < segments; i++)
+	{
+		vertices.push_back(centre);
+		vertices.push_back(makeVertex(x + circle[2 * i] * radius, y + circle[2 * i + 1] * radius, 0.0f, 0.0f, colour));
+		vertices.push_back(makeVertex(x + circle[2 * i + 2] * radius, y + circle[2 * i + 3] * radius, 0.0f, 0.0f,
+			colour));
+	}
+}
+
+SpriteBatch::SpriteBatch() : groupCount(0), stream(GL_ARRAY_BUFFER, SPRITE_STREAM_REGION_SIZE), lastDrawCallCount(0)
+{
+}
+
+SpriteMesh &SpriteBatch::getMesh(const std::shared_ptr<Texture> &texture)
+{
+	// A pass only uses a handful of textures, so a linear search beats hashing.
+	for (size_t i = 0; i < groupCount; i++)
+	{
+		if (groups[i].texture == texture)
+		{
+			return groups[i].mesh;
+		}
+	}
+	if (groupCount == groups.size())
+	{
+		groups.push_back(SpriteGroup());
+	}
+	SpriteGroup &group = groups[groupCount++];
+	group.texture = texture;
+	return group.mesh;
+}
+
+void SpriteBatch::add(const std::shared_ptr<Texture> &texture, const SpriteMesh &mesh, float offsetX, float offsetY)
+{
+	std::vector<SpriteVertex> &vertices = getMesh(texture).vertices;
+	for (const SpriteVertex &vertex : mesh.vertices)
+	{
+		vertices.push_back(vertex);
+		vertices.back().x += offsetX;
+		vertices.back().y += offsetY;
+	}
+}
+
+void SpriteBatch::addQuad(const std::shared_ptr<Texture> &texture, float x0, float y0, float x1, float y1, float u0,
+	float v0, float u1, float v1, const Colour &colour)
+{
+	getMesh(texture).addQuad(x0, y0, x1, y1, u0, v0, u1, v1, colour);
+}
+
+void SpriteBatch::flush()
+{
+	lastDrawCallCount = 0;
+	uploadData.clear();
+	for (size_t i = 0; i < groupCount; i++)
+	{
+		uploadData.insert(uploadData.end(), groups[i].mesh.vertices.begin(), groups[i].mesh.vertices.end());
+	}
+	if (!uploadData.empty())
+	{
+		size_t offset = stream.write(uploadData.data(), uploadData.size() * sizeof(SpriteVertex));
+		bindBuffer(GL_ARRAY_BUFFER, stream.getBufferID());
+		setClientArrays(true, false, true, true);
+		GLsizei stride = sizeof(SpriteVertex);
+		glVertexPointer(2, GL_FLOAT, stride, (void*)(offset));
+		glTexCoordPointer(2, GL_FLOAT, stride, (void*)(offset + 2 * sizeof(GLfloat)));
+		glColorPointer(4, GL_UNSIGNED_BYTE, stride, (void*)(offset + 4 * sizeof(GLfloat)));
+		disableState(GL_BLEND);
+		setAlphaFunc(GL_GREATER, 0.1f);
+		enableState(GL_ALPHA_TEST);
+
+		GLint first = 0;
+		for (size_t i = 0; i < groupCount; i++)
+		{
+			GLsizei count = static_cast<GLsizei>(groups[i].mesh.vertices.size());
+			if (count == 0)
+			{
+				continue;
+			}
+			if (groups[i].texture)
+			{
+				enableState(GL_TEXTURE_2D);
+				groups[i].texture->bind();
+			}
+			else
+			{
+				disableState(GL_TEXTURE_2D);
+			}
+			glDrawArrays(GL_TRIANGLES, first, count);
+			first += count;
+			lastDrawCallCount++;
+		}
+		// The colour array leaves the current colour undefined.
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+	for (size_t i = 0; i < groupCount; i++)
+	{
+		groups[i].texture.reset();
+		groups[i].mesh.clear();
+	}
+	groupCount = 0;
+}
+
+int SpriteBatch::getLastDrawCallCount()
+{
+	return lastDrawCallCount;
+}
@@ -0,0 +1,121 @@
+#ifndef ENG_SPRITE_BATCH_H
+#define ENG_SPRITE_BATCH_H
+
+#include <memory>
+#include <vector>
+#include <glbinding/gl/gl.h>
+#include "render/streambuffer.h"
+#include "render/texture.h"
+#include "utils/colour.h"
+
+/** The initial size, in bytes, of each frame's region of the sprite stream. */
+const size_t SPRITE_STREAM_REGION_SIZE = 64 * 1024;
+
+/**
+ * One vertex of 2D geometry in window coordinates, with the origin at the top left.
+ */
+struct SpriteVertex
+{
+	float x;
+	float y;
+	float u;
+	float v;
+	unsigned char colour[4];
+};
+
+/**
+ * SpriteMesh is a list of 2D triangles. Geometry that does not change from frame to frame, such as panels and rings,
+ * can be built into a SpriteMesh once and then added to a SpriteBatch at an offset every frame.
+ */
+class SpriteMesh
+{
+public:
+	std::vector<SpriteVertex> vertices;
+
+	void clear();
+	bool empty() const;
+	/**
+	 * Adds an axis aligned rectangle as two triangles.
+	 * @param x0 the x position of the first corner
+	 * @param y0 the y position of the first corner
+	 * @param x1 the x position of the opposite corner
+	 * @param y1 the y position of the opposite corner
+	 * @param u0 the texture coordinate at the first corner
+	 * @param v0 the texture coordinate at the first corner
+	 * @param u1 the texture coordinate at the opposite corner
+	 * @param v1 the texture coordinate at the opposite corner
+	 * @param colour the colour of the rectangle, which modulates its texture
+	 */
+	void addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, const Colour &colour);
+	/**
+	 * Adds a filled circle, or part of one, as a triangle fan. The points on the edge are read from a table that is
+	 * built once for each number of segments per circle.
+	 * @param x the x position of the centre
+	 * @param y the y position of the centre
+	 * @param radius the radius of the circle
+	 * @param segments the number of segments to add, starting at angle 0 and going clockwise on screen
+	 * @param segmentsPerCircle the number of segments that make up a full circle
+	 * @param colour the colour of the circle
+	 */
+	void addFan(float x, float y, float radius, int segments, int segmentsPerCircle, const Colour &colour);
+};
+
+/**
+ * SpriteBatch collects the textured and coloured 2D geometry of a pass, such as the HUD or a menu, and draws it
+ * with one glDrawArrays call per texture when flush() is called. All the geometry goes into one block of a
+ * StreamBuffer, so a flush is a single write no matter how many textures there are.
+ * <br><br>
+ * Geometry is grouped by texture, and the groups are drawn in the order their textures were first used during
+ * the pass. Within a group geometry is drawn in the order it was added. Geometry of a later texture therefore
+ * always ends up above that of an earlier one, which suits UIs where icons and text sit on top of panels.
+ */
+class SpriteBatch
+{
+public:
+	SpriteBatch();
+	/**
+	 * Gets the mesh of the group for a texture, so geometry can be appended to it directly.
+	 * @param texture the texture to draw with, or nullptr for untextured geometry
+	 */
+	SpriteMesh &getMesh(const std::shared_ptr<Texture> &texture);
+	/**
+	 * Adds a copy of a prebuilt mesh.
+	 * @param texture the texture to draw with, or nullptr for untextured geometry
+	 * @param mesh the mesh to copy
+	 * @param offsetX added to the x position of every vertex
+	 * @param offsetY added to the y position of every vertex
+	 */
+	void add(const std::shared_ptr<Texture> &texture, const SpriteMesh &mesh, float offsetX = 0.0f, float offsetY = 0.0f);
+	/**
+	 * Adds an axis aligned rectangle, see SpriteMesh::addQuad(...).
+	 */
+	void addQuad(const std::shared_ptr<Texture> &texture, float x0, float y0, float x1, float y1, float u0, float v0,
+		float u1, float v1, const Colour &colour);
+	/**
+	 * Draws and clears everything added since the last flush. The projection must be the one set up by
+	 * start2DRenderCycle(). Sprites are drawn alpha tested, without blending.
+	 */
+	void flush();
+	/**
+	 * Gets the number of draw calls issued by the last call to flush().
+	 */
+	int getLastDrawCallCount();
+private:
+	SpriteBatch(const SpriteBatch&) = delete;
+	SpriteBatch& operator=(const SpriteBatch&) = delete;
+	/**
+	 * All the geometry of one texture. Groups are reused from pass to pass so their meshes keep their capacity.
+	 */
+	struct SpriteGroup
+	{
+		std::shared_ptr<Texture> texture;
+		SpriteMesh mesh;
+	};
+	std::vector<SpriteGroup> groups;
+	size_t groupCount;
+	std::vector<SpriteVertex> uploadData;
+	StreamBuffer stream;
+	int lastDrawCallCount;
+};
+
+#endif
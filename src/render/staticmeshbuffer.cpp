@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <iterator>
+#include <iostream>
+#include <glbinding/ContextInfo.h>
+#include <glbinding/Version.h>
+#include <glbinding/gl/extension.h>
+#include "render/staticmeshbuffer.h"
+#include "render/glstate.h"
+#include "render/meshprogram.h"
+#include "render/vbo.h"
+
+using namespace gl;
+
+/** The room the buffers are first created with: 64k vertices and 256k indices. */
+static const int INITIAL_STATIC_VERTEX_CAPACITY = 65536;
+static const int INITIAL_STATIC_INDEX_CAPACITY = 4 * 65536;
+
+bool isMultiDrawIndirectSupported()
+{
+	static int supported = -1;
+	if (supported < 0)
+	{
+		bool multiDraw = glbinding::ContextInfo::version() >= glbinding::Version(4, 3) ||
+			(glbinding::ContextInfo::extensions().count(GLextension::GL_ARB_multi_draw_indirect) > 0 &&
+			glbinding::ContextInfo::extensions().count(GLextension::GL_ARB_base_instance) > 0);
+		supported = multiDraw && isCoreRenderPathActive();
+		if (!supported)
+		{
+			std::cout << "Multi draw indirect unavailable, static meshes keep their own buffers." << std::endl;
+		}
+	}
+	return supported == 1;
+}
+
+/** Created on first use and deleted by releaseStaticMeshBuffer(), as its GL objects must go with the context. */
+static StaticMeshBuffer *staticMeshBuffer = nullptr;
+
+StaticMeshBuffer &getStaticMeshBuffer()
+{
+	if (!staticMeshBuffer)
+	{
+		staticMeshBuffer = new StaticMeshBuffer();
+	}
+	return *staticMeshBuffer;
+}
+
+bool hasStaticMeshBuffer()
+{
+	return staticMeshBuffer != nullptr;
+}
+
+void releaseStaticMeshBuffer()
+{
+	delete staticMeshBuffer;
+	staticMeshBuffer = nullptr;
+}
+
+StaticMeshBuffer::StaticMeshBuffer() : vertexCount(0), indexCount(0), vertexCapacity(0), indexCapacity(0),
+	vertexBufferID(0), indexBufferID(0), vertexArrayID(0)
+{
+}
+
+StaticMeshBuffer::~StaticMeshBuffer()
+{
+	if (vertexArrayID != 0)
+	{
+		glDeleteVertexArrays(1, &vertexArrayID);
+		notifyVertexArrayDeleted(vertexArrayID);
+		glDeleteBuffers(1, &vertexBufferID);
+		notifyBufferDeleted(vertexBufferID);
+		glDeleteBuffers(1, &indexBufferID);
+		notifyBufferDeleted(indexBufferID);
+	}
+}
+
+/**
+ * Copies up to size floats of one attribute of each vertex into the packed layout, filling any components the mesh
+ * does not have from a default value.
+ */
+static void copyAttribute(MeshData &mesh, int size, int offset, int packedOffset, int packedSize,
+	const float *defaults, std::vector<float> &packed)
+{
+	const float *source = mesh.combinedData.getRawArray();
+	int vertexCount = static_cast<int>(mesh.combinedData.size()) / mesh.elementsPerRowOfCombinedData;
+	int sourceOffset = offset / static_cast<int>(sizeof(float));
+	int copied = std::min(size, packedSize);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		const float *from = source + v * mesh.elementsPerRowOfCombinedData + sourceOffset;
+		float *to = &packed[v * STATIC_MESH_VERTEX_SIZE + packedOffset];
+		std::copy(from, from + copied, to);
+		std::copy(defaults + copied, defaults + packedSize, to + copied);
+	}
+}
+
+int StaticMeshBuffer::addMesh(MeshData &mesh)
+{
+	bool floats = mesh.vertexType == GL_FLOAT && (mesh.normalSize == 0 || mesh.normalType == GL_FLOAT) &&
+		(mesh.colourSize == 0 || mesh.colourType == GL_FLOAT) &&
+		(mesh.textureCoordSize == 0 || mesh.textureCoordType == GL_FLOAT);
+	if (!floats || (mesh.glRenderMode != GL_TRIANGLES && mesh.glRenderMode != GL_QUADS) ||
+		mesh.elementsPerRowOfCombinedData <= 0)
+	{
+		return -1;
+	}
+
+	int meshVertexCount = static_cast<int>(mesh.combinedData.size()) / mesh.elementsPerRowOfCombinedData;
+	std::vector<float> vertices(meshVertexCount * STATIC_MESH_VERTEX_SIZE);
+	static const float ZERO[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	// Without colours the fixed function path draws white, so the packed mesh does too.
+	static const float WHITE[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	copyAttribute(mesh, mesh.vertexSize, mesh.vertexOffset, 0, 3, ZERO, vertices);
+	copyAttribute(mesh, mesh.normalSize, mesh.normalOffset, 3, 3, ZERO, vertices);
+	copyAttribute(mesh, mesh.colourSize, mesh.colourOffset, 6, 4, WHITE, vertices);
+	copyAttribute(mesh, (mesh.hasTextureData) ? mesh.textureCoordSize : 0, mesh.textureCoordOffset, 10, 2, ZERO,
+		vertices);
+
+	if (mesh.glRenderMode == GL_QUADS)
+	{
+		std::vector<unsigned int> triangles;
+		std::vector<MeshLOD> triangleLODs;
+		triangulateQuads(mesh.indices, meshVertexCount, mesh.lods, triangles, triangleLODs);
+		return addMesh(vertices, triangles, triangleLODs);
+	}
+	if (mesh.indices.empty())
+	{
+		std::vector<unsigned int> indices(meshVertexCount);
+		for (int i = 0; i < meshVertexCount; i++)
+		{
+			indices[i] = static_cast<unsigned int>(i);
+		}
+		return addMesh(vertices, indices, mesh.lods);
+	}
+	return addMesh(vertices, mesh.indices, mesh.lods);
+}
+
+/**
+ * Takes a range from a free-list, first fit, or from the end of the used part of the buffer if no range is large
+ * enough.
+ * @param end the end of the used part, moved past the range if it is taken from there
+ * @return the first element of the range
+ */
+static int allocateRange(std::map<int, int> &freeRanges, int count, int &end)
+{
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+	{
+		if (it->second >= count)
+		{
+			int first = it->first;
+			int remaining = it->second - count;
+			freeRanges.erase(it);
+			if (remaining > 0)
+			{
+				freeRanges[first + count] = remaining;
+			}
+			return first;
+		}
+	}
+	int first = end;
+	end += count;
+	return first;
+}
+
+/**
+ * Returns a range to a free-list, merging it with the free ranges on either side. A range that reaches the end of
+ * the used part of the buffer shortens it instead.
+ */
+static void freeRange(std::map<int, int> &freeRanges, int first, int count, int &end)
+{
+	auto next = freeRanges.lower_bound(first);
+	if (next != freeRanges.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == first)
+		{
+			first = previous->first;
+			count += previous->second;
+			freeRanges.erase(previous);
+		}
+	}
+	if (next != freeRanges.end() && first + count == next->first)
+	{
+		count += next->second;
+		freeRanges.erase(next);
+	}
+	if (first + count == end)
+	{
+		end = first;
+		return;
+	}
+	freeRanges[first] = count;
+}
+
+int StaticMeshBuffer::addMesh(const std::vector<float> &vertices, const std::vector<unsigned int> &indices,
+	const std::vector<MeshLOD> &meshLODs)
+{
+	StaticMesh mesh;
+	mesh.vertexCount = static_cast<int>(vertices.size()) / STATIC_MESH_VERTEX_SIZE;
+	mesh.indexCount = static_cast<int>(indices.size());
+	mesh.baseVertex = allocateRange(freeVertexRanges, mesh.vertexCount, vertexCount);
+	mesh.firstIndex = allocateRange(freeIndexRanges, mesh.indexCount, indexCount);
+	mesh.lods = meshLODs;
+	if (mesh.lods.empty())
+	{
+		mesh.lods.push_back({ 0, mesh.indexCount, 0.0f });
+	}
+	int meshID;
+	if (!freeMeshIDs.empty())
+	{
+		meshID = freeMeshIDs.back();
+		freeMeshIDs.pop_back();
+		meshes[meshID] = mesh;
+	}
+	else
+	{
+		meshID = static_cast<int>(meshes.size());
+		meshes.push_back(mesh);
+	}
+	PendingMesh pending;
+	pending.meshID = meshID;
+	pending.vertices = vertices;
+	pending.indices = indices;
+	pendingMeshes.push_back(pending);
+	return meshID;
+}
+
+void StaticMeshBuffer::removeMesh(int meshID)
+{
+	if (meshID < 0 || meshID >= static_cast<int>(meshes.size()) || meshes[meshID].lods.empty())
+	{
+		return;
+	}
+	StaticMesh &mesh = meshes[meshID];
+	pendingMeshes.erase(std::remove_if(pendingMeshes.begin(), pendingMeshes.end(),
+		[meshID](const PendingMesh &pending) { return pending.meshID == meshID; }), pendingMeshes.end());
+	freeRange(freeVertexRanges, mesh.baseVertex, mesh.vertexCount, vertexCount);
+	freeRange(freeIndexRanges, mesh.firstIndex, mesh.indexCount, indexCount);
+	mesh = StaticMesh();
+	freeMeshIDs.push_back(meshID);
+}
+
+/**
+ * Replaces a buffer with a larger one, copying the first usedBytes across.
+ */
+static GLuint growBuffer(GLuint bufferID, size_t usedBytes, size_t newBytes)
+{
+	GLuint grown = createVBOID();
+	glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+	glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+	if (bufferID != 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, bufferID);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+		glDeleteBuffers(1, &bufferID);
+		notifyBufferDeleted(bufferID);
+	}
+	return grown;
+}
+
+/**
+ * Copies the pending meshes into their places in the GL buffers, growing the buffers first if there is not room.
+ */
+void StaticMeshBuffer::upload()
+{
+	size_t vertexBytes = STATIC_MESH_VERTEX_SIZE * sizeof(float);
+	bool replaced = false;
+	if (vertexCount > vertexCapacity)
+	{
+		int capacity = std::max(std::max(vertexCapacity * 2, INITIAL_STATIC_VERTEX_CAPACITY), vertexCount);
+		vertexBufferID = growBuffer(vertexBufferID, vertexCapacity * vertexBytes, capacity * vertexBytes);
+		vertexCapacity = capacity;
+		replaced = true;
+	}
+	if (indexCount > indexCapacity)
+	{
+		int capacity = std::max(std::max(indexCapacity * 2, INITIAL_STATIC_INDEX_CAPACITY), indexCount);
+		indexBufferID = growBuffer(indexBufferID, indexCapacity * sizeof(GLuint), capacity * sizeof(GLuint));
+		indexCapacity = capacity;
+		replaced = true;
+	}
+
+	if (vertexArrayID == 0)
+	{
+		glGenVertexArrays(1, &vertexArrayID);
+	}
+	bindVertexArray(vertexArrayID);
+	if (replaced)
+	{
+		// The vertex array object holds on to the buffers it was set up with, so it is pointed at the new ones.
+		int stride = static_cast<int>(vertexBytes);
+		bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+		setVertexAttribute(VERTEX_ATTRIBUTE_POSITION, 3, GL_FLOAT, stride, 0);
+		setVertexAttribute(VERTEX_ATTRIBUTE_NORMAL, 3, GL_FLOAT, stride, 3 * sizeof(float));
+		setVertexAttribute(VERTEX_ATTRIBUTE_COLOUR, 4, GL_FLOAT, stride, 6 * sizeof(float));
+		setVertexAttribute(VERTEX_ATTRIBUTE_TEXTURE_COORD, 2, GL_FLOAT, stride, 10 * sizeof(float));
+	}
+	bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+	for (PendingMesh &pending : pendingMeshes)
+	{
+		const StaticMesh &mesh = meshes[pending.meshID];
+		glBufferSubData(GL_ARRAY_BUFFER, mesh.baseVertex * vertexBytes, pending.vertices.size() * sizeof(float),
+			pending.vertices.data());
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, mesh.firstIndex * sizeof(GLuint), pending.indices.size() * sizeof(GLuint),
+			pending.indices.data());
+	}
+	pendingMeshes = std::vector<PendingMesh>();
+}
+
+void StaticMeshBuffer::bind()
+{
+	if (!pendingMeshes.empty())
+	{
+		upload();
+		return;
+	}
+	bindVertexArray(vertexArrayID);
+}
@@ -0,0 +1,136 @@
+#ifndef ENG_STATIC_MESH_BUFFER_H
+#define ENG_STATIC_MESH_BUFFER_H
+
+#include <map>
+#include <vector>
+#include <glbinding/gl/gl.h>
+#include "world/meshdata.h"
+
+/** Floats per vertex in a StaticMeshBuffer: a position, a normal, a colour and a texture coordinate. */
+const int STATIC_MESH_VERTEX_SIZE = 12;
+
+/**
+ * Where one mesh lives in a StaticMeshBuffer. Its indices count from baseVertex, so they are the mesh's own.
+ */
+struct StaticMesh
+{
+	int baseVertex;
+	int vertexCount;
+	int firstIndex;
+	int indexCount;
+	/** The index ranges of each level of detail, relative to firstIndex. There is always at least one. */
+	std::vector<MeshLOD> lods;
+};
+
+/**
+ * One draw read by glMultiDrawElementsIndirect, laid out as GL expects it in the GL_DRAW_INDIRECT_BUFFER.
+ */
+struct DrawElementsIndirectCommand
+{
+	gl::GLuint count;
+	gl::GLuint instanceCount;
+	gl::GLuint firstIndex;
+	gl::GLint baseVertex;
+	/** Added to the instance number before per-instance attributes are read, so each draw finds its own transforms. */
+	gl::GLuint baseInstance;
+};
+
+/**
+ * StaticMeshBuffer packs the meshes of every static model into one vertex buffer and one element buffer behind a
+ * single vertex array object, so any number of them can be drawn with one glMultiDrawElementsIndirect. Every mesh
+ * is converted to the same vertex layout, and quads are split into triangles.
+ * <br><br>
+ * Meshes are kept on the CPU only until the next bind(), which uploads them to the GL buffers. Removed meshes leave
+ * vertex and index ranges behind on free-lists, which later meshes are placed in first fit, so models that come and
+ * go do not grow the buffers. Buffers that run out of room are replaced by ones twice the size, with the meshes
+ * already there copied across on the GPU.
+ */
+class StaticMeshBuffer
+{
+public:
+	StaticMeshBuffer();
+	~StaticMeshBuffer();
+	/**
+	 * Adds a mesh to the buffer.
+	 * @param mesh the mesh to add. Every attribute must be stored as GL_FLOAT, and it must be drawn as
+	 * GL_TRIANGLES or GL_QUADS
+	 * @return the ID of the mesh, or -1 if the mesh cannot be packed
+	 */
+	int addMesh(MeshData &mesh);
+	/**
+	 * Adds a mesh that is already in the buffer's vertex layout.
+	 * @param vertices STATIC_MESH_VERTEX_SIZE floats per vertex
+	 * @param indices the triangles' indices, counting from the mesh's first vertex
+	 * @param meshLODs the index ranges of each level of detail, or empty if all the indices are one level
+	 * @return the ID of the mesh
+	 */
+	int addMesh(const std::vector<float> &vertices, const std::vector<unsigned int> &indices,
+		const std::vector<MeshLOD> &meshLODs);
+	/**
+	 * Removes a mesh, freeing its ranges of the buffers for later meshes. Its ID may be handed out again.
+	 * @param meshID an ID returned by addMesh(...)
+	 */
+	void removeMesh(int meshID);
+	/**
+	 * Gets where a mesh added earlier lives in the buffer.
+	 */
+	const StaticMesh &getMesh(int meshID) const;
+	/**
+	 * Binds the vertex array object, uploading any meshes added since the last bind. It has no per-instance
+	 * attributes of its own; locations from VERTEX_ATTRIBUTE_FIRST_INSTANCE up are left to the caller. The element
+	 * buffer holds GL_UNSIGNED_INT indices.
+	 */
+	void bind();
+private:
+	StaticMeshBuffer(const StaticMeshBuffer&) = delete;
+	StaticMeshBuffer& operator=(const StaticMeshBuffer&) = delete;
+	/**
+	 * A mesh added since the last upload, with the data to put at its place in the buffers.
+	 */
+	struct PendingMesh
+	{
+		int meshID;
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+	};
+	std::vector<StaticMesh> meshes;
+	std::vector<int> freeMeshIDs;
+	std::vector<PendingMesh> pendingMeshes;
+	/** Free ranges of each buffer keyed by their first element, mapped to their length. Neighbours are merged. */
+	std::map<int, int> freeVertexRanges;
+	std::map<int, int> freeIndexRanges;
+	/**
+	 * The end of the used part of each buffer, in vertices and indices, counting meshes not yet uploaded, and the
+	 * number there is room for.
+	 */
+	int vertexCount;
+	int indexCount;
+	int vertexCapacity;
+	int indexCapacity;
+	gl::GLuint vertexBufferID;
+	gl::GLuint indexBufferID;
+	gl::GLuint vertexArrayID;
+	void upload();
+};
+
+/**
+ * Checks, once, whether static models are packed into the StaticMeshBuffer and drawn with
+ * glMultiDrawElementsIndirect. This needs the core render path, and GL 4.3 or ARB_multi_draw_indirect and
+ * ARB_base_instance. The buffer itself only needs the core render path.
+ */
+bool isMultiDrawIndirectSupported();
+/**
+ * Gets the StaticMeshBuffer every static model is packed into, creating it on the first call.
+ */
+StaticMeshBuffer &getStaticMeshBuffer();
+/**
+ * Gets whether the StaticMeshBuffer exists, so objects destroyed after releaseStaticMeshBuffer() do not create it
+ * again to remove their meshes.
+ */
+bool hasStaticMeshBuffer();
+/**
+ * Deletes the StaticMeshBuffer and its GL objects. This is called at shutdown, while the GL context still exists.
+ */
+void releaseStaticMeshBuffer();
+
+#endif
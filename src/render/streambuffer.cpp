@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <glbinding/ContextInfo.h>
+#include <glbinding/Version.h>
+#include <glbinding/gl/extension.h>
+#include "render/streambuffer.h"
+#include "render/glstate.h"
+
+using namespace gl;
+
+/** How long a single wait on a fence may take, in nanoseconds, before it is retried. */
+static const GLuint64 FENCE_WAIT_TIMEOUT = 1000000000;
+
+static unsigned int streamBufferFrame = 0;
+
+void advanceStreamBufferFrame()
+{
+	streamBufferFrame++;
+}
+
+/**
+ * Checks, once, whether the context can create immutable buffer storage that stays mapped.
+ */
+static bool isBufferStorageSupported()
+{
+	static int supported = -1;
+	if (supported < 0)
+	{
+		supported = glbinding::ContextInfo::version() >= glbinding::Version(4, 4) ||
+			glbinding::ContextInfo::extensions().count(GLextension::GL_ARB_buffer_storage) > 0;
+	}
+	return supported == 1;
+}
+
+StreamBuffer::StreamBuffer(GLenum target, size_t regionSize) : target(target), bufferID(0), regionSize(regionSize),
+	region(0), cursor(0), frame(streamBufferFrame), mapping(nullptr), persistent(false)
+{
+	std::fill(fences, fences + STREAM_BUFFER_REGIONS, nullptr);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	releaseStorage();
+	releaseRetiredBuffers(true);
+}
+
+/**
+ * Allocates the GL buffer with room for every region, mapping it if persistent mapping is supported.
+ */
+void StreamBuffer::createStorage()
+{
+	glGenBuffers(1, &bufferID);
+	bindBuffer(target, bufferID);
+	size_t size = regionSize * STREAM_BUFFER_REGIONS;
+	persistent = isBufferStorageSupported();
+	if (persistent)
+	{
+		glBufferStorage(target, size, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+		mapping = static_cast<char*>(glMapBufferRange(target, 0, size,
+			GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+		if (!mapping)
+		{
+			std::cout << "Persistent mapping of a stream buffer failed, mapping per write instead." << std::endl;
+			glDeleteBuffers(1, &bufferID);
+			notifyBufferDeleted(bufferID);
+			glGenBuffers(1, &bufferID);
+			bindBuffer(target, bufferID);
+			persistent = false;
+		}
+	}
+	if (!persistent)
+	{
+		glBufferData(target, size, nullptr, GL_STREAM_DRAW);
+	}
+}
+
+/**
+ * Deletes the GL buffer and every fence. Draws already issued from the buffer are unaffected, as GL keeps the
+ * storage alive until they complete.
+ */
+void StreamBuffer::releaseStorage()
+{
+	for (GLsync &fence : fences)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	if (bufferID != 0)
+	{
+		if (mapping)
+		{
+			bindBuffer(target, bufferID);
+			glUnmapBuffer(target);
+			mapping = nullptr;
+		}
+		glDeleteBuffers(1, &bufferID);
+		notifyBufferDeleted(bufferID);
+		bufferID = 0;
+	}
+}
+
+/**
+ * Moves the GL buffer to the retired list, leaving it mapped and alive, and drops the fences of its regions.
+ */
+void StreamBuffer::retireStorage()
+{
+	for (GLsync &fence : fences)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	RetiredBuffer retired = { bufferID, mapping != nullptr, nullptr };
+	retiredBuffers.push_back(retired);
+	bufferID = 0;
+	mapping = nullptr;
+}
+
+/**
+ * Deletes the retired buffers whose fence has passed, without waiting for the others.
+ * @param force whether to delete every retired buffer, fenced or not
+ */
+void StreamBuffer::releaseRetiredBuffers(bool force)
+{
+	for (size_t i = 0; i < retiredBuffers.size();)
+	{
+		RetiredBuffer &retired = retiredBuffers[i];
+		if (!force)
+		{
+			if (!retired.fence)
+			{
+				i++;
+				continue;
+			}
+			GLenum result = glClientWaitSync(retired.fence, static_cast<SyncObjectMask>(0), 0);
+			if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+			{
+				i++;
+				continue;
+			}
+		}
+		if (retired.fence)
+		{
+			glDeleteSync(retired.fence);
+		}
+		if (retired.mapped)
+		{
+			bindBuffer(target, retired.bufferID);
+			glUnmapBuffer(target);
+		}
+		glDeleteBuffers(1, &retired.bufferID);
+		notifyBufferDeleted(retired.bufferID);
+		retiredBuffers.erase(retiredBuffers.begin() + i);
+	}
+}
+
+/**
+ * Blocks until the GPU has finished every command issued before the region's fence.
+ */
+void StreamBuffer::waitForRegion(int region)
+{
+	GLsync &fence = fences[region];
+	if (!fence)
+	{
+		return;
+	}
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT);
+	while (result == GL_TIMEOUT_EXPIRED)
+	{
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT);
+	}
+	if (result == GL_WAIT_FAILED)
+	{
+		std::cout << "Waiting on a stream buffer fence failed." << std::endl;
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+size_t StreamBuffer::write(const void *data, size_t bytes, size_t alignment)
+{
+	if (bufferID == 0)
+	{
+		createStorage();
+	}
+	if (frame != streamBufferFrame)
+	{
+		// Every command reading this region has been issued by now, so the fence can go in on the first write of
+		// the next frame rather than at the end of the last one.
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_UNUSED_BIT);
+		region = (region + 1) % STREAM_BUFFER_REGIONS;
+		cursor = 0;
+		frame = streamBufferFrame;
+		waitForRegion(region);
+		for (RetiredBuffer &retired : retiredBuffers)
+		{
+			if (!retired.fence)
+			{
+				retired.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_UNUSED_BIT);
+			}
+		}
+		releaseRetiredBuffers(false);
+	}
+
+	size_t start = (cursor + alignment - 1) & ~(alignment - 1);
+	if (start + bytes > regionSize)
+	{
+		// Blocks handed out earlier this frame may not have been drawn from yet, so the old buffer is kept alive.
+		retireStorage();
+		regionSize = std::max(regionSize * 2, bytes * 2);
+		createStorage();
+		region = 0;
+		start = 0;
+	}
+	cursor = start + bytes;
+
+	size_t offset = region * regionSize + start;
+	if (persistent)
+	{
+		std::memcpy(mapping + offset, data, bytes);
+		return offset;
+	}
+	bindBuffer(target, bufferID);
+	void *destination = glMapBufferRange(target, offset, bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	if (destination)
+	{
+		std::memcpy(destination, data, bytes);
+		glUnmapBuffer(target);
+	}
+	else
+	{
+		glBufferSubData(target, offset, bytes, data);
+	}
+	return offset;
+}
+
+GLuint StreamBuffer::getBufferID()
+{
+	return bufferID;
+}
+
+bool StreamBuffer::isPersistentlyMapped()
+{
+	return persistent;
+}
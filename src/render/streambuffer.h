@@ -0,0 +1,92 @@
+#ifndef ENG_STREAM_BUFFER_H
+#define ENG_STREAM_BUFFER_H
+
+#include <cstddef>
+#include <vector>
+#include <glbinding/gl/gl.h>
+
+/** The number of frames a StreamBuffer can have in flight before writing to it waits on the GPU. */
+const int STREAM_BUFFER_REGIONS = 3;
+/** The default alignment, in bytes, of each block written to a StreamBuffer. */
+const size_t STREAM_BUFFER_ALIGNMENT = 16;
+
+/**
+ * StreamBuffer is a ring buffer for data that is rebuilt every frame, such as instance transforms. The GL buffer
+ * is split into STREAM_BUFFER_REGIONS regions and each frame writes into the next one, so the CPU can fill a region
+ * while the GPU still reads the regions of the previous frames. A fence is placed after the last frame that used a
+ * region, and the region is only reused once that fence has been passed.
+ * <br><br>
+ * Where GL 4.4 or ARB_buffer_storage is available the buffer is mapped once, persistently, and writes are a plain
+ * memcpy. Otherwise each write maps its range with GL_MAP_UNSYNCHRONIZED_BIT, which is safe for the same reason.
+ * <br><br>
+ * The buffer is created on the first write, as that needs a GL context. A region that runs out of room is doubled by
+ * replacing the buffer, so getBufferID() changes. The old buffer is kept, untouched, until a fence placed after the
+ * frame it was replaced in has passed, so blocks written to it earlier in that frame can still be drawn from.
+ */
+class StreamBuffer
+{
+public:
+	/**
+	 * Creates a StreamBuffer but does not allocate any GL resources.
+	 * @param target the buffer target the data is written through, such as GL_ARRAY_BUFFER
+	 * @param regionSize the initial size of one frame's region, in bytes
+	 */
+	StreamBuffer(gl::GLenum target, size_t regionSize);
+	~StreamBuffer();
+	/**
+	 * Copies a block of data into this frame's region.
+	 * @param data the bytes to copy
+	 * @param bytes the number of bytes to copy
+	 * @param alignment the alignment of the block's offset, which must be a power of two
+	 * @return the offset of the block from the start of the buffer, valid until the buffer is written to in a
+	 * later frame. It is an offset into the buffer getBufferID() returns straight after this write, as a write that
+	 * grows the buffer replaces it
+	 */
+	size_t write(const void *data, size_t bytes, size_t alignment = STREAM_BUFFER_ALIGNMENT);
+	/**
+	 * Gets the GL buffer the last write went to. This changes when a write grows the buffer.
+	 */
+	gl::GLuint getBufferID();
+	/**
+	 * Gets whether the buffer is written through a persistent mapping.
+	 */
+	bool isPersistentlyMapped();
+private:
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+	gl::GLenum target;
+	gl::GLuint bufferID;
+	size_t regionSize;
+	int region;
+	/** The next free byte of the current region, relative to its start. */
+	size_t cursor;
+	/** The value of the frame counter when this buffer was last written to. */
+	unsigned int frame;
+	gl::GLsync fences[STREAM_BUFFER_REGIONS];
+	char *mapping;
+	bool persistent;
+	/**
+	 * A buffer that was replaced when the regions grew.
+	 */
+	struct RetiredBuffer
+	{
+		gl::GLuint bufferID;
+		bool mapped;
+		/** Placed once the frame the buffer was replaced in has ended, or null until then. */
+		gl::GLsync fence;
+	};
+	std::vector<RetiredBuffer> retiredBuffers;
+	void createStorage();
+	void releaseStorage();
+	void retireStorage();
+	void releaseRetiredBuffers(bool force);
+	void waitForRegion(int region);
+};
+
+/**
+ * Ends the frame for every StreamBuffer. The next write to each buffer fences the region it wrote last and moves
+ * on to the next one. This is called once per frame, after the buffers are swapped.
+ */
+void advanceStreamBufferFrame();
+
+#endif
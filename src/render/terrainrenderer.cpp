@@ -1,24 +1,402 @@
-
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 #include <glm/vec3.hpp>
-#include "utils/flexarray.h"
+#include <glm/geometric.hpp>
 #include "terrainrenderer.h"
+#include "graphics/gluhelper.h"
+#include "graphics/rendersettingshelper.h"
+#include "render/glstate.h"
+#include "render/meshprogram.h"
+#include "render/vbo.h"
+
+using namespace gl;
+
+/** The number of floats per vertex: position, normal, colour, texture coordinate. */
+static const int TERRAIN_ROW_SIZE = 12;
+static const int TERRAIN_GRID_SIDE = TERRAIN_CHUNK_QUADS + 1;
+static const int TERRAIN_VERTICES_PER_CHUNK = TERRAIN_GRID_SIDE * TERRAIN_GRID_SIDE + 4 * TERRAIN_GRID_SIDE;
+
+TerrainChunk::TerrainChunk(AABB bounds, int handle, int firstVertex) : bounds(bounds), handle(handle),
+	firstVertex(firstVertex), lodLevel(0)
+{
+}
+
+TerrainQuadtreeNode::TerrainQuadtreeNode(AABB bounds, int chunk) : bounds(bounds), chunk(chunk)
+{
+	std::fill(children, children + 4, -1);
+}
+
+TerrainRenderer::TerrainRenderer() : indexBufferID(0), rootNode(-1), chunksPerSide(0), samplesPerSide(0), spacing(1.0f),
+	origin(0.0f), lastDrawnChunkCount(0)
+{
+}
+
+/**
+ * Gets the index of a vertex in a chunk's grid.
+ */
+static int gridVertex(int x, int z)
+{
+	return z * TERRAIN_GRID_SIDE + x;
+}
+
+/**
+ * Gets the index of a skirt vertex. Edges are numbered 0: z = 0, 1: x = max, 2: z = max, 3: x = 0, and k is the
+ * position along the edge.
+ */
+static int skirtVertex(int edge, int k)
+{
+	return TERRAIN_GRID_SIDE * TERRAIN_GRID_SIDE + edge * TERRAIN_GRID_SIDE + k;
+}
+
+/**
+ * Gets the grid vertex that a skirt vertex hangs below.
+ */
+static int skirtTop(int edge, int k)
+{
+	switch (edge)
+	{
+	case 0: return gridVertex(k, 0);
+	case 1: return gridVertex(TERRAIN_CHUNK_QUADS, k);
+	case 2: return gridVertex(k, TERRAIN_CHUNK_QUADS);
+	default: return gridVertex(0, k);
+	}
+}
 
-TerrainRenderer::TerrainRenderer() : terrainPolygons(FlexArray<TerrainPolygon>(100)), vbo(new DynamicVBO())
+void TerrainRenderer::createIndexBuffer()
 {
+	std::vector<GLushort> indices;
+	for (int lod = 0; lod < TERRAIN_LOD_LEVELS; lod++)
+	{
+		int step = 1 << lod;
+		lodRanges[lod].firstIndex = static_cast<int>(indices.size());
+		for (int z = 0; z < TERRAIN_CHUNK_QUADS; z += step)
+		{
+			for (int x = 0; x < TERRAIN_CHUNK_QUADS; x += step)
+			{
+				GLushort a = gridVertex(x, z);
+				GLushort b = gridVertex(x + step, z);
+				GLushort c = gridVertex(x, z + step);
+				GLushort d = gridVertex(x + step, z + step);
+				GLushort quad[] = { a, c, b, b, c, d };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+		// Skirts are wound to face away from the chunk.
+		for (int edge = 0; edge < 4; edge++)
+		{
+			for (int k = 0; k < TERRAIN_CHUNK_QUADS; k += step)
+			{
+				GLushort t0 = skirtTop(edge, k);
+				GLushort t1 = skirtTop(edge, k + step);
+				GLushort s0 = skirtVertex(edge, k);
+				GLushort s1 = skirtVertex(edge, k + step);
+				if (edge < 2)
+				{
+					GLushort strip[] = { t0, t1, s0, t1, s1, s0 };
+					indices.insert(indices.end(), strip, strip + 6);
+				}
+				else
+				{
+					GLushort strip[] = { t0, s0, t1, t1, s0, s1 };
+					indices.insert(indices.end(), strip, strip + 6);
+				}
+			}
+		}
+		lodRanges[lod].indexCount = static_cast<int>(indices.size()) - lodRanges[lod].firstIndex;
+	}
+	indexBufferID = createVBOID();
+	// On the core render path the element buffer binding belongs to the bound vertex array object.
+	vertices.bindVertices();
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
 }
 
-void TerrainRenderer::create(std::shared_ptr<TerrainData> terrain, std::shared_ptr<Texture> terrainTexture)
+/**
+ * Samples the heights and colours of one chunk from the Terrain and writes its vertices, skirts included, into rows.
+ * @return the bounds of the chunk
+ */
+AABB TerrainRenderer::buildChunk(int chunkX, int chunkZ, std::vector<float> &rows)
 {
-    std::shared_ptr<FlexArray<TerrainPolygon>> polys = terrain->getPolygons();
-    vbo->create(polys, terrainTexture);
+	// The heights one sample past each edge are needed for the normals along it.
+	const int border = TERRAIN_GRID_SIDE + 2;
+	std::vector<float> heights(border * border);
+	for (int z = 0; z < border; z++)
+	{
+		for (int x = 0; x < border; x++)
+		{
+			int sx = std::min(std::max(chunkX * TERRAIN_CHUNK_QUADS + x - 1, 0), samplesPerSide - 1);
+			int sz = std::min(std::max(chunkZ * TERRAIN_CHUNK_QUADS + z - 1, 0), samplesPerSide - 1);
+			heights[z * border + x] = terrain->getHeight(origin + sx * spacing, origin + sz * spacing);
+		}
+	}
+	auto heightAt = [&](int x, int z) {
+		return heights[(z + 1) * border + x + 1];
+	};
+
+	rows.resize(TERRAIN_VERTICES_PER_CHUNK * TERRAIN_ROW_SIZE);
+	float minHeight = heightAt(0, 0);
+	float maxHeight = minHeight;
+	for (int z = 0; z < TERRAIN_GRID_SIDE; z++)
+	{
+		for (int x = 0; x < TERRAIN_GRID_SIDE; x++)
+		{
+			int sx = chunkX * TERRAIN_CHUNK_QUADS + x;
+			int sz = chunkZ * TERRAIN_CHUNK_QUADS + z;
+			float px = origin + sx * spacing;
+			float pz = origin + sz * spacing;
+			float py = heightAt(x, z);
+			glm::vec3 normal = glm::normalize(glm::vec3(heightAt(x - 1, z) - heightAt(x + 1, z), 2 * spacing,
+					heightAt(x, z - 1) - heightAt(x, z + 1)));
+			Colour colour = terrain->getColour(px, pz);
+			float row[] = { px, py, pz, normal.x, normal.y, normal.z, static_cast<float>(colour.r),
+					static_cast<float>(colour.g), static_cast<float>(colour.b), static_cast<float>(colour.a),
+					px / TERRAIN_TEXTURE_SIZE, pz / TERRAIN_TEXTURE_SIZE };
+			std::copy(row, row + TERRAIN_ROW_SIZE, &rows[gridVertex(x, z) * TERRAIN_ROW_SIZE]);
+			minHeight = std::min(minHeight, py);
+			maxHeight = std::max(maxHeight, py);
+		}
+	}
+	// Skirts only need to reach as far down as the largest gap a coarser neighbour can leave, which is at most the
+	// chunk's height range. One sample spacing covers flat chunks.
+	float skirtDepth = std::max(maxHeight - minHeight, spacing);
+	for (int edge = 0; edge < 4; edge++)
+	{
+		for (int k = 0; k < TERRAIN_GRID_SIDE; k++)
+		{
+			float *top = &rows[skirtTop(edge, k) * TERRAIN_ROW_SIZE];
+			float *skirt = &rows[skirtVertex(edge, k) * TERRAIN_ROW_SIZE];
+			std::copy(top, top + TERRAIN_ROW_SIZE, skirt);
+			skirt[1] -= skirtDepth;
+		}
+	}
+	float chunkSize = TERRAIN_CHUNK_QUADS * spacing;
+	return AABB(origin + chunkX * chunkSize, minHeight - skirtDepth, origin + chunkZ * chunkSize,
+			origin + (chunkX + 1) * chunkSize, maxHeight, origin + (chunkZ + 1) * chunkSize);
+}
+
+void TerrainRenderer::create(std::shared_ptr<Terrain> terrain, std::shared_ptr<Texture> terrainTexture, float sampleSpacing)
+{
+	this->terrain = terrain;
+	texture = terrainTexture;
+	if (texture)
+	{
+		// The texture is tiled across the terrain rather than stretched over each polygon.
+		bindTexture2D(texture->textureID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, static_cast<GLint>(GL_REPEAT));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, static_cast<GLint>(GL_REPEAT));
+	}
+	float width = terrain->width;
+	chunksPerSide = std::max(1, static_cast<int>(std::ceil(width / (sampleSpacing * TERRAIN_CHUNK_QUADS))));
+	samplesPerSide = chunksPerSide * TERRAIN_CHUNK_QUADS + 1;
+	spacing = width / (samplesPerSide - 1);
+	origin = -width / 2;
+
+	// Every chunk fits without the DynamicVBO having to grow.
+	vertices.create(chunksPerSide * chunksPerSide * TERRAIN_VERTICES_PER_CHUNK, texture);
+	std::vector<float> rows;
+	chunks.clear();
+	for (int cz = 0; cz < chunksPerSide; cz++)
+	{
+		for (int cx = 0; cx < chunksPerSide; cx++)
+		{
+			AABB bounds = buildChunk(cx, cz, rows);
+			int handle = vertices.addVertices(rows.data(), TERRAIN_VERTICES_PER_CHUNK);
+			chunks.push_back(TerrainChunk(bounds, handle, vertices.getFirstVertex(handle)));
+		}
+	}
+	if (indexBufferID == 0)
+	{
+		createIndexBuffer();
+	}
+	nodes.clear();
+	rootNode = buildQuadtree(0, 0, chunksPerSide, chunksPerSide);
+	std::cout << "Terrain: " << chunks.size() << " chunks of " << TERRAIN_CHUNK_QUADS << "x" << TERRAIN_CHUNK_QUADS
+			<< " quads, " << chunks.size() * TERRAIN_VERTICES_PER_CHUNK * TERRAIN_ROW_SIZE * sizeof(float) / 1024
+			<< "KB of vertex data" << std::endl;
+}
+
+void TerrainRenderer::rebuildChunks(const AABB &region)
+{
+	if (rootNode < 0)
+	{
+		return;
+	}
+	// The normals along a chunk's edges are taken from the samples just past it, so a change up to one sample
+	// outside a chunk still reaches it.
+	float chunkSize = TERRAIN_CHUNK_QUADS * spacing;
+	int xBegin = std::max(0, static_cast<int>(std::floor((region.xMin - spacing - origin) / chunkSize)));
+	int zBegin = std::max(0, static_cast<int>(std::floor((region.zMin - spacing - origin) / chunkSize)));
+	int xEnd = std::min(chunksPerSide, static_cast<int>(std::floor((region.xMax + spacing - origin) / chunkSize)) + 1);
+	int zEnd = std::min(chunksPerSide, static_cast<int>(std::floor((region.zMax + spacing - origin) / chunkSize)) + 1);
+	if (xBegin >= xEnd || zBegin >= zEnd)
+	{
+		return;
+	}
+	std::vector<float> rows;
+	for (int cz = zBegin; cz < zEnd; cz++)
+	{
+		for (int cx = xBegin; cx < xEnd; cx++)
+		{
+			TerrainChunk &chunk = chunks[cz * chunksPerSide + cx];
+			chunk.bounds = buildChunk(cx, cz, rows);
+			vertices.updateVertices(chunk.handle, 0, rows.data(), TERRAIN_VERTICES_PER_CHUNK);
+		}
+	}
+	// The bounds of the chunks' ancestors may have changed with them.
+	nodes.clear();
+	rootNode = buildQuadtree(0, 0, chunksPerSide, chunksPerSide);
+}
+
+/**
+ * Builds the quadtree node covering chunks [xBegin, xEnd) x [zBegin, zEnd) and everything below it.
+ * @return the index of the new node
+ */
+int TerrainRenderer::buildQuadtree(int xBegin, int zBegin, int xEnd, int zEnd)
+{
+	if (xEnd - xBegin == 1 && zEnd - zBegin == 1)
+	{
+		int chunk = zBegin * chunksPerSide + xBegin;
+		nodes.push_back(TerrainQuadtreeNode(chunks[chunk].bounds, chunk));
+		return static_cast<int>(nodes.size()) - 1;
+	}
+	int xMid = (xBegin + xEnd + 1) / 2;
+	int zMid = (zBegin + zEnd + 1) / 2;
+	int ranges[4][4] = {
+		{ xBegin, zBegin, xMid, zMid }, { xMid, zBegin, xEnd, zMid },
+		{ xBegin, zMid, xMid, zEnd }, { xMid, zMid, xEnd, zEnd }
+	};
+	int children[4];
+	AABB bounds(0, 0, 0, 0, 0, 0);
+	bool first = true;
+	for (int i = 0; i < 4; i++)
+	{
+		children[i] = -1;
+		if (ranges[i][0] >= ranges[i][2] || ranges[i][1] >= ranges[i][3])
+		{
+			continue;
+		}
+		children[i] = buildQuadtree(ranges[i][0], ranges[i][1], ranges[i][2], ranges[i][3]);
+		AABB &child = nodes[children[i]].bounds;
+		if (first)
+		{
+			bounds = child;
+			first = false;
+		}
+		else
+		{
+			bounds = AABB(std::min(bounds.xMin, child.xMin), std::min(bounds.yMin, child.yMin),
+					std::min(bounds.zMin, child.zMin), std::max(bounds.xMax, child.xMax),
+					std::max(bounds.yMax, child.yMax), std::max(bounds.zMax, child.zMax));
+		}
+	}
+	TerrainQuadtreeNode node(bounds, -1);
+	std::copy(children, children + 4, node.children);
+	nodes.push_back(node);
+	return static_cast<int>(nodes.size()) - 1;
+}
+
+/**
+ * Picks a chunk's level of detail from the distance between the camera and the closest point of the chunk.
+ */
+int TerrainRenderer::selectLOD(const TerrainChunk &chunk, const glm::vec3 &eye)
+{
+	glm::vec3 closest(std::min(std::max(eye.x, chunk.bounds.xMin), chunk.bounds.xMax),
+			std::min(std::max(eye.y, chunk.bounds.yMin), chunk.bounds.yMax),
+			std::min(std::max(eye.z, chunk.bounds.zMin), chunk.bounds.zMax));
+	float distance = glm::length(closest - eye);
+	if (distance < TERRAIN_LOD_DISTANCE)
+	{
+		return 0;
+	}
+	int lod = static_cast<int>(std::log2(distance / TERRAIN_LOD_DISTANCE)) + 1;
+	return std::min(lod, TERRAIN_LOD_LEVELS - 1);
+}
+
+void TerrainRenderer::drawNode(int node, const Frustum &frustum, const glm::vec3 &eye)
+{
+	TerrainQuadtreeNode &current = nodes[node];
+	if (!frustum.intersects(current.bounds))
+	{
+		return;
+	}
+	if (current.chunk < 0)
+	{
+		for (int child : current.children)
+		{
+			if (child >= 0)
+			{
+				drawNode(child, frustum, eye);
+			}
+		}
+		return;
+	}
+
+	TerrainChunk &chunk = chunks[current.chunk];
+	chunk.lodLevel = selectLOD(chunk, eye);
+	LODRange &range = lodRanges[chunk.lodLevel];
+	if (isCoreRenderPathActive())
+	{
+		glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_SHORT,
+			(void*)(range.firstIndex * sizeof(GLushort)), chunk.firstVertex);
+		lastDrawnChunkCount++;
+		return;
+	}
+	size_t base = static_cast<size_t>(chunk.firstVertex) * TERRAIN_ROW_SIZE * sizeof(float);
+	glVertexPointer(3, GL_FLOAT, 48, (void*)(base));
+	glNormalPointer(GL_FLOAT, 48, (void*)(base + 12));
+	glColorPointer(4, GL_FLOAT, 48, (void*)(base + 24));
+	glTexCoordPointer(2, GL_FLOAT, 48, (void*)(base + 40));
+	glDrawElements(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_SHORT, (void*)(range.firstIndex * sizeof(GLushort)));
+	lastDrawnChunkCount++;
 }
 
 void TerrainRenderer::draw(Camera *cam)
 {
-    vbo->draw(cam);
+	lastDrawnChunkCount = 0;
+	if (rootNode < 0)
+	{
+		return;
+	}
+	if (isCoreRenderPathActive())
+	{
+		// The terrain is already in world space.
+		if (texture)
+		{
+			texture->bind();
+		}
+		vertices.bindVertices();
+		bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+		useMeshProgram(glm::mat4(1.0f), static_cast<bool>(texture));
+		drawNode(rootNode, createCameraFrustum(cam, getAspectRatio()), cam->getPosition());
+		return;
+	}
+	glLoadIdentity();
+	setLookAt(cam);
+	if (texture)
+	{
+		enableState(GL_TEXTURE_2D);
+		texture->bind();
+	}
+	else
+	{
+		disableState(GL_TEXTURE_2D);
+	}
+	vertices.bindVertices();
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+	drawNode(rootNode, createCameraFrustum(cam, getAspectRatio()), cam->getPosition());
+}
+
+int TerrainRenderer::getLastDrawnChunkCount()
+{
+	return lastDrawnChunkCount;
 }
 
 TerrainRenderer::~TerrainRenderer()
 {
-    delete vbo;
+	if (indexBufferID != 0)
+	{
+		glDeleteBuffers(1, &indexBufferID);
+		notifyBufferDeleted(indexBufferID);
+	}
 }
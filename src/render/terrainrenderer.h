@@ -2,86 +2,111 @@
 #define TERRAIN_RENDERER_H
 
 #include <memory>
+#include <vector>
+#include <glbinding/gl/gl.h>
 #include <glm/vec3.hpp>
 #include "graphics/camera.h"
-#include "graphics/terrainpolygon.h"
-#include "terrain/terraindata.h"
+#include "math/frustum.h"
+#include "physics/aabb.h"
+#include "terrain/terrain.h"
 #include "render/dynamicvbo.h"
-#include "utils/flexarray.h"
 #include "render/texture.h"
 
+/** The number of quads along one side of a terrain chunk at full detail. This must be a power of two. */
+const int TERRAIN_CHUNK_QUADS = 32;
+/** The number of levels of detail of a chunk. Level i uses every 2^i-th height sample along each side. */
+const int TERRAIN_LOD_LEVELS = 5;
+/** Chunks closer than this are drawn at full detail. Each doubling of the distance past it drops one level. */
+const float TERRAIN_LOD_DISTANCE = 30.0f;
+/** The distance, in world units, the terrain texture is stretched across before it repeats. */
+const float TERRAIN_TEXTURE_SIZE = 8.0f;
+
+/**
+ * One square piece of the terrain. Its vertices are a block of the shared DynamicVBO, laid out as a
+ * (TERRAIN_CHUNK_QUADS + 1)^2 grid followed by one row of skirt vertices per edge.
+ */
+struct TerrainChunk
+{
+	AABB bounds;
+	/** The chunk's handle in the DynamicVBO. */
+	int handle;
+	int firstVertex;
+	int lodLevel;
+	TerrainChunk(AABB bounds, int handle, int firstVertex);
+};
+
+/**
+ * A node of the quadtree built over the chunks. Leaves refer to one chunk, other nodes to up to four children.
+ */
+struct TerrainQuadtreeNode
+{
+	AABB bounds;
+	/** The index of the chunk this leaf holds, or -1 for an inner node. */
+	int chunk;
+	/** Indices of the child nodes, -1 where there is none. */
+	int children[4];
+	TerrainQuadtreeNode(AABB bounds, int chunk);
+};
+
+/**
+ * TerrainRenderer draws a heightmapped Terrain as a grid of chunks, each of which is drawn at a level of detail that
+ * depends on its distance from the camera (geomipmapping). Every chunk has the same vertex layout, so one index
+ * buffer holds the triangles of each level for all chunks. Cracks between neighbouring chunks at different levels
+ * are hidden by skirts: a strip of triangles hanging down from each chunk edge. The chunks are kept in a quadtree
+ * so whole regions outside the view frustum are skipped with a single test. Each chunk's vertices are a block of a
+ * DynamicVBO, so a chunk that is rebuilt after the terrain changes uploads only its own vertices.
+ */
 class TerrainRenderer
 {
 public:
-    FlexArray<TerrainPolygon> terrainPolygons;
-    DynamicVBO* vbo;
     TerrainRenderer();
-    void create(std::shared_ptr<TerrainData> terrain, std::shared_ptr<Texture> terrainTexture);
+	/**
+	 * Samples the heights and colours of a Terrain and uploads the chunks to the GPU.
+	 * @param terrain the Terrain to draw. Heights are sampled over [-width / 2, width / 2] on the x and z axes
+	 * @param terrainTexture the texture tiled across the terrain
+	 * @param sampleSpacing the approximate distance between height samples at full detail
+	 */
+    void create(std::shared_ptr<Terrain> terrain, std::shared_ptr<Texture> terrainTexture, float sampleSpacing = 1.0f);
+	/**
+	 * Samples the Terrain again for every chunk that overlaps a region, after its heights or colours there have
+	 * changed. Only the vertices of those chunks are uploaded.
+	 * @param region the region that changed. Only its x and z extents are used
+	 */
+	void rebuildChunks(const AABB &region);
 	void draw(Camera *cam);
+	/**
+	 * Gets the number of chunks that passed frustum culling during the last call to draw(...).
+	 */
+	int getLastDrawnChunkCount();
     ~TerrainRenderer();
-
-/*
-	public static void doStuffAdd1()
-	{
-		if(p.getIBOIndexes() == null)
-		{
-			vbo.add(p);
-			vbo.add(p1);
-		}
-		else
-		{
-			System.out.println("DerpA1");
-		}
-	}
-
-	public static void doStuffRemove1()
+private:
+	/**
+	 * A range of the shared index buffer holding the triangles of one level of detail.
+	 */
+	struct LODRange
 	{
-		if(p.getIBOIndexes() != null)
-		{
-			vbo.remove(p.getIBOIndexes());
-			p.setIBOIndexes(null);
-			vbo.remove(p1.getIBOIndexes());
-			p1.setIBOIndexes(null);
-		}
-		else
-		{
-			System.out.println("DerpR1");
-		}
-	}
-
-	public static void doStuffAdd2()
-	{
-		if(p2.getIBOIndexes() == null)
-		{
-			vbo.add(p2);
-			vbo.add(p3);
-		}
-		else
-		{
-			System.out.println("DerpA2");
-		}
-	}
-
-	public static void doStuffRemove2()
-	{
-		if(p2.getIBOIndexes() != null)
-		{
-			vbo.remove(p2.getIBOIndexes());
-			p2.setIBOIndexes(null);
-			vbo.remove(p3.getIBOIndexes());
-			p3.setIBOIndexes(null);
-		}
-		else
-		{
-			System.out.println("DerpR2");
-		}
-	}
-*/
+		int firstIndex;
+		int indexCount;
+	};
+	std::vector<TerrainChunk> chunks;
+	std::vector<TerrainQuadtreeNode> nodes;
+	LODRange lodRanges[TERRAIN_LOD_LEVELS];
+	std::shared_ptr<Terrain> terrain;
+	std::shared_ptr<Texture> texture;
+	/** The vertices of every chunk. The chunks are indexed by indexBufferID rather than the DynamicVBO's own. */
+	DynamicVBO vertices;
+	gl::GLuint indexBufferID;
+	int rootNode;
+	int chunksPerSide;
+	int samplesPerSide;
+	float spacing;
+	float origin;
+	int lastDrawnChunkCount;
+	void createIndexBuffer();
+	AABB buildChunk(int chunkX, int chunkZ, std::vector<float> &rows);
+	int buildQuadtree(int xBegin, int zBegin, int xEnd, int zEnd);
+	void drawNode(int node, const Frustum &frustum, const glm::vec3 &eye);
+	int selectLOD(const TerrainChunk &chunk, const glm::vec3 &eye);
 };
 
-
-
-
-
-
 #endif
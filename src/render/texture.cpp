@@ -1,5 +1,6 @@
 
 #include "texture.h"
+#include "render/glstate.h"
 
 using namespace gl;
 
@@ -11,12 +12,21 @@ Texture::Texture(std::string associatedFileName, gl::GLuint textureID) : texture
 {
 }
 
+Texture::~Texture()
+{
+    if (textureID != 0)
+    {
+        glDeleteTextures(1, &textureID);
+        notifyTextureDeleted(textureID);
+    }
+}
+
 /**
  * Binds the texture using GL11. The texture will remain bound until the next bind() call of a different
  * texture object, or manual call to GL11.glBindTexture(...)
  */
 void Texture::bind()
 {
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    bindTexture2D(textureID);
 }
 
@@ -8,6 +8,7 @@
  * Texture is a simple class for managing OpenGL textures. A texture object is created
  * with an integer value (the textureID), and can then be bound using {@link #bind()}. This will cause
  * images drawn to use this texture, until another Texture object's bind() method is called.
+ * The Texture owns its GL texture, which is deleted along with it, so it cannot be copied.
  * @author      Alec Sobeck
  */
 class Texture
@@ -21,6 +22,12 @@ public:
 	 * @param textureID the Integer representing the texture that can be bound
 	 */
 	Texture(std::string associatedFileName, gl::GLuint textureID);
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+	/**
+	 * Deletes the GL texture.
+	 */
+	~Texture();
 	/**
 	 * Binds the texture using GL11. The texture will remain bound until the next bind() call of a different
 	 * texture object, or manual call to GL11.glBindTexture(...)
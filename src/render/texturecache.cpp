@@ -0,0 +1,200 @@
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "render/texturecache.h"
+#include "render/glstate.h"
+#include "utils/binaryio.h"
+#include "utils/fileutils.h"
+#include "utils/mappedfile.h"
+
+using namespace gl;
+
+/** "TXCH", written at the start and the end of every texture cache. The end marker catches truncated files. */
+static const uint32_t TEXTURE_CACHE_MAGIC = 0x48435854;
+/** Mip levels beyond this would be for textures larger than any GL implementation allows. */
+static const int MAX_TEXTURE_CACHE_LEVELS = 32;
+
+///
+/// A texture cache is a flat, native endian file:
+///   magic, version, source size, source modification time, source hash
+///   internal format, level count, then for each level: width, height, byte count, the compressed data
+///   magic
+///
+
+std::string getTextureCachePath(std::string sourcePath)
+{
+	return sourcePath + ".texcache";
+}
+
+static uint64_t hashFile(const std::string &path)
+{
+	MappedFile file(path);
+	return hashBytes(file.data(), file.size());
+}
+
+bool openTextureCache(std::string sourcePath, TextureCacheContents &contents)
+{
+	std::string cachePath = getTextureCachePath(sourcePath);
+	FileStatus sourceStatus;
+	FileStatus cacheStatus;
+	if (!getFileStatus(sourcePath, sourceStatus) || !getFileStatus(cachePath, cacheStatus))
+	{
+		return false;
+	}
+	try
+	{
+		std::shared_ptr<MappedFile> file(new MappedFile(cachePath));
+		BinaryReader reader(file->data(), file->size());
+		if (reader.read<uint32_t>() != TEXTURE_CACHE_MAGIC || reader.read<uint32_t>() != TEXTURE_CACHE_VERSION)
+		{
+			std::cout << "Texture cache >" << cachePath << "< is out of date, reloading." << std::endl;
+			return false;
+		}
+		long long size = reader.read<int64_t>();
+		long long modifiedTime = reader.read<int64_t>();
+		uint64_t hash = reader.read<uint64_t>();
+		// A checkout or copy changes the modification time without changing the image, so the contents decide.
+		if ((size != sourceStatus.size || modifiedTime != sourceStatus.modifiedTime) &&
+			(size != sourceStatus.size || hash != hashFile(sourcePath)))
+		{
+			std::cout << "Texture cache >" << cachePath << "< is stale, reloading." << std::endl;
+			return false;
+		}
+
+		GLenum internalFormat = static_cast<GLenum>(reader.read<uint32_t>());
+		int levelCount = reader.read<int32_t>();
+		if (levelCount < 1 || levelCount > MAX_TEXTURE_CACHE_LEVELS)
+		{
+			throw std::runtime_error("Bad level count");
+		}
+		std::vector<TextureCacheLevel> levels(levelCount);
+		for (TextureCacheLevel &level : levels)
+		{
+			level.width = reader.read<int32_t>();
+			level.height = reader.read<int32_t>();
+			level.bytes = reader.read<int32_t>();
+			if (level.width < 1 || level.height < 1 || level.bytes < 1)
+			{
+				throw std::runtime_error("Bad level size");
+			}
+			level.data = reader.take(level.bytes);
+		}
+		if (reader.read<uint32_t>() != TEXTURE_CACHE_MAGIC)
+		{
+			throw std::runtime_error("No end marker");
+		}
+		contents.file = file;
+		contents.internalFormat = internalFormat;
+		contents.levels.swap(levels);
+		return true;
+	}
+	catch (const std::runtime_error &e)
+	{
+		std::cout << "Texture cache >" << cachePath << "< could not be read (" << e.what() << "), reloading." << std::endl;
+		return false;
+	}
+}
+
+int getFirstLevelWithin(const TextureCacheContents &contents, int maxSize)
+{
+	int last = static_cast<int>(contents.levels.size()) - 1;
+	for (int level = 0; level < last; level++)
+	{
+		if (contents.levels[level].width <= maxSize && contents.levels[level].height <= maxSize)
+		{
+			return level;
+		}
+	}
+	return last;
+}
+
+void uploadTextureCacheLevel(const TextureCacheContents &contents, int level)
+{
+	const TextureCacheLevel &data = contents.levels[level];
+	glCompressedTexImage2D(GL_TEXTURE_2D, level, contents.internalFormat, data.width, data.height, 0, data.bytes,
+		data.data);
+}
+
+GLuint loadCachedTexture(std::string sourcePath, int maxSize)
+{
+	TextureCacheContents contents;
+	if (!openTextureCache(sourcePath, contents))
+	{
+		return 0;
+	}
+	int levelCount = static_cast<int>(contents.levels.size());
+	int firstLevel = (maxSize > 0) ? getFirstLevelWithin(contents, maxSize) : 0;
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	bindTexture2D(textureID);
+	for (int level = firstLevel; level < levelCount; level++)
+	{
+		uploadTextureCacheLevel(contents, level);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, firstLevel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+	return textureID;
+}
+
+void writeTextureCache(std::string sourcePath, GLuint textureID)
+{
+	std::string cachePath = getTextureCachePath(sourcePath);
+	bindTexture2D(textureID);
+	GLint compressed = 0;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+	if (!compressed)
+	{
+		std::cout << "Not writing texture cache >" << cachePath << "<, the texture is not compressed." << std::endl;
+		return;
+	}
+	FileStatus sourceStatus;
+	if (!getFileStatus(sourcePath, sourceStatus))
+	{
+		return;
+	}
+	GLint internalFormat = 0;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+
+	std::vector<char> levels;
+	int levelCount = 0;
+	for (; levelCount < MAX_TEXTURE_CACHE_LEVELS; levelCount++)
+	{
+		GLint width = 0;
+		GLint height = 0;
+		GLint bytes = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, levelCount, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, levelCount, GL_TEXTURE_HEIGHT, &height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, levelCount, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &bytes);
+		if (width < 1 || height < 1 || bytes < 1)
+		{
+			break;
+		}
+		appendValue<int32_t>(levels, width);
+		appendValue<int32_t>(levels, height);
+		appendValue<int32_t>(levels, bytes);
+		size_t start = levels.size();
+		levels.resize(start + bytes);
+		glGetCompressedTexImage(GL_TEXTURE_2D, levelCount, &levels[start]);
+	}
+
+	std::vector<char> buffer;
+	appendValue<uint32_t>(buffer, TEXTURE_CACHE_MAGIC);
+	appendValue<uint32_t>(buffer, TEXTURE_CACHE_VERSION);
+	appendValue<int64_t>(buffer, sourceStatus.size);
+	appendValue<int64_t>(buffer, sourceStatus.modifiedTime);
+	appendValue<uint64_t>(buffer, hashFile(sourcePath));
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(internalFormat));
+	appendValue<int32_t>(buffer, levelCount);
+	appendBytes(buffer, levels.data(), levels.size());
+	appendValue<uint32_t>(buffer, TEXTURE_CACHE_MAGIC);
+	try
+	{
+		writeBinaryFile(cachePath, buffer);
+		std::cout << "Wrote texture cache >" << cachePath << "<: " << levelCount << " levels, " << buffer.size() << " bytes" << std::endl;
+	}
+	catch (const std::runtime_error &e)
+	{
+		std::cout << "Not writing texture cache: " << e.what() << std::endl;
+	}
+}
@@ -0,0 +1,76 @@
+#ifndef ENGINE_TEXTURE_CACHE_H
+#define ENGINE_TEXTURE_CACHE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <glbinding/gl/gl.h>
+#include "utils/mappedfile.h"
+
+/** Bumped whenever the layout of a texture cache, or the flags textures are loaded with, change. */
+const unsigned int TEXTURE_CACHE_VERSION = 1;
+
+/**
+ * Gets the path of the texture cache kept next to an image file.
+ * @param sourcePath the path of the image, such as a PNG
+ */
+std::string getTextureCachePath(std::string sourcePath);
+
+/**
+ * One mip level of a texture cache. The data points into the cache's mapping.
+ */
+struct TextureCacheLevel
+{
+	int width;
+	int height;
+	int bytes;
+	const char *data;
+};
+
+/**
+ * An open and validated texture cache. The file stays mapped for as long as this is kept, so levels can be uploaded
+ * from it later on.
+ */
+struct TextureCacheContents
+{
+	std::shared_ptr<MappedFile> file;
+	gl::GLenum internalFormat;
+	/** The mip chain, finest level first. */
+	std::vector<TextureCacheLevel> levels;
+};
+
+/**
+ * Opens and validates an image's texture cache. The cache is used if the image has the size and modification time it
+ * was written with, or failing that, the same contents.
+ * @param sourcePath the path of the image the cache was built from
+ * @param contents receives the mapped cache
+ * @return true if there is a valid cache, otherwise false and contents is not changed
+ */
+bool openTextureCache(std::string sourcePath, TextureCacheContents &contents);
+/**
+ * Gets the finest level of a cached mip chain that is no larger than a size in either dimension. The coarsest level
+ * is returned if none are that small.
+ */
+int getFirstLevelWithin(const TextureCacheContents &contents, int maxSize);
+/**
+ * Uploads one level of a cached mip chain to the bound texture with glCompressedTexImage2D.
+ */
+void uploadTextureCacheLevel(const TextureCacheContents &contents, int level);
+/**
+ * Creates a texture from the compressed mip chain stored in an image's texture cache. Each level is uploaded with
+ * glCompressedTexImage2D straight from the memory mapped cache, so nothing is decoded or compressed.
+ * @param sourcePath the path of the image the cache was built from
+ * @param maxSize if not 0, only the levels no larger than this are uploaded, and GL_TEXTURE_BASE_LEVEL is set to
+ * the first of them. The finer levels can be streamed in later by the texture residency manager
+ * @return the new texture, which is left bound, or 0 if there is no valid cache
+ */
+gl::GLuint loadCachedTexture(std::string sourcePath, int maxSize = 0);
+/**
+ * Reads the compressed mip chain of a texture back from the driver and writes it to the image's texture cache.
+ * Textures the driver did not compress are not cached. Failing to write the cache is logged but is not an error.
+ * @param sourcePath the path of the image the texture was loaded from
+ * @param textureID the texture to read back
+ */
+void writeTextureCache(std::string sourcePath, gl::GLuint textureID);
+
+#endif
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include "render/textureresidency.h"
+#include "render/glstate.h"
+#include "render/texturecache.h"
+
+using namespace gl;
+
+/**
+ * The residency of one streamed texture. Levels residentBase up to the last one are resident.
+ */
+struct StreamedTexture
+{
+	std::weak_ptr<Texture> texture;
+	gl::GLuint textureID;
+	TextureCacheContents cache;
+	int residentBase;
+	/** The finest level any draw has asked for during lastUsedFrame. */
+	int requestedBase;
+	/** Levels this one and coarser are never evicted. */
+	int minimumBase;
+	unsigned int lastUsedFrame;
+};
+
+static std::unordered_map<const Texture*, StreamedTexture> streamedTextures;
+static size_t textureBudget = TEXTURE_VRAM_BUDGET;
+static size_t residentBytes = 0;
+/** Starts at 1 so a texture that has never been drawn is older than any frame. */
+static unsigned int residencyFrame = 1;
+
+static size_t getResidentBytes(const StreamedTexture &streamed)
+{
+	size_t bytes = 0;
+	for (size_t level = streamed.residentBase; level < streamed.cache.levels.size(); level++)
+	{
+		bytes += streamed.cache.levels[level].bytes;
+	}
+	return bytes;
+}
+
+void registerStreamedTexture(std::shared_ptr<Texture> texture)
+{
+	StreamedTexture streamed;
+	if (!openTextureCache(texture->associatedFileName, streamed.cache))
+	{
+		return;
+	}
+	texture->bind();
+	GLint baseLevel = 0;
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+	int levelCount = static_cast<int>(streamed.cache.levels.size());
+	streamed.texture = texture;
+	streamed.textureID = texture->textureID;
+	streamed.residentBase = std::min(std::max(static_cast<int>(baseLevel), 0), levelCount - 1);
+	streamed.requestedBase = streamed.residentBase;
+	streamed.minimumBase = getFirstLevelWithin(streamed.cache, TEXTURE_STREAMING_MIN_SIZE);
+	streamed.lastUsedFrame = 0;
+	// The address of a deleted texture may be reused by a new one.
+	auto existing = streamedTextures.find(texture.get());
+	if (existing != streamedTextures.end())
+	{
+		residentBytes -= getResidentBytes(existing->second);
+	}
+	residentBytes += getResidentBytes(streamed);
+	streamedTextures[texture.get()] = streamed;
+}
+
+void requestTextureDetail(const std::shared_ptr<Texture> &texture, float screenSize)
+{
+	if (!texture)
+	{
+		return;
+	}
+	auto it = streamedTextures.find(texture.get());
+	if (it == streamedTextures.end())
+	{
+		return;
+	}
+	StreamedTexture &streamed = it->second;
+	const TextureCacheLevel &finest = streamed.cache.levels[0];
+	int levelCount = static_cast<int>(streamed.cache.levels.size());
+	// Each level halves the size, so the wanted level is how many times the full size can be halved and still
+	// cover the texture's size on screen.
+	int level = levelCount - 1;
+	if (screenSize > 0.0f)
+	{
+		float texelsPerPixel = std::max(finest.width, finest.height) / (screenSize * TEXTURE_STREAMING_TEXELS_PER_PIXEL);
+		level = std::min(std::max(static_cast<int>(std::floor(std::log2(texelsPerPixel))), 0), levelCount - 1);
+	}
+	if (streamed.lastUsedFrame != residencyFrame)
+	{
+		streamed.lastUsedFrame = residencyFrame;
+		streamed.requestedBase = level;
+	}
+	else
+	{
+		streamed.requestedBase = std::min(streamed.requestedBase, level);
+	}
+}
+
+static void evictLevel(StreamedTexture &streamed)
+{
+	int level = streamed.residentBase;
+	bindTexture2D(streamed.textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+	// Respecifying the level as empty is what lets the driver release its memory. It is outside the base to max
+	// range now, so it does not make the texture incomplete.
+	glTexImage2D(GL_TEXTURE_2D, level, static_cast<GLint>(GL_RGBA), 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	residentBytes -= streamed.cache.levels[level].bytes;
+	streamed.residentBase = level + 1;
+}
+
+/**
+ * Drops the finest level of the least recently used texture that is not needed this frame.
+ * @return false if there was nothing that could be evicted
+ */
+static bool evictLeastRecentlyUsed()
+{
+	StreamedTexture *victim = nullptr;
+	for (auto &entry : streamedTextures)
+	{
+		StreamedTexture &streamed = entry.second;
+		if (streamed.residentBase >= streamed.minimumBase)
+		{
+			continue;
+		}
+		// Levels coarser than what is wanted this frame are fair game, finer ones are still being drawn.
+		if (streamed.lastUsedFrame == residencyFrame && streamed.residentBase >= streamed.requestedBase)
+		{
+			continue;
+		}
+		// Ties go to the texture with the largest level, which frees the most memory.
+		if (!victim || streamed.lastUsedFrame < victim->lastUsedFrame ||
+			(streamed.lastUsedFrame == victim->lastUsedFrame &&
+			streamed.cache.levels[streamed.residentBase].bytes > victim->cache.levels[victim->residentBase].bytes))
+		{
+			victim = &streamed;
+		}
+	}
+	if (!victim)
+	{
+		return false;
+	}
+	evictLevel(*victim);
+	return true;
+}
+
+void updateTextureResidency()
+{
+	for (auto it = streamedTextures.begin(); it != streamedTextures.end(); )
+	{
+		if (it->second.texture.expired())
+		{
+			residentBytes -= getResidentBytes(it->second);
+			it = streamedTextures.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	// Textures furthest from the detail they are drawn at are streamed first.
+	std::vector<StreamedTexture*> wanted;
+	for (auto &entry : streamedTextures)
+	{
+		StreamedTexture &streamed = entry.second;
+		if (streamed.lastUsedFrame == residencyFrame && streamed.requestedBase < streamed.residentBase)
+		{
+			wanted.push_back(&streamed);
+		}
+	}
+	std::sort(wanted.begin(), wanted.end(), [](const StreamedTexture *a, const StreamedTexture *b) {
+		return a->residentBase - a->requestedBase > b->residentBase - b->requestedBase;
+	});
+	size_t uploaded = 0;
+	for (StreamedTexture *streamed : wanted)
+	{
+		while (streamed->requestedBase < streamed->residentBase && uploaded < TEXTURE_STREAMING_BYTES_PER_FRAME)
+		{
+			int level = streamed->residentBase - 1;
+			size_t bytes = streamed->cache.levels[level].bytes;
+			while (residentBytes + bytes > textureBudget && evictLeastRecentlyUsed())
+			{
+			}
+			if (residentBytes + bytes > textureBudget)
+			{
+				break;
+			}
+			bindTexture2D(streamed->textureID);
+			uploadTextureCacheLevel(streamed->cache, level);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+			streamed->residentBase = level;
+			residentBytes += bytes;
+			uploaded += bytes;
+		}
+	}
+
+	// The budget may have been lowered since the last frame.
+	while (residentBytes > textureBudget && evictLeastRecentlyUsed())
+	{
+	}
+	residencyFrame++;
+}
+
+void setTextureBudget(size_t bytes)
+{
+	textureBudget = bytes;
+}
+
+size_t getResidentTextureBytes(const Texture &texture)
+{
+	auto it = streamedTextures.find(&texture);
+	return (it != streamedTextures.end()) ? getResidentBytes(it->second) : 0;
+}
+
+size_t getTotalResidentTextureBytes()
+{
+	return residentBytes;
+}
+
+void logTextureResidency()
+{
+	std::cout << "Streamed textures: " << streamedTextures.size() << ", " << residentBytes << " of " << textureBudget <<
+		" bytes resident" << std::endl;
+	for (auto &entry : streamedTextures)
+	{
+		StreamedTexture &streamed = entry.second;
+		std::shared_ptr<Texture> texture = streamed.texture.lock();
+		if (!texture)
+		{
+			continue;
+		}
+		const TextureCacheLevel &base = streamed.cache.levels[streamed.residentBase];
+		std::cout << "    " << texture->associatedFileName << ": " << base.width << "x" << base.height << " (level " <<
+			streamed.residentBase << " of " << streamed.cache.levels.size() << "), " << getResidentBytes(streamed) <<
+			" bytes" << std::endl;
+	}
+}
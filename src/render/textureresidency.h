@@ -0,0 +1,67 @@
+#ifndef ENG_TEXTURE_RESIDENCY_H
+#define ENG_TEXTURE_RESIDENCY_H
+
+#include <cstddef>
+#include <memory>
+#include "render/texture.h"
+
+/** The default number of bytes streamed textures may keep resident before their least recently used levels go. */
+const size_t TEXTURE_VRAM_BUDGET = 128 * 1024 * 1024;
+/** The number of bytes of finer mip levels uploaded per frame, so streaming never stalls a frame for long. */
+const size_t TEXTURE_STREAMING_BYTES_PER_FRAME = 4 * 1024 * 1024;
+/** Streamed textures start with, and never drop below, the levels no larger than this in either dimension. */
+const int TEXTURE_STREAMING_MIN_SIZE = 128;
+/**
+ * How many texels a level may have per pixel of screen coverage before a finer one is wanted. Above 1 the texture
+ * is allowed to be slightly blurry in exchange for memory.
+ */
+const float TEXTURE_STREAMING_TEXELS_PER_PIXEL = 1.0f;
+
+///
+/// The texture residency manager streams the mip chains of textures loaded with getStreamedTexture(...). Such a
+/// texture starts out with only the coarse levels of its texture cache resident. Each frame, whatever draws it says
+/// how large it is on screen with requestTextureDetail(...), and at the end of the frame updateTextureResidency()
+/// uploads the finer levels that are wanted, a few at a time, straight from the mapped cache. GL_TEXTURE_BASE_LEVEL
+/// always points at the finest resident level, so a texture is drawn at the best detail it has.
+///
+/// Once streamed textures hold more than the budget, the finest level of the least recently used texture is
+/// dropped, repeatedly, until they fit. Textures without a compressed texture cache cannot be streamed and stay
+/// fully resident.
+///
+
+/**
+ * Hands a texture to the residency manager. The texture's levels must have come from its texture cache, and its
+ * bound GL_TEXTURE_BASE_LEVEL must be the finest level it has. Nothing is done if the texture has no valid cache.
+ * The manager only holds a weak reference, so the texture is forgotten once it is deleted.
+ */
+void registerStreamedTexture(std::shared_ptr<Texture> texture);
+/**
+ * Records that a texture is being drawn this frame, and how large.
+ * @param texture the texture; textures that are not streamed are ignored
+ * @param screenSize the size, in pixels, of the texture's largest use on screen this frame
+ */
+void requestTextureDetail(const std::shared_ptr<Texture> &texture, float screenSize);
+/**
+ * Streams in wanted levels and evicts levels over the budget. This is called once per frame, after the buffers are
+ * swapped.
+ */
+void updateTextureResidency();
+/**
+ * Sets the number of bytes streamed textures may keep resident. Levels over it are evicted at the end of the frame.
+ */
+void setTextureBudget(size_t bytes);
+/**
+ * Gets the number of bytes of video memory held by the resident levels of a streamed texture, or 0 if it is not
+ * streamed.
+ */
+size_t getResidentTextureBytes(const Texture &texture);
+/**
+ * Gets the number of bytes of video memory held by all streamed textures.
+ */
+size_t getTotalResidentTextureBytes();
+/**
+ * Logs the resident levels and bytes of every streamed texture.
+ */
+void logTextureResidency();
+
+#endif
@@ -1,143 +1,76 @@
-
-#include <sstream>
 #include "render/ui.h"
 #include "graphics/windowhelper.h"
-#include "math/gamemath.h"
-using namespace gl;
+#include "utils/textformat.h"
+
+/** The health ring is split into this many segments, one per 5 degrees. */
+static const int HEALTH_RING_SEGMENTS = 72;
+
+static const Colour PANEL_OUTLINE(0.25, 0.25, 0.25, 1);
+static const Colour PANEL_FILL(100.0 / 256.0, 149.0 / 256.0, 237.0 / 256.0, 1); // Light blue
+static const Colour HEALTH_BACKGROUND(0.4, 0.4, 0.4, 1);
 
-void drawUI(Player &player, MouseManager &mouse, std::shared_ptr<GLFont> font,
+/**
+ * Gets the panels behind the ammo and medkit icons, relative to the bottom centre of the window.
+ */
+static const SpriteMesh &getItemPanels()
+{
+	static SpriteMesh panels;
+	if (panels.empty())
+	{
+		panels.addQuad(-70, -60, 0, 0, 0, 1, 1, 0, PANEL_OUTLINE);
+		panels.addQuad(-68, -60, -2, 0, 0, 1, 1, 0, PANEL_FILL);
+		panels.addQuad(0, -60, 70, 0, 0, 1, 1, 0, PANEL_OUTLINE);
+		panels.addQuad(2, -60, 68, 0, 0, 1, 1, 0, PANEL_FILL);
+	}
+	return panels;
+}
+
+/**
+ * Gets the health ring, relative to its centre. It is only rebuilt when the number of segments showing changes.
+ */
+static const SpriteMesh &getHealthRing(int segments)
+{
+	static SpriteMesh ring;
+	static int ringSegments = -1;
+	if (segments != ringSegments)
+	{
+		ringSegments = segments;
+		ring.clear();
+		ring.addFan(0, 0, 40.0f, segments, HEALTH_RING_SEGMENTS, RED);
+		ring.addFan(0, 0, 35.0f, HEALTH_RING_SEGMENTS, HEALTH_RING_SEGMENTS, HEALTH_BACKGROUND);
+	}
+	return ring;
+}
+
+void drawUI(SpriteBatch &batch, Player &player, MouseManager &mouse, std::shared_ptr<GLFont> font,
 	std::shared_ptr<Texture> ammoTexture, std::shared_ptr<Texture> medkitTexture)
 {
 	int width = getWindowWidth();
 	int height = getWindowHeight();
 	int width2 = width / 2;
 
-	glDisable(GL_TEXTURE_2D);
-
 	// Draw the backgrounds
-	glBegin(GL_QUADS);
-		// First poly -- outline
-		glColor3f(0.25f, 0.25f, 0.25f); 
-		glTexCoord2f(0.0f, 1.0f);
-		glVertex2i(width2 - 70, height - 60);
-		glTexCoord2f(0.0f, 0.0f);
-		glVertex2i(width2 - 70, height);
-		glTexCoord2f(1.0f, 0.0f);
-		glVertex2i(width2, height);
-		glTexCoord2f(1.0f, 1.0f);
-		glVertex2i(width2, height - 60);
-		// First poly -- inner icon
-		glColor3f(100.0f / 256.0f, 149.0f / 256.0f, 237.0f / 256.0f); // Light blue
-		glTexCoord2f(0.0f, 1.0f);
-		glVertex2i(width2 - 68, height - 60);
-		glTexCoord2f(0.0f, 0.0f);
-		glVertex2i(width2 - 68, height);
-		glTexCoord2f(1.0f, 0.0f);
-		glVertex2i(width2 - 2, height);
-		glTexCoord2f(1.0f, 1.0f);
-		glVertex2i(width2 - 2, height - 60);
-		// Second poly -- outline
-		glColor3f(0.25f, 0.25f, 0.25f);
-		glTexCoord2f(0.0f, 1.0f);
-		glVertex2i(width2, height - 60);
-		glTexCoord2f(0.0f, 0.0f);
-		glVertex2i(width2, height);
-		glTexCoord2f(1.0f, 0.0f);
-		glVertex2i(width2 + 70, height);
-		glTexCoord2f(1.0f, 1.0f);
-		glVertex2i(width2 + 70, height - 60);
-		// Second poly -- inner icon
-		glColor3f(100.0f / 256.0f, 149.0f / 256.0f, 237.0f / 256.0f); // Light blue
-		glTexCoord2f(0.0f, 1.0f);
-		glVertex2i(width2 + 2, height - 60);
-		glTexCoord2f(0.0f, 0.0f);
-		glVertex2i(width2 + 2, height);
-		glTexCoord2f(1.0f, 0.0f);
-		glVertex2i(width2 + 68, height);
-		glTexCoord2f(1.0f, 1.0f);
-		glVertex2i(width2 + 68, height - 60);
-	glEnd();
+	batch.add(nullptr, getItemPanels(), static_cast<float>(width2), static_cast<float>(height));
 
 	// Draw the icons
-	glEnable(GL_TEXTURE_2D);
-	ammoTexture->bind();
-	glColor3f(1.0f, 1.0f, 1.0f);
-	glBegin(GL_QUADS);
-		glTexCoord2f(0.0f, 1.0f);
-		glVertex2i(width2 - 60, height - 50);
-		glTexCoord2f(0.0f, 0.0f);
-		glVertex2i(width2 - 60, height);
-		glTexCoord2f(1.0f, 0.0f);
-		glVertex2i(width2 - 10, height);
-		glTexCoord2f(1.0f, 1.0f);
-		glVertex2i(width2 - 10, height - 50);
-	glEnd();
-
-	medkitTexture->bind();
-	glColor3f(1.0f, 1.0f, 1.0f);
-	glBegin(GL_QUADS);
-		glTexCoord2f(0.0f, 1.0f);
-		glVertex2i(width2 + 10, height - 50);
-		glTexCoord2f(0.0f, 0.0f);
-		glVertex2i(width2 + 10, height);
-		glTexCoord2f(1.0f, 0.0f);
-		glVertex2i(width2 + 60, height);
-		glTexCoord2f(1.0f, 1.0f);
-		glVertex2i(width2 + 60, height - 50);
-	glEnd();
+	batch.addQuad(ammoTexture, width2 - 60, height - 50, width2 - 10, height, 0, 1, 1, 0, WHITE);
+	batch.addQuad(medkitTexture, width2 + 10, height - 50, width2 + 60, height, 0, 1, 1, 0, WHITE);
 
 	// Draw the text.
-	glEnable(GL_TEXTURE_2D);
-	glColor3f(1.0f, 1.0f, 1.0f);
-	glDisable(GL_BLEND);
-	glAlphaFunc(GL_GREATER, 0.1f);
-	glEnable(GL_ALPHA_TEST);
-	std::stringstream ssa;
-	ssa << player.ammoCount;
-	std::stringstream ssh;
-	ssh << player.healingItemCount;
-	//glScaled(2.0f, 2.0f, 2.0f);
-	font->TextOut(ssa.str(), width2 - 60, height - 20, 0);
-	font->TextOut(ssh.str(), width2 + 20, height - 20, 0);
+	char text[32];
+	size_t length = formatInteger(text, sizeof(text), "", player.ammoCount);
+	font->TextOut(batch, text, length, width2 - 60, height - 20, WHITE);
+	length = formatInteger(text, sizeof(text), "", player.healingItemCount);
+	font->TextOut(batch, text, length, width2 + 20, height - 20, WHITE);
 
 	///
 	/// Draw the health HUD
 	/// 
-	glDisable(GL_TEXTURE_2D);
-	float degree = 5.0f;
 	float radius = 40.0f;
-	float rad = toRad(degree);
-	int degreeOfCircle = static_cast<int>(360 * player.getHealthPercent() / degree);
-	glColor3f(1.0f, 0.0f, 0.0f);
-	glBegin(GL_TRIANGLE_FAN);
-	glVertex2f(radius, height - radius);
-	for (int i = 0; i <= degreeOfCircle; i++)
-	{
-		float degInRad = i * rad;
-		glVertex2f(radius + cos(degInRad) * radius, height - radius + sin(degInRad) * radius);
-	}
-	glVertex2f(radius, height - radius);
-	glEnd();
-	// Draw the inner circle.
-	float smallerRadius = 35.0f;
-	glColor3f(.4f, .4f, .4f);
-	glBegin(GL_TRIANGLE_FAN);
-	glVertex2f(radius, height - radius);
-	for (int i = 0; i <= 360 / degree; i++)
-	{
-		float degInRad = i * rad;
-		glVertex2f(radius + cos(degInRad) * smallerRadius, height - radius + sin(degInRad) * smallerRadius);
-	}
-	glVertex2f(radius, height - radius);
-	glEnd();
+	int segments = static_cast<int>(HEALTH_RING_SEGMENTS * player.getHealthPercent());
+	batch.add(nullptr, getHealthRing(segments), radius, height - radius);
 
 	// Score
-	glEnable(GL_TEXTURE_2D);
-	glColor3f(1.0f, 1.0f, 1.0f);
-	glDisable(GL_BLEND);
-	glAlphaFunc(GL_GREATER, 0.1f);
-	glEnable(GL_ALPHA_TEST);
-	std::stringstream scoress;
-	scoress << "score: " << player.score;
-	font->TextOut(scoress.str(), 30, 10, 0);
-}
\ No newline at end of file
+	length = formatInteger(text, sizeof(text), "score: ", player.score);
+	font->TextOut(batch, text, length, 30, 10, WHITE);
+}
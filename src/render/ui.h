@@ -4,11 +4,15 @@
 #include <memory>
 #include "entity/player.h"
 #include "render/glfont.h"
+#include "render/spritebatch.h"
 #include "render/texture.h"
 #include "gameloop.h"
 
-
-void drawUI(Player &player, MouseManager &mouse, std::shared_ptr<GLFont> font, 
+/**
+ * Adds the HUD to a SpriteBatch: the ammo and medkit counts, the health ring and the score. The caller flushes the
+ * batch once the rest of the 2D pass has been added.
+ */
+void drawUI(SpriteBatch &batch, Player &player, MouseManager &mouse, std::shared_ptr<GLFont> font,
 	std::shared_ptr<Texture> ammoTexture, std::shared_ptr<Texture> medkitTexture);
 
 #endif
\ No newline at end of file
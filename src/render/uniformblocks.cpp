@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <glbinding/ContextInfo.h>
+#include <glbinding/Version.h>
+#include <glbinding/gl/extension.h>
+#include "render/uniformblocks.h"
+#include "render/glstate.h"
+#include "render/streambuffer.h"
+
+using namespace gl;
+
+static FrameConstants frameConstants;
+static LightList lightList;
+static bool lightListChanged = true;
+static GLuint lightListBufferID = 0;
+/**
+ * The frame constants are rewritten every frame, so they are streamed like instance data. It is created on first use
+ * and deleted by releaseUniformBlocks(), as its GL objects must go while the context still exists.
+ */
+static StreamBuffer *frameConstantStream = nullptr;
+
+FrameConstants &getFrameConstants()
+{
+	return frameConstants;
+}
+
+LightList &getLightList()
+{
+	return lightList;
+}
+
+void markLightListChanged()
+{
+	lightListChanged = true;
+}
+
+/**
+ * Checks, once, whether the context has uniform buffer objects.
+ */
+static bool isUniformBufferSupported()
+{
+	static int supported = -1;
+	if (supported < 0)
+	{
+		supported = glbinding::ContextInfo::version() >= glbinding::Version(3, 1) ||
+			glbinding::ContextInfo::extensions().count(GLextension::GL_ARB_uniform_buffer_object) > 0;
+	}
+	return supported == 1;
+}
+
+void uploadUniformBlocks()
+{
+	if (!isUniformBufferSupported())
+	{
+		return;
+	}
+	static GLint offsetAlignment = 0;
+	if (offsetAlignment == 0)
+	{
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+		offsetAlignment = std::max(offsetAlignment, static_cast<GLint>(STREAM_BUFFER_ALIGNMENT));
+	}
+	if (!frameConstantStream)
+	{
+		frameConstantStream = new StreamBuffer(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_STREAM_REGION_SIZE);
+	}
+	size_t offset = frameConstantStream->write(&frameConstants, sizeof(FrameConstants), offsetAlignment);
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, frameConstantStream->getBufferID(), offset,
+		sizeof(FrameConstants));
+
+	if (lightListChanged)
+	{
+		lightListChanged = false;
+		if (lightListBufferID == 0)
+		{
+			glGenBuffers(1, &lightListBufferID);
+		}
+		// Respecifying the whole buffer lets the driver hand out fresh storage if the old one is still in use.
+		glBindBuffer(GL_UNIFORM_BUFFER, lightListBufferID);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(LightList), &lightList, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_LIST_BINDING, lightListBufferID);
+	}
+}
+
+void bindUniformBlocks(GLuint programID)
+{
+	if (!isUniformBufferSupported())
+	{
+		return;
+	}
+	GLuint frameIndex = glGetUniformBlockIndex(programID, "FrameConstants");
+	if (frameIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(programID, frameIndex, FRAME_CONSTANTS_BINDING);
+	}
+	GLuint lightIndex = glGetUniformBlockIndex(programID, "LightList");
+	if (lightIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(programID, lightIndex, LIGHT_LIST_BINDING);
+	}
+}
+
+void releaseUniformBlocks()
+{
+	delete frameConstantStream;
+	frameConstantStream = nullptr;
+	if (lightListBufferID != 0)
+	{
+		glDeleteBuffers(1, &lightListBufferID);
+		notifyBufferDeleted(lightListBufferID);
+		lightListBufferID = 0;
+		lightListChanged = true;
+	}
+}
@@ -0,0 +1,107 @@
+#ifndef ENG_UNIFORM_BLOCKS_H
+#define ENG_UNIFORM_BLOCKS_H
+
+#include <glbinding/gl/gl.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+/** The uniform buffer binding point of the FrameConstants block. */
+const gl::GLuint FRAME_CONSTANTS_BINDING = 0;
+/** The uniform buffer binding point of the LightList block. */
+const gl::GLuint LIGHT_LIST_BINDING = 1;
+/** The initial size, in bytes, of each frame's region of the frame constant stream. */
+const size_t FRAME_CONSTANTS_STREAM_REGION_SIZE = 4096;
+/** Kept small enough that the LightList block stays within the 16KB a uniform block is guaranteed. */
+const int MAX_POINT_LIGHTS = 128;
+const int MAX_DIRECTION_LIGHTS = 4;
+
+///
+/// CPU side copies of the std140 uniform blocks shared by every program. A shader that declares a block with one of
+/// these names, and the same members, is bound to its binding point when it is created:
+///
+///   layout(std140) uniform FrameConstants { mat4 viewProjection; vec4 cameraPosition; vec4 wind; vec4 time;
+///       vec4 lightClusters; };
+///   layout(std140) uniform LightList { ivec4 lightCounts; PointLight pointLights[MAX_POINT_LIGHTS];
+///       DirectionLight directionLights[MAX_DIRECTION_LIGHTS]; };
+///
+/// Every member is a vec4 or mat4, so the std140 layout is the same as the C++ one. Shaders take the FrameConstants
+/// declaration from res/frame_constants.glsl with #include rather than repeating it.
+///
+
+/**
+ * Values that are the same for every draw in a frame.
+ */
+struct FrameConstants
+{
+	/** Takes world coordinates to clip coordinates, matching the fixed function projection and setLookAt(...). */
+	glm::mat4 viewProjection;
+	/** The camera position in world space, with w = 1. */
+	glm::vec4 cameraPosition;
+	/** The wind blowing over the grass: the direction in xyz and its power in w. */
+	glm::vec4 wind;
+	/** The time since the game started, in seconds, in x. */
+	glm::vec4 time;
+	/**
+	 * How to find a fragment's light cluster: the scale and bias that turn log(-viewZ) into a depth slice in xy, and
+	 * the number of clusters per pixel across and down the screen in zw. See render/lightclusters.h.
+	 */
+	glm::vec4 lightClusters;
+};
+
+struct PointLight
+{
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
+	/** The position in world space, in xyz, and the radius the light reaches, in w. */
+	glm::vec4 position;
+};
+
+struct DirectionLight
+{
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
+	glm::vec4 direction;
+};
+
+/**
+ * The lights in the scene.
+ */
+struct LightList
+{
+	/** The number of point lights in x and of direction lights in y. */
+	int lightCounts[4];
+	PointLight pointLights[MAX_POINT_LIGHTS];
+	DirectionLight directionLights[MAX_DIRECTION_LIGHTS];
+};
+
+/**
+ * Gets the frame constants to fill in before uploadUniformBlocks() is called.
+ */
+FrameConstants &getFrameConstants();
+/**
+ * Gets the light list. Call markLightListChanged() after changing it.
+ */
+LightList &getLightList();
+/**
+ * Makes the next uploadUniformBlocks() upload the light list.
+ */
+void markLightListChanged();
+/**
+ * Uploads the frame constants, and the light list if it changed, and binds them to their binding points. This is
+ * called once per frame, before anything that uses them is drawn.
+ */
+void uploadUniformBlocks();
+/**
+ * Binds the shared uniform blocks a program declares to their binding points. Shader does this for every program
+ * it is created with.
+ */
+void bindUniformBlocks(gl::GLuint programID);
+/**
+ * Deletes the GL buffers behind the uniform blocks. This is called at shutdown, while the GL context still exists.
+ * The buffers are created again by the next uploadUniformBlocks().
+ */
+void releaseUniformBlocks();
+
+#endif
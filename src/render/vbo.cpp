@@ -1,7 +1,12 @@
 
 #include "vbo.h"
 #include "render/render.h"
+#include "render/glstate.h"
+#include "render/matrixstack.h"
+#include "render/meshprogram.h"
+#include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <algorithm>
 
 /**
  * Convience method to create a VBOID. Equivalent to a call to GL15.glGenBuffers().
@@ -60,11 +65,13 @@ VBO::VBO(MeshData &data, std::shared_ptr<Texture> associatedTexture)
     float* rawArray = data.combinedData.getRawArray();
     //Create the VBO
     vertexBufferID = createVBOID();
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+    bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
     #include <iostream>
     std::cout << "CDS:" << data.combinedData.size() << std::endl;
     totalNumberOfValues = data.combinedData.size();
     glBufferData(GL_ARRAY_BUFFER, data.combinedData.size() * sizeof(float), rawArray, GL_STATIC_DRAW);
+    createVertexArray();
+    createIndexBuffer(data.indices, data.lods);
 
 
     // TODO - [LEAK] Memory leaked here - float* rawArray?
@@ -112,30 +119,123 @@ VBO::VBO(std::shared_ptr<MeshData> data, std::shared_ptr<Texture> texture)
     float* rawArray = data->combinedData.getRawArray();
     //Create the VBO
     vertexBufferID = createVBOID();
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+    bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
     #include <iostream>
     totalNumberOfValues = data->combinedData.size();
     glBufferData(GL_ARRAY_BUFFER, data->combinedData.size() * sizeof(float), rawArray, GL_STATIC_DRAW);
+    createVertexArray();
+    createIndexBuffer(data->indices, data->lods);
 }
 
 /**
- * Draws the VBO's contents.
+ * Creates the vertex array object on the core render path, while the vertex buffer is bound, so the vertex format is
+ * only set up once. The index buffer created next is recorded in it too.
  */
-void VBO::draw(Camera *camera)
+void VBO::createVertexArray()
 {
     using namespace gl;
+    vertexArrayID = 0;
+    if(!isCoreRenderPathActive())
+    {
+        return;
+    }
+    glGenVertexArrays(1, &vertexArrayID);
+    bindVertexArray(vertexArrayID);
+    setVertexAttribute(VERTEX_ATTRIBUTE_POSITION, vertexSize, vertexType, stride, vertexOffset);
+    setVertexAttribute(VERTEX_ATTRIBUTE_NORMAL, normalSize, normalType, stride, normalOffset);
+    setVertexAttribute(VERTEX_ATTRIBUTE_COLOUR, colourSize, colourType, stride, colourOffset);
+    setVertexAttribute(VERTEX_ATTRIBUTE_TEXTURE_COORD, textureCoordSize, textureCoordType, stride, textureCoordOffset);
+}
+
+void triangulateQuads(const std::vector<unsigned int> &indices, int vertexCount, const std::vector<MeshLOD> &meshLODs,
+    std::vector<unsigned int> &triangles, std::vector<MeshLOD> &triangleLODs)
+{
+    int quadCount = indices.empty() ? vertexCount / 4 : static_cast<int>(indices.size()) / 4;
+    triangles.reserve(quadCount * 6);
+    for(int quad = 0; quad < quadCount; quad++)
+    {
+        unsigned int corners[4];
+        for(int i = 0; i < 4; i++)
+        {
+            corners[i] = indices.empty() ? static_cast<unsigned int>(quad * 4 + i) : indices[quad * 4 + i];
+        }
+        unsigned int pair[] = { corners[0], corners[1], corners[2], corners[0], corners[2], corners[3] };
+        triangles.insert(triangles.end(), pair, pair + 6);
+    }
+    for(const MeshLOD &lod : meshLODs)
+    {
+        triangleLODs.push_back({ lod.firstIndex / 4 * 6, lod.indexCount / 4 * 6, lod.error });
+    }
+}
 
+/**
+ * Uploads the index data of an indexed mesh. Indices are narrowed to 16 bits whenever the vertex count allows it,
+ * halving the size of the element buffer.
+ */
+void VBO::createIndexBuffer(const std::vector<unsigned int> &indices, const std::vector<MeshLOD> &meshLODs)
+{
+    using namespace gl;
+    if(vertexArrayID != 0 && glRenderMode == GL_QUADS)
+    {
+        std::vector<unsigned int> triangles;
+        std::vector<MeshLOD> triangleLODs;
+        triangulateQuads(indices, getVertexCount(), meshLODs, triangles, triangleLODs);
+        glRenderMode = GL_TRIANGLES;
+        createIndexBuffer(triangles, triangleLODs);
+        return;
+    }
+    indexBufferID = 0;
+    indexCount = 0;
+    indexType = GL_UNSIGNED_INT;
+    if(indices.empty())
+    {
+        return;
+    }
+    lods = meshLODs;
+    if(lods.empty())
+    {
+        lods.push_back({ 0, static_cast<int>(indices.size()), 0.0f });
+    }
+    indexCount = lods[0].indexCount;
+    indexBufferID = createVBOID();
+    bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+    if(getVertexCount() <= 65536)
+    {
+        indexType = GL_UNSIGNED_SHORT;
+        std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+    }
+    else
+    {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    }
+}
+
+void VBO::bind()
+{
+    using namespace gl;
+
+    if(vertexArrayID != 0)
+    {
+        if(associatedTexture)
+        {
+            associatedTexture->bind();
+        }
+        bindVertexArray(vertexArrayID);
+        return;
+    }
     if(!associatedTexture)
     {
-        glDisable(GL_TEXTURE_2D);
+        disableState(GL_TEXTURE_2D);
     }
     else
     {
-        glEnable(GL_TEXTURE_2D);
+        enableState(GL_TEXTURE_2D);
         associatedTexture->bind();
 
     }
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+    setClientArrays(true, true, true, true);
+    bindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
     // render the cube
   //  std::cout << vertexSize << " " << colourSize << " " << textureCoordSize << " " << stride << " " <<
    //     vertexOffset << " " << normalOffset << " " << colourOffset << " " << textureCoordOffset << std::endl;
@@ -143,8 +243,78 @@ void VBO::draw(Camera *camera)
     glNormalPointer(normalType, stride, (void*)(normalOffset));
     glColorPointer(colourSize, colourType, stride, (void*)(colourOffset));
     glTexCoordPointer(textureCoordSize, textureCoordType, stride, (void*)(textureCoordOffset));
+    if(indexBufferID != 0)
+    {
+        bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+    }
+}
 
-    glDrawArrays(glRenderMode, 0, totalNumberOfValues / elementsPerRowOfCombinedData);
+/**
+ * Draws the VBO's contents.
+ */
+void VBO::draw(Camera *camera)
+{
+    using namespace gl;
+    bind();
+    const glm::mat4 &modelMatrix = getModelMatrixStack().top();
+    if(vertexArrayID != 0)
+    {
+        useMeshProgram(modelMatrix, static_cast<bool>(associatedTexture));
+    }
+    else
+    {
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glMultMatrixf(glm::value_ptr(modelMatrix));
+    }
+    if(indexBufferID != 0)
+    {
+        glDrawElements(glRenderMode, indexCount, indexType, nullptr);
+    }
+    else
+    {
+        glDrawArrays(glRenderMode, 0, getVertexCount());
+    }
+    if(vertexArrayID == 0)
+    {
+        glPopMatrix();
+    }
+}
+
+void VBO::drawInstanced(int instanceCount, int lod)
+{
+    using namespace gl;
+    if(indexBufferID != 0)
+    {
+        MeshLOD &range = lods[std::min(std::max(lod, 0), static_cast<int>(lods.size()) - 1)];
+        size_t indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+        // The caller may have bound another element buffer while setting up instance attributes. A vertex array
+        // object keeps its own.
+        if(vertexArrayID == 0)
+        {
+            bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+        }
+        glDrawElementsInstanced(glRenderMode, range.indexCount, indexType, (void*)(range.firstIndex * indexSize), instanceCount);
+    }
+    else
+    {
+        glDrawArraysInstanced(glRenderMode, 0, getVertexCount(), instanceCount);
+    }
+}
+
+int VBO::getVertexCount()
+{
+    return totalNumberOfValues / elementsPerRowOfCombinedData;
+}
+
+int VBO::getLODCount()
+{
+    return std::max(static_cast<int>(lods.size()), 1);
+}
+
+int VBO::getIndexCount()
+{
+    return indexCount;
 }
 
 VBO::~VBO()
@@ -154,5 +324,16 @@ VBO::~VBO()
     gl::GLuint *buffers = new gl::GLuint[1];
     buffers[0] = static_cast<gl::GLuint>(vertexBufferID);
     gl::glDeleteBuffers(1, buffers);
+    notifyBufferDeleted(buffers[0]);
+    if(indexBufferID != 0)
+    {
+        gl::glDeleteBuffers(1, &indexBufferID);
+        notifyBufferDeleted(indexBufferID);
+    }
+    if(vertexArrayID != 0)
+    {
+        gl::glDeleteVertexArrays(1, &vertexArrayID);
+        notifyVertexArrayDeleted(vertexArrayID);
+    }
     delete[] buffers;
 }
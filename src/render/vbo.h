@@ -2,12 +2,23 @@
 #define ENGINE_VBO_H
 
 #include <memory>
+#include <vector>
 #include <glbinding/gl/gl.h>
 #include "render/texture.h"
 #include "graphics/camera.h"
 #include "world/meshdata.h"
 
 gl::GLuint createVBOID();
+/**
+ * Splits quads into pairs of triangles, as core profiles cannot draw quads.
+ * @param indices the quads' indices, or empty if the vertices are drawn in order
+ * @param vertexCount the number of vertices, used when there are no indices
+ * @param meshLODs the index ranges of each level of detail, which are scaled to match
+ * @param triangles receives the triangles' indices
+ * @param triangleLODs receives the index ranges of each level of detail within triangles
+ */
+void triangulateQuads(const std::vector<unsigned int> &indices, int vertexCount, const std::vector<MeshLOD> &meshLODs,
+	std::vector<unsigned int> &triangles, std::vector<MeshLOD> &triangleLODs);
 
 /**
  * VBO defines an immutable class that takes a ModelData object, ructs a Vertex Buffer Object,
@@ -40,6 +51,17 @@ private:
 	/** The total size of the combined vertex, colour, normal, and texture data in bytes. */
 	// FlexArray<float> combinedData;
 	 gl::GLuint vertexBufferID;
+	/** The element buffer of an indexed VBO, or 0 if the VBO is drawn with glDrawArrays. */
+	 gl::GLuint indexBufferID;
+	 int indexCount;
+	/** GL_UNSIGNED_SHORT when every index fits in 16 bits, otherwise GL_UNSIGNED_INT. */
+	 gl::GLenum indexType;
+	/** The index ranges of each level of detail. An indexed VBO always has at least one. */
+	 std::vector<MeshLOD> lods;
+	/** The vertex array object holding this VBO's vertex format and element buffer, or 0 on the fixed function path. */
+	 gl::GLuint vertexArrayID;
+	 void createVertexArray();
+	 void createIndexBuffer(const std::vector<unsigned int> &indices, const std::vector<MeshLOD> &meshLODs);
 public:
     bool hasTextureData;
     int totalNumberOfValues;
@@ -52,9 +74,33 @@ public:
 
 	VBO(std::shared_ptr<MeshData> data, std::shared_ptr<Texture> texture);
 	/**
-	 * Draws the VBO's contents.
+	 * Binds the VBO's texture and vertex array object. On the fixed function path the buffers are bound and the client
+	 * arrays are pointed at its data instead. Nothing is drawn.
+	 */
+	void bind();
+	/**
+	 * Draws the VBO's contents at full detail, placed by the top of the model matrix stack.
 	 */
 	void draw(Camera *camera);
+	/**
+	 * Draws the VBO's contents instanceCount times with a single call. The VBO must already be bound with
+	 * {@link #bind()}, and any per-instance attributes must already be set up by the caller.
+	 * @param instanceCount the number of instances to draw
+	 * @param lod the level of detail to draw. Levels past the coarsest one this VBO has draw the coarsest
+	 */
+	void drawInstanced(int instanceCount, int lod = 0);
+	/**
+	 * Gets the number of levels of detail this VBO can draw. This is 1 unless the mesh it was built from has LODs.
+	 */
+	int getLODCount();
+	/**
+	 * Gets the number of vertices stored in this VBO.
+	 */
+	int getVertexCount();
+	/**
+	 * Gets the number of indices drawn by this VBO at full detail, or 0 if it is not indexed.
+	 */
+	int getIndexCount();
 	~VBO();
 };
 
@@ -1,8 +1,10 @@
 
-#include <sstream>
+#include <algorithm>
 #include "shaders/lightingshaderdemo.h"
 #include "graphics/gluhelper.h"
 #include "graphics/windowhelper.h"
+#include "render/glstate.h"
+#include "render/lightmanager.h"
 
 void LightingShaderDemo::render()
 {
@@ -43,7 +45,7 @@ void LightingShaderDemo::init(int argc, char **argv)
     glShadeModel(GL_SMOOTH);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClearDepth(1.0f);
-    glEnable(GL_DEPTH_TEST);
+    enableState(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
     glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
 
@@ -52,20 +54,26 @@ void LightingShaderDemo::init(int argc, char **argv)
     std::string vertFilepath = "shaders/debug_vert_shader.vert";
     std::string fragFilepath = "shaders/debug_frag_shader.frag";
     shader1 = createShader(&vertFilepath, &fragFilepath);
-    shader1->glUniform1("numPointLights", numPointLights);
-    shader1->glUniform1("numDirectionLights", numDirectionLights);
-    for(int i = 0; i < numPointLights; i++)
+    // The lights go up in the LightList uniform block, one buffer update for all of them.
+    LightList &lights = getLightList();
+    lights.lightCounts[0] = std::min(numPointLights, MAX_POINT_LIGHTS);
+    lights.lightCounts[1] = std::min(numDirectionLights, MAX_DIRECTION_LIGHTS);
+    for(int i = 0; i < lights.lightCounts[0]; i++)
     {
-        std::stringstream ss;
-        ss << "pointLights[" << i << "]";
-        shader1->glUniform3(ss.str(), pointLights[i]);
+        lights.pointLights[i].ambient = glm::vec4(pointLights[i * 4], 1.0f);
+        lights.pointLights[i].diffuse = glm::vec4(pointLights[i * 4 + 1], 1.0f);
+        lights.pointLights[i].specular = glm::vec4(pointLights[i * 4 + 2], 1.0f);
+        lights.pointLights[i].position = glm::vec4(pointLights[i * 4 + 3], DEFAULT_POINT_LIGHT_RADIUS);
     }
-    for(int i = 0; i < numDirectionLights; i++)
+    for(int i = 0; i < lights.lightCounts[1]; i++)
     {
-        std::stringstream ss;
-        ss << "directionLights[" << i << "]";
-        shader1->glUniform3(ss.str(), directionLights[i]);
+        lights.directionLights[i].ambient = glm::vec4(directionLights[i * 4], 1.0f);
+        lights.directionLights[i].diffuse = glm::vec4(directionLights[i * 4 + 1], 1.0f);
+        lights.directionLights[i].specular = glm::vec4(directionLights[i * 4 + 2], 1.0f);
+        lights.directionLights[i].direction = glm::vec4(directionLights[i * 4 + 3], 0.0f);
     }
+    markLightListChanged();
+    uploadUniformBlocks();
 }
 
 void LightingShaderDemo::initLights()
@@ -0,0 +1,184 @@
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <glbinding/ContextInfo.h>
+#include <glbinding/Version.h>
+#include <glbinding/gl/extension.h>
+#include "shaders/programcache.h"
+#include "utils/binaryio.h"
+#include "utils/fileutils.h"
+#include "utils/mappedfile.h"
+
+using namespace gl;
+
+/** "PRGC", written at the start and the end of every program cache. The end marker catches truncated files. */
+static const uint32_t PROGRAM_CACHE_MAGIC = 0x43475250;
+
+///
+/// A program cache is a flat, native endian file:
+///   magic, version, source hash, vendor, renderer, driver version
+///   binary format, binary length, the binary
+///   magic
+///
+
+/**
+ * Gets the path without its extension, if the file name has one.
+ */
+static std::string removeExtension(const std::string &path)
+{
+    size_t dot = path.find_last_of('.');
+    size_t separator = path.find_last_of("/\\");
+    if (dot == std::string::npos || (separator != std::string::npos && dot < separator))
+    {
+        return path;
+    }
+    return path.substr(0, dot);
+}
+
+std::string getProgramCachePath(const std::string *vertFilepath, const std::string *fragFilepath)
+{
+    const std::string &first = vertFilepath ? *vertFilepath : *fragFilepath;
+    std::string path = removeExtension(first);
+    // A vertex shader may be paired with more than one fragment shader, each of which needs its own cache.
+    if (vertFilepath && fragFilepath && removeExtension(*fragFilepath) != path)
+    {
+        size_t separator = fragFilepath->find_last_of("/\\");
+        path += "." + fragFilepath->substr(separator == std::string::npos ? 0 : separator + 1);
+    }
+    return path + ".progcache";
+}
+
+uint64_t hashProgramSources(const std::string &vertSource, const std::string &fragSource)
+{
+    // Hashing the two together, with the length of the first in between, tells "ab" + "c" from "a" + "bc".
+    std::vector<char> combined;
+    appendString(combined, vertSource);
+    appendString(combined, fragSource);
+    return hashBytes(combined.data(), combined.size());
+}
+
+bool isProgramCacheSupported()
+{
+    static int supported = -1;
+    if (supported < 0)
+    {
+        supported = 0;
+        if (glbinding::ContextInfo::version() >= glbinding::Version(4, 1) ||
+            glbinding::ContextInfo::extensions().count(GLextension::GL_ARB_get_program_binary) > 0)
+        {
+            GLint formatCount = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+            supported = formatCount > 0;
+        }
+    }
+    return supported == 1;
+}
+
+static std::string getDriverString(GLenum name)
+{
+    const GLubyte *value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+GLuint loadCachedProgram(const std::string &cachePath, uint64_t sourceHash)
+{
+    if (!isProgramCacheSupported())
+    {
+        return 0;
+    }
+    FileStatus cacheStatus;
+    if (!getFileStatus(cachePath, cacheStatus))
+    {
+        return 0;
+    }
+    GLuint program = 0;
+    try
+    {
+        MappedFile file(cachePath);
+        BinaryReader reader(file.data(), file.size());
+        if (reader.read<uint32_t>() != PROGRAM_CACHE_MAGIC || reader.read<uint32_t>() != PROGRAM_CACHE_VERSION)
+        {
+            std::cout << "Program cache >" << cachePath << "< is out of date, recompiling." << std::endl;
+            return 0;
+        }
+        if (reader.read<uint64_t>() != sourceHash)
+        {
+            std::cout << "Program cache >" << cachePath << "< is stale, recompiling." << std::endl;
+            return 0;
+        }
+        if (reader.readString() != getDriverString(GL_VENDOR) || reader.readString() != getDriverString(GL_RENDERER) ||
+            reader.readString() != getDriverString(GL_VERSION))
+        {
+            std::cout << "Program cache >" << cachePath << "< is from another driver, recompiling." << std::endl;
+            return 0;
+        }
+        GLenum binaryFormat = static_cast<GLenum>(reader.read<uint32_t>());
+        uint32_t length = reader.read<uint32_t>();
+        const char *binary = reader.take(length);
+        if (reader.read<uint32_t>() != PROGRAM_CACHE_MAGIC)
+        {
+            throw std::runtime_error("No end marker");
+        }
+
+        program = glCreateProgram();
+        glProgramBinary(program, binaryFormat, binary, static_cast<GLsizei>(length));
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            std::cout << "Program cache >" << cachePath << "< was rejected by the driver, recompiling." << std::endl;
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cout << "Program cache >" << cachePath << "< could not be read (" << e.what() << "), recompiling." << std::endl;
+        if (program != 0)
+        {
+            glDeleteProgram(program);
+        }
+        return 0;
+    }
+}
+
+void writeProgramCache(const std::string &cachePath, uint64_t sourceHash, GLuint program)
+{
+    if (!isProgramCacheSupported())
+    {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        std::cout << "Not writing program cache >" << cachePath << "<, the driver gave no binary." << std::endl;
+        return;
+    }
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum binaryFormat = GL_NONE;
+    glGetProgramBinary(program, length, &written, &binaryFormat, binary.data());
+
+    std::vector<char> buffer;
+    appendValue<uint32_t>(buffer, PROGRAM_CACHE_MAGIC);
+    appendValue<uint32_t>(buffer, PROGRAM_CACHE_VERSION);
+    appendValue<uint64_t>(buffer, sourceHash);
+    appendString(buffer, getDriverString(GL_VENDOR));
+    appendString(buffer, getDriverString(GL_RENDERER));
+    appendString(buffer, getDriverString(GL_VERSION));
+    appendValue<uint32_t>(buffer, static_cast<uint32_t>(binaryFormat));
+    appendValue<uint32_t>(buffer, static_cast<uint32_t>(written));
+    appendBytes(buffer, binary.data(), written);
+    appendValue<uint32_t>(buffer, PROGRAM_CACHE_MAGIC);
+    try
+    {
+        writeBinaryFile(cachePath, buffer);
+        std::cout << "Wrote program cache >" << cachePath << "<: " << buffer.size() << " bytes" << std::endl;
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cout << "Not writing program cache: " << e.what() << std::endl;
+    }
+}
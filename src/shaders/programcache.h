@@ -0,0 +1,45 @@
+#ifndef GAME_PROGRAM_CACHE_H
+#define GAME_PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <glbinding/gl/gl.h>
+
+/** Bumped whenever the layout of a program cache changes. */
+const unsigned int PROGRAM_CACHE_VERSION = 1;
+
+/**
+ * Gets the path of the program cache for a pair of shader sources. It is kept next to the vertex shader, or the
+ * fragment shader if there is no vertex shader.
+ * @param vertFilepath the path of the vertex shader, or nullptr
+ * @param fragFilepath the path of the fragment shader, or nullptr
+ */
+std::string getProgramCachePath(const std::string *vertFilepath, const std::string *fragFilepath);
+/**
+ * Hashes the sources a program is built from. Any change to either source changes the hash.
+ */
+uint64_t hashProgramSources(const std::string &vertSource, const std::string &fragSource);
+/**
+ * Gets whether the context can save and load program binaries, through GL 4.1 or ARB_get_program_binary, and
+ * supports at least one binary format.
+ */
+bool isProgramCacheSupported();
+/**
+ * Creates a program from the binary in a program cache with glProgramBinary. The binary is only used if it was
+ * saved from the same sources by the same driver: vendor, renderer and version strings all have to match. The
+ * driver may still reject it, for example after an update that did not change its version string.
+ * @param cachePath the path returned by getProgramCachePath(...)
+ * @param sourceHash the hash of the current sources, from hashProgramSources(...)
+ * @return the linked program, or 0 if there is no usable binary
+ */
+gl::GLuint loadCachedProgram(const std::string &cachePath, uint64_t sourceHash);
+/**
+ * Saves the binary of a linked program. The program should have been linked with
+ * GL_PROGRAM_BINARY_RETRIEVABLE_HINT set. Failing to write the cache is logged but is not an error.
+ * @param cachePath the path returned by getProgramCachePath(...)
+ * @param sourceHash the hash of the sources the program was built from
+ * @param program the program to save
+ */
+void writeProgramCache(const std::string &cachePath, uint64_t sourceHash, gl::GLuint program);
+
+#endif
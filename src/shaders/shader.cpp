@@ -1,8 +1,15 @@
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <glm/gtc/type_ptr.hpp>
 #include "utils/fileutils.h"
 #include "shaders/shader.h"
+#include "shaders/programcache.h"
+#include "render/glstate.h"
+#include "render/lightmanager.h"
+#include "render/uniformblocks.h"
 
 void _printShaderInfoLog(gl::GLuint obj);
 void _printProgramInfoLog(gl::GLuint obj);
@@ -10,89 +17,263 @@ void _printProgramInfoLog(gl::GLuint obj);
 Shader::Shader(gl::GLhandleARB programID) : programID(programID)
 {
     std::cout << "CREATE_SHADER:" << programID << std::endl;
+    reflectUniforms();
+    bindUniformBlocks(programID);
+    UniformHandle lightClusterData = getUniform("lightClusterData");
+    if (lightClusterData != INVALID_UNIFORM)
+    {
+        bindShader();
+        setUniform(lightClusterData, LIGHT_CLUSTER_TEXTURE_UNIT);
+        releaseShader();
+    }
+}
+
+/**
+ * Reads the active uniforms of the program into the name to handle table, so nothing has to ask the driver for a
+ * location again.
+ */
+void Shader::reflectUniforms()
+{
+    using namespace gl;
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<char> nameBuffer(std::max(maxNameLength, 1));
+    for (GLint i = 0; i < uniformCount; i++)
+    {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type = GL_NONE;
+        glGetActiveUniform(programID, i, static_cast<GLsizei>(nameBuffer.size()), &nameLength, &arraySize, &type,
+            nameBuffer.data());
+        std::string name(nameBuffer.data(), nameLength);
+        // Arrays are reported as their first element; strip that so the elements can be named.
+        bool isArray = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+        std::string baseName = isArray ? name.substr(0, name.size() - 3) : name;
+        for (GLint element = 0; element < std::max(arraySize, 1); element++)
+        {
+            std::string elementName = isArray ? baseName + "[" + std::to_string(element) + "]" : baseName;
+            // Uniforms in blocks and built in ones have no location.
+            GLint location = glGetUniformLocation(programID, elementName.c_str());
+            if (location < 0)
+            {
+                continue;
+            }
+            UniformSlot slot;
+            slot.location = location;
+            slot.hasValue = false;
+            slot.isInteger = false;
+            slot.components = 0;
+            UniformHandle handle = static_cast<UniformHandle>(uniforms.size());
+            uniforms.push_back(slot);
+            uniformHandles[elementName] = handle;
+            if (isArray && element == 0)
+            {
+                uniformHandles[baseName] = handle;
+            }
+        }
+    }
 }
 
 void Shader::bindShader()
 {
-    gl::glUseProgramObjectARB(programID);
+    useProgram(programID);
 }
 
 void Shader::releaseShader()
 {
-    gl::glUseProgramObjectARB(0);
+    useProgram(0);
+}
+
+Shader::UniformHandle Shader::getUniform(const std::string &uniformName)
+{
+    auto it = uniformHandles.find(uniformName);
+    return (it != uniformHandles.end()) ? it->second : INVALID_UNIFORM;
 }
 
-void Shader::glUniform1(std::string attributeName, gl::GLfloat v)
+/**
+ * Compares a value with the last one set to a uniform, and remembers it.
+ * @return true if the value has to be uploaded
+ */
+bool Shader::needsUpload(UniformHandle uniform, bool isInteger, const void *values, int components)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform1f(gl::glGetUniformLocation(programID, attributeName.c_str()), v);
+    if (uniform < 0)
+    {
+        return false;
+    }
+    UniformSlot &slot = uniforms[uniform];
+    size_t bytes = components * sizeof(std::uint32_t);
+    if (slot.hasValue && slot.isInteger == isInteger && slot.components == components &&
+        std::memcmp(slot.value, values, bytes) == 0)
+    {
+        return false;
+    }
+    slot.hasValue = true;
+    slot.isInteger = isInteger;
+    slot.components = components;
+    std::memcpy(slot.value, values, bytes);
+    return true;
 }
 
-void Shader::glUniform1(std::string attributeName, gl::GLint v)
+void Shader::setInts(UniformHandle uniform, const gl::GLint *values, int components)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform1i(gl::glGetUniformLocation(programID, attributeName.c_str()), v);
+    if (!needsUpload(uniform, true, values, components))
+    {
+        return;
+    }
+    useProgram(programID);
+    gl::GLint location = uniforms[uniform].location;
+    switch (components)
+    {
+    case 1: gl::glUniform1i(location, values[0]); break;
+    case 2: gl::glUniform2i(location, values[0], values[1]); break;
+    case 3: gl::glUniform3i(location, values[0], values[1], values[2]); break;
+    default: gl::glUniform4i(location, values[0], values[1], values[2], values[3]); break;
+    }
 }
 
-void Shader::glUniform1(std::string attributeName, bool v)
+void Shader::setFloats(UniformHandle uniform, const gl::GLfloat *values, int components)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform1i(gl::glGetUniformLocation(programID, attributeName.c_str()), v);
+    if (!needsUpload(uniform, false, values, components))
+    {
+        return;
+    }
+    useProgram(programID);
+    gl::GLint location = uniforms[uniform].location;
+    switch (components)
+    {
+    case 1: gl::glUniform1f(location, values[0]); break;
+    case 2: gl::glUniform2f(location, values[0], values[1]); break;
+    case 3: gl::glUniform3f(location, values[0], values[1], values[2]); break;
+    default: gl::glUniform4f(location, values[0], values[1], values[2], values[3]); break;
+    }
+}
+
+void Shader::setUniform(UniformHandle uniform, gl::GLfloat v)
+{
+    setFloats(uniform, &v, 1);
+}
+
+void Shader::setUniform(UniformHandle uniform, gl::GLint v)
+{
+    setInts(uniform, &v, 1);
+}
+
+void Shader::setUniform(UniformHandle uniform, bool v)
+{
+    gl::GLint value = v;
+    setInts(uniform, &value, 1);
+}
+
+void Shader::setUniform(UniformHandle uniform, glm::vec2 v)
+{
+    setFloats(uniform, &v.x, 2);
+}
+
+void Shader::setUniform(UniformHandle uniform, glm::vec3 v)
+{
+    setFloats(uniform, &v.x, 3);
+}
+
+void Shader::setUniform(UniformHandle uniform, glm::vec4 v)
+{
+    setFloats(uniform, &v.x, 4);
+}
+
+void Shader::setUniform(UniformHandle uniform, const glm::vec3 *values, int count)
+{
+    if (uniform < 0 || count <= 0)
+    {
+        return;
+    }
+    // The elements' remembered values would go stale, so forget them.
+    for (int i = 0; i < count && uniform + i < static_cast<int>(uniforms.size()); i++)
+    {
+        uniforms[uniform + i].hasValue = false;
+    }
+    useProgram(programID);
+    gl::glUniform3fv(uniforms[uniform].location, count, &values[0].x);
+}
+
+void Shader::setUniform(UniformHandle uniform, const glm::mat4 &value)
+{
+    if (uniform < 0)
+    {
+        return;
+    }
+    useProgram(programID);
+    gl::glUniformMatrix4fv(uniforms[uniform].location, 1, gl::GL_FALSE, glm::value_ptr(value));
 }
 
-void Shader::glUniform2(std::string attributeName, gl::GLfloat v0, gl::GLfloat v1)
+void Shader::glUniform1(const std::string &attributeName, gl::GLfloat v)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform2f(gl::glGetUniformLocation(programID, attributeName.c_str()), v0, v1);
+    setUniform(getUniform(attributeName), v);
 }
 
-void Shader::glUniform2(std::string attributeName, glm::vec2 v)
+void Shader::glUniform1(const std::string &attributeName, gl::GLint v)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform2f(gl::glGetUniformLocation(programID, attributeName.c_str()), v.x, v.y);
+    setUniform(getUniform(attributeName), v);
 }
 
-void Shader::glUniform2(std::string attributeName, gl::GLint v0, gl::GLint v1)
+void Shader::glUniform1(const std::string &attributeName, bool v)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform2i(gl::glGetUniformLocation(programID, attributeName.c_str()), v0, v1);
+    setUniform(getUniform(attributeName), v);
 }
 
-void Shader::glUniform3(std::string attributeName, gl::GLfloat v0, gl::GLfloat v1, gl::GLfloat v2)
+void Shader::glUniform2(const std::string &attributeName, gl::GLfloat v0, gl::GLfloat v1)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform3f(gl::glGetUniformLocation(programID, attributeName.c_str()), v0, v1, v2);
+    setUniform(getUniform(attributeName), glm::vec2(v0, v1));
 }
 
-void Shader::glUniform3(std::string attributeName, glm::vec3 v)
+void Shader::glUniform2(const std::string &attributeName, glm::vec2 v)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform3f(gl::glGetUniformLocation(programID, attributeName.c_str()), v.x, v.y, v.z);
+    setUniform(getUniform(attributeName), v);
 }
 
-void Shader::glUniform3(std::string attributeName, gl::GLint v0, gl::GLint v1, gl::GLint v2)
+void Shader::glUniform2(const std::string &attributeName, gl::GLint v0, gl::GLint v1)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform3i(gl::glGetUniformLocation(programID, attributeName.c_str()), v0, v1, v2);
+    gl::GLint values[] = { v0, v1 };
+    setInts(getUniform(attributeName), values, 2);
 }
 
-void Shader::glUniform4(std::string attributeName, gl::GLfloat v0, gl::GLfloat v1, gl::GLfloat v2, gl::GLfloat v3)
+void Shader::glUniform3(const std::string &attributeName, gl::GLfloat v0, gl::GLfloat v1, gl::GLfloat v2)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform4f(gl::glGetUniformLocation(programID, attributeName.c_str()), v0, v1, v2, v3);
+    setUniform(getUniform(attributeName), glm::vec3(v0, v1, v2));
 }
 
-void Shader::glUniform4(std::string attributeName, glm::vec4 v)
+void Shader::glUniform3(const std::string &attributeName, glm::vec3 v)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform4f(gl::glGetUniformLocation(programID, attributeName.c_str()), v.x, v.y, v.z, v.w);
+    setUniform(getUniform(attributeName), v);
 }
 
-void Shader::glUniform4(std::string attributeName, gl::GLint v0, gl::GLint v1, gl::GLint v2, gl::GLint v3)
+void Shader::glUniform3(const std::string &attributeName, gl::GLint v0, gl::GLint v1, gl::GLint v2)
 {
-    gl::glUseProgram(programID);
-    gl::glUniform4i(gl::glGetUniformLocation(programID, attributeName.c_str()), v0, v1, v2, v3);
+    gl::GLint values[] = { v0, v1, v2 };
+    setInts(getUniform(attributeName), values, 3);
 }
+
+void Shader::glUniform4(const std::string &attributeName, gl::GLfloat v0, gl::GLfloat v1, gl::GLfloat v2, gl::GLfloat v3)
+{
+    setUniform(getUniform(attributeName), glm::vec4(v0, v1, v2, v3));
+}
+
+void Shader::glUniform4(const std::string &attributeName, glm::vec4 v)
+{
+    setUniform(getUniform(attributeName), v);
+}
+
+void Shader::glUniform4(const std::string &attributeName, gl::GLint v0, gl::GLint v1, gl::GLint v2, gl::GLint v3)
+{
+    gl::GLint values[] = { v0, v1, v2, v3 };
+    setInts(getUniform(attributeName), values, 4);
+}
+
+gl::GLint Shader::getAttributeLocation(const std::string &attributeName)
+{
+    return gl::glGetAttribLocation(programID, attributeName.c_str());
+}
+
 /*
 void Shader::glUniformMatrix2(std::string attributeName, boolean transpose, java.nio.FloatBuffer matrices)
 {
@@ -166,49 +347,85 @@ void _printProgramInfoLog(gl::GLuint obj)
 }
 
 /**
- * Creates an OpenGL shader.
- * @param filename a String which has the filepath to the GLSL shader file to use
+ * Compiles an OpenGL shader.
+ * @param source the GLSL source code of the shader
  * @param shaderType the type of the shader to use - either GL_FRAGMENT_SHADER_ARB or GL_VERTEX_SHADER_ARB depending on the shader type
- * @return an gl::GLuint which uniquely identifies this shader within the program.
+ * @return an gl::GLuint which uniquely identifies this shader within the program, or -1 if it did not compile.
  */
-int createShader(const std::string *filename, gl::GLenum shaderType)
+int compileShader(const std::string &source, gl::GLenum shaderType)
 {
     using namespace gl;
-    GLint shader = 0;
-    try
+    GLint shader = glCreateShader(shaderType);
+    if(shader == 0)
+    {
+        return 0;
+    }
+
+    const char* val = source.c_str();
+    GLint len = static_cast<GLint>(source.length());
+    glShaderSourceARB(shader, 1, const_cast<const GLcharARB**>(&val), &len);
+    glCompileShaderARB(shader);
+    GLint ret = 0;
+    glGetObjectParameterivARB(shader, GL_OBJECT_COMPILE_STATUS_ARB, &ret);
+    if (ret == 0)
+    {
+        std::cout << "Error creating shader: " << std::endl << "Program Info Log:" << std::endl;
+        _printProgramInfoLog(shader);
+        std::cout << std::endl << "Shader Info Log: " << std::endl;
+        _printShaderInfoLog(shader);
+        return -1;
+    }
+    return shader;
+}
+
+/** How deep #include directives may nest before createShader gives up, which stops an include cycle. */
+static const int MAX_SHADER_INCLUDE_DEPTH = 8;
+
+/**
+ * Replaces each line of the form #include "file" with the contents of that file, read relative to the directory of
+ * the file that includes it. GLSL has no #include of its own, so this is how shaders share declarations such as
+ * the uniform blocks. Throws std::runtime_error if an included file cannot be read.
+ * @param source the GLSL source code to expand
+ * @param filepath the path the source was read from
+ */
+static std::string expandIncludes(const std::string &source, const std::string &filepath, int depth)
+{
+    if (depth > MAX_SHADER_INCLUDE_DEPTH)
+    {
+        throw std::runtime_error("Shader includes nested too deeply in " + filepath);
+    }
+    size_t separator = filepath.find_last_of("/\\");
+    std::string directory = (separator == std::string::npos) ? "" : filepath.substr(0, separator + 1);
+    std::string expanded;
+    size_t lineStart = 0;
+    while (lineStart < source.size())
     {
-        shader = glCreateShader(shaderType);
-        if(shader == 0)
+        size_t lineEnd = source.find('\n', lineStart);
+        lineEnd = (lineEnd == std::string::npos) ? source.size() : lineEnd + 1;
+        size_t first = source.find_first_not_of(" \t", lineStart);
+        size_t open = source.find('"', lineStart);
+        size_t close = (open < lineEnd) ? source.find('"', open + 1) : std::string::npos;
+        if (first < lineEnd && source.compare(first, 8, "#include") == 0 && close < lineEnd)
         {
-            return 0;
+            std::string includePath = directory + source.substr(open + 1, close - open - 1);
+            expanded += expandIncludes(readTextFile(includePath), includePath, depth + 1);
+            expanded += '\n';
         }
-
-        std::string fileContents = readTextFile((*filename));
-        const char* val = fileContents.c_str();
-        GLint len = static_cast<GLint>(fileContents.length());
-        glShaderSourceARB(shader, 1, const_cast<const GLcharARB**>(&val), &len);
-        glCompileShaderARB(shader);
-        GLint ret = 0;
-        glGetObjectParameterivARB(shader, GL_OBJECT_COMPILE_STATUS_ARB, &ret);
-        if (ret == 0)
+        else
         {
-            std::cout << "Error creating shader: " << std::endl << "Program Info Log:" << std::endl;
-            _printProgramInfoLog(shader);
-            std::cout << std::endl << "Shader Info Log: " << std::endl;
-            _printShaderInfoLog(shader);
-            return -1;
+            expanded.append(source, lineStart, lineEnd - lineStart);
         }
-        return shader;
-    }
-    catch(std::runtime_error &exc)
-    {
-        glDeleteObjectARB(shader);
-        return -1;
+        lineStart = lineEnd;
     }
+    return expanded;
 }
 
 /**
  * Attempts to create a shader. This may have either a vertex shader part, fragment shader part, or both.
+ * Lines of the form #include "file" are replaced with that file first.
+ * The linked program is saved to a program cache, and later calls with the same sources on the same driver load
+ * it from there instead of compiling. The sources are hashed after their includes are expanded, so editing an
+ * included file also recompiles.
  * @param vertFilepath a String which has the filepath of the source code to use for the vertex shader, or
  * null if no vertex shader is to be used.
  * @param fragFilepath a String which has the filepath of the source code to use for the fragment shader,
@@ -218,16 +435,43 @@ int createShader(const std::string *filename, gl::GLenum shaderType)
 std::shared_ptr<Shader> createShader(const std::string *vertFilepath, const std::string *fragFilepath)
 {
     using namespace gl;
+    std::string vertSource;
+    std::string fragSource;
+    try
+    {
+        if(vertFilepath)
+        {
+            vertSource = expandIncludes(readTextFile(*vertFilepath), *vertFilepath, 0);
+        }
+        if(fragFilepath)
+        {
+            fragSource = expandIncludes(readTextFile(*fragFilepath), *fragFilepath, 0);
+        }
+    }
+    catch(std::runtime_error &exc)
+    {
+        std::cout << "Error reading shader source: " << exc.what() << std::endl;
+        return std::shared_ptr<Shader>(nullptr);
+    }
+
+    std::string cachePath = getProgramCachePath(vertFilepath, fragFilepath);
+    uint64_t sourceHash = hashProgramSources(vertSource, fragSource);
+    GLuint cachedProgram = loadCachedProgram(cachePath, sourceHash);
+    if(cachedProgram != 0)
+    {
+        return std::shared_ptr<Shader>(new Shader(cachedProgram));
+    }
+
     int program = -1;
     int vertShader = -1;
     int fragShader = -1;
     if(vertFilepath)
     {
-        vertShader = createShader(vertFilepath, GL_VERTEX_SHADER_ARB);
+        vertShader = compileShader(vertSource, GL_VERTEX_SHADER_ARB);
     }
     if(fragFilepath)
     {
-        fragShader = createShader(fragFilepath, GL_FRAGMENT_SHADER_ARB);
+        fragShader = compileShader(fragSource, GL_FRAGMENT_SHADER_ARB);
     }
 
     // Failure case - couldn't create the shader
@@ -251,6 +495,10 @@ std::shared_ptr<Shader> createShader(const std::string *vertFilepath, const std:
         glAttachObjectARB(program, fragShader);
     }
 
+    if(isProgramCacheSupported())
+    {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 1);
+    }
     glLinkProgramARB(program);
     GLint ret = 0;
     glGetObjectParameterivARB(program, GL_OBJECT_LINK_STATUS_ARB, &ret);
@@ -273,9 +521,6 @@ std::shared_ptr<Shader> createShader(const std::string *vertFilepath, const std:
         _printShaderInfoLog(program);
         return std::shared_ptr<Shader>(nullptr);
     }
+    writeProgramCache(cachePath, sourceHash, program);
     return std::shared_ptr<Shader>(new Shader(program));
 }
-
-
-
-
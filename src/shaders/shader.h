@@ -1,9 +1,13 @@
 #ifndef GAME_SHADER_H
 #define GAME_SHADER_H
 
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 #include <glbinding/gl/gl.h>
+#include <glm/mat4x4.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
@@ -19,7 +23,16 @@ protected:
 
 public:
 	/**
-	 * Creates a new Shader, storing the provided programID.
+	 * A uniform resolved ahead of time with getUniform(...), so setting it needs no name lookup. Handles are
+	 * only valid for the Shader that returned them.
+	 */
+	typedef int UniformHandle;
+	/** The handle of a uniform that is not active in the program. Setting it does nothing. */
+	static const UniformHandle INVALID_UNIFORM = -1;
+
+	/**
+	 * Creates a new Shader, storing the provided programID. The program must already be linked; its active uniforms
+	 * are read once here.
 	 * @param programID an integer, generated by OpenGL, that uniquely identifies this shader
 	 */
 	Shader(gl::GLhandleARB
@@ -32,10 +45,35 @@ public:
 	 * Releases this shader, causing OpenGL to stop rendering with it.
 	 */
 	void releaseShader();
-	void glUniform1(std::string attributeName, gl::GLfloat v);
-	void glUniform1(std::string attributeName, gl::GLint v);
-	void glUniform1(std::string attributeName, bool v);
-	void glUniform2(std::string attributeName, gl::GLfloat v0, gl::GLfloat v1);
+	/**
+	 * Gets the handle of an active uniform. Arrays can be looked up by their name, which is their first element, or
+	 * by the name of any element, such as "lights[2]".
+	 * @return the handle, or INVALID_UNIFORM if there is no active uniform with that name
+	 */
+	UniformHandle getUniform(const std::string &uniformName);
+	/**
+	 * Sets a uniform. The program is only bound, and the value only uploaded, if it differs from the last value
+	 * set through this Shader.
+	 */
+	void setUniform(UniformHandle uniform, gl::GLfloat v);
+	void setUniform(UniformHandle uniform, gl::GLint v);
+	void setUniform(UniformHandle uniform, bool v);
+	void setUniform(UniformHandle uniform, glm::vec2 v);
+	void setUniform(UniformHandle uniform, glm::vec3 v);
+	void setUniform(UniformHandle uniform, glm::vec4 v);
+	/**
+	 * Sets consecutive elements of a vec3 array uniform with one call, starting at the element the handle refers to.
+	 * Arrays are always uploaded.
+	 */
+	void setUniform(UniformHandle uniform, const glm::vec3 *values, int count);
+	/**
+	 * Sets a mat4 uniform. Matrices are rarely set to the same value twice in a row, so they are always uploaded.
+	 */
+	void setUniform(UniformHandle uniform, const glm::mat4 &value);
+	void glUniform1(const std::string &attributeName, gl::GLfloat v);
+	void glUniform1(const std::string &attributeName, gl::GLint v);
+	void glUniform1(const std::string &attributeName, bool v);
+	void glUniform2(const std::string &attributeName, gl::GLfloat v0, gl::GLfloat v1);
 	/**
 	 * Assigns the values in a Vector2 to one of the variables in this Shader. The variable in the shader
 	 * should probably also be a vec2 or this might cause strange results. <br>
@@ -45,9 +83,9 @@ public:
 	 * @param v a Vector2 which will have its values assigned to the corresponding uniform variable, with a name of
 	 * attributeName, in the shader.
 	 */
-	void glUniform2(std::string attributeName, glm::vec2 v);
-	void glUniform2(std::string attributeName, gl::GLint v0, gl::GLint v1);
-	void glUniform3(std::string attributeName, gl::GLfloat v0, gl::GLfloat v1, gl::GLfloat v2);
+	void glUniform2(const std::string &attributeName, glm::vec2 v);
+	void glUniform2(const std::string &attributeName, gl::GLint v0, gl::GLint v1);
+	void glUniform3(const std::string &attributeName, gl::GLfloat v0, gl::GLfloat v1, gl::GLfloat v2);
 	/**
 	 * Assigns the values in a Vector3 to one of the variables in this Shader. The variable in the shader
 	 * should probably also be a vec3 or this might cause strange results. <br>
@@ -57,9 +95,9 @@ public:
 	 * @param v a Vector3 which will have its values assigned to the corresponding uniform variable, with a name of
 	 * attributeName, in the shader.
 	 */
-	void glUniform3(std::string attributeName, glm::vec3 v);
-	void glUniform3(std::string attributeName, gl::GLint v0, gl::GLint v1, gl::GLint v2);
-	void glUniform4(std::string attributeName, gl::GLfloat v0, gl::GLfloat v1, gl::GLfloat v2, gl::GLfloat v3);
+	void glUniform3(const std::string &attributeName, glm::vec3 v);
+	void glUniform3(const std::string &attributeName, gl::GLint v0, gl::GLint v1, gl::GLint v2);
+	void glUniform4(const std::string &attributeName, gl::GLfloat v0, gl::GLfloat v1, gl::GLfloat v2, gl::GLfloat v3);
 	/**
 	 * Assigns the values in a Vector4 to one of the variables in this Shader. The variable in the shader
 	 * should probably also be a vec3 or this might cause strange results. <br>
@@ -69,13 +107,38 @@ public:
 	 * @param v a Vector4 which will have its values assigned to the corresponding uniform variable, with a name of
 	 * attributeName, in the shader.
 	 */
-	void glUniform4(std::string attributeName, glm::vec4 v);
-	void glUniform4(std::string attributeName, gl::GLint v0, gl::GLint v1, gl::GLint v2, gl::GLint v3);
+	void glUniform4(const std::string &attributeName, glm::vec4 v);
+	void glUniform4(const std::string &attributeName, gl::GLint v0, gl::GLint v1, gl::GLint v2, gl::GLint v3);
 	//void glUniformMatrix2(std::string attributeName, bool transpose, java.nio.FloatBuffer matrices);
 	//void glUniformMatrix3(std::string attributeName, bool transpose, java.nio.FloatBuffer matrices);
 	//void glUniformMatrix4(std::string attributeName, bool transpose, java.nio.FloatBuffer matrices);
+	/**
+	 * Gets the location of a vertex attribute in this Shader.
+	 * @param attributeName the name of an attribute variable in the vertex shader
+	 * @return the attribute location, or -1 if there is no active attribute with that name
+	 */
+	gl::GLint getAttributeLocation(const std::string &attributeName);
     void printProgramInfoLog();
     void printShaderInfoLog();
+private:
+	/**
+	 * An active uniform, or one element of an active uniform array, and the last value set to it.
+	 */
+	struct UniformSlot
+	{
+		gl::GLint location;
+		/** Whether value holds what the program was last given. */
+		bool hasValue;
+		bool isInteger;
+		int components;
+		std::uint32_t value[4];
+	};
+	std::vector<UniformSlot> uniforms;
+	std::unordered_map<std::string, UniformHandle> uniformHandles;
+	void reflectUniforms();
+	bool needsUpload(UniformHandle uniform, bool isInteger, const void *values, int components);
+	void setInts(UniformHandle uniform, const gl::GLint *values, int components);
+	void setFloats(UniformHandle uniform, const gl::GLfloat *values, int components);
 };
 
 std::shared_ptr<Shader> createShader(const std::string *vertFilepath, const std::string *fragFilepath);
@@ -2,6 +2,7 @@
 #include "shaders/shaderdemo.h"
 #include "graphics/gluhelper.h"
 #include "graphics/windowhelper.h"
+#include "render/glstate.h"
 
 void ShaderDemo::render()
 {
@@ -62,7 +63,7 @@ void ShaderDemo::init(int argc, char **argv)
     glShadeModel(GL_SMOOTH);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClearDepth(1.0f);
-    glEnable(GL_DEPTH_TEST);
+    enableState(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
     glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
 
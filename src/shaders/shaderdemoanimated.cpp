@@ -4,6 +4,7 @@
 #include "graphics/gluhelper.h"
 #include "graphics/windowhelper.h"
 #include "utils/timehelper.h"
+#include "render/glstate.h"
 
 void ShaderDemoAnimated::render()
 {
@@ -50,7 +51,7 @@ void ShaderDemoAnimated::init(int argc, char **argv)
     glShadeModel(GL_SMOOTH);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClearDepth(1.0f);
-    glEnable(GL_DEPTH_TEST);
+    enableState(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
     glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
 
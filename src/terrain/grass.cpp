@@ -1,4 +1,7 @@
 #include <cmath>
+#include <iostream>
+#include <algorithm>
+#include <glm/glm.hpp>
 #include "math/gamemath.h"
 #include "terrain/grass.h"
 #include "utils/random.h"
@@ -7,15 +10,42 @@
 #include "utils/fileutils.h"
 #include "graphics/gluhelper.h"
 #include "graphics/terrainpolygon.h"
+#include "render/glstate.h"
+#include "render/matrixstack.h"
+#include "render/meshprogram.h"
+#include "render/uniformblocks.h"
+#include "math/frustum.h"
+#include "graphics/rendersettingshelper.h"
+
+/** How far a grass cluster can reach past its instance position, including scale and wind. */
+const float GRASS_CLUSTER_RADIUS = 1.2f;
+/** The height of the tallest grass cluster, including scale. */
+const float GRASS_CLUSTER_HEIGHT = 0.8f;
+
+GrassChunk::GrassChunk(AABB bounds, int firstInstance, int instanceCount) : bounds(bounds), firstInstance(firstInstance),
+    instanceCount(instanceCount), lodLevel(GRASS_LOD_LEVELS)
+{
+}
 
 Grass::Grass(int density, glm::vec3 center, glm::vec3 randomizationOffsets, float range, std::shared_ptr<Texture> texture) : texture(texture), density(density), vbo(std::shared_ptr<VBO>(nullptr)),
-    windDirection(glm::vec3(0, 0, 0)), maxTimeOfCurrentBurst(0), remainingTime(0), timeUntilNextBurst(0), previousTime(getCurrentTimeMillis()), deltaTime(0),
+    instanceBufferID(0), instancePositionLocation(-1), instanceVariationLocation(-1), textureUniform(Shader::INVALID_UNIFORM),
+    fieldCenterUniform(Shader::INVALID_UNIFORM), fieldExtentUniform(Shader::INVALID_UNIFORM), windDirection(glm::vec3(0, 0, 0)),
+    maxTimeOfCurrentBurst(0), remainingTime(0), timeUntilNextBurst(0), previousTime(getCurrentTimeMillis()), deltaTime(0),
 	grassShader(std::shared_ptr<Shader>(nullptr)), maxWindPower(0), randomizationOffsets(randomizationOffsets)
 {
     seedRandomGenerator();
     createVBO(center, range);
 }
 
+Grass::~Grass()
+{
+    if(instanceBufferID != 0)
+    {
+        gl::glDeleteBuffers(1, &instanceBufferID);
+        notifyBufferDeleted(instanceBufferID);
+    }
+}
+
 void Grass::update()
 {
     unsigned long long previousUpdateTime = previousTime;
@@ -28,6 +58,7 @@ void Grass::update()
         generateNewWind();
     }
     this->previousTime = currentTime;
+    getFrameConstants().wind = glm::vec4(windDirection, getWindPower());
 }
 
 void Grass::generateNewWind()
@@ -43,46 +74,72 @@ void Grass::generateNewWind()
 void Grass::draw(Camera *camera)
 {
     using namespace gl;
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_NORMAL_ARRAY);
-    glEnableClientState(GL_COLOR_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-    glDisable(GL_BLEND);
-    glAlphaFunc(GL_GREATER, 0.1f);
-    glEnable(GL_ALPHA_TEST);
-
-    glDisable(GL_CULL_FACE);
-    glLoadIdentity();
-    glEnable(GL_TEXTURE_2D);
-    glScalef(1.0f,1.0f,1.0f);
-    glColor3f(1.0f, 1.0f, 1.0f);
-    // Translate to model co-ordinates, based on the origin of the shape
-    setLookAt(camera);
+    disableState(GL_BLEND);
+    setAlphaFunc(GL_GREATER, 0.1f);
+    enableState(GL_ALPHA_TEST);
+    disableState(GL_CULL_FACE);
 
-    if(grassShader)
+    Frustum frustum = createCameraFrustum(camera, getAspectRatio());
+    glm::vec3 cameraPosition = camera->getPosition();
+    if(instanceBufferID != 0)
     {
-        float power = getWindPower();
-        vbo->hasTextureData = false;
-        glEnable(GL_TEXTURE_2D);
+        // The wind and the view come from the FrameConstants block, set in update() and once per frame.
         grassShader->bindShader();
-        grassShader->glUniform1("texture1", 0);
-        grassShader->glUniform3("windDirection", windDirection);
-        grassShader->glUniform1("windPower", power);
-        glActiveTexture(GL_TEXTURE0);
-        vbo->associatedTexture->bind();
+        grassShader->setUniform(textureUniform, 0);
+        grassShader->setUniform(fieldCenterUniform, fieldCenter);
+        grassShader->setUniform(fieldExtentUniform, fieldExtent);
+        setActiveTexture(GL_TEXTURE0);
+        vbo->bind();
+
+        // The instance attributes are part of the grass VBO's vertex array object, which nothing else draws with.
+        bindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+        glEnableVertexAttribArray(instancePositionLocation);
+        glEnableVertexAttribArray(instanceVariationLocation);
+        glVertexAttribDivisor(instancePositionLocation, 1);
+        glVertexAttribDivisor(instanceVariationLocation, 1);
+        for(GrassChunk &chunk : chunks)
+        {
+            updateChunkLOD(chunk, cameraPosition);
+            if(chunk.lodLevel >= GRASS_LOD_LEVELS || !frustum.intersects(chunk.bounds))
+            {
+                continue;
+            }
+            int count = static_cast<int>(ceil(chunk.instanceCount * GRASS_LOD_DENSITY[chunk.lodLevel]));
+            // Point the instance attributes at this chunk's slice of the buffer.
+            size_t offset = chunk.firstInstance * sizeof(GrassInstance);
+            glVertexAttribPointer(instancePositionLocation, 3, GL_SHORT, GL_TRUE, sizeof(GrassInstance), (void*)(offset));
+            glVertexAttribPointer(instanceVariationLocation, 2, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GrassInstance), (void*)(offset + 3 * sizeof(GLshort)));
+            vbo->drawInstanced(count);
+        }
     }
-    vbo->draw(camera);
-    if(grassShader)
+    else
     {
-        grassShader->releaseShader();
+        // No shader to place the instances, so fall back to one unanimated draw per cluster.
+        glLoadIdentity();
+        enableState(GL_TEXTURE_2D);
+        glColor3f(1.0f, 1.0f, 1.0f);
+        setLookAt(camera);
+        MatrixStack &modelMatrices = getModelMatrixStack();
+        for(GrassChunk &chunk : chunks)
+        {
+            updateChunkLOD(chunk, cameraPosition);
+            if(chunk.lodLevel >= GRASS_LOD_LEVELS || !frustum.intersects(chunk.bounds))
+            {
+                continue;
+            }
+            int count = static_cast<int>(ceil(chunk.instanceCount * GRASS_LOD_DENSITY[chunk.lodLevel]));
+            for(int i = chunk.firstInstance; i < chunk.firstInstance + count; i++)
+            {
+                glm::vec3 position = getInstancePosition(instances[i]);
+                modelMatrices.push();
+                modelMatrices.translate(position.x, position.y, position.z);
+                vbo->draw(camera);
+                modelMatrices.pop();
+            }
+        }
     }
-    glEnable(GL_CULL_FACE);
-    glDisable(GL_ALPHA_TEST);
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_NORMAL_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    enableState(GL_CULL_FACE);
+    disableState(GL_ALPHA_TEST);
 }
 
 inline void putGrassCluster(FlexArray<float> &combinedData, int index, glm::vec3 o/*offset*/)
@@ -318,30 +375,9 @@ void Grass::createVBO(glm::vec3 center, float range)
     GLuint totalElementsOfData = 3 + 3 + 4 + 2;
 
     /// 4 verts per quad; 3 quads per cluster = 12 verts. 12 floating point values per vert.
-    /// total: 144 floats / glass cluster.
-    /// use [floor(sqrt(density)) + 1] * 2 number of nodes.
-    int numberPerDimension = static_cast<int>(sqrt(density)) + 1;
-    int numberOfClusters = (numberPerDimension * numberPerDimension);
-    FlexArray<float> combinedData(144 * numberOfClusters);
-    int cx = center.x;
-    int cz = center.z;
-    int minX = cx - range;
-    int minZ = cz - range;
-    int maxX = cx + range;
-    int maxZ = cz + range;
-    for(int i = 0; i < numberPerDimension; i++)
-    {
-        for(int j = 0; j < numberPerDimension; j++)
-        {
-            int index = i * numberPerDimension + j;
-            glm::vec3 v(
-				((range * 2) / numberPerDimension) * i + minX + randomizationOffsets.x * getRandomFloat(),
-				0 + randomizationOffsets.y * getRandomFloat(),
-				((range * 2) / numberPerDimension) * j + minZ + randomizationOffsets.z * getRandomFloat()
-			);
-            putGrassCluster(combinedData, index * 144, v);
-        }
-    }
+    /// Only one cluster is stored; every cluster in the field is an instance of it.
+    FlexArray<float> combinedData(144);
+    putGrassCluster(combinedData, 0, glm::vec3(0, 0, 0));
     MeshData data(GL_QUADS,
         std::shared_ptr<Material>(nullptr),
         4,
@@ -359,6 +395,132 @@ void Grass::createVBO(glm::vec3 center, float range)
 	std::string vertPath = buildPath("res/grassy_wind.vert");
 	std::string fragPath = buildPath("res/grassy_wind.frag");
     this->grassShader = createShader(&vertPath, &fragPath);
+    createInstances(center, range);
+}
+
+/**
+ * Scatters the grass clusters over the field, sorts them into chunks and uploads them to the instance buffer. The
+ * layout matches the one the field used when every cluster was baked into the VBO: a jittered grid with
+ * [floor(sqrt(density)) + 1] clusters along each side.
+ */
+void Grass::createInstances(glm::vec3 center, float range)
+{
+    using namespace gl;
+    int numberPerDimension = static_cast<int>(sqrt(density)) + 1;
+    int cx = center.x;
+    int cz = center.z;
+    int minX = cx - range;
+    int minZ = cz - range;
+    // Positions are quantized against the bounds of the field, including the random jitter.
+    glm::vec3 minimum(minX, 0, minZ);
+    glm::vec3 maximum(minX + range * 2 + randomizationOffsets.x, randomizationOffsets.y, minZ + range * 2 + randomizationOffsets.z);
+    fieldCenter = (minimum + maximum) * 0.5f;
+    fieldExtent = glm::max((maximum - minimum) * 0.5f, glm::vec3(0.0001f));
+
+    int chunksX = static_cast<int>(ceil((maximum.x - minimum.x) / GRASS_CHUNK_SIZE));
+    int chunksZ = static_cast<int>(ceil((maximum.z - minimum.z) / GRASS_CHUNK_SIZE));
+    std::vector<std::vector<glm::vec3>> positionsByChunk(chunksX * chunksZ);
+    for(int i = 0; i < numberPerDimension; i++)
+    {
+        for(int j = 0; j < numberPerDimension; j++)
+        {
+            glm::vec3 v(
+				((range * 2) / numberPerDimension) * i + minX + randomizationOffsets.x * getRandomFloat(),
+				0 + randomizationOffsets.y * getRandomFloat(),
+				((range * 2) / numberPerDimension) * j + minZ + randomizationOffsets.z * getRandomFloat()
+			);
+            int chunkX = std::min(static_cast<int>((v.x - minimum.x) / GRASS_CHUNK_SIZE), chunksX - 1);
+            int chunkZ = std::min(static_cast<int>((v.z - minimum.z) / GRASS_CHUNK_SIZE), chunksZ - 1);
+            positionsByChunk[chunkX * chunksZ + chunkZ].push_back(v);
+        }
+    }
+
+    instances.clear();
+    instances.reserve(numberPerDimension * numberPerDimension);
+    chunks.clear();
+    for(std::vector<glm::vec3> &positions : positionsByChunk)
+    {
+        if(positions.empty())
+        {
+            continue;
+        }
+        // Shuffle so that any prefix of the chunk is an even sample of the whole chunk.
+        for(int i = static_cast<int>(positions.size()) - 1; i > 0; i--)
+        {
+            std::swap(positions[i], positions[getRandomInt(i + 1)]);
+        }
+        glm::vec3 low = positions[0];
+        glm::vec3 high = positions[0];
+        int firstInstance = static_cast<int>(instances.size());
+        for(glm::vec3 &v : positions)
+        {
+            low = glm::min(low, v);
+            high = glm::max(high, v);
+            glm::vec3 normalized = glm::clamp((v - fieldCenter) / fieldExtent, glm::vec3(-1.0f), glm::vec3(1.0f));
+            GrassInstance instance;
+            instance.x = static_cast<GLshort>(normalized.x * 32767.0f);
+            instance.y = static_cast<GLshort>(normalized.y * 32767.0f);
+            instance.z = static_cast<GLshort>(normalized.z * 32767.0f);
+            instance.seed = static_cast<GLubyte>(getRandomInt(256));
+            instance.scale = static_cast<GLubyte>(getRandomInt(256));
+            instances.push_back(instance);
+        }
+        AABB bounds(low.x - GRASS_CLUSTER_RADIUS, low.y, low.z - GRASS_CLUSTER_RADIUS,
+            high.x + GRASS_CLUSTER_RADIUS, high.y + GRASS_CLUSTER_HEIGHT, high.z + GRASS_CLUSTER_RADIUS);
+        chunks.push_back(GrassChunk(bounds, firstInstance, static_cast<int>(positions.size())));
+    }
+
+    if(grassShader)
+    {
+        instancePositionLocation = grassShader->getAttributeLocation("instancePosition");
+        instanceVariationLocation = grassShader->getAttributeLocation("instanceVariation");
+        textureUniform = grassShader->getUniform("texture1");
+        fieldCenterUniform = grassShader->getUniform("fieldCenter");
+        fieldExtentUniform = grassShader->getUniform("fieldExtent");
+    }
+    // The shader reads the VBO through the core path's generic attributes.
+    if(!grassShader || !isCoreRenderPathActive() || instancePositionLocation < 0 || instanceVariationLocation < 0)
+    {
+        std::cout << "Grass shader unavailable, grass will be drawn without instancing." << std::endl;
+        return;
+    }
+    glGenBuffers(1, &instanceBufferID);
+    bindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(GrassInstance), instances.data(), GL_STATIC_DRAW);
+}
+
+/**
+ * Picks the density level of a chunk from the distance between the camera and the nearest point of the chunk. A
+ * chunk keeps its current level for as long as that level is still valid within GRASS_LOD_HYSTERESIS of the
+ * actual distance.
+ */
+void Grass::updateChunkLOD(GrassChunk &chunk, glm::vec3 cameraPosition)
+{
+    glm::vec3 nearest = glm::clamp(cameraPosition,
+        glm::vec3(chunk.bounds.xMin, chunk.bounds.yMin, chunk.bounds.zMin),
+        glm::vec3(chunk.bounds.xMax, chunk.bounds.yMax, chunk.bounds.zMax));
+    float distance = glm::length(nearest - cameraPosition);
+    auto levelForDistance = [](float d)
+    {
+        int level = 0;
+        while(level < GRASS_LOD_LEVELS && d >= GRASS_LOD_DISTANCE[level])
+        {
+            level++;
+        }
+        return level;
+    };
+    int finest = levelForDistance(distance - GRASS_LOD_HYSTERESIS);
+    int coarsest = levelForDistance(distance + GRASS_LOD_HYSTERESIS);
+    if(chunk.lodLevel < finest || chunk.lodLevel > coarsest)
+    {
+        chunk.lodLevel = levelForDistance(distance);
+    }
+}
+
+glm::vec3 Grass::getInstancePosition(const GrassInstance &instance)
+{
+    glm::vec3 normalized(instance.x / 32767.0f, instance.y / 32767.0f, instance.z / 32767.0f);
+    return fieldCenter + normalized * fieldExtent;
 }
 
 float Grass::getWindPower()
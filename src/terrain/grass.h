@@ -2,22 +2,82 @@
 #define ENG_GRASS_GEN_H
 
 #include <memory>
+#include <vector>
+#include <glbinding/gl/gl.h>
 #include <glm/vec3.hpp>
 #include "graphics/camera.h"
+#include "physics/aabb.h"
 #include "render/vbo.h"
 #include "render/texture.h"
 #include "shaders/shader.h"
 
+/**
+ * The per-instance data of one grass cluster, packed into 8 bytes. The position is stored as normalized shorts
+ * relative to the centre and extent of the grass field, and is expanded again in grassy_wind.vert.
+ */
+struct GrassInstance
+{
+    gl::GLshort x;
+    gl::GLshort y;
+    gl::GLshort z;
+    /** Random value used to rotate the cluster and vary the wind. */
+    gl::GLubyte seed;
+    /** Random value used to scale the cluster. */
+    gl::GLubyte scale;
+};
+
+/**
+ * A square section of the grass field. The instances of a chunk are stored contiguously and in random order, so
+ * drawing only the first N of them gives an evenly thinned out patch of grass.
+ */
+struct GrassChunk
+{
+    AABB bounds;
+    int firstInstance;
+    int instanceCount;
+    /** The current density level; an index into GRASS_LOD_DENSITY, or GRASS_LOD_LEVELS if the chunk is too far to draw. */
+    int lodLevel;
+    GrassChunk(AABB bounds, int firstInstance, int instanceCount);
+};
+
+/** The number of density levels a grass chunk can be drawn at. */
+const int GRASS_LOD_LEVELS = 3;
+/** The fraction of a chunk's instances drawn at each density level. */
+const float GRASS_LOD_DENSITY[GRASS_LOD_LEVELS] = { 1.0f, 0.5f, 0.15f };
+/** The camera distance up to which each density level is used. Past the last one a chunk is not drawn. */
+const float GRASS_LOD_DISTANCE[GRASS_LOD_LEVELS] = { 25.0f, 50.0f, 90.0f };
+/** How far past a LOD boundary the camera must move before a chunk switches level, to prevent flickering. */
+const float GRASS_LOD_HYSTERESIS = 4.0f;
+/** The width and depth of a grass chunk in world units. */
+const float GRASS_CHUNK_SIZE = 16.0f;
+
+/**
+ * Grass draws a field of grass clusters. A single cluster mesh is kept in a VBO and drawn once per GrassInstance
+ * using hardware instancing; the wind shader places and animates each instance. The field is split into
+ * GrassChunks which are culled against the view frustum and drawn at a density chosen by distance to the camera.
+ */
 class Grass
 {
 public:
     Grass(int density, glm::vec3 center, glm::vec3 randomizationOffsets, float range, std::shared_ptr<Texture> texture);
+    ~Grass();
     void update();
     void draw(Camera *camera);
 private:
     std::shared_ptr<Texture> texture;
     int density;
+    /** The mesh of one grass cluster, centred on the origin. */
     std::shared_ptr<VBO> vbo;
+    std::vector<GrassInstance> instances;
+    std::vector<GrassChunk> chunks;
+    gl::GLuint instanceBufferID;
+    glm::vec3 fieldCenter;
+    glm::vec3 fieldExtent;
+    gl::GLint instancePositionLocation;
+    gl::GLint instanceVariationLocation;
+    Shader::UniformHandle textureUniform;
+    Shader::UniformHandle fieldCenterUniform;
+    Shader::UniformHandle fieldExtentUniform;
     glm::vec3 windDirection;
     float maxTimeOfCurrentBurst;
     float remainingTime;
@@ -30,6 +90,9 @@ private:
     float getWindPower();
     void generateNewWind();
     void createVBO(glm::vec3 center, float range);
+    void createInstances(glm::vec3 center, float range);
+    glm::vec3 getInstancePosition(const GrassInstance &instance);
+    void updateChunkLOD(GrassChunk &chunk, glm::vec3 cameraPosition);
 };
 
 
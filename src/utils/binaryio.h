@@ -0,0 +1,95 @@
+#ifndef ENGINE_BINARY_IO_H
+#define ENGINE_BINARY_IO_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+///
+/// Helpers for the engine's binary cache files, which are flat, native endian and read straight out of a
+/// MappedFile. Strings are a uint32 length followed by the characters.
+///
+
+/**
+ * Appends the bytes of a trivially copyable value to a buffer.
+ */
+template<typename T>
+void appendValue(std::vector<char> &buffer, T value)
+{
+	const char *bytes = reinterpret_cast<const char*>(&value);
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+inline void appendBytes(std::vector<char> &buffer, const void *data, size_t bytes)
+{
+	const char *begin = static_cast<const char*>(data);
+	buffer.insert(buffer.end(), begin, begin + bytes);
+}
+
+inline void appendString(std::vector<char> &buffer, const std::string &value)
+{
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(value.size()));
+	appendBytes(buffer, value.data(), value.size());
+}
+
+/**
+ * Hashes bytes with 64 bit FNV-1a, used to tell whether the source of a cache file has changed.
+ */
+inline uint64_t hashBytes(const char *data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+	}
+	return hash;
+}
+
+/**
+ * BinaryReader reads values in order from a block of memory. Reading past the end throws std::runtime_error, so a
+ * truncated file is never read out of bounds.
+ */
+class BinaryReader
+{
+public:
+	BinaryReader(const char *data, size_t size) : data(data), size(size), position(0)
+	{
+	}
+
+	/**
+	 * Skips over a number of bytes.
+	 * @return the first of the skipped bytes
+	 */
+	const char *take(size_t bytes)
+	{
+		if (bytes > size - position)
+		{
+			throw std::runtime_error("Unexpected end of file");
+		}
+		const char *start = data + position;
+		position += bytes;
+		return start;
+	}
+
+	template<typename T>
+	T read()
+	{
+		T value;
+		std::memcpy(&value, take(sizeof(T)), sizeof(T));
+		return value;
+	}
+
+	std::string readString()
+	{
+		uint32_t length = read<uint32_t>();
+		return std::string(take(length), length);
+	}
+private:
+	const char *data;
+	size_t size;
+	size_t position;
+};
+
+#endif
@@ -3,6 +3,7 @@
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <sys/stat.h>
 #include "fileutils.h"
 
 std::string readTextFile(std::string filepath)
@@ -54,6 +55,39 @@ std::vector<std::string> readTextFileAsLines(std::string filepath)
     return out;
 }
 
+void writeBinaryFile(std::string filepath, const std::vector<char> &contents)
+{
+    std::ofstream file(filepath.c_str(), std::ios::binary | std::ios::trunc);
+    if(file.fail())
+    {
+        std::stringstream ss;
+        ss << "Failure to open file at " << filepath;
+        throw std::runtime_error(ss.str());
+    }
+    file.write(contents.data(), contents.size());
+    file.close();
+}
+
+bool getFileStatus(std::string filepath, FileStatus &status)
+{
+#ifdef _WIN32
+    struct _stat64 result;
+    if(_stat64(filepath.c_str(), &result) != 0)
+    {
+        return false;
+    }
+#else
+    struct stat result;
+    if(stat(filepath.c_str(), &result) != 0)
+    {
+        return false;
+    }
+#endif
+    status.size = static_cast<long long>(result.st_size);
+    status.modifiedTime = static_cast<long long>(result.st_mtime);
+    return true;
+}
+
 std::string buildPath(std::string path)
 {
 #ifdef _WIN32
@@ -16,6 +16,27 @@ void writeTextFile(std::string filepath, std::string contents);
  * Reads the contents of a text file, adding each line as a separate string in a vector.
  */
 std::vector<std::string> readTextFileAsLines(std::string filepath);
+/**
+ * Writes raw bytes to a file, replacing its contents. Throws std::runtime_error if the file fails to open.
+ */
+void writeBinaryFile(std::string filepath, const std::vector<char> &contents);
+
+/**
+ * The size and last modification time of a file, used to tell whether a file derived from it is stale.
+ */
+struct FileStatus
+{
+	long long size;
+	long long modifiedTime;
+};
+
+/**
+ * Gets the size and last modification time of a file.
+ * @param filepath the file to look at
+ * @param status receives the size and modification time
+ * @return true if the file exists, otherwise false and status is left unchanged
+ */
+bool getFileStatus(std::string filepath, FileStatus &status);
 
 /*
  * Builds a filepath using the OS dependent resource directory and then appending the provided path. 
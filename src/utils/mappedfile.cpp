@@ -0,0 +1,130 @@
+#include <sstream>
+#include <stdexcept>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "utils/mappedfile.h"
+
+static void throwMappingError(const std::string &filepath)
+{
+	std::stringstream ss;
+	ss << "Failure to map file at " << filepath;
+	throw std::runtime_error(ss.str());
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string filepath) : contents(nullptr), contentSize(0), fileHandle(INVALID_HANDLE_VALUE),
+	mappingHandle(nullptr)
+{
+	fileHandle = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		throwMappingError(filepath);
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		CloseHandle(fileHandle);
+		throwMappingError(filepath);
+	}
+	contentSize = static_cast<size_t>(fileSize.QuadPart);
+	if (contentSize == 0)
+	{
+		// Empty files cannot be mapped, but there is nothing to read either.
+		return;
+	}
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle)
+	{
+		contents = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (!contents)
+	{
+		if (mappingHandle)
+		{
+			CloseHandle(mappingHandle);
+		}
+		CloseHandle(fileHandle);
+		throwMappingError(filepath);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (contents)
+	{
+		UnmapViewOfFile(contents);
+	}
+	if (mappingHandle)
+	{
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(fileHandle);
+	}
+}
+
+#else
+
+MappedFile::MappedFile(std::string filepath) : contents(nullptr), contentSize(0), fileDescriptor(-1)
+{
+	fileDescriptor = open(filepath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		throwMappingError(filepath);
+	}
+	struct stat status;
+	if (fstat(fileDescriptor, &status) != 0)
+	{
+		close(fileDescriptor);
+		throwMappingError(filepath);
+	}
+	contentSize = static_cast<size_t>(status.st_size);
+	if (contentSize == 0)
+	{
+		// Empty files cannot be mapped, but there is nothing to read either.
+		return;
+	}
+	void *mapping = mmap(nullptr, contentSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapping == MAP_FAILED)
+	{
+		close(fileDescriptor);
+		throwMappingError(filepath);
+	}
+	// The file is read front to back, so let the kernel read ahead aggressively.
+	madvise(mapping, contentSize, MADV_SEQUENTIAL);
+	contents = static_cast<const char*>(mapping);
+}
+
+MappedFile::~MappedFile()
+{
+	if (contents)
+	{
+		munmap(const_cast<char*>(contents), contentSize);
+	}
+	if (fileDescriptor >= 0)
+	{
+		close(fileDescriptor);
+	}
+}
+
+#endif
+
+const char *MappedFile::data() const
+{
+	return contents;
+}
+
+size_t MappedFile::size() const
+{
+	return contentSize;
+}
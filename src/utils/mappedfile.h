@@ -0,0 +1,41 @@
+#ifndef ENGINE_MAPPED_FILE_H
+#define ENGINE_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * MappedFile maps a whole file read-only into the address space of the process, so its contents can be read in
+ * place without copying them into a buffer first. The mapping lasts as long as the MappedFile.
+ */
+class MappedFile
+{
+public:
+	/**
+	 * Maps a file. Throws std::runtime_error if the file fails to open or cannot be mapped.
+	 * @param filepath the file to map
+	 */
+	MappedFile(std::string filepath);
+	~MappedFile();
+	/**
+	 * Gets the first byte of the file, or nullptr if the file is empty.
+	 */
+	const char *data() const;
+	/**
+	 * Gets the size of the file, in bytes.
+	 */
+	size_t size() const;
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	const char *contents;
+	size_t contentSize;
+#ifdef _WIN32
+	void *fileHandle;
+	void *mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
+
+#endif
@@ -1,188 +1,313 @@
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <memory>
 #include <sstream>
+#include <thread>
 #include <glbinding/gl/gl.h>
 #include "objparser.h"
 #include "world/meshbuilder.h"
+#include "world/meshcache.h"
+#include "world/meshoptimizer.h"
+#include "world/meshsimplifier.h"
 #include "utils/colour.h"
 #include "utils/fileutils.h"
-#include "utils/misc.h"
+#include "utils/mappedfile.h"
 #include "utils/materialparser.h"
 
-ObjParser::ObjParser(std::string filePath, std::string fileName, std::string textureName, bool dataIsTriangles) : filePath(filePath), fileName(fileName), textureName(textureName), modelName("")
+/**
+ * One face of an OBJ file with the raw, 1 based indices of up to four corners. A component missing from a corner,
+ * such as the texture in "1//3", is 0.
+ */
+struct OBJFace
 {
-    loadData(dataIsTriangles);
+    int vertex[4];
+    int texture[4];
+    int normal[4];
+    int cornerCount;
+    /** Whether the first corner has a normal index, which decides whether the face contributes normals at all. */
+    bool hasNormals;
+};
+
+enum class OBJDirective
+{
+    Object,
+    UseMaterial,
+    MaterialLibrary
+};
+
+/**
+ * An "o", "g", "usemtl" or "mtllib" line. It takes effect before the face of its chunk at faceIndex.
+ */
+struct OBJEvent
+{
+    OBJDirective directive;
+    std::string name;
+    size_t faceIndex;
+};
+
+/**
+ * Everything read from one line aligned chunk of an OBJ file, in file order.
+ */
+struct OBJChunk
+{
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> textureCoords;
+    std::vector<OBJFace> faces;
+    std::vector<OBJEvent> events;
+    int malformedValues;
+};
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
 }
 
-std::shared_ptr<Model> ObjParser::exportModel()
+static const char *skipSpaces(const char *p, const char *end)
 {
-    return std::shared_ptr<Model>(new Model(meshes));
+    while (p < end && isSpace(*p))
+    {
+        p++;
+    }
+    return p;
 }
 
-void ObjParser::loadData(bool dataIsTriangles)
+static const char *skipToken(const char *p, const char *end)
 {
-    using namespace gl;
-    GLenum renderMode = (dataIsTriangles) ? GL_TRIANGLES : GL_QUADS;
-	std::vector<glm::vec3> vertices;
-	std::vector<glm::vec3> normals;
-	std::vector<Colour> colours;
-	std::vector<glm::vec2> textureCoords;
-	std::vector<glm::vec3> faceVerts;
-	std::vector<glm::vec3> faceNormals;
-	std::vector<glm::vec3> faceTextures;
-    std::vector<std::string> fileContents = readTextFileAsLines(fileName);
-    std::string line;
-    bool hasEncounteredMesh = false;
-    std::string meshName = "";
-    std::shared_ptr<Material> activeMaterial(nullptr);
+    while (p < end && !isSpace(*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+/** The longest number parseFloat(...) reads; OBJ exporters write far fewer digits than this. */
+static const size_t MAX_NUMBER_LENGTH = 63;
+
+static float parseFloat(const char *&p, const char *end, int &malformedValues)
+{
+    p = skipSpaces(p, end);
+    const char *tokenEnd = skipToken(p, end);
+    // The mapped file is not null terminated, so the token is copied out for strtof to stop at.
+    char number[MAX_NUMBER_LENGTH + 1];
+    size_t length = std::min(static_cast<size_t>(tokenEnd - p), MAX_NUMBER_LENGTH);
+    std::memcpy(number, p, length);
+    number[length] = '\0';
+    char *numberEnd;
+    float value = std::strtof(number, &numberEnd);
+    if (numberEnd == number)
+    {
+        malformedValues++;
+        p = tokenEnd;
+        return 0.0f;
+    }
+    p += numberEnd - number;
+    return value;
+}
+
+/**
+ * Parses an optional integer directly at p. An empty component is 0.
+ */
+static int parseIndex(const char *&p, const char *end)
+{
+    bool negative = (p < end && *p == '-');
+    const char *digits = negative ? p + 1 : p;
+    if (digits == end || *digits < '0' || *digits > '9')
+    {
+        return 0;
+    }
+    int value = 0;
+    for (p = digits; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        value = value * 10 + (*p - '0');
+    }
+    return negative ? -value : value;
+}
 
-    for(unsigned int i = 0; i < fileContents.size(); i++)
+/**
+ * Parses the corners of an "f" line, each of the form v, v/t, v//n or v/t/n.
+ */
+static void parseFace(const char *p, const char *end, OBJFace &face)
+{
+    face.cornerCount = 0;
+    face.hasNormals = false;
+    while (true)
     {
-        line = fileContents[i];
-        std::vector<std::string> splitLine = split(line, ' ');
-        if (line.find("o ") == 0 || line.find("g ") == 0) // startsWith
+        p = skipSpaces(p, end);
+        if (p == end || face.cornerCount == 4)
+        {
+            return;
+        }
+        int corner = face.cornerCount++;
+        int components = 1;
+        face.vertex[corner] = parseIndex(p, end);
+        face.texture[corner] = 0;
+        face.normal[corner] = 0;
+        if (p < end && *p == '/')
         {
-            if(hasEncounteredMesh)
+            p++;
+            components++;
+            face.texture[corner] = parseIndex(p, end);
+            if (p < end && *p == '/')
             {
-                std::shared_ptr<MeshData> data = createModelDataFromParsedOBJ(
-                    renderMode,
-                    activeMaterial,
-                    meshName,
-                    3, GL_FLOAT,
-                    GL_FLOAT,
-                    4,	GL_FLOAT,
-                    2, GL_FLOAT,
-                    make1DFlex(vertices),
-                    make1DFlex(faceVerts),
-                    make1DFlex(normals, vertices.size()),
-                    make1DFlex(faceNormals),
-                    FlexArray<Colour>(),
-                    make1DFlex(textureCoords),
-                    make1DFlex(faceTextures)
-                );
-                meshes.push_back(data);
-              //  vertices = std::vector<glm::vec3>();
-              //  normals = std::vector<glm::vec3>();
-              //  colours = std::vector<Colour>();
-                //textureCoords = std::vector<glm::vec2>();
-                faceVerts = std::vector<glm::vec3>();
-                faceNormals = std::vector<glm::vec3>();
-                faceTextures = std::vector<glm::vec3>();
+                p++;
+                components++;
+                face.normal[corner] = parseIndex(p, end);
             }
-            hasEncounteredMesh = true;
-            std::cout << "MeshName: >" << splitLine.at(1) << "<" << std::endl;
-            meshName = splitLine.at(1);
-           // std::cout << "MeshName:>>" << meshName << "<<" <<  std::endl;
         }
-        else if (line.find("v ") == 0)
+        if (corner == 0)
         {
-            vertices.push_back(glm::vec3(parseDouble(splitLine.at(1)),
-                                    parseDouble(splitLine.at(2)),
-                                    parseDouble(splitLine.at(3))));
+            face.hasNormals = components > 2;
         }
-        else if (line.find("vn ") == 0)
+        p = skipToken(p, end);
+    }
+}
+
+/**
+ * Reads the first whitespace separated word after a keyword.
+ */
+static std::string parseName(const char *p, const char *end)
+{
+    p = skipSpaces(p, end);
+    return std::string(p, skipToken(p, end));
+}
+
+static bool startsWith(const char *p, const char *end, const char *keyword, size_t length)
+{
+    return static_cast<size_t>(end - p) >= length && std::memcmp(p, keyword, length) == 0;
+}
+
+/**
+ * Parses a range of an OBJ file that starts at the beginning of a line and ends just after a newline, or at the
+ * end of the file. Nothing is allocated per line; numbers are read in place.
+ */
+static void parseOBJChunk(const char *begin, const char *end, OBJChunk &chunk)
+{
+    chunk.malformedValues = 0;
+    const char *line = begin;
+    while (line < end)
+    {
+        const char *lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!lineEnd)
         {
-            normals.push_back(glm::vec3(parseDouble(splitLine.at(1)),
-                    parseDouble(splitLine.at(2)),
-                    parseDouble(splitLine.at(3))));
+            lineEnd = end;
         }
-        else if (line.find("vt ") == 0)
+        const char *p = line;
+        line = lineEnd + 1;
+
+        if (startsWith(p, lineEnd, "v ", 2))
         {
-            textureCoords.push_back(
-                glm::vec2(
-                    parseDouble(splitLine.at(1)),
-                    parseDouble(splitLine.at(2))
-                )
-            );
+            p += 2;
+            float x = parseFloat(p, lineEnd, chunk.malformedValues);
+            float y = parseFloat(p, lineEnd, chunk.malformedValues);
+            float z = parseFloat(p, lineEnd, chunk.malformedValues);
+            chunk.vertices.push_back(glm::vec3(x, y, z));
         }
-        else if (line.find("f ") == 0)
+        else if (startsWith(p, lineEnd, "vn ", 3))
         {
-            if(dataIsTriangles)
-            {
-                std::vector<std::string> firstVert = split(splitLine.at(1), '/');
-                std::vector<std::string> secondVert = split(splitLine.at(2), '/');
-                std::vector<std::string> thirdVert = split(splitLine.at(3), '/');
-                faceVerts.push_back(glm::vec3(static_cast<int>(parseDouble(firstVert.at(0))),
-                        static_cast<int>(parseDouble(secondVert.at(0))),
-                        static_cast<int>(parseDouble(thirdVert.at(0)))));
-                faceTextures.push_back(glm::vec3(static_cast<int>(parseDouble(firstVert.at(1))),
-                        static_cast<int>(parseDouble(secondVert.at(1))),
-
-                        static_cast<int>(parseDouble(thirdVert.at(1)))));
-                if (firstVert.size() > 2)
-                {
-                    faceNormals.push_back(glm::vec3(static_cast<int>(parseDouble(firstVert.at(2))),
-                            static_cast<int>(parseDouble(secondVert.at(2))),
-                            static_cast<int>(parseDouble(thirdVert.at(2)))));
-                }
-            }
-            else /// Assumption: this must indicate quads because the graphics hardware doesn't really support anything else.
-            {
-                /// If the data is a quad, break it into 2 separate triangles.
-                std::vector<std::string> firstVert = split(splitLine.at(1), '/');
-                std::vector<std::string> secondVert = split(splitLine.at(2), '/');
-                std::vector<std::string> thirdVert = split(splitLine.at(3), '/');
-                std::vector<std::string> fourthVert = split(splitLine.at(4), '/');
-                /// Make the first triangle
-                faceVerts.push_back(glm::vec3(static_cast<int>(parseDouble(firstVert.at(0))),
-                        static_cast<int>(parseDouble(secondVert.at(0))),
-                        static_cast<int>(parseDouble(fourthVert.at(0)))));
-                faceTextures.push_back(glm::vec3(static_cast<int>(parseDouble(firstVert.at(1))),
-                        static_cast<int>(parseDouble(secondVert.at(1))),
-
-                        static_cast<int>(parseDouble(fourthVert.at(1)))));
-                if (firstVert.size() > 2)
-                {
-                    faceNormals.push_back(glm::vec3(static_cast<int>(parseDouble(firstVert.at(2))),
-                            static_cast<int>(parseDouble(secondVert.at(2))),
-                            static_cast<int>(parseDouble(fourthVert.at(2)))));
-                }
-                /// Make the second triangle
-                faceVerts.push_back(glm::vec3(static_cast<int>(parseDouble(secondVert.at(0))),
-                        static_cast<int>(parseDouble(thirdVert.at(0))),
-                        static_cast<int>(parseDouble(fourthVert.at(0)))));
-                faceTextures.push_back(glm::vec3(static_cast<int>(parseDouble(secondVert.at(1))),
-                        static_cast<int>(parseDouble(thirdVert.at(1))),
-
-                        static_cast<int>(parseDouble(fourthVert.at(1)))));
-                if (firstVert.size() > 2)
-                {
-                    faceNormals.push_back(glm::vec3(static_cast<int>(parseDouble(secondVert.at(2))),
-                            static_cast<int>(parseDouble(thirdVert.at(2))),
-                            static_cast<int>(parseDouble(fourthVert.at(2)))));
-                }
-
-            }
+            p += 3;
+            float x = parseFloat(p, lineEnd, chunk.malformedValues);
+            float y = parseFloat(p, lineEnd, chunk.malformedValues);
+            float z = parseFloat(p, lineEnd, chunk.malformedValues);
+            chunk.normals.push_back(glm::vec3(x, y, z));
         }
-        else if(line.find("mtllib ") == 0)
+        else if (startsWith(p, lineEnd, "vt ", 3))
         {
-            std::string filename = splitLine.at(1);
-            if(filename.find("./") == 0)
-            {
-                filename = filename.substr(2);
-            }
-            std::stringstream ss;
-            ss << filePath << filename;
-            std::vector<std::string> fileContents = readTextFileAsLines(ss.str());
-            MaterialParser matParser(fileContents);
-            std::map<std::string, std::shared_ptr<Material>> mats = matParser.parseMaterials();
-            std::cout << "Read: " << mats.size() << " materials" << std::endl;
-            for(const auto &myPair : mats)
-            {
-                materials[myPair.first] = myPair.second;
-            }
+            p += 3;
+            float u = parseFloat(p, lineEnd, chunk.malformedValues);
+            float v = parseFloat(p, lineEnd, chunk.malformedValues);
+            chunk.textureCoords.push_back(glm::vec2(u, v));
+        }
+        else if (startsWith(p, lineEnd, "f ", 2))
+        {
+            OBJFace face;
+            parseFace(p + 2, lineEnd, face);
+            chunk.faces.push_back(face);
+        }
+        else if (startsWith(p, lineEnd, "o ", 2) || startsWith(p, lineEnd, "g ", 2))
+        {
+            chunk.events.push_back({ OBJDirective::Object, parseName(p + 2, lineEnd), chunk.faces.size() });
+        }
+        else if (startsWith(p, lineEnd, "usemtl ", 7))
+        {
+            chunk.events.push_back({ OBJDirective::UseMaterial, parseName(p + 7, lineEnd), chunk.faces.size() });
         }
-        else if(line.find("usemtl ") == 0)
+        else if (startsWith(p, lineEnd, "mtllib ", 7))
         {
-            activeMaterial = materials[splitLine.at(1)];
+            chunk.events.push_back({ OBJDirective::MaterialLibrary, parseName(p + 7, lineEnd), chunk.faces.size() });
         }
     }
+}
 
+/**
+ * Splits a file into line aligned chunks and parses them in parallel. Small files are parsed on this thread.
+ */
+static std::vector<OBJChunk> parseOBJFile(const char *data, size_t size)
+{
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunkCount = std::max<size_t>(1, std::min(threads, size / OBJ_PARSE_MIN_CHUNK_SIZE));
+    std::vector<const char*> boundaries;
+    boundaries.push_back(data);
+    for (size_t k = 1; k < chunkCount; k++)
+    {
+        const char *split = std::max(data + size * k / chunkCount, boundaries.back());
+        const char *newline = static_cast<const char*>(std::memchr(split, '\n', data + size - split));
+        boundaries.push_back(newline ? newline + 1 : data + size);
+    }
+    boundaries.push_back(data + size);
+
+    std::vector<OBJChunk> chunks(chunkCount);
+    std::vector<std::thread> workers;
+    for (size_t k = 1; k < chunkCount; k++)
+    {
+        workers.push_back(std::thread(parseOBJChunk, boundaries[k], boundaries[k + 1], std::ref(chunks[k])));
+    }
+    parseOBJChunk(boundaries[0], boundaries[1], chunks[0]);
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    return chunks;
+}
+
+ObjParser::ObjParser(std::string filePath, std::string fileName, std::string textureName, bool dataIsTriangles) : filePath(filePath), fileName(fileName), textureName(textureName), modelName("")
+{
+    loadData(dataIsTriangles);
+}
+
+std::shared_ptr<Model> ObjParser::exportModel()
+{
+    return std::shared_ptr<Model>(new Model(meshes));
+}
+
+static ResourceCache<Model> modelCache;
+
+std::shared_ptr<Model> loadModel(std::string filePath, std::string fileName, bool dataIsTriangles)
+{
+    return modelCache.get(fileName, [filePath, dataIsTriangles](const std::string &path) {
+        return ObjParser(filePath, path, "", dataIsTriangles).exportModel();
+    });
+}
 
+ResourceCacheStatistics getModelCacheStatistics()
+{
+    return modelCache.getStatistics();
+}
 
-    std::shared_ptr<MeshData> data = createModelDataFromParsedOBJ(
+/**
+ * Turns the faces gathered for one object into a MeshData.
+ */
+static std::shared_ptr<MeshData> buildMesh(gl::GLenum renderMode, std::shared_ptr<Material> material, std::string meshName,
+        std::vector<glm::vec3> &vertices, std::vector<glm::vec3> &normals, std::vector<glm::vec2> &textureCoords,
+        std::vector<glm::vec3> &faceVerts, std::vector<glm::vec3> &faceNormals, std::vector<glm::vec3> &faceTextures)
+{
+    using namespace gl;
+    return createModelDataFromParsedOBJ(
         renderMode,
-        activeMaterial,
+        material,
         meshName,
         3, GL_FLOAT,
         GL_FLOAT,
@@ -196,8 +321,132 @@ void ObjParser::loadData(bool dataIsTriangles)
         make1DFlex(textureCoords),
         make1DFlex(faceTextures)
     );
-    meshes.push_back(data);
+}
+
+void ObjParser::loadData(bool dataIsTriangles)
+{
+    using namespace gl;
+    if (readMeshCache(fileName, dataIsTriangles, meshes, materials))
+    {
+        std::cout << "Num Meshes:" << meshes.size() << std::endl;
+        return;
+    }
+    sourceFiles.push_back(fileName);
+    GLenum renderMode = (dataIsTriangles) ? GL_TRIANGLES : GL_QUADS;
+
+    std::vector<OBJChunk> chunks;
+    {
+        MappedFile file(fileName);
+        chunks = parseOBJFile(file.data(), file.size());
+    }
+
+    // Vertex indices are global to the file, so every chunk's vertex data is merged before any face is resolved.
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoords;
+    int malformedValues = 0;
+    for (OBJChunk &chunk : chunks)
+    {
+        vertices.insert(vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        textureCoords.insert(textureCoords.end(), chunk.textureCoords.begin(), chunk.textureCoords.end());
+        malformedValues += chunk.malformedValues;
+    }
+    if (malformedValues > 0)
+    {
+        std::cout << "Error: " << malformedValues << " malformed values in " << fileName << " were read as 0" << std::endl;
+    }
+
+	std::vector<glm::vec3> faceVerts;
+	std::vector<glm::vec3> faceNormals;
+	std::vector<glm::vec3> faceTextures;
+    bool hasEncounteredMesh = false;
+    std::string meshName = "";
+    std::shared_ptr<Material> activeMaterial(nullptr);
+
+    for (OBJChunk &chunk : chunks)
+    {
+        size_t nextEvent = 0;
+        for (size_t i = 0; i <= chunk.faces.size(); i++)
+        {
+            for (; nextEvent < chunk.events.size() && chunk.events[nextEvent].faceIndex == i; nextEvent++)
+            {
+                OBJEvent &event = chunk.events[nextEvent];
+                if (event.directive == OBJDirective::Object)
+                {
+                    if (hasEncounteredMesh)
+                    {
+                        meshes.push_back(buildMesh(renderMode, activeMaterial, meshName, vertices, normals, textureCoords,
+                            faceVerts, faceNormals, faceTextures));
+                        faceVerts.clear();
+                        faceNormals.clear();
+                        faceTextures.clear();
+                    }
+                    hasEncounteredMesh = true;
+                    std::cout << "MeshName: >" << event.name << "<" << std::endl;
+                    meshName = event.name;
+                }
+                else if (event.directive == OBJDirective::MaterialLibrary)
+                {
+                    std::string filename = event.name;
+                    if (filename.find("./") == 0)
+                    {
+                        filename = filename.substr(2);
+                    }
+                    std::stringstream ss;
+                    ss << filePath << filename;
+                    sourceFiles.push_back(ss.str());
+                    std::vector<std::string> fileContents = readTextFileAsLines(ss.str());
+                    MaterialParser matParser(fileContents);
+                    std::map<std::string, std::shared_ptr<Material>> mats = matParser.parseMaterials();
+                    std::cout << "Read: " << mats.size() << " materials" << std::endl;
+                    for (const auto &myPair : mats)
+                    {
+                        materials[myPair.first] = myPair.second;
+                    }
+                }
+                else
+                {
+                    activeMaterial = materials[event.name];
+                }
+            }
+            if (i == chunk.faces.size())
+            {
+                break;
+            }
+
+            OBJFace &face = chunk.faces[i];
+            if (face.cornerCount < 3 || (!dataIsTriangles && face.cornerCount < 4))
+            {
+                continue;
+            }
+            /// Quads are broken into 2 separate triangles, (1, 2, 4) and (2, 3, 4).
+            static const int TRIANGLE_CORNERS[] = { 0, 1, 2 };
+            static const int QUAD_CORNERS[] = { 0, 1, 3, 1, 2, 3 };
+            const int *corners = (dataIsTriangles) ? TRIANGLE_CORNERS : QUAD_CORNERS;
+            int triangleCount = (dataIsTriangles) ? 1 : 2;
+            for (int t = 0; t < triangleCount; t++)
+            {
+                const int *c = corners + t * 3;
+                faceVerts.push_back(glm::vec3(face.vertex[c[0]], face.vertex[c[1]], face.vertex[c[2]]));
+                faceTextures.push_back(glm::vec3(face.texture[c[0]], face.texture[c[1]], face.texture[c[2]]));
+                if (face.hasNormals)
+                {
+                    faceNormals.push_back(glm::vec3(face.normal[c[0]], face.normal[c[1]], face.normal[c[2]]));
+                }
+            }
+        }
+    }
+
+    meshes.push_back(buildMesh(renderMode, activeMaterial, meshName, vertices, normals, textureCoords,
+        faceVerts, faceNormals, faceTextures));
+
+    for (std::shared_ptr<MeshData> &mesh : meshes)
+    {
+        optimizeMesh(*mesh);
+        generateMeshLODs(*mesh);
+    }
+    writeMeshCache(sourceFiles, dataIsTriangles, meshes, materials);
 
     std::cout << "Num Meshes:" << meshes.size() << std::endl;
 }
-
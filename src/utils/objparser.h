@@ -11,7 +11,16 @@
 #include "terrain/terraindata.h"
 #include "graphics/model.h"
 #include "world/material.h"
+#include "utils/resourcecache.h"
 
+/** OBJ files are split into chunks of at least this many bytes, each parsed on its own thread. */
+const size_t OBJ_PARSE_MIN_CHUNK_SIZE = 256 * 1024;
+
+/**
+ * ObjParser imports a Wavefront OBJ model. The file is memory mapped and split into line aligned chunks that are
+ * parsed in parallel, then merged in file order. Imported models are kept in a mesh cache next to the file, which is
+ * used instead of the OBJ for as long as it is up to date.
+ */
 class ObjParser
 {
 public:
@@ -19,6 +28,8 @@ public:
     std::map<std::string, std::shared_ptr<Material>> materials;
     std::string filePath;
 	std::string fileName;
+	/** The OBJ file and every material library it loaded, which the mesh cache depends on. */
+	std::vector<std::string> sourceFiles;
 	std::string textureName;
 	std::string modelName;
 	ObjParser(std::string filePath, std::string fileName, std::string textureName, bool dataIsTriangles);
@@ -28,6 +39,19 @@ private:
     void loadData(bool dataIsTriangles);
 };
 
+/**
+ * Gets the Model for an OBJ file. Every caller asking for the same file shares one Model, which is only imported if
+ * no one is holding it already.
+ * @param filePath the directory holding the OBJ file and its material libraries
+ * @param fileName the path of the OBJ file
+ * @param dataIsTriangles whether the faces are triangles, rather than quads
+ */
+std::shared_ptr<Model> loadModel(std::string filePath, std::string fileName, bool dataIsTriangles);
+/**
+ * Gets the hit and miss counts of the cache behind loadModel(...).
+ */
+ResourceCacheStatistics getModelCacheStatistics();
+
 
 
 #endif
@@ -0,0 +1,23 @@
+#include <unordered_set>
+#include "utils/resourcecache.h"
+
+const std::string *internPath(const std::string &path)
+{
+	static std::unordered_set<std::string> paths;
+	std::string normalized;
+	normalized.reserve(path.size());
+	for (char c : path)
+	{
+		if (c == '\\')
+		{
+			c = '/';
+		}
+		if (c == '/' && normalized.size() > 1 && normalized.back() == '/')
+		{
+			continue;
+		}
+		normalized.push_back(c);
+	}
+	// Elements of an unordered_set never move, so the address is stable across rehashes.
+	return &*paths.insert(normalized).first;
+}
@@ -0,0 +1,77 @@
+#ifndef ENGINE_RESOURCE_CACHE_H
+#define ENGINE_RESOURCE_CACHE_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/**
+ * How well a ResourceCache has been doing. A hit is a request answered by a resource that was still alive.
+ */
+struct ResourceCacheStatistics
+{
+	int hits;
+	int misses;
+	/** The number of cached resources that are still referenced somewhere. */
+	int liveResources;
+};
+
+/**
+ * Gets the single shared copy of a resource path. Backslashes become forward slashes and repeated separators are
+ * collapsed first, so different spellings of one path share a copy. The returned pointer is valid for the rest of
+ * the program and can be compared and hashed in place of the string.
+ * @param path the path to intern
+ */
+const std::string *internPath(const std::string &path);
+
+/**
+ * ResourceCache hands out one shared instance of each resource, keyed by its interned path. The cache only holds
+ * weak references, so a resource is freed, along with any GL objects it owns, as soon as the last user lets go of
+ * it, and is loaded again the next time it is asked for.
+ */
+template<class T>
+class ResourceCache
+{
+public:
+	ResourceCache() : hits(0), misses(0)
+	{
+	}
+
+	/**
+	 * Gets the resource at a path, loading it if it is not alive.
+	 * @param path the path of the resource
+	 * @param load creates the resource from its normalized path, and may return nullptr if it fails
+	 */
+	std::shared_ptr<T> get(const std::string &path, std::function<std::shared_ptr<T>(const std::string&)> load)
+	{
+		const std::string *key = internPath(path);
+		std::weak_ptr<T> &entry = entries[key];
+		std::shared_ptr<T> resource = entry.lock();
+		if (resource)
+		{
+			hits++;
+			return resource;
+		}
+		misses++;
+		resource = load(*key);
+		entry = resource;
+		return resource;
+	}
+
+	ResourceCacheStatistics getStatistics()
+	{
+		ResourceCacheStatistics statistics = { hits, misses, 0 };
+		for (auto &entry : entries)
+		{
+			statistics.liveResources += entry.second.expired() ? 0 : 1;
+		}
+		return statistics;
+	}
+private:
+	std::unordered_map<const std::string*, std::weak_ptr<T>> entries;
+	int hits;
+	int misses;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef ENGINE_TEXT_FORMAT_H
+#define ENGINE_TEXT_FORMAT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+/**
+ * Writes a prefix followed by an integer in decimal into a buffer, without iostreams or heap allocations. Text that
+ * does not fit is cut off. The result is not null terminated.
+ * @param buffer receives the text
+ * @param capacity the size of the buffer
+ * @param prefix written before the number, such as "score: "
+ * @param value the number to write
+ * @return the number of characters written
+ */
+inline size_t formatInteger(char *buffer, size_t capacity, const char *prefix, long long value)
+{
+	size_t length = std::min(std::strlen(prefix), capacity);
+	std::memcpy(buffer, prefix, length);
+	// The digits come out lowest first, so they are gathered back to front. 20 digits and a sign fit any long long.
+	char digits[21];
+	char *first = digits + sizeof(digits);
+	unsigned long long magnitude = (value < 0) ? 0ULL - static_cast<unsigned long long>(value) :
+		static_cast<unsigned long long>(value);
+	do
+	{
+		*--first = static_cast<char>('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+	if (value < 0)
+	{
+		*--first = '-';
+	}
+	size_t digitCount = static_cast<size_t>(digits + sizeof(digits) - first);
+	if (digitCount > capacity - length)
+	{
+		return length;
+	}
+	std::memcpy(buffer + length, first, digitCount);
+	return length + digitCount;
+}
+
+#endif
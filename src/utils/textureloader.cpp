@@ -2,25 +2,69 @@
 
 #include <soil/SOIL.h>
 #include <glbinding/gl/gl.h>
+#include "render/glstate.h"
+#include "render/texturecache.h"
+#include "render/textureresidency.h"
 
-std::shared_ptr<Texture> getTexture(std::string resourceName)
+static ResourceCache<Texture> textureCache;
+static ResourceCache<Texture> streamedTextureCache;
+
+static std::shared_ptr<Texture> loadTexture(const std::string &resourceName, int maxSize)
 {
-    std::shared_ptr<Texture> tex(new Texture(
-        resourceName,
-        static_cast<gl::GLuint>(SOIL_load_OGL_texture(
+    gl::GLuint textureID = loadCachedTexture(resourceName, maxSize);
+    if (textureID == 0)
+    {
+        textureID = static_cast<gl::GLuint>(SOIL_load_OGL_texture(
             resourceName.c_str(),
             SOIL_LOAD_AUTO,
             SOIL_CREATE_NEW_ID,
             SOIL_FLAG_MIPMAPS | SOIL_FLAG_INVERT_Y | SOIL_FLAG_NTSC_SAFE_RGB | SOIL_FLAG_COMPRESS_TO_DXT
-        ))
-    ));
+        ));
+        // SOIL binds the texture behind the state cache's back.
+        invalidateGLState();
+        if (textureID != 0)
+        {
+            // SOIL has just decoded, mipmapped and compressed the image; keep the result for next time.
+            writeTextureCache(resourceName, textureID);
+        }
+    }
+    std::shared_ptr<Texture> tex(new Texture(resourceName, textureID));
 
-    gl::glBindTexture(gl::GL_TEXTURE_2D, tex->textureID);
+    tex->bind();
 	gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, static_cast<gl::GLint>(gl::GL_LINEAR));
 	gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, static_cast<gl::GLint>(gl::GL_LINEAR));
     return tex;
 }
 
+static std::shared_ptr<Texture> loadWholeTexture(const std::string &resourceName)
+{
+    return loadTexture(resourceName, 0);
+}
 
+static std::shared_ptr<Texture> loadStreamedTexture(const std::string &resourceName)
+{
+    // On a cache miss the texture is loaded whole, and streaming starts by evicting from it.
+    std::shared_ptr<Texture> tex = loadTexture(resourceName, TEXTURE_STREAMING_MIN_SIZE);
+    registerStreamedTexture(tex);
+    return tex;
+}
 
+std::shared_ptr<Texture> getTexture(std::string resourceName)
+{
+    return textureCache.get(resourceName, loadWholeTexture);
+}
 
+std::shared_ptr<Texture> getStreamedTexture(std::string resourceName)
+{
+    return streamedTextureCache.get(resourceName, loadStreamedTexture);
+}
+
+ResourceCacheStatistics getTextureCacheStatistics()
+{
+    ResourceCacheStatistics whole = textureCache.getStatistics();
+    ResourceCacheStatistics streamed = streamedTextureCache.getStatistics();
+    whole.hits += streamed.hits;
+    whole.misses += streamed.misses;
+    whole.liveResources += streamed.liveResources;
+    return whole;
+}
@@ -4,7 +4,24 @@
 #include <string>
 #include <memory>
 #include "render/texture.h"
+#include "utils/resourcecache.h"
 
-std::shared_ptr<Texture> getTexture(std::string);
+/**
+ * Gets the Texture for an image file. Every caller asking for the same path shares one Texture, which is only loaded
+ * if no one is holding it already, and its GL texture is deleted once no one is.
+ * @param resourceName the path of the image
+ */
+std::shared_ptr<Texture> getTexture(std::string resourceName);
+/**
+ * Gets the Texture for an image file whose mip levels are streamed in by the texture residency manager. It starts
+ * out with only its coarse levels, so whatever draws it must call requestTextureDetail(...) each frame. Images
+ * without a compressed texture cache are loaded whole. Streamed textures are shared separately from getTexture(...).
+ * @param resourceName the path of the image
+ */
+std::shared_ptr<Texture> getStreamedTexture(std::string resourceName);
+/**
+ * Gets the hit and miss counts of the caches behind getTexture(...) and getStreamedTexture(...).
+ */
+ResourceCacheStatistics getTextureCacheStatistics();
 
 #endif
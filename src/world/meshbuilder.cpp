@@ -2,12 +2,41 @@
 
 #include <stdexcept>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include "utils/colour.h"
 #include "render/vbo.h"
 #include "world/meshdata.h"
 
+/**
+ * The indices of one OBJ face corner into the vertex, normal and texture coordinate lists. Corners with the same
+ * key can share a single vertex in the output mesh.
+ */
+struct OBJVertexKey
+{
+    int vertex;
+    int normal;
+    int texture;
+    bool operator==(const OBJVertexKey &other) const
+    {
+        return vertex == other.vertex && normal == other.normal && texture == other.texture;
+    }
+};
+
+struct OBJVertexKeyHash
+{
+    size_t operator()(const OBJVertexKey &key) const
+    {
+        size_t hash = static_cast<size_t>(key.vertex) * 73856093u;
+        hash ^= static_cast<size_t>(key.normal) * 19349663u;
+        hash ^= static_cast<size_t>(key.texture) * 83492791u;
+        return hash;
+    }
+};
+
 inline int fmodp(int num, int mod)
 {
 /*
@@ -103,7 +132,13 @@ std::shared_ptr<MeshData> createModelDataFromParsedOBJ(gl::GLenum glRenderMode,
             colourSize * sizeof(colourType) +
             textureCoordSize * sizeof(textureCoordType);
 
-    FlexArray<float> combinedBuffer(faceVerts.size() * vertsPerFace * elementsPerRowOfCombinedData);
+    // Each face corner is resolved to its (vertex, normal, texture) indices once. Every distinct triple becomes one
+    // vertex in the combined buffer, and the faces are rebuilt as indices into it.
+    std::unordered_map<OBJVertexKey, unsigned int, OBJVertexKeyHash> vertexLookup;
+    vertexLookup.reserve(faceVerts.size() * vertsPerFace);
+    std::vector<float> uniqueVertices;
+    uniqueVertices.reserve(faceVerts.size() * elementsPerRowOfCombinedData);
+    std::vector<unsigned int> indices(faceVerts.size() * vertsPerFace);
     int k = 0;
 
     for (int i = 0; i < faceVerts.size(); i++)
@@ -111,62 +146,31 @@ std::shared_ptr<MeshData> createModelDataFromParsedOBJ(gl::GLenum glRenderMode,
         glm::vec3 facesVerts = faceVerts[i];
         glm::vec3 facesNormals = faceNormals[i];
         glm::vec3 facesTextures = faceTextures[i];
-        // X
-        // Stuff the vert data
-        combinedBuffer[k++] = static_cast<float>(vertexData[fmodp(static_cast<int>(facesVerts.x - 1) , vertexData.size())].x);
-        combinedBuffer[k++] = static_cast<float>(vertexData[fmodp(static_cast<int>(facesVerts.x - 1), vertexData.size())].y);
-        combinedBuffer[k++] = static_cast<float>(vertexData[fmodp(static_cast<int>(facesVerts.x - 1), vertexData.size())].z);
-        // Then add associated normal
-        combinedBuffer[k++] = static_cast<float>(normalData[fmodp(static_cast<int>(facesNormals.x - 1), normalData.size())].x);
-        combinedBuffer[k++] = static_cast<float>(normalData[fmodp(static_cast<int>(facesNormals.x - 1), normalData.size())].y);
-        combinedBuffer[k++] = static_cast<float>(normalData[fmodp(static_cast<int>(facesNormals.x - 1), normalData.size())].z);
-        //Then add associated vert colour
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.x - 1) ,colourData.size())].r);
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.x - 1) ,colourData.size())].g);
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.x - 1) ,colourData.size())].b);
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.x - 1) ,colourData.size())].a);
-        // Add in UV textureData
-
-        combinedBuffer[k++] = static_cast<float>(textureData[fmodp(static_cast<int>(facesTextures.x - 1),textureData.size())].x);
-        combinedBuffer[k++] = static_cast<float>(textureData[fmodp(static_cast<int>(facesTextures.x - 1),textureData.size())].y);
-
-        //Y
-        // Stuff the vert data
-        combinedBuffer[k++] = static_cast<float>(vertexData[fmodp(static_cast<int>(facesVerts.y - 1), vertexData.size())].x);
-        combinedBuffer[k++] = static_cast<float>(vertexData[fmodp(static_cast<int>(facesVerts.y - 1), vertexData.size())].y);
-        combinedBuffer[k++] = static_cast<float>(vertexData[fmodp(static_cast<int>(facesVerts.y - 1), vertexData.size())].z);
-        // Then add associated normal
-        combinedBuffer[k++] = static_cast<float>(normalData[fmodp(static_cast<int>(facesNormals.y - 1), normalData.size())].x);
-        combinedBuffer[k++] = static_cast<float>(normalData[fmodp(static_cast<int>(facesNormals.y - 1), normalData.size())].y);
-        combinedBuffer[k++] = static_cast<float>(normalData[fmodp(static_cast<int>(facesNormals.y - 1), normalData.size())].z);
-        //Then add associated vert colour
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.y- 1) ,colourData.size())].r);
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.y- 1) ,colourData.size())].g);
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.y- 1) ,colourData.size())].b);
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.y- 1) ,colourData.size())].a);
-        // Add in UV textureData
-        combinedBuffer[k++] = static_cast<float>(textureData[fmodp(static_cast<int>(facesTextures.y - 1),textureData.size())].x);
-        combinedBuffer[k++] = static_cast<float>(textureData[fmodp(static_cast<int>(facesTextures.y - 1),textureData.size())].y);
-
-        //Z
-        // Stuff the vert data
-        combinedBuffer[k++] = static_cast<float>(vertexData[fmodp(static_cast<int>(facesVerts.z - 1), vertexData.size())].x);
-        combinedBuffer[k++] = static_cast<float>(vertexData[fmodp(static_cast<int>(facesVerts.z - 1), vertexData.size())].y);
-        combinedBuffer[k++] = static_cast<float>(vertexData[fmodp(static_cast<int>(facesVerts.z - 1), vertexData.size())].z);
-        // Then add associated normal
-        combinedBuffer[k++] = static_cast<float>(normalData[fmodp(static_cast<int>(facesNormals.z - 1), normalData.size())].x);
-        combinedBuffer[k++] = static_cast<float>(normalData[fmodp(static_cast<int>(facesNormals.z - 1), normalData.size())].y);
-        combinedBuffer[k++] = static_cast<float>(normalData[fmodp(static_cast<int>(facesNormals.z - 1), normalData.size())].z);
-        //Then add associated vert colour
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.z- 1) ,colourData.size())].r);
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.z- 1) ,colourData.size())].g);
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.z- 1) ,colourData.size())].b);
-        combinedBuffer[k++] = static_cast<float>(colourData[fmodp(static_cast<int>(facesVerts.z- 1) ,colourData.size())].a);
-        // Add in UV textureData
-        combinedBuffer[k++] = static_cast<float>(textureData[fmodp(static_cast<int>(facesTextures.z - 1),textureData.size())].x);
-        combinedBuffer[k++] = static_cast<float>(textureData[fmodp(static_cast<int>(facesTextures.z - 1),textureData.size())].y);
+        for (int corner = 0; corner < vertsPerFace; corner++)
+        {
+            OBJVertexKey key;
+            key.vertex = fmodp(static_cast<int>(facesVerts[corner] - 1), vertexData.size());
+            key.normal = fmodp(static_cast<int>(facesNormals[corner] - 1), normalData.size());
+            key.texture = fmodp(static_cast<int>(facesTextures[corner] - 1), textureData.size());
+            auto result = vertexLookup.emplace(key, static_cast<unsigned int>(vertexLookup.size()));
+            if (result.second)
+            {
+                glm::vec3 &v = vertexData[key.vertex];
+                glm::vec3 &n = normalData[key.normal];
+                // The colour data is indexed the same way as the vertex data.
+                Colour &c = colourData[fmodp(key.vertex, colourData.size())];
+                glm::vec2 &t = textureData[key.texture];
+                float row[] = { v.x, v.y, v.z, n.x, n.y, n.z, static_cast<float>(c.r), static_cast<float>(c.g),
+                        static_cast<float>(c.b), static_cast<float>(c.a), t.x, t.y };
+                uniqueVertices.insert(uniqueVertices.end(), row, row + 12);
+            }
+            indices[k++] = result.first->second;
+        }
     }
 
+    FlexArray<float> combinedBuffer(static_cast<int>(uniqueVertices.size()));
+    std::copy(uniqueVertices.begin(), uniqueVertices.end(), combinedBuffer.getRawArray());
+
     return std::shared_ptr<MeshData>(new MeshData(glRenderMode, material, vertsPerFace,
             associatedTextureName,
             stride,
@@ -175,8 +179,7 @@ std::shared_ptr<MeshData> createModelDataFromParsedOBJ(gl::GLenum glRenderMode,
             normalSize, normalOffset, normalType,
             colourSize, colourOffset, colourType,
             textureCoordSize, textureCoordOffset, textureCoordType,
-            combinedBuffer));
-
+            combinedBuffer, indices));
 }
 
 MeshData createModelData(gl::GLenum glRenderMode,
@@ -0,0 +1,301 @@
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "world/meshcache.h"
+#include "utils/binaryio.h"
+#include "utils/fileutils.h"
+#include "utils/mappedfile.h"
+
+/** "MCHE", written at the start and the end of every mesh cache. The end marker catches truncated files. */
+static const uint32_t MESH_CACHE_MAGIC = 0x4548434d;
+
+///
+/// A mesh cache is a flat, native endian file:
+///   magic, version, dataIsTriangles
+///   source file count, then for each: path, size, modification time
+///   material count, then for each: name, Ka, Kd, Ks, Ns, d, Tr, illum
+///   mesh count, then for each: the MeshData layout fields, material index (-1 for none), bounds, the sizes of the
+///     combined data, indices and levels of detail, then those three arrays
+///   magic
+///
+
+static glm::vec3 readVec3(BinaryReader &reader)
+{
+	float x = reader.read<float>();
+	float y = reader.read<float>();
+	float z = reader.read<float>();
+	return glm::vec3(x, y, z);
+}
+
+std::string getMeshCachePath(std::string sourcePath)
+{
+	return sourcePath + ".meshcache";
+}
+
+static std::shared_ptr<MeshData> readMesh(BinaryReader &reader, const std::vector<std::shared_ptr<Material>> &materialList)
+{
+	using namespace gl;
+	GLenum renderMode = static_cast<GLenum>(reader.read<uint32_t>());
+	int vertexPerFace = reader.read<int32_t>();
+	std::string textureName = reader.readString();
+	int materialIndex = reader.read<int32_t>();
+	int stride = reader.read<int32_t>();
+	int elementsPerRow = reader.read<int32_t>();
+	int vertexSize = reader.read<int32_t>();
+	int vertexOffset = reader.read<int32_t>();
+	GLenum vertexType = static_cast<GLenum>(reader.read<uint32_t>());
+	int normalSize = reader.read<int32_t>();
+	int normalOffset = reader.read<int32_t>();
+	GLenum normalType = static_cast<GLenum>(reader.read<uint32_t>());
+	int colourSize = reader.read<int32_t>();
+	int colourOffset = reader.read<int32_t>();
+	GLenum colourType = static_cast<GLenum>(reader.read<uint32_t>());
+	int textureCoordSize = reader.read<int32_t>();
+	int textureCoordOffset = reader.read<int32_t>();
+	GLenum textureCoordType = static_cast<GLenum>(reader.read<uint32_t>());
+	bool hasTextureData = reader.read<uint32_t>() != 0;
+	glm::vec3 boundsMin = readVec3(reader);
+	glm::vec3 boundsMax = readVec3(reader);
+	uint32_t floatCount = reader.read<uint32_t>();
+	uint32_t indexCount = reader.read<uint32_t>();
+	uint32_t lodCount = reader.read<uint32_t>();
+
+	std::shared_ptr<Material> material(nullptr);
+	if (materialIndex >= static_cast<int>(materialList.size()))
+	{
+		throw std::runtime_error("Mesh cache refers to a missing material");
+	}
+	if (materialIndex >= 0)
+	{
+		material = materialList[materialIndex];
+	}
+
+	// The counts come from the file, so the bytes are taken, which checks they are there, before anything is
+	// allocated for them.
+	if (floatCount > static_cast<uint32_t>(INT_MAX) || indexCount > static_cast<uint32_t>(INT_MAX))
+	{
+		throw std::runtime_error("Mesh cache has an impossibly large mesh");
+	}
+	const char *floatBytes = reader.take(floatCount * sizeof(float));
+	const char *indexBytes = reader.take(indexCount * sizeof(uint32_t));
+	FlexArray<float> combinedData(static_cast<int>(floatCount));
+	std::memcpy(combinedData.getRawArray(), floatBytes, floatCount * sizeof(float));
+	std::vector<unsigned int> indices(indexCount);
+	std::memcpy(indices.data(), indexBytes, indexCount * sizeof(uint32_t));
+
+	std::shared_ptr<MeshData> mesh(new MeshData(renderMode, material, vertexPerFace, textureName, stride, elementsPerRow,
+		vertexSize, vertexOffset, vertexType,
+		normalSize, normalOffset, normalType,
+		colourSize, colourOffset, colourType,
+		textureCoordSize, textureCoordOffset, textureCoordType,
+		combinedData, indices));
+	mesh->hasTextureData = hasTextureData;
+	mesh->setAABB(AABB(boundsMin.x, boundsMin.y, boundsMin.z, boundsMax.x, boundsMax.y, boundsMax.z));
+	for (uint32_t i = 0; i < lodCount; i++)
+	{
+		MeshLOD lod;
+		lod.firstIndex = reader.read<int32_t>();
+		lod.indexCount = reader.read<int32_t>();
+		lod.error = reader.read<float>();
+		if (lod.firstIndex < 0 || lod.indexCount < 0 || lod.firstIndex + lod.indexCount > static_cast<int>(indexCount))
+		{
+			throw std::runtime_error("Mesh cache has a level of detail outside its indices");
+		}
+		mesh->lods.push_back(lod);
+	}
+	return mesh;
+}
+
+bool readMeshCache(std::string sourcePath, bool dataIsTriangles, std::vector<std::shared_ptr<MeshData>> &meshes,
+	std::map<std::string, std::shared_ptr<Material>> &materials)
+{
+	std::string cachePath = getMeshCachePath(sourcePath);
+	FileStatus cacheStatus;
+	if (!getFileStatus(cachePath, cacheStatus))
+	{
+		return false;
+	}
+	try
+	{
+		MappedFile file(cachePath);
+		BinaryReader reader(file.data(), file.size());
+		if (reader.read<uint32_t>() != MESH_CACHE_MAGIC || reader.read<uint32_t>() != MESH_CACHE_VERSION ||
+			(reader.read<uint32_t>() != 0) != dataIsTriangles)
+		{
+			std::cout << "Mesh cache >" << cachePath << "< is out of date, re-importing." << std::endl;
+			return false;
+		}
+		uint32_t sourceCount = reader.read<uint32_t>();
+		for (uint32_t i = 0; i < sourceCount; i++)
+		{
+			std::string path = reader.readString();
+			long long size = reader.read<int64_t>();
+			long long modifiedTime = reader.read<int64_t>();
+			FileStatus status;
+			if (!getFileStatus(path, status) || status.size != size || status.modifiedTime != modifiedTime)
+			{
+				std::cout << "Mesh cache >" << cachePath << "< is stale, >" << path << "< has changed." << std::endl;
+				return false;
+			}
+		}
+
+		std::map<std::string, std::shared_ptr<Material>> readMaterials;
+		std::vector<std::shared_ptr<Material>> materialList;
+		uint32_t materialCount = reader.read<uint32_t>();
+		for (uint32_t i = 0; i < materialCount; i++)
+		{
+			std::string name = reader.readString();
+			glm::vec3 ambient = readVec3(reader);
+			glm::vec3 diffuse = readVec3(reader);
+			glm::vec3 specular = readVec3(reader);
+			float specularPower = reader.read<float>();
+			float d = reader.read<float>();
+			float Tr = reader.read<float>();
+			int illum = reader.read<int32_t>();
+			std::shared_ptr<Material> material(new Material(name, ambient, diffuse, specular, specularPower, d, Tr, illum));
+			readMaterials[name] = material;
+			materialList.push_back(material);
+		}
+
+		std::vector<std::shared_ptr<MeshData>> readMeshes;
+		uint32_t meshCount = reader.read<uint32_t>();
+		for (uint32_t i = 0; i < meshCount; i++)
+		{
+			readMeshes.push_back(readMesh(reader, materialList));
+		}
+		if (reader.read<uint32_t>() != MESH_CACHE_MAGIC)
+		{
+			throw std::runtime_error("Mesh cache has no end marker");
+		}
+
+		meshes = readMeshes;
+		materials = readMaterials;
+		std::cout << "Loaded mesh cache >" << cachePath << "<: " << meshes.size() << " meshes" << std::endl;
+		return true;
+	}
+	catch (const std::exception &e)
+	{
+		// Anything wrong with the cache, even a corrupt count that could not be allocated, means re-importing.
+		std::cout << "Mesh cache >" << cachePath << "< could not be read (" << e.what() << "), re-importing." << std::endl;
+		return false;
+	}
+}
+
+static void appendMesh(std::vector<char> &buffer, MeshData &mesh, const std::map<const Material*, int> &materialIndices)
+{
+	int materialIndex = -1;
+	auto found = materialIndices.find(mesh.material.get());
+	if (found != materialIndices.end())
+	{
+		materialIndex = found->second;
+	}
+	AABB bounds = mesh.getAABB();
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(mesh.glRenderMode));
+	appendValue<int32_t>(buffer, mesh.vertexPerFace);
+	appendString(buffer, mesh.associatedTextureName);
+	appendValue<int32_t>(buffer, materialIndex);
+	appendValue<int32_t>(buffer, mesh.stride);
+	appendValue<int32_t>(buffer, mesh.elementsPerRowOfCombinedData);
+	appendValue<int32_t>(buffer, mesh.vertexSize);
+	appendValue<int32_t>(buffer, mesh.vertexOffset);
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(mesh.vertexType));
+	appendValue<int32_t>(buffer, mesh.normalSize);
+	appendValue<int32_t>(buffer, mesh.normalOffset);
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(mesh.normalType));
+	appendValue<int32_t>(buffer, mesh.colourSize);
+	appendValue<int32_t>(buffer, mesh.colourOffset);
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(mesh.colourType));
+	appendValue<int32_t>(buffer, mesh.textureCoordSize);
+	appendValue<int32_t>(buffer, mesh.textureCoordOffset);
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(mesh.textureCoordType));
+	appendValue<uint32_t>(buffer, mesh.hasTextureData ? 1 : 0);
+	float boundsData[] = { bounds.xMin, bounds.yMin, bounds.zMin, bounds.xMax, bounds.yMax, bounds.zMax };
+	appendBytes(buffer, boundsData, sizeof(boundsData));
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(mesh.combinedData.size()));
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(mesh.indices.size()));
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(mesh.lods.size()));
+	appendBytes(buffer, mesh.combinedData.getRawArray(), mesh.combinedData.size() * sizeof(float));
+	appendBytes(buffer, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+	for (const MeshLOD &lod : mesh.lods)
+	{
+		appendValue<int32_t>(buffer, lod.firstIndex);
+		appendValue<int32_t>(buffer, lod.indexCount);
+		appendValue<float>(buffer, lod.error);
+	}
+}
+
+void writeMeshCache(const std::vector<std::string> &sourceFiles, bool dataIsTriangles,
+	const std::vector<std::shared_ptr<MeshData>> &meshes,
+	const std::map<std::string, std::shared_ptr<Material>> &materials)
+{
+	if (sourceFiles.empty())
+	{
+		return;
+	}
+	std::string cachePath = getMeshCachePath(sourceFiles[0]);
+	std::vector<char> buffer;
+	appendValue<uint32_t>(buffer, MESH_CACHE_MAGIC);
+	appendValue<uint32_t>(buffer, MESH_CACHE_VERSION);
+	appendValue<uint32_t>(buffer, dataIsTriangles ? 1 : 0);
+
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(sourceFiles.size()));
+	for (const std::string &path : sourceFiles)
+	{
+		FileStatus status;
+		if (!getFileStatus(path, status))
+		{
+			std::cout << "Not writing mesh cache >" << cachePath << "<, >" << path << "< is missing." << std::endl;
+			return;
+		}
+		appendString(buffer, path);
+		appendValue<int64_t>(buffer, status.size);
+		appendValue<int64_t>(buffer, status.modifiedTime);
+	}
+
+	// Unknown material names leave null entries in the parser's map, which are not worth keeping.
+	std::map<const Material*, int> materialIndices;
+	uint32_t materialCount = 0;
+	for (const auto &entry : materials)
+	{
+		materialCount += entry.second ? 1 : 0;
+	}
+	appendValue<uint32_t>(buffer, materialCount);
+	for (const auto &entry : materials)
+	{
+		const std::shared_ptr<Material> &material = entry.second;
+		if (!material)
+		{
+			continue;
+		}
+		int index = static_cast<int>(materialIndices.size());
+		materialIndices[material.get()] = index;
+		appendString(buffer, entry.first);
+		float colours[] = {
+			material->ambientColour.x, material->ambientColour.y, material->ambientColour.z,
+			material->diffuseColour.x, material->diffuseColour.y, material->diffuseColour.z,
+			material->specularColour.x, material->specularColour.y, material->specularColour.z,
+			material->specularPower, material->d, material->Tr
+		};
+		appendBytes(buffer, colours, sizeof(colours));
+		appendValue<int32_t>(buffer, material->illum);
+	}
+
+	appendValue<uint32_t>(buffer, static_cast<uint32_t>(meshes.size()));
+	for (const std::shared_ptr<MeshData> &mesh : meshes)
+	{
+		appendMesh(buffer, *mesh, materialIndices);
+	}
+	appendValue<uint32_t>(buffer, MESH_CACHE_MAGIC);
+
+	try
+	{
+		writeBinaryFile(cachePath, buffer);
+		std::cout << "Wrote mesh cache >" << cachePath << "<: " << buffer.size() << " bytes" << std::endl;
+	}
+	catch (const std::runtime_error &e)
+	{
+		std::cout << "Not writing mesh cache: " << e.what() << std::endl;
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef ENGINE_MESH_CACHE_H
+#define ENGINE_MESH_CACHE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "world/material.h"
+#include "world/meshdata.h"
+
+/** Bumped whenever the layout of a mesh cache, or the processing done before it is written, changes. */
+const unsigned int MESH_CACHE_VERSION = 1;
+
+/**
+ * Gets the path of the mesh cache kept next to a model file.
+ * @param sourcePath the path of the model file, such as an OBJ
+ */
+std::string getMeshCachePath(std::string sourcePath);
+/**
+ * Reads the meshes and materials of a model from its mesh cache. The cache is memory mapped and its vertex, index
+ * and level of detail data are copied straight into the MeshData objects, so nothing is parsed. It is rejected if it
+ * was written by another version, with other import settings, or if any of the files it was built from have changed
+ * size or modification time since.
+ * @param sourcePath the path of the model file the cache was built from
+ * @param dataIsTriangles the import setting the model is being loaded with
+ * @param meshes receives the meshes, in the order they were written
+ * @param materials receives the materials
+ * @return true if the cache was valid and has been read, otherwise false and neither output is changed
+ */
+bool readMeshCache(std::string sourcePath, bool dataIsTriangles, std::vector<std::shared_ptr<MeshData>> &meshes,
+	std::map<std::string, std::shared_ptr<Material>> &materials);
+/**
+ * Writes a mesh cache for a model that has just been imported and processed. Failing to write the cache, for example
+ * because the resource directory is read only, is logged but is not an error.
+ * @param sourceFiles the files the model was built from, starting with the model file itself. Any later change to
+ * one of them invalidates the cache
+ * @param dataIsTriangles the import setting the model was loaded with
+ * @param meshes the processed meshes
+ * @param materials the materials the meshes refer to
+ */
+void writeMeshCache(const std::vector<std::string> &sourceFiles, bool dataIsTriangles,
+	const std::vector<std::shared_ptr<MeshData>> &meshes,
+	const std::map<std::string, std::shared_ptr<Material>> &materials);
+
+#endif
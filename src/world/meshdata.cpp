@@ -15,7 +15,7 @@ MeshData::MeshData(
     colourSize(colourSize), colourOffset(colourOffset), colourType(colourType),
     textureCoordSize(0), textureCoordOffset(0), textureCoordType(gl::GL_FLOAT),
     elementsPerRowOfCombinedData(elementsPerRowOfCombinedData), combinedData(combinedData),
-    vertexPerFace(vertexPerFace), hasTextureData(false)
+    vertexPerFace(vertexPerFace), hasTextureData(false), bounds(0, 0, 0, 0, 0, 0), hasBounds(false)
 {
 }
 
@@ -30,19 +30,30 @@ MeshData::MeshData(
         int normalSize, int normalOffset, gl::GLenum normalType,
         int colourSize, int colourOffset, gl::GLenum colourType,
         int textureCoordSize, int textureCoordOffset, gl::GLenum textureCoordType,
-        FlexArray<float> combinedData
+        FlexArray<float> combinedData,
+        std::vector<unsigned int> indices
     ) : associatedTextureName(associatedTextureName), glRenderMode(glRenderMode), stride(stride),
     vertexSize(vertexSize), vertexOffset(vertexOffset), vertexType(vertexType),
     normalSize(normalSize), normalOffset(normalOffset), normalType(normalType),
     colourSize(colourSize), colourOffset(colourOffset), colourType(colourType),
     textureCoordSize(textureCoordSize), textureCoordOffset(textureCoordOffset), textureCoordType(textureCoordType),
-    elementsPerRowOfCombinedData(elementsPerRowOfCombinedData), combinedData(combinedData),
-    vertexPerFace(vertexPerFace), hasTextureData(false), material(material)
+    elementsPerRowOfCombinedData(elementsPerRowOfCombinedData), combinedData(combinedData), indices(indices),
+    vertexPerFace(vertexPerFace), hasTextureData(false), material(material), bounds(0, 0, 0, 0, 0, 0), hasBounds(false)
 {
 }
 
+void MeshData::setAABB(const AABB &bounds)
+{
+    this->bounds = bounds;
+    hasBounds = true;
+}
+
 AABB MeshData::getAABB()
 {
+    if(hasBounds)
+    {
+        return bounds;
+    }
     if(combinedData.size() == 0)
     {
         return AABB(0, 0, 0, 0, 0, 0);
@@ -104,7 +115,8 @@ AABB MeshData::getAABB()
         }
     }
 
-    return AABB(xMin, yMin, zMin, xMax, yMax, zMax);
+    setAABB(AABB(xMin, yMin, zMin, xMax, yMax, zMax));
+    return bounds;
 }
 
 
@@ -3,11 +3,26 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include <glbinding/gl/gl.h>
 #include "physics/aabb.h"
 #include "utils/flexarray.h"
 #include "world/material.h"
 
+/** The most levels of detail a mesh can have, counting the full detail mesh. */
+const int MAX_MESH_LOD_LEVELS = 4;
+
+/**
+ * One level of detail of an indexed mesh: a range of MeshData::indices drawn over the shared vertex data.
+ */
+struct MeshLOD
+{
+	int firstIndex;
+	int indexCount;
+	/** The largest geometric error, in model units, introduced by the simplification that produced this level. */
+	float error;
+};
+
 /**
  * Contains data to create a VBO to draw a model. That is, vertex data, normals, colour, and texture coordinates.
  */
@@ -36,6 +51,16 @@ public:
 	/** The total number of elements associated to one vertex*/
 	const int elementsPerRowOfCombinedData;
 	FlexArray<float> combinedData;
+	/**
+	 * Indices into combinedData, one per face corner. If this is empty the mesh is not indexed, and every
+	 * elementsPerRowOfCombinedData floats in combinedData are a vertex drawn in order.
+	 */
+	std::vector<unsigned int> indices;
+	/**
+	 * The levels of detail stored in indices, from full detail to coarsest. If this is empty the whole of indices
+	 * is the only level.
+	 */
+	std::vector<MeshLOD> lods;
 	const int vertexPerFace;
 	bool hasTextureData;
     std::shared_ptr<Material> material;
@@ -89,6 +114,7 @@ public:
 	 * @param textureCoordOffset
 	 * @param textureCoordType
 	 * @param combinedData
+	 * @param indices the index of the vertex used by each face corner, or an empty vector if the mesh is not indexed
 	 */
 	MeshData(
 			gl::GLenum glRenderMode,
@@ -101,14 +127,23 @@ public:
 			int normalSize, int normalOffset, gl::GLenum normalType,
 			int colourSize, int colourOffset, gl::GLenum colourType,
 			int textureCoordSize, int textureCoordOffset, gl::GLenum textureCoordType,
-			FlexArray<float> combinedData
+			FlexArray<float> combinedData,
+			std::vector<unsigned int> indices = std::vector<unsigned int>()
         );
 	/**
-	 * This calculates every time.
+	 * This is calculated on the first call and kept, as the vertex positions do not change after import.
 	 * @return an AABB that bounds the entire Model. If for some reason there is no vertex
 	 * data the bounding box will simply be the origin.
 	 */
 	AABB getAABB();
+	/**
+	 * Sets the bounds returned by getAABB() for a mesh whose bounds are already known, such as one read from a
+	 * mesh cache.
+	 */
+	void setAABB(const AABB &bounds);
+private:
+	AABB bounds;
+	bool hasBounds;
 };
 
 #endif
@@ -0,0 +1,395 @@
+#include "world/meshoptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+
+// Forsyth's scoring constants, as given in the original article.
+static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+/**
+ * Scores a vertex for the Forsyth optimizer. Vertices that are recently used score high, so triangles that reuse
+ * them are picked next, and vertices with few triangles left score high, so lone triangles aren't left behind to
+ * be drawn with a cold cache later.
+ * @param cachePosition the vertex's position in the simulated LRU cache, or -1 if it isn't cached
+ * @param remainingTriangles the number of triangles using this vertex that haven't been emitted yet
+ */
+static float scoreVertex(int cachePosition, int remainingTriangles)
+{
+	if (remainingTriangles == 0)
+	{
+		return -1.0f;
+	}
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+		{
+			// The vertices of the triangle just drawn get a fixed score so the optimizer doesn't favour
+			// strip-like orders, which reuse only two of them.
+			score = FORSYTH_LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			float scaler = 1.0f / (VERTEX_CACHE_OPTIMIZER_SIZE - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+		}
+	}
+	score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+	return score;
+}
+
+VertexCacheStatistics analyzeVertexCache(const std::vector<unsigned int> &indices, int vertexCount, int cacheSize)
+{
+	// A vertex is in the FIFO if fewer than cacheSize misses have happened since it was last loaded.
+	std::vector<int> loadedAt(vertexCount, -cacheSize - 1);
+	std::vector<bool> used(vertexCount, false);
+	int misses = 0;
+	int uniqueVertices = 0;
+	for (unsigned int index : indices)
+	{
+		if (misses - loadedAt[index] > cacheSize)
+		{
+			loadedAt[index] = misses;
+			misses++;
+		}
+		if (!used[index])
+		{
+			used[index] = true;
+			uniqueVertices++;
+		}
+	}
+	VertexCacheStatistics stats;
+	stats.transformedVertices = misses;
+	stats.acmr = (indices.size() >= 3) ? static_cast<float>(misses) / (indices.size() / 3) : 0.0f;
+	stats.atvr = (uniqueVertices > 0) ? static_cast<float>(misses) / uniqueVertices : 0.0f;
+	return stats;
+}
+
+void optimizeVertexCache(std::vector<unsigned int> &indices, int vertexCount)
+{
+	int triangleCount = static_cast<int>(indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Build the vertex to triangle adjacency. The first remainingTriangles[v] entries of each vertex's range are
+	// the triangles still to be emitted.
+	std::vector<int> remainingTriangles(vertexCount, 0);
+	for (unsigned int index : indices)
+	{
+		remainingTriangles[index]++;
+	}
+	std::vector<int> adjacencyOffset(vertexCount + 1, 0);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + remainingTriangles[v];
+	}
+	std::vector<int> adjacency(indices.size());
+	std::vector<int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (int t = 0; t < triangleCount; t++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			adjacency[fill[indices[t * 3 + c]]++] = t;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		vertexScore[v] = scoreVertex(-1, remainingTriangles[v]);
+	}
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	int bestTriangle = 0;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (triangleScore[t] > triangleScore[bestTriangle])
+		{
+			bestTriangle = t;
+		}
+	}
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> nextCache;
+	cache.reserve(VERTEX_CACHE_OPTIMIZER_SIZE + 3);
+	nextCache.reserve(VERTEX_CACHE_OPTIMIZER_SIZE + 3);
+	int nextUnemitted = 0;
+
+	while (bestTriangle >= 0)
+	{
+		emitted[bestTriangle] = true;
+		const unsigned int *corners = &indices[bestTriangle * 3];
+		nextCache.clear();
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = corners[c];
+			result.push_back(v);
+			nextCache.push_back(v);
+			int begin = adjacencyOffset[v];
+			int end = begin + remainingTriangles[v];
+			for (int k = begin; k < end; k++)
+			{
+				if (adjacency[k] == bestTriangle)
+				{
+					std::swap(adjacency[k], adjacency[end - 1]);
+					break;
+				}
+			}
+			remainingTriangles[v]--;
+		}
+		for (unsigned int v : cache)
+		{
+			if (v != corners[0] && v != corners[1] && v != corners[2])
+			{
+				nextCache.push_back(v);
+			}
+		}
+
+		// Rescore every vertex that was in the cache, including the ones just pushed out of it, then every
+		// triangle that touches one of them. The best of those triangles is drawn next.
+		for (size_t i = 0; i < nextCache.size(); i++)
+		{
+			unsigned int v = nextCache[i];
+			cachePosition[v] = (i < VERTEX_CACHE_OPTIMIZER_SIZE) ? static_cast<int>(i) : -1;
+			vertexScore[v] = scoreVertex(cachePosition[v], remainingTriangles[v]);
+		}
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (unsigned int v : nextCache)
+		{
+			int begin = adjacencyOffset[v];
+			int end = begin + remainingTriangles[v];
+			for (int k = begin; k < end; k++)
+			{
+				int t = adjacency[k];
+				float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				triangleScore[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+		if (nextCache.size() > VERTEX_CACHE_OPTIMIZER_SIZE)
+		{
+			nextCache.resize(VERTEX_CACHE_OPTIMIZER_SIZE);
+		}
+		cache.swap(nextCache);
+
+		// Nothing in the cache has triangles left, so this part of the mesh is done. Carry on from the next
+		// triangle that hasn't been drawn rather than searching the whole mesh for the best score.
+		if (bestTriangle < 0)
+		{
+			while (nextUnemitted < triangleCount && emitted[nextUnemitted])
+			{
+				nextUnemitted++;
+			}
+			bestTriangle = (nextUnemitted < triangleCount) ? nextUnemitted : -1;
+		}
+	}
+	indices.swap(result);
+}
+
+/**
+ * Feeds one triangle through a simulated FIFO cache.
+ * @param loadedAt for each vertex, the value of misses when it was last loaded into the cache
+ * @param misses the running count of cache misses, which is advanced by this call
+ * @return the number of the triangle's vertices that missed the cache
+ */
+static int simulateTriangle(const std::vector<unsigned int> &indices, int triangle, std::vector<int> &loadedAt, int &misses)
+{
+	int triangleMisses = 0;
+	for (int c = 0; c < 3; c++)
+	{
+		unsigned int v = indices[triangle * 3 + c];
+		if (misses - loadedAt[v] > VERTEX_CACHE_SIMULATION_SIZE)
+		{
+			loadedAt[v] = misses;
+			misses++;
+			triangleMisses++;
+		}
+	}
+	return triangleMisses;
+}
+
+/**
+ * A run of consecutive triangles in the index buffer that the overdraw pass moves as one unit.
+ */
+struct OverdrawCluster
+{
+	int firstTriangle;
+	int triangleCount;
+	float sortKey;
+};
+
+void optimizeOverdraw(MeshData &mesh, float threshold)
+{
+	std::vector<unsigned int> &indices = mesh.indices;
+	int triangleCount = static_cast<int>(indices.size() / 3);
+	int vertexCount = mesh.combinedData.size() / mesh.elementsPerRowOfCombinedData;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+	float meshACMR = analyzeVertexCache(indices, vertexCount).acmr;
+
+	// Hard boundaries are where the cache is already completely cold: all three vertices of a triangle miss.
+	std::vector<int> loadedAt(vertexCount, -VERTEX_CACHE_SIMULATION_SIZE - 1);
+	std::vector<bool> hardBoundary(triangleCount, false);
+	int misses = 0;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		hardBoundary[t] = simulateTriangle(indices, t, loadedAt, misses) == 3;
+	}
+
+	// Soft boundaries cut a run once it has paid for its own cold start, that is once its ACMR, simulated from an
+	// empty cache, is back within threshold of the mesh's. Moving such a run costs little vertex reuse.
+	std::vector<OverdrawCluster> clusters;
+	OverdrawCluster current = { 0, 0, 0.0f };
+	int clusterMisses = 0;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		if (current.triangleCount > 0 && hardBoundary[t])
+		{
+			clusters.push_back(current);
+			current.firstTriangle = t;
+			current.triangleCount = 0;
+			clusterMisses = 0;
+		}
+		if (current.triangleCount == 0)
+		{
+			misses += VERTEX_CACHE_SIMULATION_SIZE + 1; // Empties the simulated cache.
+		}
+		clusterMisses += simulateTriangle(indices, t, loadedAt, misses);
+		current.triangleCount++;
+		if (static_cast<float>(clusterMisses) / current.triangleCount <= meshACMR * threshold && t + 1 < triangleCount)
+		{
+			clusters.push_back(current);
+			current.firstTriangle = t + 1;
+			current.triangleCount = 0;
+			clusterMisses = 0;
+		}
+	}
+	if (current.triangleCount > 0)
+	{
+		clusters.push_back(current);
+	}
+	if (clusters.size() < 2)
+	{
+		return;
+	}
+
+	// Area weighted centroid and normal of each cluster, and of the whole mesh.
+	int positionOffset = mesh.vertexOffset / static_cast<int>(sizeof(float));
+	float *data = mesh.combinedData.getRawArray();
+	std::vector<glm::vec3> clusterCentroids(clusters.size());
+	std::vector<glm::vec3> clusterNormals(clusters.size());
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t i = 0; i < clusters.size(); i++)
+	{
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (int t = clusters[i].firstTriangle; t < clusters[i].firstTriangle + clusters[i].triangleCount; t++)
+		{
+			glm::vec3 p[3];
+			for (int c = 0; c < 3; c++)
+			{
+				float *row = data + indices[t * 3 + c] * mesh.elementsPerRowOfCombinedData + positionOffset;
+				p[c] = glm::vec3(row[0], row[1], row[2]);
+			}
+			glm::vec3 cross = glm::cross(p[1] - p[0], p[2] - p[0]);
+			float triangleArea = glm::length(cross) * 0.5f;
+			centroid += (p[0] + p[1] + p[2]) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+		meshCentroid += centroid;
+		meshArea += area;
+		clusterCentroids[i] = (area > 0.0f) ? centroid / area : centroid;
+		clusterNormals[i] = normal;
+	}
+	if (meshArea > 0.0f)
+	{
+		meshCentroid /= meshArea;
+	}
+	for (size_t i = 0; i < clusters.size(); i++)
+	{
+		float normalLength = glm::length(clusterNormals[i]);
+		clusters[i].sortKey = (normalLength > 0.0f) ?
+				glm::dot(clusterCentroids[i] - meshCentroid, clusterNormals[i] / normalLength) : 0.0f;
+	}
+
+	// Clusters that face furthest outward go first.
+	std::stable_sort(clusters.begin(), clusters.end(), [](const OverdrawCluster &a, const OverdrawCluster &b) {
+		return a.sortKey > b.sortKey;
+	});
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (OverdrawCluster &cluster : clusters)
+	{
+		result.insert(result.end(), indices.begin() + cluster.firstTriangle * 3,
+				indices.begin() + (cluster.firstTriangle + cluster.triangleCount) * 3);
+	}
+	indices.swap(result);
+}
+
+void optimizeVertexFetch(MeshData &mesh)
+{
+	int rowSize = mesh.elementsPerRowOfCombinedData;
+	int vertexCount = mesh.combinedData.size() / rowSize;
+	const unsigned int UNASSIGNED = static_cast<unsigned int>(-1);
+	std::vector<unsigned int> remap(vertexCount, UNASSIGNED);
+	unsigned int nextVertex = 0;
+	for (unsigned int &index : mesh.indices)
+	{
+		if (remap[index] == UNASSIGNED)
+		{
+			remap[index] = nextVertex++;
+		}
+		index = remap[index];
+	}
+
+	FlexArray<float> reordered(static_cast<int>(nextVertex) * rowSize);
+	float *source = mesh.combinedData.getRawArray();
+	float *destination = reordered.getRawArray();
+	for (int v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] != UNASSIGNED)
+		{
+			std::copy(source + v * rowSize, source + (v + 1) * rowSize, destination + remap[v] * rowSize);
+		}
+	}
+	mesh.combinedData = reordered;
+}
+
+void optimizeMesh(MeshData &mesh)
+{
+	using namespace gl;
+	if (mesh.indices.empty() || mesh.glRenderMode != GL_TRIANGLES || mesh.vertexPerFace != 3)
+	{
+		return;
+	}
+	int vertexCount = mesh.combinedData.size() / mesh.elementsPerRowOfCombinedData;
+	VertexCacheStatistics before = analyzeVertexCache(mesh.indices, vertexCount);
+	optimizeVertexCache(mesh.indices, vertexCount);
+	optimizeOverdraw(mesh);
+	optimizeVertexFetch(mesh);
+	VertexCacheStatistics after = analyzeVertexCache(mesh.indices, mesh.combinedData.size() / mesh.elementsPerRowOfCombinedData);
+	std::cout << "Optimized mesh >" << mesh.associatedTextureName << "<: " << mesh.indices.size() / 3 << " triangles, "
+			<< "ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
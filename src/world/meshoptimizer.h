@@ -0,0 +1,66 @@
+#ifndef ENG_MESH_OPTIMIZER_H
+#define ENG_MESH_OPTIMIZER_H
+
+#include <vector>
+#include "world/meshdata.h"
+
+/** The size of the FIFO cache used to estimate post-transform cache behaviour when reporting on a mesh. */
+const int VERTEX_CACHE_SIMULATION_SIZE = 16;
+/** The size of the LRU cache the Forsyth optimizer models when scoring triangles. */
+const int VERTEX_CACHE_OPTIMIZER_SIZE = 32;
+/**
+ * How much worse than the mesh's overall ACMR a run of triangles may be and still be cut into its own cluster
+ * by the overdraw pass. Larger values produce more, smaller clusters: better overdraw, worse vertex reuse.
+ */
+const float OVERDRAW_CLUSTER_THRESHOLD = 1.05f;
+
+/**
+ * The result of running an index buffer through a simulated FIFO post-transform vertex cache.
+ */
+struct VertexCacheStatistics
+{
+	/** The number of vertices that missed the cache and had to be transformed. */
+	int transformedVertices;
+	/** Average cache miss ratio: transformed vertices per triangle. 0.5 is ideal, 3 is the worst case. */
+	float acmr;
+	/** Average transform to vertex ratio: transformed vertices per unique vertex. 1 is ideal. */
+	float atvr;
+};
+
+/**
+ * Simulates a FIFO post-transform vertex cache over a triangle list.
+ * @param indices three indices per triangle
+ * @param vertexCount the number of vertices the indices refer to
+ * @param cacheSize the number of entries in the simulated cache
+ */
+VertexCacheStatistics analyzeVertexCache(const std::vector<unsigned int> &indices, int vertexCount,
+		int cacheSize = VERTEX_CACHE_SIMULATION_SIZE);
+/**
+ * Reorders the triangles of a triangle list to improve post-transform vertex cache hits, using Tom Forsyth's
+ * "Linear-Speed Vertex Cache Optimisation" scoring. The set of triangles and their winding are unchanged.
+ * @param indices three indices per triangle, reordered in place
+ * @param vertexCount the number of vertices the indices refer to
+ */
+void optimizeVertexCache(std::vector<unsigned int> &indices, int vertexCount);
+/**
+ * Splits a cache-optimized triangle list into clusters wherever the vertex cache is already cold, then sorts the
+ * clusters so that those facing away from the centre of the mesh are drawn first. This is view-independent: on
+ * average the outward facing parts of a convex-ish mesh occlude the rest, so fewer fragments are shaded twice.
+ * Vertex cache efficiency inside each cluster is preserved.
+ * @param mesh an indexed triangle mesh whose indices should be reordered
+ * @param threshold see OVERDRAW_CLUSTER_THRESHOLD
+ */
+void optimizeOverdraw(MeshData &mesh, float threshold = OVERDRAW_CLUSTER_THRESHOLD);
+/**
+ * Reorders the vertices in combinedData into the order the index buffer first uses them, so vertex fetch walks
+ * memory mostly forwards. Vertices no index refers to are dropped.
+ * @param mesh an indexed mesh whose combinedData and indices are rewritten
+ */
+void optimizeVertexFetch(MeshData &mesh);
+/**
+ * Runs the vertex cache, overdraw, and vertex fetch passes over an indexed triangle mesh and prints the ACMR and
+ * ATVR before and after. Meshes that aren't indexed triangle lists are left alone.
+ */
+void optimizeMesh(MeshData &mesh);
+
+#endif
@@ -0,0 +1,340 @@
+#include "world/meshsimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+#include "world/meshoptimizer.h"
+
+/**
+ * A symmetric 4x4 error quadric, stored as its upper triangle (xx, xy, xz, xw, yy, yz, yw, zz, zw, ww), along
+ * with the total area of the planes summed into it.
+ */
+struct Quadric
+{
+	double a[10];
+	double weight;
+};
+
+static void addPlaneToQuadric(Quadric &q, const glm::dvec3 &normal, double distance, double weight)
+{
+	double plane[4] = { normal.x, normal.y, normal.z, distance };
+	int k = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = i; j < 4; j++)
+		{
+			q.a[k++] += plane[i] * plane[j] * weight;
+		}
+	}
+	q.weight += weight;
+}
+
+static void addQuadric(Quadric &q, const Quadric &other)
+{
+	for (int i = 0; i < 10; i++)
+	{
+		q.a[i] += other.a[i];
+	}
+	q.weight += other.weight;
+}
+
+/**
+ * Gets the area weighted mean squared distance from a point to the planes summed into a pair of quadrics.
+ */
+static double evaluateQuadrics(const Quadric &first, const Quadric &second, const glm::dvec3 &p)
+{
+	double a[10];
+	for (int i = 0; i < 10; i++)
+	{
+		a[i] = first.a[i] + second.a[i];
+	}
+	double error = a[0] * p.x * p.x + 2 * a[1] * p.x * p.y + 2 * a[2] * p.x * p.z + 2 * a[3] * p.x +
+			a[4] * p.y * p.y + 2 * a[5] * p.y * p.z + 2 * a[6] * p.y +
+			a[7] * p.z * p.z + 2 * a[8] * p.z +
+			a[9];
+	double weight = first.weight + second.weight;
+	return (weight > 0.0) ? std::fabs(error) / weight : 0.0;
+}
+
+/**
+ * A candidate edge collapse: vertex from is moved onto vertex to.
+ */
+struct EdgeCollapse
+{
+	unsigned int from;
+	unsigned int to;
+	double cost;
+};
+
+static glm::dvec3 getPosition(MeshData &mesh, unsigned int vertex)
+{
+	const float *row = mesh.combinedData.getRawArray() + vertex * mesh.elementsPerRowOfCombinedData +
+			mesh.vertexOffset / static_cast<int>(sizeof(float));
+	return glm::dvec3(row[0], row[1], row[2]);
+}
+
+/**
+ * Checks whether moving vertex from onto vertex to would turn any remaining triangle around it over.
+ */
+static bool collapseFlipsTriangle(MeshData &mesh, const std::vector<unsigned int> &indices,
+		const std::vector<int> &adjacencyOffset, const std::vector<int> &adjacency, unsigned int from, unsigned int to)
+{
+	glm::dvec3 target = getPosition(mesh, to);
+	for (int k = adjacencyOffset[from]; k < adjacencyOffset[from + 1]; k++)
+	{
+		const unsigned int *corners = &indices[adjacency[k] * 3];
+		if (corners[0] == to || corners[1] == to || corners[2] == to)
+		{
+			continue; // This triangle collapses away.
+		}
+		glm::dvec3 before[3];
+		glm::dvec3 after[3];
+		for (int c = 0; c < 3; c++)
+		{
+			before[c] = getPosition(mesh, corners[c]);
+			after[c] = (corners[c] == from) ? target : before[c];
+		}
+		glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+		glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+		if (glm::dot(normalBefore, normalAfter) <= 0.0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<unsigned int> simplifyMesh(MeshData &mesh, const std::vector<unsigned int> &indices, int targetIndexCount,
+		float maxError, float &resultError)
+{
+	int vertexCount = mesh.combinedData.size() / mesh.elementsPerRowOfCombinedData;
+	std::vector<unsigned int> result(indices);
+	resultError = 0.0f;
+	double maxCost = static_cast<double>(maxError) * maxError;
+
+	// Lock vertices on open or non-manifold edges. Texture and normal seams split a surface into separate index
+	// islands, so this also catches most seams; the position check below catches the rest.
+	std::vector<bool> locked(vertexCount, false);
+	std::map<std::pair<unsigned int, unsigned int>, int> edgeUses;
+	for (size_t t = 0; t + 2 < result.size(); t += 3)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int a = result[t + c];
+			unsigned int b = result[t + (c + 1) % 3];
+			edgeUses[std::make_pair(std::min(a, b), std::max(a, b))]++;
+		}
+	}
+	for (auto &edge : edgeUses)
+	{
+		if (edge.second != 2)
+		{
+			locked[edge.first.first] = true;
+			locked[edge.first.second] = true;
+		}
+	}
+	std::map<std::tuple<float, float, float>, unsigned int> firstAtPosition;
+	for (int v = 0; v < vertexCount; v++)
+	{
+		glm::dvec3 p = getPosition(mesh, v);
+		auto inserted = firstAtPosition.emplace(std::make_tuple(static_cast<float>(p.x), static_cast<float>(p.y),
+				static_cast<float>(p.z)), v);
+		if (!inserted.second)
+		{
+			locked[v] = true;
+			locked[inserted.first->second] = true;
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount, Quadric());
+	for (size_t t = 0; t + 2 < result.size(); t += 3)
+	{
+		glm::dvec3 p0 = getPosition(mesh, result[t]);
+		glm::dvec3 cross = glm::cross(getPosition(mesh, result[t + 1]) - p0, getPosition(mesh, result[t + 2]) - p0);
+		double length = glm::length(cross);
+		if (length <= 0.0)
+		{
+			continue;
+		}
+		glm::dvec3 normal = cross / length;
+		for (int c = 0; c < 3; c++)
+		{
+			addPlaneToQuadric(quadrics[result[t + c]], normal, -glm::dot(normal, p0), length * 0.5);
+		}
+	}
+
+	std::vector<int> adjacencyOffset(vertexCount + 1);
+	std::vector<int> adjacency;
+	std::vector<EdgeCollapse> collapses;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	// Each pass collapses a set of edges that don't share a neighbourhood, cheapest first, then rebuilds the
+	// triangle list. Passes repeat until the target is met or nothing can be collapsed within maxError.
+	while (static_cast<int>(result.size()) > targetIndexCount)
+	{
+		int triangleCount = static_cast<int>(result.size() / 3);
+		std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+		for (unsigned int index : result)
+		{
+			adjacencyOffset[index + 1]++;
+		}
+		for (int v = 0; v < vertexCount; v++)
+		{
+			adjacencyOffset[v + 1] += adjacencyOffset[v];
+		}
+		adjacency.resize(result.size());
+		std::vector<int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (int t = 0; t < triangleCount; t++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				adjacency[fill[result[t * 3 + c]]++] = t;
+			}
+		}
+
+		// Interior edges appear once in each direction, so taking a < b visits each of them once.
+		collapses.clear();
+		for (int t = 0; t < triangleCount; t++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int a = result[t * 3 + c];
+				unsigned int b = result[t * 3 + (c + 1) % 3];
+				if (a >= b || (locked[a] && locked[b]))
+				{
+					continue;
+				}
+				EdgeCollapse collapse;
+				double costAToB = locked[a] ? -1.0 : evaluateQuadrics(quadrics[a], quadrics[b], getPosition(mesh, b));
+				double costBToA = locked[b] ? -1.0 : evaluateQuadrics(quadrics[a], quadrics[b], getPosition(mesh, a));
+				if (costBToA < 0.0 || (costAToB >= 0.0 && costAToB <= costBToA))
+				{
+					collapse.from = a;
+					collapse.to = b;
+					collapse.cost = costAToB;
+				}
+				else
+				{
+					collapse.from = b;
+					collapse.to = a;
+					collapse.cost = costBToA;
+				}
+				if (collapse.cost <= maxCost)
+				{
+					collapses.push_back(collapse);
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse &first, const EdgeCollapse &second) {
+			return first.cost < second.cost;
+		});
+
+		for (int v = 0; v < vertexCount; v++)
+		{
+			remap[v] = v;
+		}
+		std::fill(touched.begin(), touched.end(), false);
+		int targetTriangles = targetIndexCount / 3;
+		int collapseCount = 0;
+		for (EdgeCollapse &collapse : collapses)
+		{
+			if (triangleCount <= targetTriangles)
+			{
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to] ||
+					collapseFlipsTriangle(mesh, result, adjacencyOffset, adjacency, collapse.from, collapse.to))
+			{
+				continue;
+			}
+			// The whole neighbourhood of the moved vertex is frozen for the rest of the pass, so the flip test
+			// above only ever sees triangles that haven't changed yet.
+			for (int k = adjacencyOffset[collapse.from]; k < adjacencyOffset[collapse.from + 1]; k++)
+			{
+				const unsigned int *corners = &result[adjacency[k] * 3];
+				if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+				{
+					triangleCount--;
+				}
+				touched[corners[0]] = true;
+				touched[corners[1]] = true;
+				touched[corners[2]] = true;
+			}
+			remap[collapse.from] = collapse.to;
+			addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			resultError = std::max(resultError, static_cast<float>(std::sqrt(collapse.cost)));
+			collapseCount++;
+		}
+		if (collapseCount == 0)
+		{
+			break;
+		}
+
+		size_t write = 0;
+		for (size_t t = 0; t + 2 < result.size(); t += 3)
+		{
+			unsigned int a = remap[result[t]];
+			unsigned int b = remap[result[t + 1]];
+			unsigned int c = remap[result[t + 2]];
+			if (a != b && b != c && a != c)
+			{
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+		}
+		result.resize(write);
+	}
+	return result;
+}
+
+void generateMeshLODs(MeshData &mesh)
+{
+	using namespace gl;
+	if (mesh.indices.empty() || mesh.glRenderMode != GL_TRIANGLES || mesh.vertexPerFace != 3)
+	{
+		return;
+	}
+	int vertexCount = mesh.combinedData.size() / mesh.elementsPerRowOfCombinedData;
+	double radius = 0.0;
+	for (int v = 0; v < vertexCount; v++)
+	{
+		radius = std::max(radius, glm::length(getPosition(mesh, v)));
+	}
+
+	std::vector<unsigned int> allIndices(mesh.indices);
+	std::vector<unsigned int> previous(mesh.indices);
+	mesh.lods.clear();
+	mesh.lods.push_back({ 0, static_cast<int>(previous.size()), 0.0f });
+	// Each level is simplified from the one before it, so the errors of the levels add up.
+	float totalError = 0.0f;
+	for (int level = 1; level < MAX_MESH_LOD_LEVELS; level++)
+	{
+		int target = static_cast<int>(previous.size() / 3 * MESH_LOD_REDUCTION) * 3;
+		float error = 0.0f;
+		std::vector<unsigned int> lod = simplifyMesh(mesh, previous, target,
+				static_cast<float>(MESH_LOD_MAX_ERROR[level - 1] * radius), error);
+		if (lod.empty() || lod.size() > previous.size() * MESH_LOD_MIN_REDUCTION)
+		{
+			break;
+		}
+		optimizeVertexCache(lod, vertexCount);
+		totalError += error;
+		mesh.lods.push_back({ static_cast<int>(allIndices.size()), static_cast<int>(lod.size()), totalError });
+		allIndices.insert(allIndices.end(), lod.begin(), lod.end());
+		previous.swap(lod);
+	}
+	mesh.indices.swap(allIndices);
+
+	std::cout << "Mesh >" << mesh.associatedTextureName << "< has " << mesh.lods.size() << " levels of detail:";
+	for (MeshLOD &lod : mesh.lods)
+	{
+		std::cout << " " << lod.indexCount / 3;
+	}
+	std::cout << " triangles" << std::endl;
+}
@@ -0,0 +1,38 @@
+#ifndef ENG_MESH_SIMPLIFIER_H
+#define ENG_MESH_SIMPLIFIER_H
+
+#include <vector>
+#include "world/meshdata.h"
+
+/** Each generated level of detail aims for this fraction of the previous level's triangles. */
+const float MESH_LOD_REDUCTION = 0.5f;
+/** A generated level is dropped, and no coarser ones are made, unless it has at most this fraction of the previous level's triangles. */
+const float MESH_LOD_MIN_REDUCTION = 0.8f;
+/**
+ * The largest error each generated level may add, as a fraction of the mesh's bounding radius. Coarser levels are
+ * only drawn smaller on screen, so they are allowed more error.
+ */
+const float MESH_LOD_MAX_ERROR[MAX_MESH_LOD_LEVELS - 1] = { 0.01f, 0.03f, 0.08f };
+
+/**
+ * Simplifies an indexed triangle list with quadric error metric edge collapses. Every collapse moves one vertex
+ * onto the other end of the edge, so the result only refers to vertices already in the mesh and can share its
+ * vertex buffer. Vertices on open borders, and vertices that share their position with another vertex (texture or
+ * normal seams), are never moved so the silhouette and seams don't tear.
+ * @param mesh the mesh whose combinedData supplies the vertex positions
+ * @param indices three indices per triangle to simplify
+ * @param targetIndexCount the number of indices to stop at. Fewer collapses are made if they would exceed maxError
+ * @param maxError the largest distance, in model units, any collapse may move the surface
+ * @param resultError set to the largest error of any collapse that was made
+ * @return the simplified triangle list
+ */
+std::vector<unsigned int> simplifyMesh(MeshData &mesh, const std::vector<unsigned int> &indices, int targetIndexCount,
+		float maxError, float &resultError);
+/**
+ * Builds up to MAX_MESH_LOD_LEVELS - 1 coarser versions of an indexed triangle mesh, appends their indices to
+ * mesh.indices and records every level, including the original, in mesh.lods. Meshes that aren't indexed triangle
+ * lists are left alone.
+ */
+void generateMeshLODs(MeshData &mesh);
+
+#endif
@@ -0,0 +1,309 @@
+///
+/// Checks LightClusterGrid::assignLights(...) against brute force assignments that test every light against every
+/// cluster, with no tile or slice narrowing. A cluster's box is wider than the frustum cell it bounds, so the grid
+/// may leave out clusters that only the box reaches. Each cluster's lights must therefore lie between two brute
+/// force results: those whose sphere reaches a sample point inside the cell, and those whose sphere reaches the
+/// box. It needs no GL context. Build and run it from the repository root with:
+///
+///   g++ -std=c++11 -O2 -Isrc -Ilibraries tests/lightclusterstest.cpp src/render/lightclusters.cpp -o lightclusterstest
+///   ./lightclusterstest
+///
+/// It prints each failure and returns non-zero if there were any.
+///
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+#include "render/lightclusters.h"
+
+static const float FIELD_OF_VIEW = 60.0f;
+static const float ASPECT_RATIO = 16.0f / 9.0f;
+static const float NEAR_DISTANCE = 0.1f;
+static const float FAR_DISTANCE = 500.0f;
+
+static int failures = 0;
+
+static void check(bool condition, const char *what, int detail)
+{
+	if (!condition)
+	{
+		std::cout << "FAILED: " << what << " (" << detail << ")" << std::endl;
+		failures++;
+	}
+}
+
+/**
+ * Cluster bounds in view space, worked out again from the layout documented in render/lightclusters.h.
+ */
+struct ClusterBounds
+{
+	float minX, minY, minZ, maxX, maxY, maxZ;
+	/** The frustum cell itself: its sides as tangents of the view angle, and its depth range. */
+	float left, right, bottom, top, nearDepth, farDepth;
+};
+
+/** Sample points per axis of a cell. */
+static const int CELL_SAMPLES = 5;
+
+static float getSliceDepth(int slice)
+{
+	return NEAR_DISTANCE * std::pow(FAR_DISTANCE / NEAR_DISTANCE, static_cast<float>(slice) / LIGHT_CLUSTERS_Z);
+}
+
+static std::vector<ClusterBounds> buildClusterBounds()
+{
+	float tanHalfHeight = std::tan(FIELD_OF_VIEW * 3.14159265f / 360.0f);
+	float tanHalfWidth = tanHalfHeight * ASPECT_RATIO;
+	std::vector<ClusterBounds> bounds(LIGHT_CLUSTER_COUNT);
+	for (int z = 0; z < LIGHT_CLUSTERS_Z; z++)
+	{
+		float sliceNear = getSliceDepth(z);
+		float sliceFar = getSliceDepth(z + 1);
+		for (int y = 0; y < LIGHT_CLUSTERS_Y; y++)
+		{
+			float bottom = (-1.0f + 2.0f * y / LIGHT_CLUSTERS_Y) * tanHalfHeight;
+			float top = (-1.0f + 2.0f * (y + 1) / LIGHT_CLUSTERS_Y) * tanHalfHeight;
+			for (int x = 0; x < LIGHT_CLUSTERS_X; x++)
+			{
+				float left = (-1.0f + 2.0f * x / LIGHT_CLUSTERS_X) * tanHalfWidth;
+				float right = (-1.0f + 2.0f * (x + 1) / LIGHT_CLUSTERS_X) * tanHalfWidth;
+				ClusterBounds &cluster = bounds[x + LIGHT_CLUSTERS_X * (y + LIGHT_CLUSTERS_Y * z)];
+				cluster.minX = std::min(left * sliceNear, left * sliceFar);
+				cluster.maxX = std::max(right * sliceNear, right * sliceFar);
+				cluster.minY = std::min(bottom * sliceNear, bottom * sliceFar);
+				cluster.maxY = std::max(top * sliceNear, top * sliceFar);
+				cluster.minZ = -sliceFar;
+				cluster.maxZ = -sliceNear;
+				cluster.left = left;
+				cluster.right = right;
+				cluster.bottom = bottom;
+				cluster.top = top;
+				cluster.nearDepth = sliceNear;
+				cluster.farDepth = sliceFar;
+			}
+		}
+	}
+	return bounds;
+}
+
+/**
+ * Tests a sphere against a box the same way the grid does, so the two agree exactly on spheres that only touch.
+ */
+static bool intersects(const ClusterBounds &cluster, const glm::vec4 &center, float radius)
+{
+	float dx = center.x - std::min(std::max(center.x, cluster.minX), cluster.maxX);
+	float dy = center.y - std::min(std::max(center.y, cluster.minY), cluster.maxY);
+	float dz = center.z - std::min(std::max(center.z, cluster.minZ), cluster.maxZ);
+	return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+/**
+ * Checks whether a sphere reaches any of a grid of points inside a frustum cell. The points are kept just inside
+ * the cell, as one exactly on its edge belongs to either neighbour.
+ */
+static bool reachesCell(const ClusterBounds &cluster, const glm::vec4 &center, float radius)
+{
+	const float inset = 1e-3f;
+	for (int i = 0; i < CELL_SAMPLES; i++)
+	{
+		float u = inset + (1.0f - 2.0f * inset) * i / (CELL_SAMPLES - 1);
+		float depth = cluster.nearDepth + (cluster.farDepth - cluster.nearDepth) * u;
+		for (int j = 0; j < CELL_SAMPLES; j++)
+		{
+			float v = inset + (1.0f - 2.0f * inset) * j / (CELL_SAMPLES - 1);
+			float y = (cluster.bottom + (cluster.top - cluster.bottom) * v) * depth;
+			for (int k = 0; k < CELL_SAMPLES; k++)
+			{
+				float w = inset + (1.0f - 2.0f * inset) * k / (CELL_SAMPLES - 1);
+				float x = (cluster.left + (cluster.right - cluster.left) * w) * depth;
+				glm::vec3 offset = glm::vec3(x, y, -depth) - glm::vec3(center);
+				if (glm::dot(offset, offset) <= radius * radius)
+				{
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+/**
+ * The lights that must and may reach each cluster, each in ascending order.
+ */
+struct ExpectedClusters
+{
+	/** The lights reaching a sample point in the cell, which the grid must not miss. */
+	std::vector<std::vector<uint32_t>> required;
+	/** The lights reaching the cell's box, which bound what the grid may assign. */
+	std::vector<std::vector<uint32_t>> allowed;
+};
+
+static ExpectedClusters assignByBruteForce(const std::vector<ClusterBounds> &bounds, const glm::mat4 &view,
+	const std::vector<glm::vec4> &lights)
+{
+	ExpectedClusters expected;
+	expected.required.resize(LIGHT_CLUSTER_COUNT);
+	expected.allowed.resize(LIGHT_CLUSTER_COUNT);
+	for (size_t light = 0; light < lights.size(); light++)
+	{
+		float radius = lights[light].w;
+		if (radius <= 0.0f)
+		{
+			continue;
+		}
+		glm::vec4 center = view * glm::vec4(glm::vec3(lights[light]), 1.0f);
+		for (int cluster = 0; cluster < LIGHT_CLUSTER_COUNT; cluster++)
+		{
+			if (intersects(bounds[cluster], center, radius))
+			{
+				expected.allowed[cluster].push_back(static_cast<uint32_t>(light));
+			}
+			if (reachesCell(bounds[cluster], center, radius))
+			{
+				expected.required[cluster].push_back(static_cast<uint32_t>(light));
+			}
+		}
+	}
+	return expected;
+}
+
+/**
+ * Unpacks the grid's offset and count pairs, checking that they tile the index list with no gaps or overlaps, and
+ * that each cluster's lights are in ascending order and between the two brute force results.
+ */
+static void compare(const LightClusterGrid &grid, const ExpectedClusters &expected, const char *name)
+{
+	const std::vector<uint32_t> &data = grid.getClusterData();
+	size_t indexCount = data.size() - 2 * LIGHT_CLUSTER_COUNT;
+	uint32_t nextOffset = 0;
+	int missing = 0;
+	int extra = 0;
+	for (int cluster = 0; cluster < LIGHT_CLUSTER_COUNT; cluster++)
+	{
+		uint32_t offset = data[2 * cluster];
+		uint32_t count = data[2 * cluster + 1];
+		if (offset != nextOffset || offset + count > indexCount)
+		{
+			check(false, "offsets are packed in cluster order", cluster);
+			return;
+		}
+		nextOffset = offset + count;
+		std::vector<uint32_t> lights(data.begin() + 2 * LIGHT_CLUSTER_COUNT + offset,
+			data.begin() + 2 * LIGHT_CLUSTER_COUNT + offset + count);
+		check(std::adjacent_find(lights.begin(), lights.end(), std::greater_equal<uint32_t>()) == lights.end(),
+			"a cluster's lights are ascending and unique", cluster);
+		const std::vector<uint32_t> &required = expected.required[cluster];
+		const std::vector<uint32_t> &allowed = expected.allowed[cluster];
+		if (!std::includes(lights.begin(), lights.end(), required.begin(), required.end()))
+		{
+			missing++;
+		}
+		if (!std::includes(allowed.begin(), allowed.end(), lights.begin(), lights.end()))
+		{
+			extra++;
+		}
+	}
+	check(nextOffset == indexCount, "every index belongs to a cluster", static_cast<int>(indexCount));
+	if (missing > 0)
+	{
+		std::cout << name << ": ";
+		check(false, "no cluster misses a light that reaches it", missing);
+	}
+	if (extra > 0)
+	{
+		std::cout << name << ": ";
+		check(false, "no cluster holds a light that misses its box", extra);
+	}
+}
+
+static glm::mat4 createView(const glm::vec3 &eye, const glm::vec3 &target)
+{
+	return glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+/**
+ * Lights whose leftmost tile is not a multiple of 4 make assignLights(...) widen its search to the whole group of
+ * four. The clusters this adds to the search must still be rejected unless the sphere reaches their boxes.
+ */
+static void testWidenedTileRange(LightClusterGrid &grid, const std::vector<ClusterBounds> &bounds)
+{
+	glm::mat4 view(1.0f);
+	float tanHalfWidth = std::tan(FIELD_OF_VIEW * 3.14159265f / 360.0f) * ASPECT_RATIO;
+	std::vector<glm::vec4> lights;
+	for (int tile = 0; tile < LIGHT_CLUSTERS_X; tile++)
+	{
+		// A small light in the middle of each column of tiles, 20 units away.
+		float screenX = -1.0f + (2.0f * tile + 1.0f) / LIGHT_CLUSTERS_X;
+		lights.push_back(glm::vec4(screenX * tanHalfWidth * 20.0f, 0.0f, -20.0f, 0.3f));
+	}
+	grid.assignLights(view, lights.data(), static_cast<int>(lights.size()));
+	compare(grid, assignByBruteForce(bounds, view, lights), "widened tile range");
+}
+
+static void testRandomScenes(LightClusterGrid &grid, const std::vector<ClusterBounds> &bounds)
+{
+	std::mt19937 random(2053);
+	std::uniform_real_distribution<float> position(-150.0f, 150.0f);
+	std::uniform_real_distribution<float> radius(-2.0f, 40.0f);
+	for (int scene = 0; scene < 50; scene++)
+	{
+		glm::mat4 view = createView(glm::vec3(position(random), position(random) * 0.1f, position(random)),
+			glm::vec3(position(random), 0.0f, position(random)));
+		std::vector<glm::vec4> lights(1 + scene * 2);
+		for (glm::vec4 &light : lights)
+		{
+			// Some lights have no radius, and some are behind the camera or past the far plane.
+			light = glm::vec4(position(random), position(random) * 0.2f, position(random), radius(random));
+		}
+		grid.assignLights(view, lights.data(), static_cast<int>(lights.size()));
+		compare(grid, assignByBruteForce(bounds, view, lights), "random scene");
+	}
+}
+
+static void testNoLights(LightClusterGrid &grid)
+{
+	grid.assignLights(glm::mat4(1.0f), nullptr, 0);
+	const std::vector<uint32_t> &data = grid.getClusterData();
+	check(data.size() == 2 * static_cast<size_t>(LIGHT_CLUSTER_COUNT), "no lights leaves no indices",
+		static_cast<int>(data.size()));
+	check(std::count(data.begin(), data.end(), 0u) == static_cast<long>(data.size()), "no lights leaves zero counts",
+		0);
+}
+
+/**
+ * The slice a fragment looks up from its depth, as in res/lighting.glsl, must be the slice whose bounds hold it.
+ */
+static void testSliceLookup(const LightClusterGrid &grid, const std::vector<ClusterBounds> &bounds)
+{
+	glm::vec4 scaleAndBias = grid.getSliceScaleAndBias();
+	for (int z = 0; z < LIGHT_CLUSTERS_Z; z++)
+	{
+		const ClusterBounds &cluster = bounds[LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * z];
+		float depth = std::sqrt(-cluster.minZ * -cluster.maxZ);
+		int slice = static_cast<int>(std::floor(std::log(depth) * scaleAndBias.x + scaleAndBias.y));
+		check(slice == z, "slice lookup finds the slice holding a depth", z);
+	}
+}
+
+int main()
+{
+	LightClusterGrid grid;
+	grid.setProjection(FIELD_OF_VIEW, ASPECT_RATIO, NEAR_DISTANCE, FAR_DISTANCE);
+	std::vector<ClusterBounds> bounds = buildClusterBounds();
+	testNoLights(grid);
+	testWidenedTileRange(grid, bounds);
+	testRandomScenes(grid, bounds);
+	testSliceLookup(grid, bounds);
+	if (failures > 0)
+	{
+		std::cout << failures << " checks failed." << std::endl;
+		return 1;
+	}
+	std::cout << "All light cluster checks passed." << std::endl;
+	return 0;
+}